@@ -95,6 +95,7 @@ static void usage()
 			"         \tscripts/mmiotrace/mmt-app-demmt-mmiotrace.sh)\n"
 			"  -x 0/1/2\tdisable/enable loose/enable strict sandboxing (default: 2\n"
 			"          \tif libseccomp is available)\n"
+			"  -M file\trecord macro uploads and calls to \"file\" (for macrobench)\n"
 			"\n"
 			"  -d msg_type1[,msg_type2[,msg_type3....]] - disable messages\n"
 			"  -e msg_type1[,msg_type2[,msg_type3....]] - enable messages\n"
@@ -445,7 +446,7 @@ char *read_opts(int argc, char *argv[])
 		colors = &envy_null_colors;
 
 	int c;
-	while ((c = getopt (argc, argv, "m:o:g:qac:l:i:r:he:d:p:s:x:")) != -1)
+	while ((c = getopt (argc, argv, "m:o:g:qac:l:i:r:he:d:p:s:x:M:")) != -1)
 	{
 		switch (c)
 		{
@@ -577,6 +578,14 @@ char *read_opts(int argc, char *argv[])
 			case 's':
 				mmt_sync_fd = open(optarg, O_WRONLY);
 				break;
+			case 'M':
+				macro_record = fopen(optarg, "w");
+				if (!macro_record)
+				{
+					perror(optarg);
+					exit(1);
+				}
+				break;
 		}
 	}
 
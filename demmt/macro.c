@@ -35,6 +35,7 @@
 int macro_rt_verbose = 0;
 int macro_rt = 1;
 int macro_dis_enabled = 1;
+FILE *macro_record;
 
 #if 0
 static void unsupp(const char *str)
@@ -738,7 +739,19 @@ static void print_aligned(char *str)
 	mmt_printf("%s", str);
 }
 
-#define MAX_BACK_JUMPS 100
+static void macro_print_oops(uint32_t c)
+{
+	char pfx[100];
+
+	sprintf(pfx, "MC: 0x%08x   ", c);
+	if (c & 0x80)
+		strcat(pfx, mcr_exit);
+	macro_dis_dst(outs, c);
+	sprintf(outs2, "%s%s ???", pfx, outs);
+
+	print_aligned(outs2);
+	mmt_printf(" | ???, aborting%s\n", "");
+}
 
 static void macro_sim(struct macro_interpreter_state *istate)
 {
@@ -1261,14 +1274,7 @@ static void macro_sim(struct macro_interpreter_state *istate)
 		else
 		{
 			// { 0, 0, T(dst), OOPS, REG2 }
-			macro_dis_dst(outs, c);
-			sprintf(outs2, "%s%s ???", pfx, outs);
-
-			if (macro_rt_verbose || 1)
-			{
-				print_aligned(outs2);
-				mmt_printf(" | ???, aborting%s\n", "");
-			}
+			macro_print_oops(c);
 			++istate->pc;
 			istate->aborted = 1;
 		}
@@ -1287,6 +1293,36 @@ static void macro_sim(struct macro_interpreter_state *istate)
 	}
 }
 
+static void macro_send(struct macro_interpreter_state *istate, uint32_t data)
+{
+	decode_method_raw(istate->mthd, data, istate->obj, dec_obj, dec_mthd, dec_val);
+	register_method_call(istate, data);
+}
+
+static void macro_run(struct macro_interpreter_state *istate)
+{
+	if (macro_rt_verbose)
+	{
+		macro_sim(istate);
+		return;
+	}
+
+	init_macrodis();
+
+	switch (macro_exec(istate))
+	{
+		case MACRO_EXEC_OOPS:
+			macro_print_oops(istate->code[istate->lastpc]);
+			break;
+		case MACRO_EXEC_LOOP:
+			mmt_error("more than %d backward jumps, aborting macro simulation\n", MAX_BACK_JUMPS);
+			break;
+		case MACRO_EXEC_RANGE:
+			mmt_error("macro ran past the end of code memory, aborting macro simulation%s\n", "");
+			break;
+	}
+}
+
 int decode_macro(struct pushbuf_decode_state *pstate, struct macro_state *macro)
 {
 	int mthd = pstate->mthd;
@@ -1295,17 +1331,26 @@ int decode_macro(struct pushbuf_decode_state *pstate, struct macro_state *macro)
 	if (mthd == 0x0114) // GRAPH.MACRO_CODE_POS
 	{
 		if (macro->code == NULL)
-			macro->code = calloc(0x2000, 1);
+		{
+			int i;
+			macro->code = calloc(MACRO_CODE_WORDS, 4);
+			macro->uops = malloc(MACRO_CODE_WORDS * sizeof(*macro->uops));
+			for (i = 0; i < MACRO_CODE_WORDS; ++i)
+				macro_predecode(&macro->uops[i], 0);
+		}
 		macro->last_code_pos = data * 4;
 		macro->cur_code_pos = data * 4;
 	}
 	else if (mthd == 0x0118) // GRAPH.MACRO_CODE_DATA
 	{
-		if (macro->cur_code_pos >= 0x2000)
+		if (macro->cur_code_pos >= MACRO_CODE_WORDS * 4)
 			mmt_log("not enough space for more macro code, truncating%s\n", "");
 		else
 		{
+			if (macro_record)
+				fprintf(macro_record, "code 0x%x 0x%08x\n", macro->cur_code_pos / 4, data);
 			macro->code[macro->cur_code_pos / 4] = data;
+			macro_predecode(&macro->uops[macro->cur_code_pos / 4], data);
 			macro->cur_code_pos += 4;
 			if (pstate->size == 0)
 			{
@@ -1345,6 +1390,8 @@ int decode_macro(struct pushbuf_decode_state *pstate, struct macro_state *macro)
 		else
 		{
 			macro->entries[macro->last_entry_pos].start = data * 4;
+			if (macro_record)
+				fprintf(macro_record, "entry 0x%x 0x%x\n", macro->last_entry_pos, data);
 			mmt_debug("binding entry at 0x%x to position 0x%x\n", data,
 					macro->last_entry_pos);
 		}
@@ -1360,11 +1407,20 @@ int decode_macro(struct pushbuf_decode_state *pstate, struct macro_state *macro)
 		{
 			mmt_debug("MACRO[0x%x]: 0x%x\n", macro_idx, data);
 
+			uint32_t start = macro->entries[macro_idx].start / 4;
+
+			if (macro_record)
+				fprintf(macro_record, "call 0x%x 0x%x\n", macro_idx, data);
+
 			memset(&macro->istate, 0, sizeof(macro->istate));
 			macro->istate.regs[1] = data;
 			macro->istate.obj = current_subchan_object(pstate);
-			macro->istate.code = macro->code + macro->entries[macro_idx].start / 4;
+			macro->istate.code = macro->code + start;
 			macro->istate.words = macro->entries[macro_idx].words;
+			macro->istate.uops = macro->uops + start;
+			if (macro->uops && start < MACRO_CODE_WORDS)
+				macro->istate.limit = MACRO_CODE_WORDS - start;
+			macro->istate.send = macro_send;
 			macro->istate.delayed_pc = 0xffffffff;
 			macro->istate.exit_when_0 = 0xffffffff;
 			macro->istate.device = pstate->fifo;
@@ -1382,15 +1438,17 @@ int decode_macro(struct pushbuf_decode_state *pstate, struct macro_state *macro)
 			}
 
 			if (macro_rt)
-				macro_sim(&macro->istate);
+				macro_run(&macro->istate);
 		}
 		else
 		{
 			mmt_debug("MACRO_PARAM[0x%x]: 0x%x\n", macro_idx, data);
+			if (macro_record)
+				fprintf(macro_record, "parm 0x%x\n", data);
 			if (macro_rt)
 			{
 				macro->istate.macro_param = &data;
-				macro_sim(&macro->istate);
+				macro_run(&macro->istate);
 				macro->istate.macro_param = NULL;
 			}
 		}
@@ -2,15 +2,67 @@
 #define DEMMT_MACRO_H
 
 #include <stdint.h>
+#include <stdio.h>
 #include "pushbuf.h"
 
 struct buffer;
 
+enum macro_uop_op
+{
+	MOP_ADD,
+	MOP_ADC,
+	MOP_SUB,
+	MOP_SBB,
+	MOP_XOR,
+	MOP_OR,
+	MOP_AND,
+	MOP_ANDN,
+	MOP_NAND,
+	MOP_NOP,
+	MOP_PARM,
+	MOP_IMM,
+	MOP_ADDI,
+	MOP_EXTRINSRT,
+	MOP_EXTRSHL_R,
+	MOP_EXTRSHL_I,
+	MOP_READI,
+	MOP_READ,
+	MOP_BRA,
+	MOP_BRAZ,
+	MOP_BRANZ,
+	MOP_OOPS,
+};
+
+/* one macro instruction, decoded once at upload */
+struct macro_uop
+{
+	uint8_t op;
+	uint8_t dst;
+	uint8_t r1, r2, r3;
+	uint8_t exit;
+	uint8_t annul;
+	uint8_t srcpos, dstpos;
+	int32_t imm;
+	uint32_t mask1, mask2;
+};
+
+enum macro_exec_res
+{
+	MACRO_EXEC_OK,
+	MACRO_EXEC_OOPS,
+	MACRO_EXEC_LOOP,
+	MACRO_EXEC_RANGE,
+};
+
 struct macro_interpreter_state
 {
 	uint32_t *code;
 	uint32_t words;
 
+	const struct macro_uop *uops;
+	uint32_t limit;
+	void (*send)(struct macro_interpreter_state *istate, uint32_t data);
+
 	uint32_t pc;
 	uint32_t regs[8];
 	uint32_t mthd;
@@ -33,6 +85,7 @@ struct macro_interpreter_state
 struct macro_state
 {
 	uint32_t *code;
+	struct macro_uop *uops;
 	uint32_t last_code_pos;
 	uint32_t cur_code_pos;
 	uint32_t last_entry_pos;
@@ -46,11 +99,18 @@ struct macro_state
 	struct macro_interpreter_state istate;
 };
 
+#define MACRO_CODE_WORDS 0x800
+#define MAX_BACK_JUMPS 100
+
+void macro_predecode(struct macro_uop *uop, uint32_t c);
+int macro_exec(struct macro_interpreter_state *istate);
+
 int decode_macro(struct pushbuf_decode_state *pstate, struct macro_state *macro);
 
 extern int macro_rt_verbose;
 extern int macro_rt;
 extern int macro_dis_enabled;
+extern FILE *macro_record;
 
 void fini_macrodis();
 #endif
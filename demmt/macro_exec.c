@@ -0,0 +1,317 @@
+/*
+ * Copyright (C) 2014 Marcin Ślusarz <marcin.slusarz@gmail.com>.
+ * Copyright (C) 2010-2011 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "macro.h"
+
+/*
+ * Fast path of the macro interpreter: works on instructions predecoded at
+ * upload time and does no formatting.  Must behave exactly like macro_sim
+ * in macro.c, which is still used when macro_rt_verbose is set.
+ */
+
+void macro_predecode(struct macro_uop *u, uint32_t c)
+{
+	uint32_t sz = (c >> 22) & 0x1f;
+
+	u->dst = (c >> 4) & 0x7;
+	u->r1 = (c >> 8) & 0x7;
+	u->r2 = (c >> 11) & 0x7;
+	u->r3 = (c >> 14) & 0x7;
+	u->exit = !!(c & 0x80);
+	u->annul = !!(c & 0x20);
+	u->srcpos = (c >> 17) & 0x1f;
+	u->dstpos = (c >> 27) & 0x1f;
+	u->imm = ((int)c) >> 14;
+	u->mask1 = 0;
+	u->mask2 = 0;
+
+	if ((c & 0x00000007) == 0x00000000)
+	{
+		switch ((c >> 17) & 0x1f)
+		{
+			case 0x00: u->op = MOP_ADD; break;
+			case 0x01: u->op = MOP_ADC; break;
+			case 0x02: u->op = MOP_SUB; break;
+			case 0x03: u->op = MOP_SBB; break;
+			case 0x08: u->op = MOP_XOR; break;
+			case 0x09: u->op = MOP_OR; break;
+			case 0x0a: u->op = MOP_AND; break;
+			case 0x0b: u->op = MOP_ANDN; break;
+			case 0x0c: u->op = MOP_NAND; break;
+			default: u->op = MOP_OOPS; break;
+		}
+	}
+	else if (c == 0x00000011 || c == 0x00000091)
+		u->op = MOP_NOP;
+	else if ((c & 0xfffff87f) == 0x00000001)
+		u->op = MOP_PARM;
+	else if ((c & 0x00003807) == 0x00000001)
+		u->op = MOP_IMM;
+	else if ((c & 0x00000007) == 0x00000001)
+		u->op = MOP_ADDI;
+	else if ((c & 0x00000007) == 0x00000002)
+	{
+		u->op = MOP_EXTRINSRT;
+		u->mask1 = ((1 << (sz + 1)) - 1) << u->dstpos;
+		u->mask2 = ((1 << (sz + 1)) - 1) << u->srcpos;
+	}
+	else if ((c & 0x00000007) == 0x00000003)
+	{
+		u->op = MOP_EXTRSHL_R;
+		u->mask1 = ((1 << (sz + 1)) - 1);
+	}
+	else if ((c & 0x00000007) == 0x00000004)
+	{
+		u->op = MOP_EXTRSHL_I;
+		u->mask1 = ((1 << (sz + 1)) - 1) << u->srcpos;
+	}
+	else if ((c & 0x00003877) == 0x00000015)
+		u->op = MOP_READI;
+	else if ((c & 0x00000077) == 0x00000015)
+		u->op = MOP_READ;
+	else if ((c & 0x00003817) == 0x00000007)
+		u->op = MOP_BRA;
+	else if ((c & 0x00000017) == 0x00000007)
+		u->op = MOP_BRAZ;
+	else if ((c & 0x00000017) == 0x00000017)
+		u->op = MOP_BRANZ;
+	else
+		u->op = MOP_OOPS;
+}
+
+static inline void set_maddr(struct macro_interpreter_state *istate, uint32_t res)
+{
+	istate->mthd = (res & 0xfff) << 2;
+	istate->incr = (res >> 12) & 0x3f;
+}
+
+/* returns 1 if the instruction needs a parameter that's not there yet */
+static int exec_dst(struct macro_interpreter_state *istate,
+		const struct macro_uop *u, uint32_t res)
+{
+	uint32_t *regs = istate->regs;
+	const uint32_t *param = istate->macro_param;
+
+	switch (u->dst)
+	{
+		case 0: // parm REG1 ign
+			if (!param)
+				return 1;
+			regs[u->r1] = *param;
+			istate->macro_param = NULL;
+			break;
+		case 1: // mov REG1
+			regs[u->r1] = res;
+			break;
+		case 2: // maddr [REG1]
+			set_maddr(istate, res);
+			if (u->r1)
+				regs[u->r1] = res;
+			break;
+		case 3: // parm REG1 send
+			if (!param)
+				return 1;
+			istate->send(istate, res);
+			istate->mthd += istate->incr * 4;
+			regs[u->r1] = *param;
+			istate->macro_param = NULL;
+			break;
+		case 4: // send [REG1]
+			istate->send(istate, res);
+			istate->mthd += istate->incr * 4;
+			if (u->r1)
+				regs[u->r1] = res;
+			break;
+		case 5: // parm REG1 maddr
+			if (!param)
+				return 1;
+			set_maddr(istate, res);
+			regs[u->r1] = *param;
+			istate->macro_param = NULL;
+			break;
+		case 6: // parmsend maddr [REG1]
+			if (!param)
+				return 1;
+			set_maddr(istate, res);
+			istate->send(istate, *param);
+			istate->mthd += istate->incr * 4;
+			if (u->r1)
+				regs[u->r1] = res;
+			istate->macro_param = NULL;
+			break;
+		case 7: // maddrsend [REG1]
+			istate->mthd = (res & 0xfff) << 2;
+			istate->send(istate, (res >> 12) & 0x3f);
+			if (u->r1)
+				regs[u->r1] = res;
+			istate->mthd += istate->incr * 4;
+			break;
+	}
+	return 0;
+}
+
+int macro_exec(struct macro_interpreter_state *istate)
+{
+	uint32_t *regs = istate->regs;
+	int ret = MACRO_EXEC_OK;
+
+	while (!istate->aborted)
+	{
+		const struct macro_uop *u;
+		uint32_t res, mthd;
+		int taken;
+
+		if (istate->pc >= istate->limit)
+		{
+			istate->aborted = 1;
+			return MACRO_EXEC_RANGE;
+		}
+		u = &istate->uops[istate->pc];
+
+		if (u->exit)
+			istate->exit_when_0 = 2;
+
+		if (istate->pc < istate->lastpc && istate->backward_jumps++ > MAX_BACK_JUMPS)
+		{
+			istate->aborted = 1;
+			return MACRO_EXEC_LOOP;
+		}
+		istate->lastpc = istate->pc;
+
+		switch (u->op)
+		{
+			case MOP_ADD:
+			case MOP_ADC: // TODO: carry flag
+				res = regs[u->r2] + regs[u->r3];
+				break;
+			case MOP_SUB:
+			case MOP_SBB: // TODO: carry flag
+				res = regs[u->r2] - regs[u->r3];
+				break;
+			case MOP_XOR:
+				res = regs[u->r2] ^ regs[u->r3];
+				break;
+			case MOP_OR:
+				res = regs[u->r2] | regs[u->r3];
+				break;
+			case MOP_AND:
+				res = regs[u->r2] & regs[u->r3];
+				break;
+			case MOP_ANDN:
+				res = regs[u->r2] & ~regs[u->r3];
+				break;
+			case MOP_NAND:
+				res = ~(regs[u->r2] & regs[u->r3]);
+				break;
+			case MOP_IMM:
+				res = u->imm;
+				break;
+			case MOP_ADDI:
+				res = regs[u->r2] + u->imm;
+				break;
+			case MOP_EXTRINSRT:
+				res = (regs[u->r2] & ~u->mask1) |
+					(((regs[u->r3] & u->mask2) >> u->srcpos) << u->dstpos);
+				break;
+			case MOP_EXTRSHL_R:
+			{
+				uint32_t v2 = regs[u->r2];
+				res = ((regs[u->r3] & (u->mask1 << v2)) >> v2) << u->dstpos;
+				break;
+			}
+			case MOP_EXTRSHL_I:
+				res = ((regs[u->r3] & u->mask1) >> u->srcpos) << regs[u->r2];
+				break;
+
+			case MOP_NOP:
+				++istate->pc;
+				goto next;
+			case MOP_PARM:
+				if (!istate->macro_param)
+					return ret;
+				regs[u->r1] = *istate->macro_param;
+				istate->macro_param = NULL;
+				++istate->pc;
+				goto next;
+			case MOP_READI:
+			case MOP_READ:
+				mthd = u->imm;
+				if (u->op == MOP_READ)
+					mthd += regs[u->r2];
+				mthd = (mthd & 0xfff) << 2;
+				regs[u->r1] = istate->obj->data[mthd / 4];
+				++istate->pc;
+				goto next;
+			case MOP_BRA:
+			case MOP_BRAZ:
+			case MOP_BRANZ:
+				if (u->op == MOP_BRA)
+					taken = 1;
+				else if (u->op == MOP_BRAZ)
+					taken = regs[u->r2] == 0;
+				else
+					taken = regs[u->r2] != 0;
+				if (!taken)
+				{
+					++istate->pc;
+					if (u->exit) // exit cancelled
+						istate->exit_when_0 = 0xffffffff;
+				}
+				else if (u->annul)
+					istate->pc += u->imm;
+				else
+				{
+					istate->delayed_pc = istate->pc + u->imm;
+					++istate->pc;
+					continue;
+				}
+				goto next;
+			default:
+				++istate->pc;
+				istate->aborted = 1;
+				ret = MACRO_EXEC_OOPS;
+				goto next;
+		}
+
+		if (exec_dst(istate, u, res))
+			return ret;
+		++istate->pc;
+
+next:
+		if (istate->delayed_pc != 0xffffffff)
+		{
+			istate->pc = istate->delayed_pc;
+			istate->delayed_pc = 0xffffffff;
+		}
+
+		if (istate->exit_when_0 != 0xffffffff)
+		{
+			if (--istate->exit_when_0 == 0)
+				break;
+		}
+	}
+
+	return ret;
+}
@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2014 Marcin Ślusarz <marcin.slusarz@gmail.com>.
+ * Copyright (C) 2010-2011 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "macro.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Replays macro uploads and calls recorded by demmt -M through the
+ * predecoded macro engine and reports its speed.  Method reads see only
+ * what the replayed macros themselves sent.
+ */
+
+enum ev_type
+{
+	EV_CODE,
+	EV_ENTRY,
+	EV_CALL,
+	EV_PARM,
+};
+
+struct event
+{
+	int type;
+	uint32_t a, b;
+};
+
+static uint32_t sends, sendsum;
+
+static void bench_send(struct macro_interpreter_state *istate, uint32_t data)
+{
+	if (istate->mthd < OBJECT_SIZE)
+		istate->obj->data[istate->mthd / 4] = data;
+	sends++;
+	sendsum = (sendsum * 31) ^ istate->mthd ^ (data << 16);
+}
+
+static void usage()
+{
+	fprintf(stderr, "Usage: macrobench [-n repeats] file\n"
+			"Replays macro calls recorded by demmt -M.\n");
+	exit(1);
+}
+
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv)
+{
+	int repeats = 100;
+	int c;
+
+	while ((c = getopt(argc, argv, "n:")) != -1)
+	{
+		switch (c)
+		{
+			case 'n':
+				repeats = strtoul(optarg, NULL, 0);
+				break;
+			default:
+				usage();
+		}
+	}
+	if (optind + 1 != argc)
+		usage();
+
+	FILE *f = fopen(argv[optind], "r");
+	if (!f)
+	{
+		perror(argv[optind]);
+		return 1;
+	}
+
+	struct event *evs = NULL;
+	int nevs = 0, maxevs = 0, ncalls = 0, nparms = 0;
+	char type[16];
+	uint32_t a, b;
+	while ((c = fscanf(f, "%15s %i", type, &a)) == 2)
+	{
+		struct event ev = { 0, a, 0 };
+		if (strcmp(type, "code") == 0 && fscanf(f, "%i", &b) == 1)
+			ev.type = EV_CODE;
+		else if (strcmp(type, "entry") == 0 && fscanf(f, "%i", &b) == 1)
+			ev.type = EV_ENTRY;
+		else if (strcmp(type, "call") == 0 && fscanf(f, "%i", &b) == 1)
+			ev.type = EV_CALL, ncalls++;
+		else if (strcmp(type, "parm") == 0)
+			ev.type = EV_PARM, nparms++, b = a;
+		else
+		{
+			fprintf(stderr, "bad record \"%s\"\n", type);
+			return 1;
+		}
+		ev.b = b;
+		if ((ev.type == EV_CODE && a >= MACRO_CODE_WORDS) || (ev.type != EV_CODE && ev.type != EV_PARM && a >= 0x80))
+		{
+			fprintf(stderr, "%s index 0x%x out of range\n", type, a);
+			return 1;
+		}
+		if (nevs == maxevs)
+		{
+			maxevs = maxevs ? maxevs * 2 : 1024;
+			evs = realloc(evs, maxevs * sizeof *evs);
+		}
+		evs[nevs++] = ev;
+	}
+	fclose(f);
+
+	uint32_t *code = calloc(MACRO_CODE_WORDS, 4);
+	struct macro_uop *uops = malloc(MACRO_CODE_WORDS * sizeof *uops);
+	uint32_t entries[0x80] = { 0 };
+	struct obj obj;
+	struct macro_interpreter_state istate;
+	int aborts = 0, r, i;
+
+	memset(&istate, 0, sizeof istate);
+	istate.aborted = 1;
+	memset(&obj, 0, sizeof obj);
+	obj.data = calloc(OBJECT_SIZE, 1);
+	for (i = 0; i < MACRO_CODE_WORDS; ++i)
+		macro_predecode(&uops[i], 0);
+
+	double t = now();
+	for (r = 0; r < repeats; ++r)
+	{
+		sends = sendsum = 0;
+		for (i = 0; i < nevs; ++i)
+		{
+			struct event *ev = &evs[i];
+			switch (ev->type)
+			{
+				case EV_CODE:
+					code[ev->a] = ev->b;
+					macro_predecode(&uops[ev->a], ev->b);
+					break;
+				case EV_ENTRY:
+					entries[ev->a] = ev->b;
+					break;
+				case EV_CALL:
+					memset(&istate, 0, sizeof istate);
+					istate.regs[1] = ev->b;
+					istate.obj = &obj;
+					istate.code = code + entries[ev->a];
+					istate.uops = uops + entries[ev->a];
+					if (entries[ev->a] < MACRO_CODE_WORDS)
+						istate.limit = MACRO_CODE_WORDS - entries[ev->a];
+					istate.send = bench_send;
+					istate.delayed_pc = 0xffffffff;
+					istate.exit_when_0 = 0xffffffff;
+					if (macro_exec(&istate) != MACRO_EXEC_OK && !r)
+						aborts++;
+					break;
+				case EV_PARM:
+					istate.macro_param = &ev->b;
+					if (macro_exec(&istate) != MACRO_EXEC_OK && !r)
+						aborts++;
+					istate.macro_param = NULL;
+					break;
+			}
+		}
+	}
+	t = now() - t;
+
+	printf("%d calls, %d params, %u sends (sum %08x), %d aborted\n",
+			ncalls, nparms, sends, sendsum, aborts);
+	if (repeats && ncalls)
+		printf("%d repeats: %.3f s, %.1f ns/call\n", repeats, t,
+				t * 1e9 / ((double)repeats * ncalls));
+
+	free(evs);
+	free(code);
+	free(uops);
+	free(obj.data);
+	return 0;
+}
@@ -672,6 +672,14 @@ int main(int argc, char *argv[])
 			exit(1);
 		seccomp_syscall_priority(ctx, SCMP_SYS(write), 255);
 
+		if (macro_record)
+		{
+			rc = seccomp_rule_add_exact(ctx, SCMP_ACT_ALLOW, SCMP_SYS(write), 1,
+					SCMP_A0(SCMP_CMP_EQ, fileno(macro_record)));
+			if (rc != 0)
+				exit(1);
+		}
+
 		rc = seccomp_rule_add_exact(ctx, SCMP_ACT_ALLOW, SCMP_SYS(rt_sigreturn), 0);
 		if (rc != 0)
 			exit(1);
@@ -722,6 +730,8 @@ int main(int argc, char *argv[])
 	fflush(stdout);
 
 	fini_macrodis();
+	if (macro_record)
+		fflush(macro_record);
 	demmt_cleanup_isas();
 	rnndec_freecontext(gf100_shaders_ctx);
 	rnn_freedb(rnndb);
@@ -119,6 +119,7 @@ static void destroy_gf100_3d_data(struct gpu_object *obj)
 	struct gf100_3d_data *d = obj->class_data;
 	rnndec_freecontext(d->texture_ctx);
 	free(d->macro.code);
+	free(d->macro.uops);
 	free(d->addresses);
 	free(d);
 }
@@ -24,6 +24,7 @@
 
 #include "easm.h"
 #include <stdlib.h>
+#include <string.h>
 
 struct easm_expr *easm_expr_bin(enum easm_expr_type type, struct easm_expr *e1, struct easm_expr *e2) {
 	struct easm_expr *res = calloc(sizeof *res, 1);
@@ -110,6 +111,7 @@ void easm_del_expr(struct easm_expr *expr) {
 	easm_del_expr(expr->e2);
 	free(expr->astr.str);
 	free(expr->str);
+	free(expr->alabel);
 	easm_del_sinsn(expr->sinsn);
 	easm_del_mods(expr->mods);
 	free(expr);
@@ -172,6 +174,117 @@ void easm_del_file(struct easm_file *file) {
 	free(file);
 }
 
+static char *easm_copy_str(const char *str) {
+	return str ? strdup(str) : 0;
+}
+
+struct easm_mod *easm_copy_mod(const struct easm_mod *mod) {
+	if (!mod) return 0;
+	struct easm_mod *res = malloc(sizeof *res);
+	*res = *mod;
+	res->str = easm_copy_str(mod->str);
+	return res;
+}
+
+struct easm_mods *easm_copy_mods(const struct easm_mods *mods) {
+	if (!mods) return 0;
+	struct easm_mods *res = malloc(sizeof *res);
+	int i;
+	*res = *mods;
+	res->mods = 0;
+	res->modsnum = res->modsmax = 0;
+	for (i = 0; i < mods->modsnum; i++) {
+		struct easm_mod *mod = easm_copy_mod(mods->mods[i]);
+		ADDARRAY(res->mods, mod);
+	}
+	return res;
+}
+
+struct easm_operand *easm_copy_operand(const struct easm_operand *operand) {
+	if (!operand) return 0;
+	struct easm_operand *res = malloc(sizeof *res);
+	int i;
+	*res = *operand;
+	res->mods = easm_copy_mods(operand->mods);
+	res->exprs = 0;
+	res->exprsnum = res->exprsmax = 0;
+	for (i = 0; i < operand->exprsnum; i++) {
+		struct easm_expr *expr = easm_copy_expr(operand->exprs[i]);
+		ADDARRAY(res->exprs, expr);
+	}
+	return res;
+}
+
+struct easm_expr *easm_copy_expr(const struct easm_expr *expr) {
+	if (!expr) return 0;
+	struct easm_expr *res = malloc(sizeof *res);
+	int i;
+	*res = *expr;
+	res->swizzles = 0;
+	res->swizzlesnum = res->swizzlesmax = 0;
+	for (i = 0; i < expr->swizzlesnum; i++) {
+		struct easm_swizzle sw = { easm_copy_str(expr->swizzles[i].str), expr->swizzles[i].num };
+		ADDARRAY(res->swizzles, sw);
+	}
+	res->e1 = easm_copy_expr(expr->e1);
+	res->e2 = easm_copy_expr(expr->e2);
+	if (expr->astr.str) {
+		res->astr.str = malloc(expr->astr.len + 1);
+		memcpy(res->astr.str, expr->astr.str, expr->astr.len);
+		res->astr.str[expr->astr.len] = 0;
+	}
+	res->str = easm_copy_str(expr->str);
+	res->alabel = easm_copy_str(expr->alabel);
+	res->sinsn = easm_copy_sinsn(expr->sinsn);
+	res->mods = easm_copy_mods(expr->mods);
+	return res;
+}
+
+struct easm_sinsn *easm_copy_sinsn(const struct easm_sinsn *sinsn) {
+	if (!sinsn) return 0;
+	struct easm_sinsn *res = malloc(sizeof *res);
+	int i;
+	*res = *sinsn;
+	res->str = easm_copy_str(sinsn->str);
+	res->mods = easm_copy_mods(sinsn->mods);
+	res->operands = 0;
+	res->operandsnum = res->operandsmax = 0;
+	for (i = 0; i < sinsn->operandsnum; i++) {
+		struct easm_operand *operand = easm_copy_operand(sinsn->operands[i]);
+		ADDARRAY(res->operands, operand);
+	}
+	return res;
+}
+
+struct easm_subinsn *easm_copy_subinsn(const struct easm_subinsn *subinsn) {
+	if (!subinsn) return 0;
+	struct easm_subinsn *res = malloc(sizeof *res);
+	int i;
+	*res = *subinsn;
+	res->prefs = 0;
+	res->prefsnum = res->prefsmax = 0;
+	for (i = 0; i < subinsn->prefsnum; i++) {
+		struct easm_expr *pref = easm_copy_expr(subinsn->prefs[i]);
+		ADDARRAY(res->prefs, pref);
+	}
+	res->sinsn = easm_copy_sinsn(subinsn->sinsn);
+	return res;
+}
+
+struct easm_insn *easm_copy_insn(const struct easm_insn *insn) {
+	if (!insn) return 0;
+	struct easm_insn *res = malloc(sizeof *res);
+	int i;
+	*res = *insn;
+	res->subinsns = 0;
+	res->subinsnsnum = res->subinsnsmax = 0;
+	for (i = 0; i < insn->subinsnsnum; i++) {
+		struct easm_subinsn *subinsn = easm_copy_subinsn(insn->subinsns[i]);
+		ADDARRAY(res->subinsns, subinsn);
+	}
+	return res;
+}
+
 int easm_isimm(struct easm_expr *expr) {
 	switch (expr->type) {
 		case EASM_EXPR_LOR:
@@ -32,8 +32,16 @@ struct iasctx {
 	struct litem **atoms;
 	int atomsnum;
 	int atomsmax;
+	struct easm_expr **exprs;
+	int exprsnum;
+	int exprsmax;
 };
 
+static struct easm_expr *as_expr(struct iasctx *ctx, struct easm_expr *expr) {
+	ADDARRAY(ctx->exprs, expr);
+	return expr;
+}
+
 struct matches *emptymatches() {
 	struct matches *res = calloc(sizeof *res, 1);
 	return res;
@@ -280,6 +288,8 @@ struct matches *atomopl_a APROTO {
 }
 
 struct matches *atomsestart_a APROTO {
+	if (spos == ctx->atomsnum)
+		return 0;
 	struct litem *li = ctx->atoms[spos];
 	if (li->type == LITEM_SESTART)
 		return alwaysmatches(spos+1);
@@ -288,6 +298,8 @@ struct matches *atomsestart_a APROTO {
 }
 
 struct matches *atomseend_a APROTO {
+	if (spos == ctx->atomsnum)
+		return 0;
 	struct litem *li = ctx->atoms[spos];
 	if (li->type == LITEM_SEEND)
 		return alwaysmatches(spos+1);
@@ -458,30 +470,30 @@ struct matches *atomdiscard_a APROTO {
 	}
 }
 
-int addexpr (struct easm_expr **iex, struct easm_expr *expr, int flip) {
+int addexpr (struct iasctx *ctx, struct easm_expr **iex, struct easm_expr *expr, int flip) {
 	if (flip) {
 		if (!*iex)
-			*iex = easm_expr_un(EASM_EXPR_NEG, expr);
+			*iex = as_expr(ctx, easm_expr_un(EASM_EXPR_NEG, expr));
 		else
-			*iex = easm_expr_bin(EASM_EXPR_SUB, *iex, expr);
+			*iex = as_expr(ctx, easm_expr_bin(EASM_EXPR_SUB, *iex, expr));
 	} else {
 		if (!*iex)
 			*iex = expr;
 		else
-			*iex = easm_expr_bin(EASM_EXPR_ADD, *iex, expr);
+			*iex = as_expr(ctx, easm_expr_bin(EASM_EXPR_ADD, *iex, expr));
 	}
 	return 1;
 }
 
-int matchmemaddr(struct easm_expr **iex, struct easm_expr **niex1, struct easm_expr **niex2, struct easm_expr *expr, int flip) {
+int matchmemaddr(struct iasctx *ctx, struct easm_expr **iex, struct easm_expr **niex1, struct easm_expr **niex2, struct easm_expr *expr, int flip) {
 	if (easm_isimm(expr))
-		return addexpr(iex, expr, flip);
+		return addexpr(ctx, iex, expr, flip);
 	if (expr->type == EASM_EXPR_ADD)
-		return matchmemaddr(iex, niex1, niex2, expr->e1, flip) && matchmemaddr(iex, niex1, niex2, expr->e2, flip);
+		return matchmemaddr(ctx, iex, niex1, niex2, expr->e1, flip) && matchmemaddr(ctx, iex, niex1, niex2, expr->e2, flip);
 	if (expr->type == EASM_EXPR_SUB)
-		return matchmemaddr(iex, niex1, niex2, expr->e1, flip) && matchmemaddr(iex, niex1, niex2, expr->e2, !flip);
+		return matchmemaddr(ctx, iex, niex1, niex2, expr->e1, flip) && matchmemaddr(ctx, iex, niex1, niex2, expr->e2, !flip);
 	if (expr->type == EASM_EXPR_NEG)
-		return matchmemaddr(iex, niex1, niex2, expr->e1, !flip);
+		return matchmemaddr(ctx, iex, niex1, niex2, expr->e1, !flip);
 	if (flip)
 		return 0;
 	if (niex1 && !*niex1)
@@ -506,7 +518,7 @@ struct matches *atommem_a APROTO {
 	if (!ismem && mem->name)
 		return 0;
 	if (ismem) {
-		if (strncmp(expr->str, mem->name, strlen(mem->name)))
+		if (!expr->str || strncmp(expr->str, mem->name, strlen(mem->name)))
 			return 0;
 		if (mem->idx) {
 			const char *str = expr->str + strlen(mem->name);
@@ -523,9 +535,9 @@ struct matches *atommem_a APROTO {
 				return 0;
 		}
 		if (expr->type == EASM_EXPR_MEMPP)
-			addexpr(&pexpr, expr->e2, 0);
+			addexpr(ctx, &pexpr, expr->e2, 0);
 		else if (expr->type == EASM_EXPR_MEMMM)
-			addexpr(&pexpr, expr->e2, 1);
+			addexpr(ctx, &pexpr, expr->e2, 1);
 		else if (expr->type != EASM_EXPR_MEM)
 			return 0;
 		expr = expr->e1;
@@ -533,7 +545,7 @@ struct matches *atommem_a APROTO {
 	struct easm_expr *iex = 0;
 	struct easm_expr *niex1 = 0;
 	struct easm_expr *niex2 = 0;
-	matchmemaddr(&iex, &niex1, &niex2, expr, 0);
+	matchmemaddr(ctx, &iex, &niex1, &niex2, expr, 0);
 	if (mem->imm) {
 		if (mem->postincr) {
 			if (!pexpr || iex)
@@ -547,7 +559,7 @@ struct matches *atommem_a APROTO {
 				if (!setrbf(&res, mem->imm, iex))
 					return 0;
 			} else {
-				if (!setrbf(&res, mem->imm, easm_expr_num(EASM_EXPR_NUM, 0)))
+				if (!setrbf(&res, mem->imm, as_expr(ctx, easm_expr_num(EASM_EXPR_NUM, 0))))
 					return 0;
 			}
 		}
@@ -557,9 +569,9 @@ struct matches *atommem_a APROTO {
 	}
 	if (mem->reg && mem->reg2) {
 		if (!niex1)
-			niex1 = easm_expr_num(EASM_EXPR_NUM, 0);
+			niex1 = as_expr(ctx, easm_expr_num(EASM_EXPR_NUM, 0));
 		if (!niex2)
-			niex2 = easm_expr_num(EASM_EXPR_NUM, 0);
+			niex2 = as_expr(ctx, easm_expr_num(EASM_EXPR_NUM, 0));
 		struct match sres = res;
 		if (!matchreg(&res, mem->reg, niex1, ctx) || !matchshreg(&res, mem->reg2, niex2, mem->reg2shr, ctx)) {
 			res = sres;
@@ -570,14 +582,14 @@ struct matches *atommem_a APROTO {
 		if (niex2)
 			return 0;
 		if (!niex1)
-			niex1 = easm_expr_num(EASM_EXPR_NUM, 0);
+			niex1 = as_expr(ctx, easm_expr_num(EASM_EXPR_NUM, 0));
 		if (!matchreg(&res, mem->reg, niex1, ctx))
 			return 0;
 	} else if (mem->reg2) {
 		if (niex2)
 			return 0;
 		if (!niex1)
-			niex1 = easm_expr_num(EASM_EXPR_NUM, 0);
+			niex1 = as_expr(ctx, easm_expr_num(EASM_EXPR_NUM, 0));
 		if (!matchshreg(&res, mem->reg2, niex1, mem->reg2shr, ctx))
 			return 0;
 	} else {
@@ -617,14 +629,14 @@ struct matches *atomvec_a APROTO {
 		if (e->type == EASM_EXPR_DISCARD) {
 		} else if (e->type == EASM_EXPR_REG) {
 			if (strncmp(e->str, vec->name, strlen(vec->name)))
-				return 0;
+				goto fail;
 			char *end;
 			ull num = strtoull(e->str + strlen(vec->name), &end, 10);
 			if (*end)
-				return 0;
+				goto fail;
 			if (mask) {
 				if (num != cur)
-					return 0;
+					goto fail;
 				cur++;
 			} else {
 				start = num;
@@ -632,9 +644,10 @@ struct matches *atomvec_a APROTO {
 			}
 			mask |= 1ull << i;
 		} else {
-			return 0;
+			goto fail;
 		}
 	}
+	free(vexprs);
 	if (!setbf(&res, vec->bf, start))
 		return 0;
 	if (!setbf(&res, vec->cnt, cnt))
@@ -649,6 +662,9 @@ struct matches *atomvec_a APROTO {
 	struct matches *rres = emptymatches();
 	ADDARRAY(rres->m, res);
 	return rres;
+fail:
+	free(vexprs);
+	return 0;
 }
 
 struct matches *atombf_a APROTO {
@@ -748,5 +764,23 @@ struct matches *do_as(const struct disisa *isa, struct varinfo *varinfo, struct
 		if (m->m[i].lpos == ctx->atomsnum) {
 			ADDARRAY(res->m, m->m[i]);
 		}
+	free(m->m);
+	free(m);
+	for (i = 0; i < ctx->atomsnum; i++)
+		free(ctx->atoms[i]);
+	free(ctx->atoms);
+	res->exprs = ctx->exprs;
+	res->exprsnum = ctx->exprsnum;
+	res->exprsmax = ctx->exprsmax;
 	return res;
 }
+
+void del_matches(struct matches *ms) {
+	int i;
+	/* only the nodes themselves are ours, the leaves belong to the insn */
+	for (i = 0; i < ms->exprsnum; i++)
+		free(ms->exprs[i]);
+	free(ms->exprs);
+	free(ms->m);
+	free(ms);
+}
@@ -25,6 +25,7 @@
 #include "dis-intern.h"
 #include "easm.h"
 #include <stdlib.h>
+#include <string.h>
 
 struct disctx {
 	const struct disisa *isa;
@@ -376,14 +377,7 @@ struct dis_op_chunk {
 };
 
 struct dis_res {
-	enum dis_status {
-		DIS_STATUS_OK = 0,
-		DIS_STATUS_EOF = 0x1,		/* EOF in the middle of an opcode */
-		DIS_STATUS_UNK_FORM = 0x2,	/* failed to determine instruction format - opcode length uncertain */
-		DIS_STATUS_UNK_INSN = 0x4,	/* failed to determine instruction name - unknown opcode or due to one of the above errors */
-		DIS_STATUS_UNK_OPERAND = 0x8,	/* failed to determine instruction operands */
-		DIS_STATUS_UNUSED_BITS = 0x10,	/* instruction decoded, but unused bitfields have non-default values */
-	} status;
+	enum dis_status status;
 	uint32_t oplen;
 	struct dis_op_chunk *chunks;
 	int chunksnum;
@@ -393,12 +387,14 @@ struct dis_res {
 	ull a[MAXOPLEN], m[MAXOPLEN];
 	struct easm_insn *insn;
 	int endmark;
+	int shared;
 //	uint32_t *umask;
 };
 
 static void dis_del_res(struct dis_res *dres)
 {
-	easm_del_insn(dres->insn);
+	if (!dres->shared)
+		easm_del_insn(dres->insn);
 
 	free(dres);
 }
@@ -465,6 +461,18 @@ static struct easm_insn *dis_parse_insn(struct disctx *ctx, enum dis_status *sta
 	return res;
 }
 
+/* what the discovery pass learns about an instruction, for envycfg */
+struct dis_cfg_insn {
+	uint32_t len;
+	int endmark;
+};
+
+struct dis_cfg_edge {
+	uint32_t from;
+	uint64_t to;
+	int call;
+};
+
 struct decoctx {
 	const struct disisa *isa;
 	struct varinfo *varinfo;
@@ -476,9 +484,27 @@ struct decoctx {
 	struct label *labels;
 	int labelsnum;
 	int labelsmax;
+	struct dis_cache *cache;
+	struct dis_cfg_insn *cfginsns;
+	struct dis_cfg_edge *cfgedges;
+	int cfgedgesnum;
+	int cfgedgesmax;
+	int cfgrec;
 };
 
+static struct dis_res *do_dis_root(struct decoctx *deco, uint32_t cur, const struct insn *root);
+static struct dis_res *dis_cache_dis(struct decoctx *deco, uint32_t cur, const struct insn *root);
+
 struct dis_res *do_dis(struct decoctx *deco, uint32_t cur) {
+	const struct insn *root = deco->isa->troot;
+	if (deco->isa->tsched && (cur % deco->isa->schedpos) == 0)
+		root = deco->isa->tsched;
+	if (deco->cache)
+		return dis_cache_dis(deco, cur, root);
+	return do_dis_root(deco, cur, root);
+}
+
+static struct dis_res *do_dis_root(struct decoctx *deco, uint32_t cur, const struct insn *root) {
 	struct disctx c = { 0 };
 	struct disctx *ctx = &c;
 	struct dis_res *res = calloc(sizeof *res, 1);
@@ -489,10 +515,7 @@ struct dis_res *do_dis(struct decoctx *deco, uint32_t cur) {
 	}
 	ctx->isa = deco->isa;
 	ctx->varinfo = deco->varinfo;
-	if (deco->isa->tsched && (cur % deco->isa->schedpos) == 0)
-		atomtab_d (ctx, res->a, res->m, deco->isa->tsched);
-	else
-		atomtab_d (ctx, res->a, res->m, deco->isa->troot);
+	atomtab_d (ctx, res->a, res->m, root);
 	res->oplen = ctx->oplen;
 	if (res->oplen + cur > deco->codesz)
 		res->status |= DIS_STATUS_EOF;
@@ -517,6 +540,13 @@ static void mark(struct decoctx *ctx, uint32_t ptr, int m) {
 	ctx->marks[ptr - ctx->codebase] |= m;
 }
 
+static void cfg_edge(struct decoctx *ctx, uint32_t from, uint64_t to, int call) {
+	if (!ctx->cfgrec)
+		return;
+	struct dis_cfg_edge edge = { from, to, call };
+	ADDARRAY(ctx->cfgedges, edge);
+}
+
 static int is_nr_mark(struct decoctx *ctx, uint32_t ptr) {
 	if (ptr < ctx->codebase || ptr >= ctx->codebase + ctx->codesz)
 		return 0;
@@ -544,11 +574,13 @@ static void dis_pp_expr(struct decoctx *deco, struct dis_res *dres, struct easm_
 	if (easm_cfold_expr(expr)) {
 		if (expr->special == EASM_SPEC_CTARG) {
 			mark(deco, expr->num, 2);
+			cfg_edge(deco, pos, expr->num, 1);
 			expr->alabel = deco_label(deco, expr->num);
 			if (is_nr_mark(deco, expr->num))
 				dres->endmark = 1;
 		} else if (expr->special == EASM_SPEC_BTARG) {
 			mark(deco, expr->num, 1);
+			cfg_edge(deco, pos, expr->num, 0);
 			expr->alabel = deco_label(deco, expr->num);
 		}
 		if (expr->num & 1ull << 63 && !expr->special) {
@@ -615,9 +647,224 @@ static void dis_pp_insn(struct decoctx *deco, struct dis_res *dres, struct easm_
 }
 
 void dis_dopp(struct decoctx *deco, struct dis_res *dres, uint64_t pos) {
+	if (dres->shared)
+		return;
 	dis_pp_insn(deco, dres, dres->insn, pos);
 }
 
+/*
+ * Decoded instruction cache
+ *
+ * The decoder output only depends on the opcode bits and the table used, so
+ * it's kept for every encoding seen and reused when the encoding comes again.
+ * Instructions with no branch targets, literals or $pc references come out of
+ * dis_dopp the same everywhere, so these are stored already post-processed
+ * and handed out shared - the result has to be freed before the next lookup.
+ * The rest is stored raw and copied, to have dis_dopp run on the copy.
+ * Instructions too close to the end of code aren't cached, as their decoding
+ * depends on what's missing.
+ */
+
+#define DIS_CACHE_MIN 0x40
+#define DIS_CACHE_MAX 0x10000
+
+struct dis_cache_entry {
+	ull key[MAXOPLEN];
+	const struct insn *root;
+	struct dis_res *res;
+	int pure;
+};
+
+struct dis_cache {
+	const struct disisa *isa;
+	struct varinfo *varinfo;
+	struct dis_cache_entry *entries;
+	int size;
+	int used;
+	struct dis_cache_stats stats;
+};
+
+struct dis_cache *dis_cache_new(const struct disisa *isa, struct varinfo *varinfo) {
+	struct dis_cache *res = calloc(sizeof *res, 1);
+	res->isa = isa;
+	res->varinfo = varinfo;
+	return res;
+}
+
+static void dis_cache_clear(struct dis_cache *cache) {
+	int i;
+	for (i = 0; i < cache->size; i++)
+		if (cache->entries[i].res)
+			dis_del_res(cache->entries[i].res);
+	free(cache->entries);
+	cache->entries = 0;
+	cache->size = 0;
+	cache->used = 0;
+}
+
+void dis_cache_del(struct dis_cache *cache) {
+	dis_cache_clear(cache);
+	free(cache);
+}
+
+struct dis_cache_stats dis_cache_get_stats(const struct dis_cache *cache) {
+	return cache->stats;
+}
+
+static struct dis_cache_entry *dis_cache_find(struct dis_cache *cache, const ull *key, const struct insn *root) {
+	ull h = (key[0] ^ (uintptr_t)root) * 0x9e3779b97f4a7c15ull;
+	int i;
+	for (i = 1; i < MAXOPLEN; i++)
+		h = (h ^ key[i]) * 0x9e3779b97f4a7c15ull;
+	uint32_t idx = (h >> 32) & (cache->size - 1);
+	while (cache->entries[idx].res) {
+		struct dis_cache_entry *e = &cache->entries[idx];
+		if (e->root == root && !memcmp(e->key, key, sizeof e->key))
+			break;
+		idx = (idx + 1) & (cache->size - 1);
+	}
+	return &cache->entries[idx];
+}
+
+static int dis_pure_sinsn(struct easm_sinsn *sinsn);
+
+static int dis_pure_expr(struct easm_expr *expr) {
+	if (expr->type == EASM_EXPR_POS)
+		return 0;
+	if (expr->special == EASM_SPEC_BTARG || expr->special == EASM_SPEC_CTARG || expr->special == EASM_SPEC_LITERAL)
+		return 0;
+	if (expr->e1 && !dis_pure_expr(expr->e1))
+		return 0;
+	if (expr->e2 && !dis_pure_expr(expr->e2))
+		return 0;
+	if (expr->sinsn && !dis_pure_sinsn(expr->sinsn))
+		return 0;
+	return 1;
+}
+
+static int dis_pure_sinsn(struct easm_sinsn *sinsn) {
+	int i, j;
+	for (i = 0; i < sinsn->operandsnum; i++)
+		for (j = 0; j < sinsn->operands[i]->exprsnum; j++)
+			if (!dis_pure_expr(sinsn->operands[i]->exprs[j]))
+				return 0;
+	return 1;
+}
+
+static int dis_pure_insn(struct easm_insn *insn) {
+	int i, j;
+	for (i = 0; i < insn->subinsnsnum; i++) {
+		for (j = 0; j < insn->subinsns[i]->prefsnum; j++)
+			if (!dis_pure_expr(insn->subinsns[i]->prefs[j]))
+				return 0;
+		if (!dis_pure_sinsn(insn->subinsns[i]->sinsn))
+			return 0;
+	}
+	return 1;
+}
+
+static void dis_cache_resize(struct dis_cache *cache, int size) {
+	struct dis_cache_entry *old = cache->entries;
+	int oldsize = cache->size;
+	int i;
+	cache->entries = calloc(sizeof *cache->entries, size);
+	cache->size = size;
+	for (i = 0; i < oldsize; i++)
+		if (old[i].res)
+			*dis_cache_find(cache, old[i].key, old[i].root) = old[i];
+	free(old);
+}
+
+static struct dis_res *dis_cache_dis(struct decoctx *deco, uint32_t cur, const struct insn *root) {
+	struct dis_cache *cache = deco->cache;
+	int stride = ed_getcstride(deco->isa, deco->varinfo);
+	ull key[MAXOPLEN] = { 0 };
+	int i;
+	if (cur + deco->isa->maxoplen > deco->codesz) {
+		cache->stats.uncached++;
+		return do_dis_root(deco, cur, root);
+	}
+	for (i = 0; i < deco->isa->maxoplen * stride; i++)
+		key[i/8] |= (ull)deco->code[cur*stride + i] << (i&7)*8;
+	if (!cache->size)
+		dis_cache_resize(cache, DIS_CACHE_MIN);
+	struct dis_cache_entry *e = dis_cache_find(cache, key, root);
+	struct dis_res *res;
+	if (e->res) {
+		cache->stats.hits++;
+		res = malloc(sizeof *res);
+		*res = *e->res;
+		if (e->pure)
+			res->shared = 1;
+		else
+			res->insn = easm_copy_insn(e->res->insn);
+		/* the bits past the instruction are whatever follows it here */
+		for (i = 0; i < MAXOPLEN; i++)
+			res->a[i] = 0;
+		for (i = 0; i < MAXOPLEN*8 && cur + i/stride < deco->codesz; i++)
+			res->a[i/8] |= (ull)deco->code[cur*stride + i] << (i&7)*8;
+		return res;
+	}
+	cache->stats.misses++;
+	res = do_dis_root(deco, cur, root);
+	if (cache->used * 2 >= cache->size) {
+		if (cache->size < DIS_CACHE_MAX) {
+			dis_cache_resize(cache, cache->size * 2);
+		} else {
+			cache->stats.flushes++;
+			dis_cache_clear(cache);
+			dis_cache_resize(cache, DIS_CACHE_MIN);
+		}
+		e = dis_cache_find(cache, key, root);
+	}
+	for (i = 0; i < MAXOPLEN; i++)
+		e->key[i] = key[i];
+	e->root = root;
+	e->pure = dis_pure_insn(res->insn);
+	e->res = malloc(sizeof *e->res);
+	*e->res = *res;
+	e->res->insn = easm_copy_insn(res->insn);
+	if (e->pure)
+		dis_pp_insn(deco, e->res, e->res->insn, 0);
+	cache->used++;
+	return res;
+}
+
+/*
+ * Single instruction disassembly, for tools checking the tables rather than
+ * producing listings.  code has to be readable for MAXOPLEN*8 bytes.  Returns
+ * the decoded instruction with addresses resolved for position pos, its
+ * length, DIS_STATUS_* flags and the opcode bits no table claimed.
+ */
+
+struct easm_insn *dis_insn(const struct disisa *isa, struct varinfo *varinfo, uint8_t *code, uint32_t pos, int *oplen, int *status, ull *unk) {
+	struct decoctx c = { 0 };
+	struct decoctx *ctx = &c;
+	int marks[MAXOPLEN * 8] = { 0 };
+	int i;
+	ctx->isa = isa;
+	ctx->varinfo = varinfo;
+	ctx->code = code;
+	ctx->codesz = isa->maxoplen;
+	ctx->codebase = pos;
+	ctx->marks = marks;
+	struct dis_res *dres;
+	if (isa->tsched && (pos % isa->schedpos) == 0)
+		dres = do_dis_root(ctx, 0, isa->tsched);
+	else
+		dres = do_dis_root(ctx, 0, isa->troot);
+	dis_dopp(ctx, dres, pos);
+	for (i = dres->oplen * ed_getcstride(isa, varinfo); i < MAXOPLEN * 8; i++)
+		dres->a[i/8] &= ~(0xffull << (i & 7) * 8);
+	for (i = 0; i < MAXOPLEN; i++)
+		unk[i] = dres->a[i] & ~dres->m[i];
+	struct easm_insn *res = dres->insn;
+	*oplen = dres->oplen;
+	*status = dres->status;
+	free(dres);
+	return res;
+}
+
 /*
  * Disassembler driver
  *
@@ -627,20 +874,41 @@ void dis_dopp(struct decoctx *deco, struct dis_res *dres, uint64_t pos) {
 
 void envydis (const struct disisa *isa, FILE *out, uint8_t *code, uint32_t start, int num, struct varinfo *varinfo, int quiet, struct label *labels, int labelsnum, const struct envy_colors *cols)
 {
-	struct decoctx c = { 0 };
-	struct decoctx *ctx = &c;
+	struct dis_cache *cache = dis_cache_new(isa, varinfo);
+	envydis_cached(cache, out, code, start, num, quiet, labels, labelsnum, cols);
+	dis_cache_del(cache);
+}
+
+/*
+ * First pass: finds the instruction boundaries and marks branch and call
+ * targets.  With labels given, only code reachable from them is decoded,
+ * otherwise everything is, back to back.
+ */
+
+static struct dis_res *discover_insn(struct decoctx *ctx, uint32_t cur) {
+	struct dis_res *dres = do_dis(ctx, cur);
+	ctx->cfgrec = ctx->cfginsns && !ctx->cfginsns[cur].len;
+	dis_dopp(ctx, dres, cur + ctx->codebase);
+	if (ctx->cfgrec) {
+		ctx->cfginsns[cur].len = dres->oplen;
+		ctx->cfginsns[cur].endmark = dres->endmark;
+		ctx->cfgrec = 0;
+	}
+	return dres;
+}
+
+static void discover(struct decoctx *ctx, struct dis_cache *cache, uint8_t *code, uint32_t start, int num, struct label *labels, int labelsnum) {
 	int cur = 0, i, j;
+	ctx->cache = cache;
 	ctx->code = code;
 	ctx->codesz = num;
 	ctx->marks = calloc(num, sizeof *ctx->marks);
 	ctx->names = calloc(num, sizeof *ctx->names);
 	ctx->codebase = start;
-	ctx->varinfo = varinfo;
-	ctx->isa = isa;
+	ctx->varinfo = cache->varinfo;
+	ctx->isa = cache->isa;
 	ctx->labels = labels;
 	ctx->labelsnum = labelsnum;
-	int stride = ed_getcstride(ctx->isa, ctx->varinfo);
-	int cbsz = ed_getcbsz(ctx->isa, ctx->varinfo);
 	if (labels) {
 		for (i = 0; i < labelsnum; i++) {
 			mark(ctx, labels[i].val, labels[i].type);
@@ -665,8 +933,7 @@ void envydis (const struct disisa *isa, FILE *out, uint8_t *code, uint32_t start
 					ctx->marks[cur] |= 8;
 				}
 				if (active) {
-					struct dis_res *dres = do_dis(ctx, cur);
-					dis_dopp(ctx, dres, cur + start);
+					struct dis_res *dres = discover_insn(ctx, cur);
 					if (dres->oplen && !dres->endmark && !(ctx->marks[cur] & 4))
 						cur += dres->oplen;
 					else
@@ -679,8 +946,7 @@ void envydis (const struct disisa *isa, FILE *out, uint8_t *code, uint32_t start
 		} while (!done);
 	} else {
 		while (cur < num) {
-			struct dis_res *dres = do_dis(ctx, cur);
-			dis_dopp(ctx, dres, cur + start);
+			struct dis_res *dres = discover_insn(ctx, cur);
 			if (dres->oplen)
 				cur += dres->oplen;
 			else
@@ -688,7 +954,18 @@ void envydis (const struct disisa *isa, FILE *out, uint8_t *code, uint32_t start
 			dis_del_res(dres);
 		}
 	}
-	cur = 0;
+}
+
+void envydis_cached (struct dis_cache *cache, FILE *out, uint8_t *code, uint32_t start, int num, int quiet, struct label *labels, int labelsnum, const struct envy_colors *cols)
+{
+	const struct disisa *isa = cache->isa;
+	struct decoctx c = { 0 };
+	struct decoctx *ctx = &c;
+	int i, j;
+	discover(ctx, cache, code, start, num, labels, labelsnum);
+	int stride = ed_getcstride(ctx->isa, ctx->varinfo);
+	int cbsz = ed_getcbsz(ctx->isa, ctx->varinfo);
+	int cur = 0;
 	int active = 0;
 	int skip = 0, nonzero = 0;
 	while (cur < num) {
@@ -867,3 +1144,125 @@ void envydis (const struct disisa *isa, FILE *out, uint8_t *code, uint32_t start
 	free(ctx->marks);
 	free(ctx->names);
 }
+
+/*
+ * Control flow graph export
+ *
+ * Reuses the discovery pass: blocks end at branches, ENDMARK instructions,
+ * calls to no-return targets and before branch/call targets or labels.  Only
+ * falcon and xtensa tables mark unconditional jumps and returns with ENDMARK,
+ * elsewhere a block ending in a branch gets the fallthrough edge as well -
+ * it's listed apart from the branch targets, for the consumer to sort out.
+ */
+
+static int cfg_edge_cmp(const void *a, const void *b) {
+	const struct dis_cfg_edge *ea = a, *eb = b;
+	if (ea->from != eb->from)
+		return ea->from < eb->from ? -1 : 1;
+	if (ea->call != eb->call)
+		return ea->call - eb->call;
+	if (ea->to != eb->to)
+		return ea->to < eb->to ? -1 : 1;
+	return 0;
+}
+
+static void cfg_print_edges(FILE *out, struct decoctx *ctx, int e0, int e1, int call, enum dis_cfg_format fmt, uint32_t addr) {
+	int i, first = 1;
+	for (i = e0; i < e1; i++) {
+		struct dis_cfg_edge *edge = &ctx->cfgedges[i];
+		if (edge->call != call || (i > e0 && !cfg_edge_cmp(edge, edge - 1)))
+			continue;
+		if (fmt == DIS_CFG_DOT)
+			fprintf(out, "\tb%08x -> b%08llx%s;\n", addr, (unsigned long long)edge->to, call ? " [style=dotted]" : "");
+		else
+			fprintf(out, "%s%llu", first ? "" : ",", (unsigned long long)edge->to);
+		first = 0;
+	}
+}
+
+static void cfg_print_name(FILE *out, const char *name) {
+	for (; *name; name++) {
+		if (*name == '"' || *name == '\\')
+			fputc('\\', out);
+		fputc(*name, out);
+	}
+}
+
+void envycfg (struct dis_cache *cache, FILE *out, uint8_t *code, uint32_t start, int num, struct label *labels, int labelsnum, enum dis_cfg_format fmt)
+{
+	struct decoctx c = { 0 };
+	struct decoctx *ctx = &c;
+	ctx->cfginsns = calloc(num, sizeof *ctx->cfginsns);
+	discover(ctx, cache, code, start, num, labels, labelsnum);
+	qsort(ctx->cfgedges, ctx->cfgedgesnum, sizeof *ctx->cfgedges, cfg_edge_cmp);
+	if (fmt == DIS_CFG_DOT)
+		fprintf(out, "digraph cfg {\n\tnode [shape=box];\n");
+	else
+		fprintf(out, "{\"blocks\":[");
+	int cur = 0, e = 0, nblocks = 0;
+	while (cur < num) {
+		if (!ctx->cfginsns[cur].len) {
+			cur++;
+			continue;
+		}
+		uint32_t bstart = cur;
+		int end = 0;
+		while (e < ctx->cfgedgesnum && ctx->cfgedges[e].from < bstart + start)
+			e++;
+		int e0 = e;
+		while (1) {
+			struct dis_cfg_insn *ci = &ctx->cfginsns[cur];
+			uint32_t addr = cur + start;
+			int branch = 0;
+			for (; e < ctx->cfgedgesnum && ctx->cfgedges[e].from <= addr; e++)
+				if (ctx->cfgedges[e].from == addr && !ctx->cfgedges[e].call)
+					branch = 1;
+			int stop = ci->endmark || ctx->marks[cur] & 4;
+			cur += ci->len;
+			if (stop) {
+				end = 1;
+				break;
+			}
+			if (branch || cur >= num || !ctx->cfginsns[cur].len || ctx->marks[cur] & 3 || ctx->names[cur])
+				break;
+		}
+		int fall = !end && cur < num && ctx->cfginsns[cur].len;
+		const char *name = ctx->names[bstart];
+		if (fmt == DIS_CFG_DOT) {
+			fprintf(out, "\tb%08x [label=\"", bstart + start);
+			if (name) {
+				cfg_print_name(out, name);
+				fprintf(out, "\\n");
+			}
+			fprintf(out, "%08x-%08x\"];\n", bstart + start, cur + start);
+			cfg_print_edges(out, ctx, e0, e, 0, fmt, bstart + start);
+			if (fall)
+				fprintf(out, "\tb%08x -> b%08x [style=dashed];\n", bstart + start, cur + start);
+			cfg_print_edges(out, ctx, e0, e, 1, fmt, bstart + start);
+		} else {
+			fprintf(out, "%s\n{\"addr\":%u,\"end\":%u", nblocks ? "," : "", bstart + start, cur + start);
+			if (name) {
+				fprintf(out, ",\"name\":\"");
+				cfg_print_name(out, name);
+				fprintf(out, "\"");
+			}
+			fprintf(out, ",\"branch\":[");
+			cfg_print_edges(out, ctx, e0, e, 0, fmt, bstart + start);
+			fprintf(out, "],\"call\":[");
+			cfg_print_edges(out, ctx, e0, e, 1, fmt, bstart + start);
+			fprintf(out, "]");
+			if (fall)
+				fprintf(out, ",\"fall\":%u", cur + start);
+			fprintf(out, "}");
+		}
+		nblocks++;
+	}
+	if (fmt == DIS_CFG_DOT)
+		fprintf(out, "}\n");
+	else
+		fprintf(out, "\n]}\n");
+	free(ctx->cfginsns);
+	free(ctx->cfgedges);
+	free(ctx->marks);
+	free(ctx->names);
+}
@@ -302,6 +302,19 @@ static inline int var_ok(int fmask, int ptype, struct varinfo *varinfo) {
 	return (!fmask || (varinfo->fmask[0] & fmask) == fmask) && (!ptype || (varinfo->modes[0] != -1 && ptype & 1 << varinfo->modes[0]));
 }
 
+enum dis_status {
+	DIS_STATUS_OK = 0,
+	DIS_STATUS_EOF = 0x1,		/* EOF in the middle of an opcode */
+	DIS_STATUS_UNK_FORM = 0x2,	/* failed to determine instruction format - opcode length uncertain */
+	DIS_STATUS_UNK_INSN = 0x4,	/* failed to determine instruction name - unknown opcode or due to one of the above errors */
+	DIS_STATUS_UNK_OPERAND = 0x8,	/* failed to determine instruction operands */
+	DIS_STATUS_UNUSED_BITS = 0x10,	/* instruction decoded, but unused bitfields have non-default values */
+};
+
+struct easm_insn;
+
+struct easm_insn *dis_insn(const struct disisa *isa, struct varinfo *varinfo, uint8_t *code, uint32_t pos, int *oplen, int *status, ull *unk);
+
 extern struct disisa g80_isa_s;
 extern struct disisa gf100_isa_s;
 extern struct disisa gk110_isa_s;
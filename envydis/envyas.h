@@ -45,6 +45,10 @@ struct matches {
 	struct match *m;
 	int mnum;
 	int mmax;
+	/* expressions made up by the assembler, referenced by relocs */
+	struct easm_expr **exprs;
+	int exprsnum;
+	int exprsmax;
 };
 
 int setsbf (struct match *res, int pos, int len, ull num);
@@ -52,5 +56,6 @@ int setsbf (struct match *res, int pos, int len, ull num);
 ull getrbf_as(const struct rbitfield *bf, ull *a, ull *m, ull cpos);
 
 struct matches *do_as(const struct disisa *isa, struct varinfo *varinfo, struct easm_insn *insn);
+void del_matches(struct matches *ms);
 
 #endif
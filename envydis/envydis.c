@@ -29,6 +29,9 @@
 #include <unistd.h>
 #include <string.h>
 #include <stdlib.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
 
 /*
  * Options:
@@ -53,17 +56,243 @@
  *
  *  -n           Disable color escape sequences in output
  *  -q           Disable printing address + opcodes
+ *  -C           Print decoded instruction cache statistics to stderr
+ *  -g <format>  Output the control flow graph instead of a listing, as
+ *               "json" or "dot"
+ *
+ * Batch mode, used when given more than one input file, a directory or any
+ * of the options below:
+ *
+ *  -L <list>    Read input file names from <list>, one per line ("-" for
+ *               standard input)
+ *  -o <dir>     Write the disassembly of each input to a file in <dir>,
+ *               named after its path with "/" turned into "_" and ".dis"
+ *               (or ".json"/".dot" with -g) appended, instead of
+ *               concatenating them to standard output
+ *  -j <num>     Disassemble using <num> threads
  *
  * Refer to docs/envydis/index.rst for ISA details
  */
 
+static const struct disisa *isa;
+static struct varinfo *var;
+static struct label *labels;
+static int labelsnum;
+static int labelsmax;
+static int w, bin, quiet, wsz;
+static uint32_t cbsz;
+static unsigned base, skip, limit;
+static const struct envy_colors *cols = &envy_def_colors;
+static int printstats;
+static int cfg;
+static enum dis_cfg_format cfgfmt;
+static struct dis_cache_stats cachestats;
+
+static void addstats(struct dis_cache *cache) {
+	struct dis_cache_stats stats = dis_cache_get_stats(cache);
+	cachestats.hits += stats.hits;
+	cachestats.misses += stats.misses;
+	cachestats.uncached += stats.uncached;
+	cachestats.flushes += stats.flushes;
+}
+
+static uint8_t *read_code(FILE *infile, int *pnum) {
+	int num = 0;
+	int maxnum = 16;
+	uint8_t *code = malloc (maxnum);
+	unsigned long long t;
+	int i;
+	if (bin) {
+		int pos = 0;
+		int c;
+		while ((c = getc(infile)) != EOF) {
+			if (pos < CEILDIV(cbsz, 8)) {
+				if (num >= maxnum) maxnum *= 2, code = realloc (code, maxnum);
+				code[num++] = c;
+			}
+			pos++;
+			if (pos == wsz)
+				pos = 0;
+		}
+	} else {
+		while (!feof(infile) && fscanf (infile, "%llx", &t) == 1) {
+			if (num + wsz - 1 >= maxnum) maxnum *= 2, code = realloc (code, maxnum);
+			for (i = 0; i < wsz; i++) {
+				code[num++] = t & 0xff;
+				t >>= 8;
+			}
+			fscanf (infile, " ,");
+		}
+	}
+	*pnum = num;
+	return code;
+}
+
+static void disfile(struct dis_cache *cache, FILE *infile, FILE *out) {
+	int num;
+	uint8_t *code = read_code(infile, &num);
+	if (num > skip) {
+		int cnt = num - skip;
+		cnt /= ed_getcstride(isa, var);
+		if (limit && limit < cnt)
+			cnt = limit;
+		if (cfg)
+			envycfg (cache, out, code+skip, base, cnt, labels, labelsnum, cfgfmt);
+		else
+			envydis_cached (cache, out, code+skip, base, cnt, quiet, labels, labelsnum, cols);
+	}
+	free(code);
+}
+
+/*
+ * Batch mode: the ISA, variant and map file are set up once, then the inputs
+ * are handed out to worker threads.  Each one is disassembled into memory,
+ * then either written to its own file or passed on to stdout in input order.
+ */
+
+struct job {
+	const char *name;
+	char *res;
+	size_t reslen;
+	int done;
+};
+
+static struct job *jobs;
+static int jobsnum;
+static int jobsmax;
+static const char *outdir;
+static pthread_mutex_t joblock = PTHREAD_MUTEX_INITIALIZER;
+static int nextjob, nextout, nerrors;
+
+static int namecmp(const void *a, const void *b) {
+	return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static void addinput(const char *name) {
+	struct stat st;
+	if (strcmp(name, "-") && !stat(name, &st) && S_ISDIR(st.st_mode)) {
+		DIR *dir = opendir(name);
+		struct dirent *ent;
+		char **names = 0;
+		int namesnum = 0;
+		int namesmax = 0;
+		int i;
+		if (!dir) {
+			perror(name);
+			nerrors++;
+			return;
+		}
+		while ((ent = readdir(dir))) {
+			if (ent->d_name[0] == '.')
+				continue;
+			char *sub = aprintf("%s/%s", name, ent->d_name);
+			ADDARRAY(names, sub);
+		}
+		closedir(dir);
+		/* so that the output order doesn't depend on the filesystem */
+		qsort(names, namesnum, sizeof *names, namecmp);
+		for (i = 0; i < namesnum; i++)
+			addinput(names[i]);
+		free(names);
+		return;
+	}
+	struct job job = { name };
+	ADDARRAY(jobs, job);
+}
+
+static char *outname(const char *name) {
+	while (*name == '/' || !strncmp(name, "./", 2))
+		name += *name == '/' ? 1 : 2;
+	const char *ext = !cfg ? "dis" : cfgfmt == DIS_CFG_DOT ? "dot" : "json";
+	char *res = aprintf("%s/%s.%s", outdir, name, ext);
+	char *p;
+	for (p = res + strlen(outdir) + 1; *p; p++)
+		if (*p == '/')
+			*p = '_';
+	return res;
+}
+
+static void joberror(const char *name) {
+	perror(name);
+	pthread_mutex_lock(&joblock);
+	nerrors++;
+	pthread_mutex_unlock(&joblock);
+}
+
+static void dojob(struct dis_cache *cache, struct job *job) {
+	FILE *infile = strcmp(job->name, "-") ? fopen(job->name, "r") : stdin;
+	if (!infile) {
+		joberror(job->name);
+		return;
+	}
+	FILE *out = open_memstream(&job->res, &job->reslen);
+	if (!outdir)
+		fprintf(out, "%s==> %s <==\n", cols->reset, job->name);
+	disfile(cache, infile, out);
+	if (!outdir)
+		fprintf(out, "\n");
+	fclose(out);
+	if (infile != stdin)
+		fclose(infile);
+	if (outdir) {
+		char *name = outname(job->name);
+		FILE *f = fopen(name, "w");
+		if (!f || fwrite(job->res, 1, job->reslen, f) != job->reslen || fclose(f))
+			joberror(name);
+		free(name);
+		free(job->res);
+		job->res = 0;
+	}
+}
+
+static void *worker(void *arg) {
+	/* each thread keeps its own cache for all its inputs */
+	struct dis_cache *cache = dis_cache_new(isa, var);
+	while (1) {
+		pthread_mutex_lock(&joblock);
+		int idx = nextjob;
+		if (idx < jobsnum)
+			nextjob++;
+		pthread_mutex_unlock(&joblock);
+		if (idx >= jobsnum)
+			break;
+		dojob(cache, &jobs[idx]);
+		pthread_mutex_lock(&joblock);
+		jobs[idx].done = 1;
+		while (nextout < jobsnum && jobs[nextout].done) {
+			if (jobs[nextout].res) {
+				fwrite(jobs[nextout].res, 1, jobs[nextout].reslen, stdout);
+				free(jobs[nextout].res);
+			}
+			nextout++;
+		}
+		pthread_mutex_unlock(&joblock);
+	}
+	pthread_mutex_lock(&joblock);
+	addstats(cache);
+	pthread_mutex_unlock(&joblock);
+	dis_cache_del(cache);
+	return 0;
+}
+
+static int batch(int nthreads) {
+	pthread_t *threads = calloc(nthreads, sizeof *threads);
+	int i;
+	for (i = 0; i < nthreads; i++)
+		if (pthread_create(&threads[i], 0, worker, 0)) {
+			perror("pthread_create");
+			return 1;
+		}
+	for (i = 0; i < nthreads; i++)
+		pthread_join(threads[i], 0);
+	free(threads);
+	return nerrors != 0;
+}
+
 int main(int argc, char **argv) {
 	FILE *infile = stdin;
-	const struct disisa *isa = 0;
-	struct label *labels = 0;
-	int labelsnum = 0;
-	int labelsmax = 0;
-	int w = 0, bin = 0, quiet = 0;
+	const char *listname = 0;
+	int nthreads = 1;
 	const char **varnames = 0;
 	int varnamesnum = 0;
 	int varnamesmax = 0;
@@ -73,8 +302,6 @@ int main(int argc, char **argv) {
 	const char **featnames = 0;
 	int featnamesnum = 0;
 	int featnamesmax = 0;
-	int wsz = 0;
-	const struct envy_colors *cols = &envy_def_colors;
 	argv[0] = basename(argv[0]);
 	int len = strlen(argv[0]);
 	if (len > 3 && !strcmp(argv[0] + len - 3, "dis")) {
@@ -84,8 +311,7 @@ int main(int argc, char **argv) {
 			w = 1;
 	}
 	int c;
-	unsigned base = 0, skip = 0, limit = 0;
-	while ((c = getopt (argc, argv, "b:d:l:m:V:O:F:wWinqu:M:S:")) != -1)
+	while ((c = getopt (argc, argv, "b:d:l:m:V:O:F:wWinqCg:u:M:S:L:o:j:")) != -1)
 		switch (c) {
 			case 'b':
 				sscanf(optarg, "%x", &base);
@@ -111,6 +337,31 @@ int main(int argc, char **argv) {
 			case 'q':
 				quiet = 1;
 				break;
+			case 'C':
+				printstats = 1;
+				break;
+			case 'g':
+				cfg = 1;
+				if (!strcmp(optarg, "json")) {
+					cfgfmt = DIS_CFG_JSON;
+				} else if (!strcmp(optarg, "dot")) {
+					cfgfmt = DIS_CFG_DOT;
+				} else {
+					fprintf (stderr, "Unknown graph format \"%s\"!\n", optarg);
+					return 1;
+				}
+				break;
+			case 'L':
+				listname = optarg;
+				break;
+			case 'o':
+				outdir = optarg;
+				break;
+			case 'j':
+				nthreads = strtol(optarg, 0, 0);
+				if (nthreads < 1)
+					nthreads = 1;
+				break;
 			case 'n':
 				cols = &envy_null_colors;
 				break;
@@ -200,22 +451,11 @@ int main(int argc, char **argv) {
 					break;
 				}
 		}
-	if (optind < argc) {
-		if (!(infile = fopen(argv[optind], "r"))) {
-			perror(argv[optind]);
-			return 1;
-		}
-		optind++;
-		if (optind < argc) {
-			fprintf (stderr, "Too many parameters!\n");
-			return 1;
-		}
-	}
 	if (!isa) {
 		fprintf (stderr, "No architecture specified!\n");
 		return 1;
 	}
-	struct varinfo *var = varinfo_new(isa->vardata);
+	var = varinfo_new(isa->vardata);
 	if (!var)
 		return 1;
 	int i;
@@ -228,7 +468,7 @@ int main(int argc, char **argv) {
 	for (i = 0; i < modenamesnum; i++)
 		if (varinfo_set_mode(var, modenames[i]))
 			return 1;
-	uint32_t cbsz = ed_getcbsz(isa, var);
+	cbsz = ed_getcbsz(isa, var);
 	if (!cbsz) {
 		fprintf(stderr, "Not enough variant info specified!\n");
 		return 1;
@@ -237,10 +477,6 @@ int main(int argc, char **argv) {
 		fprintf(stderr, "Byte size too large for non-binary input!\n");
 		return 1;
 	}
-	int num = 0;
-	int maxnum = 16;
-	uint8_t *code = malloc (maxnum);
-	unsigned long long t;
 	if (bin) {
 		if (!wsz)
 			wsz = CEILDIV(cbsz, 8);
@@ -248,17 +484,6 @@ int main(int argc, char **argv) {
 			fprintf(stderr, "Stride too small!\n");
 			return 1;
 		}
-		int pos = 0;
-		int c;
-		while ((c = getc(infile)) != EOF) {
-			if (pos < CEILDIV(cbsz, 8)) {
-				if (num >= maxnum) maxnum *= 2, code = realloc (code, maxnum);
-				code[num++] = c;
-			}
-			pos++;
-			if (pos == wsz)
-				pos = 0;
-		}
 	} else {
 		if (wsz) {
 			fprintf(stderr, "Stride is meaningless in hex input mode!\n");
@@ -269,21 +494,45 @@ int main(int argc, char **argv) {
 			wsz = 4;
 		if (cbsz == 8 && w == 2)
 			wsz = 8;
-		while (!feof(infile) && fscanf (infile, "%llx", &t) == 1) {
-			if (num + wsz - 1 >= maxnum) maxnum *= 2, code = realloc (code, maxnum);
-			for (i = 0; i < wsz; i++) {
-				code[num++] = t & 0xff;
-				t >>= 8;
+	}
+	if (listname) {
+		FILE *list = strcmp(listname, "-") ? fopen(listname, "r") : stdin;
+		char buf[0x1000];
+		if (!list) {
+			perror(listname);
+			return 1;
+		}
+		while (fgets(buf, sizeof buf, list)) {
+			buf[strcspn(buf, "\n")] = 0;
+			if (buf[0])
+				addinput(strdup(buf));
+		}
+		if (list != stdin)
+			fclose(list);
+	}
+	for (i = optind; i < argc; i++)
+		addinput(argv[i]);
+	int res = 0;
+	/* a single plain file or stdin is disassembled the old way */
+	if (listname || outdir || nerrors || jobsnum != argc - optind || (jobsnum && (jobsnum > 1 || jobs[0].name != argv[optind]))) {
+		res = batch(nthreads);
+	} else {
+		if (jobsnum) {
+			if (!(infile = fopen(jobs[0].name, "r"))) {
+				perror(jobs[0].name);
+				return 1;
 			}
-			fscanf (infile, " ,");
 		}
+		struct dis_cache *cache = dis_cache_new(isa, var);
+		disfile(cache, infile, stdout);
+		addstats(cache);
+		dis_cache_del(cache);
 	}
-	if (num <= skip)
-		return 0;
-	int cnt = num - skip;
-	cnt /= ed_getcstride(isa, var);
-	if (limit && limit < cnt)
-		cnt = limit;
-	envydis (isa, stdout, code+skip, base, cnt, var, quiet, labels, labelsnum, cols);
-	return 0;
+	if (printstats) {
+		unsigned long long total = cachestats.hits + cachestats.misses + cachestats.uncached;
+		fprintf(stderr, "cache: %llu instructions, %llu hits, %llu misses, %llu uncached, %llu flushes, %.1f%% hit rate\n",
+				total, cachestats.hits, cachestats.misses, cachestats.uncached, cachestats.flushes,
+				total ? 100.0 * cachestats.hits / total : 0.0);
+	}
+	return res;
 }
@@ -0,0 +1,506 @@
+/*
+ * Copyright (C) 2016 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "envyas.h"
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Round-trip verifier: disassembles every encoding of a range, assembles the
+ * text back and reports encodings that don't come back identical.
+ *
+ * Options:
+ *
+ *  -m <machine>  Select the ISA
+ *  -V <variant>  Select variant of the ISA
+ *  -O <mode>     Select processor mode
+ *  -F <feature>  Enable optional ISA feature
+ *
+ *  -s <start>    First encoding index (default 0)
+ *  -n <count>    Number of encodings (default: the whole space, if it has
+ *                at most 32 bits)
+ *  -r <seed>     Check pseudo-random encodings derived from index and seed
+ *                instead of the index itself
+ *  -b <pos>      Position to disassemble at (default 8)
+ *  -j <threads>  Number of worker threads (default 1)
+ *  -c <file>     Checkpoint file: resume from it if it exists and keep it
+ *                updated as the sweep goes
+ *  -u            Also list encodings with unknown bits
+ *
+ * All numbers are hex.
+ */
+
+#define CHUNK 0x1000
+#define CHECKPOINT_SECS 10
+
+enum {
+	RES_OK,
+	RES_UNKNOWN,
+	RES_MISMATCH,
+	RES_ASFAIL,
+	RES_NUM,
+};
+
+static const char *const res_names[RES_NUM] = { "ok", "unknown", "mismatch", "asfail" };
+
+struct pending {
+	ull chunk;
+	ull stats[RES_NUM];
+};
+
+static const struct disisa *isa;
+static const char **varnames, **modenames, **featnames;
+static int varnamesnum, varnamesmax, modenamesnum, modenamesmax, featnamesnum, featnamesmax;
+static char config[0x400];
+static int randmode, listunk;
+static ull seed, start, count, encmask;
+static uint32_t pos = 8;
+static int nbytes;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static ull nchunks, next_chunk, done_chunks;
+static ull stats[RES_NUM];
+static struct pending *pend;
+static int pendnum, pendmax;
+static const char *ckname;
+static time_t last_ck;
+
+static void addconfig(const char *fmt, ...) {
+	int len = strlen(config);
+	va_list va;
+	va_start(va, fmt);
+	vsnprintf(config + len, sizeof config - len, fmt, va);
+	va_end(va);
+}
+
+static struct varinfo *make_varinfo(void) {
+	struct varinfo *varinfo = varinfo_new(isa->vardata);
+	int i;
+	if (!varinfo)
+		return 0;
+	for (i = 0; i < varnamesnum; i++)
+		if (varinfo_set_variant(varinfo, varnames[i]))
+			goto fail;
+	for (i = 0; i < featnamesnum; i++)
+		if (varinfo_set_feature(varinfo, featnames[i]))
+			goto fail;
+	for (i = 0; i < modenamesnum; i++)
+		if (varinfo_set_mode(varinfo, modenames[i]))
+			goto fail;
+	return varinfo;
+fail:
+	varinfo_del(varinfo);
+	return 0;
+}
+
+static ull encoding(ull idx) {
+	if (!randmode)
+		return idx & encmask;
+	/* splitmix64 */
+	ull z = seed + idx * 0x9e3779b97f4a7c15ull;
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return (z ^ (z >> 31)) & encmask;
+}
+
+/* like calc in envyas, without labels */
+static int calc_num(const struct easm_expr *expr, ull *val) {
+	ull x, y;
+	if (expr->type == EASM_EXPR_NUM) {
+		*val = expr->num;
+		return 1;
+	}
+	if (expr->type < EASM_EXPR_LOR || expr->type > EASM_EXPR_LNOT)
+		return 0;
+	if (!calc_num(expr->e1, &x))
+		return 0;
+	if (expr->e2 && !calc_num(expr->e2, &y))
+		return 0;
+	switch (expr->type) {
+		case EASM_EXPR_NEG:
+			*val = -x;
+			return 1;
+		case EASM_EXPR_NOT:
+			*val = ~x;
+			return 1;
+		case EASM_EXPR_LNOT:
+			*val = !x;
+			return 1;
+		case EASM_EXPR_MUL:
+			*val = x * y;
+			return 1;
+		case EASM_EXPR_DIV:
+			if (!y)
+				return 0;
+			*val = x / y;
+			return 1;
+		case EASM_EXPR_MOD:
+			if (!y)
+				return 0;
+			*val = x % y;
+			return 1;
+		case EASM_EXPR_ADD:
+			*val = x + y;
+			return 1;
+		case EASM_EXPR_SUB:
+			*val = x - y;
+			return 1;
+		case EASM_EXPR_SHL:
+			*val = x << y;
+			return 1;
+		case EASM_EXPR_SHR:
+			*val = x >> y;
+			return 1;
+		case EASM_EXPR_AND:
+			*val = x & y;
+			return 1;
+		case EASM_EXPR_XOR:
+			*val = x ^ y;
+			return 1;
+		case EASM_EXPR_OR:
+			*val = x | y;
+			return 1;
+		case EASM_EXPR_LAND:
+			*val = x && y;
+			return 1;
+		case EASM_EXPR_LOR:
+			*val = x || y;
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+/* like resolve in envyas, with calc_num instead of calc */
+static int resolve_num(struct match m, ull *val) {
+	int i;
+	for (i = 0; i < m.nrelocs; i++) {
+		const struct rbitfield *bf = m.relocs[i].bf;
+		ull rval;
+		if (!calc_num(m.relocs[i].expr, &rval))
+			return 0;
+		ull num = rval - bf->addend;
+		if (bf->pcrel)
+			num -= (pos + bf->pospreadd) & -(1ull << bf->shr);
+		num >>= bf->shr;
+		setsbf(&m, bf->sbf[0].pos, bf->sbf[0].len, num);
+		num >>= bf->sbf[0].len;
+		setsbf(&m, bf->sbf[1].pos, bf->sbf[1].len, num);
+		ull mask = ~0ull;
+		ull totalsz = bf->shr + bf->sbf[0].len + bf->sbf[1].len;
+		if (bf->wrapok && totalsz < 64)
+			mask = (1ull << totalsz) - 1;
+		if ((getrbf_as(bf, m.a, m.m, pos) & mask) != (rval & mask))
+			return 0;
+	}
+	for (i = 0; i < MAXOPLEN; i++)
+		val[i] = m.a[i];
+	return 1;
+}
+
+static void report(ull enc, const char *what, const char *text, const char *extra) {
+	flockfile(stdout);
+	printf("%0*llx: %s: %s%s\n", nbytes * 2, enc, what, text, extra);
+	funlockfile(stdout);
+}
+
+static int check(struct varinfo *varinfo, ull enc) {
+	uint8_t code[MAXOPLEN * 8] = { 0 };
+	char text[0x1000];
+	int stride = ed_getcstride(isa, varinfo);
+	int oplen, status, i, res;
+	ull unk[MAXOPLEN];
+	for (i = 0; i < 8; i++)
+		code[i] = enc >> i * 8;
+	struct easm_insn *insn = dis_insn(isa, varinfo, code, pos, &oplen, &status, unk);
+	FILE *f = fmemopen(text, sizeof text, "w");
+	easm_print_insn(f, &envy_null_colors, insn);
+	fputc(0, f);
+	fclose(f);
+	text[sizeof text - 2] = 0;
+	easm_del_insn(insn);
+	if (status & (DIS_STATUS_UNK_FORM | DIS_STATUS_UNK_INSN | DIS_STATUS_UNK_OPERAND)) {
+		if (listunk)
+			report(enc, "unknown", text, "");
+		return RES_UNKNOWN;
+	}
+	for (i = 0; i < MAXOPLEN; i++)
+		if (unk[i]) {
+			if (listunk)
+				report(enc, "unknown bits", text, "");
+			return RES_UNKNOWN;
+		}
+
+	struct easm_file *file;
+	/* the parser wants whole lines */
+	size_t len = strlen(text);
+	text[len] = '\n';
+	f = fmemopen(text, len + 1, "r");
+	int r = easm_read_file(f, "roundtrip", &file);
+	fclose(f);
+	text[len] = 0;
+	if (r || file->linesnum != 1 || file->lines[0]->type != EASM_LINE_INSN) {
+		if (!r)
+			easm_del_file(file);
+		report(enc, "asfail", text, " [parse error]");
+		return RES_ASFAIL;
+	}
+	struct matches *ms = do_as(isa, varinfo, file->lines[0]->insn);
+	res = RES_ASFAIL;
+	for (i = 0; i < ms->mnum; i++) {
+		ull val[MAXOPLEN];
+		if (!resolve_num(ms->m[i], val))
+			continue;
+		int len = ms->m[i].oplen * stride;
+		ull vmask = len >= 8 ? ~0ull : (1ull << len * 8) - 1;
+		if (ms->m[i].oplen == oplen && (val[0] & vmask) == (enc & vmask)) {
+			res = RES_OK;
+		} else {
+			char extra[64];
+			snprintf(extra, sizeof extra, " -> %0*llx", len * 2, val[0] & vmask);
+			report(enc, "mismatch", text, extra);
+			res = RES_MISMATCH;
+		}
+		break;
+	}
+	if (res == RES_ASFAIL)
+		report(enc, "asfail", text, ms->mnum ? " [relocation failed]" : " [no match]");
+	del_matches(ms);
+	easm_del_file(file);
+	return res;
+}
+
+static void write_checkpoint(void) {
+	char *tmpname = aprintf("%s.tmp", ckname);
+	FILE *f = fopen(tmpname, "w");
+	int i;
+	if (!f) {
+		perror(tmpname);
+		exit(1);
+	}
+	fprintf(f, "config%s\n", config);
+	fprintf(f, "next %llx\n", start + done_chunks * CHUNK);
+	for (i = 0; i < RES_NUM; i++)
+		fprintf(f, "%s %llx\n", res_names[i], stats[i]);
+	if (fclose(f) || rename(tmpname, ckname)) {
+		perror(ckname);
+		exit(1);
+	}
+	free(tmpname);
+	last_ck = time(0);
+}
+
+static int read_checkpoint(void) {
+	FILE *f = fopen(ckname, "r");
+	char line[0x500] = "";
+	ull next = 0;
+	int i;
+	if (!f)
+		return 0;
+	if (fgets(line, sizeof line, f))
+		line[strcspn(line, "\n")] = 0;
+	if (strncmp(line, "config", 6) || strcmp(line + 6, config)) {
+		fprintf(stderr, "%s: made by a sweep with different parameters\n", ckname);
+		exit(1);
+	}
+	if (fscanf(f, " next %llx", &next) != 1)
+		goto bad;
+	for (i = 0; i < RES_NUM; i++) {
+		char name[16];
+		if (fscanf(f, " %15s %llx", name, &stats[i]) != 2 || strcmp(name, res_names[i]))
+			goto bad;
+	}
+	fclose(f);
+	if (next < start || (next - start) % CHUNK)
+		goto bad;
+	done_chunks = next_chunk = (next - start) / CHUNK;
+	fprintf(stderr, "resuming at %llx\n", next);
+	return 0;
+bad:
+	fprintf(stderr, "%s: malformed checkpoint\n", ckname);
+	exit(1);
+}
+
+/* folds in a finished chunk; chunks finish out of order, so the checkpoint
+ * only covers the ones below the lowest still running */
+static void chunk_done(ull chunk, ull *cstats) {
+	int i, j;
+	pthread_mutex_lock(&lock);
+	struct pending p = { chunk };
+	for (i = 0; i < RES_NUM; i++)
+		p.stats[i] = cstats[i];
+	ADDARRAY(pend, p);
+	for (i = 0; i < pendnum; ) {
+		if (pend[i].chunk == done_chunks) {
+			for (j = 0; j < RES_NUM; j++)
+				stats[j] += pend[i].stats[j];
+			done_chunks++;
+			pend[i] = pend[--pendnum];
+			i = 0;
+		} else {
+			i++;
+		}
+	}
+	if (ckname && time(0) - last_ck >= CHECKPOINT_SECS)
+		write_checkpoint();
+	pthread_mutex_unlock(&lock);
+}
+
+static void *worker(void *arg) {
+	struct varinfo *varinfo = make_varinfo();
+	while (1) {
+		ull cstats[RES_NUM] = { 0 };
+		ull chunk, idx, end;
+		pthread_mutex_lock(&lock);
+		chunk = next_chunk;
+		if (chunk < nchunks)
+			next_chunk++;
+		pthread_mutex_unlock(&lock);
+		if (chunk >= nchunks)
+			break;
+		idx = start + chunk * CHUNK;
+		end = idx + CHUNK;
+		if (end - start > count)
+			end = start + count;
+		for (; idx < end; idx++)
+			cstats[check(varinfo, encoding(idx))]++;
+		chunk_done(chunk, cstats);
+	}
+	varinfo_del(varinfo);
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	int nthreads = 1;
+	int hascount = 0;
+	int c, i;
+	while ((c = getopt (argc, argv, "m:V:O:F:s:n:r:b:j:c:u")) != -1)
+		switch (c) {
+			case 'm':
+				addconfig(" m=%s", optarg);
+				isa = ed_getisa(optarg);
+				if (!isa) {
+					fprintf (stderr, "Unknown architecture \"%s\"!\n", optarg);
+					return 1;
+				}
+				break;
+			case 'V':
+				addconfig(" V=%s", optarg);
+				ADDARRAY(varnames, optarg);
+				break;
+			case 'O':
+				addconfig(" O=%s", optarg);
+				ADDARRAY(modenames, optarg);
+				break;
+			case 'F':
+				addconfig(" F=%s", optarg);
+				ADDARRAY(featnames, optarg);
+				break;
+			case 's':
+				sscanf(optarg, "%llx", &start);
+				break;
+			case 'n':
+				sscanf(optarg, "%llx", &count);
+				hascount = 1;
+				break;
+			case 'r':
+				sscanf(optarg, "%llx", &seed);
+				randmode = 1;
+				break;
+			case 'b':
+				sscanf(optarg, "%x", &pos);
+				break;
+			case 'j':
+				nthreads = strtol(optarg, 0, 0);
+				break;
+			case 'c':
+				ckname = optarg;
+				break;
+			case 'u':
+				listunk = 1;
+				break;
+			default:
+				return 1;
+		}
+	if (!isa) {
+		fprintf (stderr, "No architecture specified!\n");
+		return 1;
+	}
+	struct varinfo *varinfo = make_varinfo();
+	if (!varinfo)
+		return 1;
+	if (!ed_getcbsz(isa, varinfo)) {
+		fprintf(stderr, "Not enough variant info specified!\n");
+		return 1;
+	}
+	nbytes = isa->maxoplen * ed_getcstride(isa, varinfo);
+	if (nbytes > 8) {
+		fprintf(stderr, "Instructions longer than 64 bits are not supported\n");
+		return 1;
+	}
+	encmask = nbytes == 8 ? ~0ull : (1ull << nbytes * 8) - 1;
+	varinfo_del(varinfo);
+	if (!hascount) {
+		if (randmode || nbytes > 4) {
+			fprintf(stderr, "Encoding space too large, use -n\n");
+			return 1;
+		}
+		count = encmask + 1 - start;
+	}
+	if (nthreads < 1)
+		nthreads = 1;
+
+	addconfig(" s=%llx n=%llx b=%x", start, count, pos);
+	if (randmode)
+		addconfig(" r=%llx", seed);
+
+	nchunks = CEILDIV(count, CHUNK);
+	if (ckname)
+		read_checkpoint();
+	last_ck = time(0);
+
+	pthread_t *threads = calloc(nthreads, sizeof *threads);
+	for (i = 0; i < nthreads; i++)
+		if (pthread_create(&threads[i], 0, worker, 0)) {
+			perror("pthread_create");
+			return 1;
+		}
+	for (i = 0; i < nthreads; i++)
+		pthread_join(threads[i], 0);
+	free(threads);
+	if (ckname)
+		write_checkpoint();
+
+	ull total = 0;
+	for (i = 0; i < RES_NUM; i++)
+		total += stats[i];
+	fprintf(stderr, "%llu encodings: %llu ok, %llu unknown, %llu mismatched, %llu failed to assemble\n",
+			total, stats[RES_OK], stats[RES_UNKNOWN], stats[RES_MISMATCH], stats[RES_ASFAIL]);
+	return stats[RES_MISMATCH] || stats[RES_ASFAIL];
+}
@@ -26,6 +26,7 @@
 #include "old.h"
 #include "nva.h"
 #include <unistd.h>
+#include <sys/wait.h>
 #include <stdio.h>
 #include <string.h>
 #include <pciaccess.h>
@@ -34,11 +35,22 @@ hwtest::Test::Test(TestOptions &opt, uint32_t seed) : rnd(seed), opt(opt), cnum(
 	chipset = nva_cards[cnum]->chipset;
 }
 
-int hwtest::RepeatTest::run() {
-	int num = repeats() * opt.repeat_factor;
+int hwtest::RepeatTest::run_shard(uint32_t seed, int num, int shard, int step) {
 	int worst = HWTEST_RES_NA;
-	for (int i = 0; i < num; i++) {
-		int res = run_once();
+	for (int i = shard; i < num; i += step) {
+		int res;
+		/* every iteration gets its own seed, so that it can be replayed
+		 * or run in any shard on its own */
+		rnd.seed(seed + i);
+		try {
+			replay_begin(i);
+			res = run_once();
+			replay_end();
+		} catch (ReplayError &e) {
+			replay_end(true);
+			printf("%s\n", e.what());
+			res = e.missing ? HWTEST_RES_NA : HWTEST_RES_FAIL;
+		}
 		if (res >= worst)
 			worst = res;
 		if (res > HWTEST_RES_PASS) {
@@ -50,9 +62,57 @@ int hwtest::RepeatTest::run() {
 	return worst;
 }
 
+int hwtest::RepeatTest::run() {
+	int num = repeats() * opt.repeat_factor;
+	uint32_t seed = rnd();
+	if (opt.jobs <= 1)
+		return run_shard(seed, num, 0, 1);
+	/* Each shard runs in a forked child - tests carry their state in
+	 * the Test object, and fork gives every shard its own copy.  Output
+	 * goes to a temporary file, to be printed in shard order.  */
+	std::vector<std::pair<pid_t, FILE *>> shards;
+	fflush(stdout);
+	for (int i = 0; i < opt.jobs; i++) {
+		FILE *out = tmpfile();
+		if (!out) {
+			perror("tmpfile");
+			break;
+		}
+		pid_t pid = fork();
+		if (pid == 0) {
+			dup2(fileno(out), 1);
+			int res = run_shard(seed, num, i, opt.jobs);
+			fflush(stdout);
+			_exit(res);
+		}
+		if (pid < 0) {
+			perror("fork");
+			fclose(out);
+			break;
+		}
+		shards.push_back({pid, out});
+	}
+	int worst = shards.size() == (size_t)opt.jobs ? HWTEST_RES_NA : HWTEST_RES_FAIL;
+	for (auto &shard : shards) {
+		int status;
+		int res = HWTEST_RES_FAIL;
+		if (waitpid(shard.first, &status, 0) == shard.first && WIFEXITED(status))
+			res = WEXITSTATUS(status);
+		if (res >= worst)
+			worst = res;
+		char buf[0x1000];
+		size_t len;
+		rewind(shard.second);
+		while ((len = fread(buf, 1, sizeof buf, shard.second)))
+			fwrite(buf, 1, len, stdout);
+		fclose(shard.second);
+	}
+	return worst;
+}
+
 namespace {
 
-int hwtest_run_group(hwtest::TestOptions &opt, std::string gname, hwtest::Test *group, int indent, const char *filter, bool boring = false) {
+int hwtest_run_group(hwtest::TestOptions &opt, std::string gname, std::string path, hwtest::Test *group, int indent, const char *filter, bool boring = false) {
 	static const char *const tabn[] = {
 		[HWTEST_RES_NA] = "n/a",
 		[HWTEST_RES_PASS] = "passed",
@@ -70,7 +130,16 @@ int hwtest_run_group(hwtest::TestOptions &opt, std::string gname, hwtest::Test *
 	if (!group->supported()) {
 		pres = HWTEST_RES_NA;
 	} else {
-		pres = group->run();
+		hwtest::replay_set_path(path);
+		try {
+			hwtest::replay_begin(-1);
+			pres = group->run();
+			hwtest::replay_end();
+		} catch (hwtest::ReplayError &e) {
+			hwtest::replay_end(true);
+			printf("%s\n", e.what());
+			pres = e.missing ? HWTEST_RES_NA : HWTEST_RES_FAIL;
+		}
 	}
 	bool sboring = group->subtests_boring();
 	auto subtests = group->subtests();
@@ -109,7 +178,7 @@ int hwtest_run_group(hwtest::TestOptions &opt, std::string gname, hwtest::Test *
 		if (filter && name != curfilt && curfilt != "*")
 			continue;
 		found = true;
-		int res = hwtest_run_group(opt, name, test, indent, fnext, sboring);
+		int res = hwtest_run_group(opt, name, path + "/" + name, test, indent, fnext, sboring);
 		if (worst < res)
 			worst = res;
 		delete test;
@@ -156,13 +225,11 @@ int main(int argc, char **argv) {
 	opt.cnum = 0;
 	opt.repeat_factor = 10;
 	opt.keep_going = false;
-	if (nva_init()) {
-		fprintf (stderr, "PCI init failure!\n");
-		return 1;
-	}
+	opt.jobs = 1;
 	int c;
 	bool force = false;
-	while ((c = getopt (argc, argv, "c:nsfr:k")) != -1)
+	const char *record = 0, *replay = 0;
+	while ((c = getopt (argc, argv, "c:nsfr:kw:p:j:")) != -1)
 		switch (c) {
 			case 'c':
 				sscanf(optarg, "%d", &opt.cnum);
@@ -182,7 +249,35 @@ int main(int argc, char **argv) {
 			case 'r':
 				sscanf(optarg, "%d", &opt.repeat_factor);
 				break;
+			case 'w':
+				record = optarg;
+				break;
+			case 'p':
+				replay = optarg;
+				break;
+			case 'j':
+				sscanf(optarg, "%d", &opt.jobs);
+				break;
+		}
+	if (replay) {
+		if (record) {
+			fprintf (stderr, "Can't record and replay at once.\n");
+			return 1;
 		}
+		opt.cnum = 0;
+		if (hwtest::replay_load(replay))
+			return 1;
+		goto run;
+	}
+	if (opt.jobs > 1) {
+		/* the card has a single PGRAPH, after all */
+		fprintf (stderr, "WARNING: -j only works when replaying, ignoring.\n");
+		opt.jobs = 1;
+	}
+	if (nva_init()) {
+		fprintf (stderr, "PCI init failure!\n");
+		return 1;
+	}
 	if (opt.cnum >= nva_cardsnum) {
 		if (nva_cardsnum)
 			fprintf (stderr, "No such card.\n");
@@ -199,16 +294,20 @@ int main(int argc, char **argv) {
 			return 1;
 		}
 	}
+	if (record && hwtest::replay_record(opt.cnum, record))
+		return 1;
+run:
 	hwtest::Test *root = new RootTest(opt, 1);
 	int worst = 0;
 	if (optind == argc) {
 		printf("Running all tests...\n");
-		worst = hwtest_run_group(opt, "", root, 0, nullptr);
+		worst = hwtest_run_group(opt, "", "", root, 0, nullptr);
 	} else while (optind < argc) {
-		int res = hwtest_run_group(opt, "", root, 0, argv[optind++]);
+		int res = hwtest_run_group(opt, "", "", root, 0, argv[optind++]);
 		if (res > worst)
 			worst = res;
 	}
+	hwtest::replay_finish();
 	if (worst == HWTEST_RES_PASS)
 		return 0;
 	else
@@ -32,6 +32,7 @@
 #include <string>
 #include <utility>
 #include <random>
+#include <stdexcept>
 
 enum hwtest_res {
 	HWTEST_RES_NA,
@@ -47,6 +48,7 @@ namespace hwtest {
 		bool colors;
 		bool keep_going;
 		int repeat_factor;
+		int jobs;
 	};
 
 	class Test {
@@ -79,10 +81,26 @@ namespace hwtest {
 		virtual int repeats() {
 			return 1000;
 		}
+		int run_shard(uint32_t seed, int num, int shard, int step);
 	public:
 		int run() override;
 		using Test::Test;
 	};
+
+	/* Raised by MMIO accesses when a replay can't go on.  */
+	class ReplayError : public std::runtime_error {
+	public:
+		bool missing;
+		ReplayError(bool missing, const std::string &msg);
+	};
+
+	int replay_record(int cnum, const char *fname);
+	int replay_load(const char *fname);
+	bool replay_active();
+	void replay_set_path(const std::string &path);
+	void replay_begin(int iter);
+	void replay_end(bool abort = false);
+	void replay_finish();
 }
 
 uint32_t vram_rd32(int card, uint64_t addr);
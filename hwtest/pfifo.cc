@@ -614,7 +614,7 @@ class PFifoUserWriteTest : public PFifoStateTest {
 			nva_wr8(cnum, addr, val);
 		} else if (sz == 1) {
 			val &= 0xffff;
-			*((volatile uint16_t*)(((volatile uint8_t *)nva_cards[cnum]->bar0) + addr)) = val;
+			nva_wr16(cnum, addr, val);
 		} else {
 			nva_wr32(cnum, addr, val);
 		}
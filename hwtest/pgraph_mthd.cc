@@ -114,16 +114,16 @@ static void nv03_pgraph_prep_mthd(struct pgraph_state *state, uint32_t *pgctx, i
 static void nv03_pgraph_mthd(int cnum, struct pgraph_state *state, uint32_t *grobj, uint32_t gctx, uint32_t addr, uint32_t val) {
 	if (extr(state->debug[1], 16, 1) || extr(addr, 0, 13) == 0) {
 		uint32_t inst = gctx & 0xffff;
-		nva_gwr32(nva_cards[cnum]->bar1, 0xc00000 + inst * 0x10, grobj[0]);
-		nva_gwr32(nva_cards[cnum]->bar1, 0xc00004 + inst * 0x10, grobj[1]);
-		nva_gwr32(nva_cards[cnum]->bar1, 0xc00008 + inst * 0x10, grobj[2]);
-		nva_gwr32(nva_cards[cnum]->bar1, 0xc0000c + inst * 0x10, grobj[3]);
+		nva_bar1_wr32(cnum, 0xc00000 + inst * 0x10, grobj[0]);
+		nva_bar1_wr32(cnum, 0xc00004 + inst * 0x10, grobj[1]);
+		nva_bar1_wr32(cnum, 0xc00008 + inst * 0x10, grobj[2]);
+		nva_bar1_wr32(cnum, 0xc0000c + inst * 0x10, grobj[3]);
 	}
 	if ((addr & 0x1ffc) == 0) {
 		int i;
 		for (i = 0; i < 0x200; i++) {
-			nva_gwr32(nva_cards[cnum]->bar1, 0xc00000 + i * 8, val);
-			nva_gwr32(nva_cards[cnum]->bar1, 0xc00004 + i * 8, gctx | 1 << 23);
+			nva_bar1_wr32(cnum, 0xc00000 + i * 8, val);
+			nva_bar1_wr32(cnum, 0xc00004 + i * 8, gctx | 1 << 23);
 		}
 	}
 	nva_wr32(cnum, 0x2100, 0xffffffff);
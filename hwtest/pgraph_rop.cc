@@ -149,7 +149,7 @@ class RopSolidTest : public MthdTest {
 			for (int j = 0; j < 4; j++) {
 				paddr[j] = (x * cpp + y * 0x400 + j * 0x40000);
 				pixel[j] = epixel[j] = rnd();
-				nva_gwr32(nva_cards[cnum]->bar1, paddr[j] & ~3, pixel[j]);
+				nva_bar1_wr32(cnum, paddr[j] & ~3, pixel[j]);
 			}
 		}
 		val = y << 16 | x;
@@ -234,7 +234,7 @@ class RopSolidTest : public MthdTest {
 			}
 		} else {
 			for (int j = 0; j < 4; j++) {
-				rpixel[j] = nva_grd32(nva_cards[cnum]->bar1, paddr[j] & ~3);
+				rpixel[j] = nva_bar1_rd32(cnum, paddr[j] & ~3);
 				if (rpixel[j] != epixel[j]) {
 					printf("Difference in PIXEL[%d]: expected %08x real %08x\n", j, epixel[j], rpixel[j]);
 					res = true;
@@ -387,12 +387,12 @@ class RopBlitTest : public MthdTest {
 				spaddr[j] = (sx * cpp + sy * 0x400 + j * 0x40000);
 				spixel[j] = rnd();
 				if (sx >= 0x80)
-					nva_gwr32(nva_cards[cnum]->bar1, spaddr[j] & ~3, spixel[j]);
+					nva_bar1_wr32(cnum, spaddr[j] & ~3, spixel[j]);
 			}
 			for (int j = 0; j < 4; j++) {
 				paddr[j] = (x * cpp + y * 0x400 + j * 0x40000);
 				pixel[j] = epixel[j] = rnd();
-				nva_gwr32(nva_cards[cnum]->bar1, paddr[j] & ~3, pixel[j]);
+				nva_bar1_wr32(cnum, paddr[j] & ~3, pixel[j]);
 			}
 		}
 		val = 1 << 16 | 1;
@@ -485,7 +485,7 @@ class RopBlitTest : public MthdTest {
 			}
 		} else {
 			for (int j = 0; j < 4; j++) {
-				rpixel[j] = nva_grd32(nva_cards[cnum]->bar1, paddr[j] & ~3);
+				rpixel[j] = nva_bar1_rd32(cnum, paddr[j] & ~3);
 				if (rpixel[j] != epixel[j]) {
 					printf("Difference in PIXEL[%d]: expected %08x real %08x\n", j, epixel[j], rpixel[j]);
 					res = true;
@@ -566,7 +566,7 @@ class RopZPointTest : public MthdTest {
 		for (int j = 0; j < 4; j++) {
 			paddr[j] = (x * cpp + y * 0x400 + j * 0x40000);
 			pixel[j] = epixel[j] = rnd();
-			nva_gwr32(nva_cards[cnum]->bar1, paddr[j] & ~3, pixel[j]);
+			nva_bar1_wr32(cnum, paddr[j] & ~3, pixel[j]);
 		}
 		uint32_t zcur = extr(pixel[3], (paddr[3] & 3) * 8, cpp * 8);
 		if (!(rnd() & 3)) {
@@ -613,7 +613,7 @@ class RopZPointTest : public MthdTest {
 	bool other_fail() override {
 		bool res = false;
 		for (int j = 0; j < 4; j++) {
-			rpixel[j] = nva_grd32(nva_cards[cnum]->bar1, paddr[j] & ~3);
+			rpixel[j] = nva_bar1_rd32(cnum, paddr[j] & ~3);
 			if (rpixel[j] != epixel[j]) {
 				printf("Difference in PIXEL[%d]: expected %08x real %08x\n", j, epixel[j], rpixel[j]);
 				res = true;
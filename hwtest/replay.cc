@@ -0,0 +1,362 @@
+/*
+ * Copyright (C) 2016 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "hwtest.h"
+#include "nva.h"
+#include <stdio.h>
+#include <string.h>
+#include <unordered_map>
+
+/*
+ * Recording and replay of hardware results.
+ *
+ * When recording, every BAR0/BAR1 read made by a test is logged, together
+ * with a hash of all writes.  Accesses are grouped into segments, one per
+ * RepeatTest iteration (and one per plain test run), keyed by test path and
+ * iteration number.  Since every iteration is reseeded from its index, the
+ * segments can be replayed independently, in any order, without the card.
+ *
+ * File format: "HWTR", version byte, PMC_ID (LE32), then segments:
+ *
+ *	varint pathlen, path, varint iteration + 1
+ *	varint bodylen, body
+ *	LE32 write hash
+ *
+ * The body is a sequence of reads: varint tag, then varint value unless the
+ * read returned the last value written to or read from that address within
+ * the segment.  The tag is zigzag(addr - prev addr) << 4 | bar << 3 |
+ * sizecode << 1 | same, where sizecode is 0, 1 or 2 for 4, 1 or 2 bytes.
+ */
+
+namespace hwtest {
+
+namespace {
+
+const char magic[4] = { 'H', 'W', 'T', 'R' };
+const int version = 1;
+
+enum {
+	MODE_NONE,
+	MODE_RECORD,
+	MODE_REPLAY,
+} mode;
+
+struct Segment {
+	std::string key;
+	bool missing;
+	/* record: the body being built; replay: points into the file */
+	std::vector<uint8_t> body;
+	const uint8_t *ptr, *end;
+	size_t hdrlen;
+	uint32_t prev_addr;
+	uint32_t whash, exp_whash;
+	std::unordered_map<uint64_t, uint32_t> known;
+};
+
+std::string cur_path;
+std::vector<Segment> segs;
+FILE *rec_file;
+struct nva_card *real_card;
+struct nva_card replay_card;
+struct nva_card *replay_cards[1];
+std::vector<uint8_t> replay_data;
+std::unordered_map<std::string, size_t> replay_index;
+
+std::string seg_key(const std::string &path, int iter) {
+	return path + "#" + std::to_string(iter);
+}
+
+void put_varint(std::vector<uint8_t> &out, uint64_t val) {
+	while (val >= 0x80) {
+		out.push_back(val | 0x80);
+		val >>= 7;
+	}
+	out.push_back(val);
+}
+
+bool get_varint(const uint8_t *&ptr, const uint8_t *end, uint64_t *val) {
+	uint64_t res = 0;
+	int shift = 0;
+	while (ptr < end && shift < 64) {
+		uint8_t byte = *ptr++;
+		res |= (uint64_t)(byte & 0x7f) << shift;
+		if (!(byte & 0x80)) {
+			*val = res;
+			return true;
+		}
+		shift += 7;
+	}
+	return false;
+}
+
+uint32_t get_le32(const uint8_t *ptr) {
+	return ptr[0] | ptr[1] << 8 | ptr[2] << 16 | (uint32_t)ptr[3] << 24;
+}
+
+void put_le32(uint8_t *ptr, uint32_t val) {
+	ptr[0] = val;
+	ptr[1] = val >> 8;
+	ptr[2] = val >> 16;
+	ptr[3] = val >> 24;
+}
+
+uint64_t known_key(int bar, uint32_t addr, int size) {
+	return (uint64_t)addr | (uint64_t)bar << 32 | (uint64_t)size << 33;
+}
+
+int size_code(int size) {
+	return size == 4 ? 0 : size;
+}
+
+uint32_t hash_word(uint32_t hash, uint32_t val) {
+	for (int i = 0; i < 4; i++) {
+		hash ^= val >> i * 8 & 0xff;
+		hash *= 0x01000193;
+	}
+	return hash;
+}
+
+void hook_wr(void *priv, int bar, uint32_t addr, uint32_t val, int size) {
+	if (mode == MODE_RECORD) {
+		if (bar)
+			nva_gwr32(real_card->bar1, addr, val);
+		else if (size == 1)
+			nva_gwr8(real_card->bar0, addr, val);
+		else if (size == 2)
+			nva_gwr16(real_card->bar0, addr, val);
+		else
+			nva_gwr32(real_card->bar0, addr, val);
+	}
+	if (segs.empty())
+		return;
+	Segment &seg = segs.back();
+	seg.whash = hash_word(seg.whash, bar << 4 | size);
+	seg.whash = hash_word(seg.whash, addr);
+	seg.whash = hash_word(seg.whash, val);
+	seg.known[known_key(bar, addr, size)] = val;
+}
+
+void diverged(Segment &seg, const char *what) {
+	throw ReplayError(seg.missing, "Replay of " + seg.key + ": " + what);
+}
+
+uint32_t hook_rd(void *priv, int bar, uint32_t addr, int size) {
+	if (mode == MODE_REPLAY && segs.empty())
+		throw ReplayError(true, "Replay: hardware access outside of a test");
+	uint64_t kk = known_key(bar, addr, size);
+	uint32_t val;
+	if (mode == MODE_RECORD) {
+		if (bar)
+			val = nva_grd32(real_card->bar1, addr);
+		else if (size == 1)
+			val = nva_grd8(real_card->bar0, addr);
+		else if (size == 2)
+			val = nva_grd16(real_card->bar0, addr);
+		else
+			val = nva_grd32(real_card->bar0, addr);
+		if (segs.empty())
+			return val;
+		Segment &seg = segs.back();
+		auto it = seg.known.find(kk);
+		bool same = it != seg.known.end() && it->second == val;
+		int32_t delta = addr - seg.prev_addr;
+		uint64_t zz = (uint32_t)delta << 1 ^ (uint32_t)(delta >> 31);
+		put_varint(seg.body, zz << 4 | bar << 3 | size_code(size) << 1 | same);
+		if (!same)
+			put_varint(seg.body, val);
+		seg.prev_addr = addr;
+		seg.known[kk] = val;
+		return val;
+	}
+	Segment &seg = segs.back();
+	if (seg.missing)
+		diverged(seg, "not recorded");
+	uint64_t tag, rval;
+	if (seg.ptr == seg.end)
+		diverged(seg, "more reads than recorded");
+	if (!get_varint(seg.ptr, seg.end, &tag))
+		diverged(seg, "corrupt recording");
+	uint32_t zz = tag >> 4;
+	uint32_t raddr = seg.prev_addr + (zz >> 1 ^ -(zz & 1));
+	if (raddr != addr || (int)(tag >> 3 & 1) != bar || (int)(tag >> 1 & 3) != size_code(size)) {
+		char buf[100];
+		snprintf(buf, sizeof buf, "read of %d:%08x, recorded %d:%08x", bar, addr, (int)(tag >> 3 & 1), raddr);
+		diverged(seg, buf);
+	}
+	if (tag & 1) {
+		auto it = seg.known.find(kk);
+		if (it == seg.known.end())
+			diverged(seg, "corrupt recording");
+		val = it->second;
+	} else {
+		if (!get_varint(seg.ptr, seg.end, &rval))
+			diverged(seg, "corrupt recording");
+		val = rval;
+	}
+	seg.prev_addr = addr;
+	seg.known[kk] = val;
+	return val;
+}
+
+const struct nva_hook replay_hook = { hook_rd, hook_wr };
+
+}
+
+ReplayError::ReplayError(bool missing, const std::string &msg) : std::runtime_error(msg), missing(missing) {}
+
+int replay_record(int cnum, const char *fname) {
+	rec_file = fopen(fname, "wb");
+	if (!rec_file) {
+		perror(fname);
+		return 1;
+	}
+	real_card = nva_cards[cnum];
+	uint8_t hdr[9];
+	memcpy(hdr, magic, 4);
+	hdr[4] = version;
+	put_le32(hdr + 5, real_card->chipset.pmc_id);
+	fwrite(hdr, sizeof hdr, 1, rec_file);
+	real_card->hook = &replay_hook;
+	mode = MODE_RECORD;
+	return 0;
+}
+
+int replay_load(const char *fname) {
+	FILE *file = fopen(fname, "rb");
+	if (!file) {
+		perror(fname);
+		return 1;
+	}
+	uint8_t buf[0x10000];
+	size_t num;
+	while ((num = fread(buf, 1, sizeof buf, file)))
+		replay_data.insert(replay_data.end(), buf, buf + num);
+	fclose(file);
+	if (replay_data.size() < 9 || memcmp(replay_data.data(), magic, 4) || replay_data[4] != version) {
+		fprintf(stderr, "%s: not a hwtest recording\n", fname);
+		return 1;
+	}
+	const uint8_t *ptr = replay_data.data() + 9, *end = replay_data.data() + replay_data.size();
+	while (ptr != end) {
+		size_t start = ptr - replay_data.data();
+		uint64_t len, iter;
+		if (!get_varint(ptr, end, &len) || len > (size_t)(end - ptr))
+			goto corrupt;
+		std::string path((const char *)ptr, len);
+		ptr += len;
+		if (!get_varint(ptr, end, &iter) || !get_varint(ptr, end, &len) || (size_t)(end - ptr) < len + 4ull)
+			goto corrupt;
+		ptr += len + 4;
+		replay_index.insert({seg_key(path, (int)iter - 1), start});
+	}
+	parse_pmc_id(get_le32(replay_data.data() + 5), &replay_card.chipset);
+	replay_card.type = NVA_DEVICE_GPU;
+	replay_card.hook = &replay_hook;
+	replay_cards[0] = &replay_card;
+	nva_cards = replay_cards;
+	nva_cardsnum = 1;
+	mode = MODE_REPLAY;
+	return 0;
+corrupt:
+	fprintf(stderr, "%s: corrupt recording\n", fname);
+	return 1;
+}
+
+bool replay_active() {
+	return mode == MODE_REPLAY;
+}
+
+void replay_set_path(const std::string &path) {
+	cur_path = path;
+}
+
+void replay_begin(int iter) {
+	if (mode == MODE_NONE)
+		return;
+	segs.emplace_back();
+	Segment &seg = segs.back();
+	seg.key = seg_key(cur_path, iter);
+	seg.missing = false;
+	seg.prev_addr = 0;
+	seg.whash = 0x811c9dc5;
+	if (mode == MODE_RECORD) {
+		put_varint(seg.body, cur_path.size());
+		seg.body.insert(seg.body.end(), cur_path.begin(), cur_path.end());
+		put_varint(seg.body, iter + 1);
+		/* the body proper starts here */
+		seg.hdrlen = seg.body.size();
+		return;
+	}
+	auto it = replay_index.find(seg.key);
+	if (it == replay_index.end()) {
+		seg.missing = true;
+		return;
+	}
+	const uint8_t *ptr = replay_data.data() + it->second, *end = replay_data.data() + replay_data.size();
+	uint64_t len, dummy;
+	get_varint(ptr, end, &len);
+	ptr += len;
+	get_varint(ptr, end, &dummy);
+	get_varint(ptr, end, &len);
+	seg.ptr = ptr;
+	seg.end = ptr + len;
+	seg.exp_whash = get_le32(seg.end);
+}
+
+void replay_end(bool abort) {
+	if (mode == MODE_NONE)
+		return;
+	Segment &seg = segs.back();
+	if (mode == MODE_REPLAY && !abort) {
+		/* throws with the segment still open - the caller aborts it */
+		if (seg.missing && seg.whash != 0x811c9dc5)
+			diverged(seg, "not recorded");
+		if (!seg.missing && seg.ptr != seg.end)
+			diverged(seg, "fewer reads than recorded");
+		if (!seg.missing && seg.whash != seg.exp_whash)
+			diverged(seg, "writes differ from the recording");
+	}
+	if (mode == MODE_RECORD && (seg.body.size() != seg.hdrlen || seg.whash != 0x811c9dc5)) {
+		std::vector<uint8_t> len;
+		put_varint(len, seg.body.size() - seg.hdrlen);
+		uint8_t whash[4];
+		put_le32(whash, seg.whash);
+		fwrite(seg.body.data(), seg.hdrlen, 1, rec_file);
+		fwrite(len.data(), len.size(), 1, rec_file);
+		fwrite(seg.body.data() + seg.hdrlen, seg.body.size() - seg.hdrlen, 1, rec_file);
+		fwrite(whash, 4, 1, rec_file);
+	}
+	segs.pop_back();
+}
+
+void replay_finish() {
+	if (rec_file) {
+		real_card->hook = 0;
+		fclose(rec_file);
+		rec_file = 0;
+	}
+}
+
+}
@@ -29,7 +29,7 @@ uint32_t vram_rd32(int card, uint64_t addr) {
 	if (nva_cards[card]->chipset.card_type < 3) {
 		return nva_rd32(card, 0x1000000 + addr);
 	} else if (nva_cards[card]->chipset.card_type < 0x30) {
-		return nva_grd32(nva_cards[card]->bar1, addr);
+		return nva_bar1_rd32(card, addr);
 	} else if (nva_cards[card]->chipset.card_type < 0x50) {
 		nva_wr32(card, 0x1570, addr);
 		return nva_rd32(card, 0x1574);
@@ -46,7 +46,7 @@ void vram_wr32(int card, uint64_t addr, uint32_t val) {
 	if (nva_cards[card]->chipset.card_type < 3) {
 		nva_wr32(card, 0x1000000 + addr, val);
 	} else if (nva_cards[card]->chipset.card_type < 0x30) {
-		nva_gwr32(nva_cards[card]->bar1, addr, val);
+		nva_bar1_wr32(card, addr, val);
 	} else if (nva_cards[card]->chipset.card_type < 0x50) {
 		nva_wr32(card, 0x1570, addr);
 		nva_wr32(card, 0x1574, val);
@@ -64,4 +64,36 @@ static inline int ed_getcstride(const struct disisa *isa, struct varinfo *varinf
 
 void envydis (const struct disisa *isa, FILE *out, uint8_t *code, uint32_t start, int num, struct varinfo *varinfo, int quiet, struct label *labels, int labelsnum, const struct envy_colors *cols);
 
+/*
+ * Cache of decoded instructions, for a given ISA and variant.  envydis uses
+ * one for the duration of the call; use envydis_cached to keep one across
+ * calls.
+ */
+struct dis_cache;
+
+struct dis_cache_stats {
+	unsigned long long hits;
+	unsigned long long misses;
+	unsigned long long uncached;
+	unsigned long long flushes;
+};
+
+struct dis_cache *dis_cache_new(const struct disisa *isa, struct varinfo *varinfo);
+void dis_cache_del(struct dis_cache *cache);
+struct dis_cache_stats dis_cache_get_stats(const struct dis_cache *cache);
+
+void envydis_cached (struct dis_cache *cache, FILE *out, uint8_t *code, uint32_t start, int num, int quiet, struct label *labels, int labelsnum, const struct envy_colors *cols);
+
+/*
+ * Instead of a listing, writes out the control flow graph found by the
+ * disassembler: basic blocks with their branch targets, calls and
+ * fallthrough successors.
+ */
+enum dis_cfg_format {
+	DIS_CFG_JSON,
+	DIS_CFG_DOT,
+};
+
+void envycfg (struct dis_cache *cache, FILE *out, uint8_t *code, uint32_t start, int num, struct label *labels, int labelsnum, enum dis_cfg_format fmt);
+
 #endif
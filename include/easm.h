@@ -185,6 +185,14 @@ void easm_del_directive(struct easm_directive *directive);
 void easm_del_line(struct easm_line *line);
 void easm_del_file(struct easm_file *file);
 
+struct easm_mod *easm_copy_mod(const struct easm_mod *mod);
+struct easm_mods *easm_copy_mods(const struct easm_mods *mods);
+struct easm_expr *easm_copy_expr(const struct easm_expr *expr);
+struct easm_operand *easm_copy_operand(const struct easm_operand *operand);
+struct easm_subinsn *easm_copy_subinsn(const struct easm_subinsn *subinsn);
+struct easm_sinsn *easm_copy_sinsn(const struct easm_sinsn *sinsn);
+struct easm_insn *easm_copy_insn(const struct easm_insn *insn);
+
 int easm_read_file(FILE *file, const char *filename, struct easm_file **res);
 
 void easm_print_expr(FILE *out, const struct envy_colors *cols, struct easm_expr *expr, int lvl);
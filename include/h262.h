@@ -231,5 +231,10 @@ void h262_print_picparm(struct h262_picparm *picparm);
 void h262_print_gop(struct h262_gop *gop);
 void h262_print_slice(struct h262_seqparm *seqparm, struct h262_picparm *picparm, struct h262_slice *slice);
 
+void h262_trace_seqparm(struct vs_trace *tr, struct h262_seqparm *seqparm);
+void h262_trace_picparm(struct vs_trace *tr, struct h262_picparm *picparm);
+void h262_trace_gop(struct vs_trace *tr, struct h262_gop *gop);
+void h262_trace_slice(struct vs_trace *tr, struct h262_seqparm *seqparm, struct h262_picparm *picparm, struct h262_slice *slice);
+
 #endif
 
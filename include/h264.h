@@ -421,8 +421,6 @@ struct h264_macroblock {
 	uint32_t coded_block_pattern;
 	uint32_t transform_size_8x8_flag;
 	int32_t mb_qp_delta;
-	uint32_t pcm_sample_luma[256];
-	uint32_t pcm_sample_chroma[512];
 	uint32_t prev_intra4x4_pred_mode_flag[16];
 	uint32_t rem_intra4x4_pred_mode[16];
 	uint32_t prev_intra8x8_pred_mode_flag[4];
@@ -431,14 +429,23 @@ struct h264_macroblock {
 	uint32_t sub_mb_type[4];
 	uint32_t ref_idx[2][4];
 	int32_t mvd[2][16][2];
+	int total_coeff[3][16]; /* [0 luma, 1 cb, 2 cr][blkIdx] */
+	int coded_block_flag[3][17]; /* [0 luma, 1 cb, 2 cr][blkIdx], with blkIdx == 16 being DC */
+	/* sample and coefficient arrays go last - the decoder only clears the ones a given mb_type uses */
+	uint32_t pcm_sample_luma[256];
+	uint32_t pcm_sample_chroma[512];
 	int32_t block_luma_dc[3][16]; /* [0 luma, 1 cb, 2 cr][coeff] */
 	int32_t block_luma_ac[3][16][15]; /* [0 luma, 1 cb, 2 cr][blkIdx][coeff] */
 	int32_t block_luma_4x4[3][16][16]; /* [0 luma, 1 cb, 2 cr][blkIdx][coeff] */
 	int32_t block_luma_8x8[3][4][64]; /* [0 luma, 1 cb, 2 cr][blkIdx][coeff] */
 	int32_t block_chroma_dc[2][8]; /* [0 cb, 1 cr][coeff] */
 	int32_t block_chroma_ac[2][8][15]; /* [0 cb, 1 cr][blkIdx][coeff] */
-	int total_coeff[3][16]; /* [0 luma, 1 cb, 2 cr][blkIdx] */
-	int coded_block_flag[3][17]; /* [0 luma, 1 cb, 2 cr][blkIdx], with blkIdx == 16 being DC */
+};
+
+/* reusable macroblock storage for decoding many slices in a row */
+struct h264_mb_arena {
+	struct h264_macroblock *mbs;
+	uint32_t mbsmax;
 };
 
 struct h264_ref_pic_list_modification {
@@ -554,6 +561,7 @@ struct h264_slice {
 	/* macroblocks */
 	int *sgmap;
 	struct h264_macroblock *mbs;
+	struct h264_mb_arena *mb_arena;
 };
 
 enum h264_mb_pos {
@@ -638,6 +646,9 @@ void h264_del_seqparm(struct h264_seqparm *seqparm);
 void h264_del_picparm(struct h264_picparm *picparm);
 void h264_del_slice(struct h264_slice *slice);
 
+void h264_mb_arena_attach(struct h264_mb_arena *arena, struct h264_slice *slice);
+void h264_mb_arena_fini(struct h264_mb_arena *arena);
+
 int h264_seqparm(struct bitstream *str, struct h264_seqparm *seqparm);
 int h264_seqparm_svc(struct bitstream *str, struct h264_seqparm *seqparm);
 int h264_seqparm_mvc(struct bitstream *str, struct h264_seqparm *seqparm);
@@ -654,4 +665,10 @@ void h264_print_picparm(struct h264_picparm *picparm);
 void h264_print_slice_header(struct h264_slice *slice);
 void h264_print_slice_data(struct h264_slice *slice);
 
+void h264_trace_seqparm(struct vs_trace *tr, struct h264_seqparm *seqparm);
+void h264_trace_seqparm_ext(struct vs_trace *tr, struct h264_seqparm *seqparm);
+void h264_trace_picparm(struct vs_trace *tr, struct h264_picparm *picparm);
+void h264_trace_slice_header(struct vs_trace *tr, struct h264_slice *slice);
+void h264_trace_slice_data(struct vs_trace *tr, struct h264_slice *slice);
+
 #endif
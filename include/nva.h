@@ -44,6 +44,15 @@ enum nva_bus_type {
 	NVA_BUS_PLATFORM,
 };
 
+/*
+ * Optional interceptor for BAR0/BAR1 accesses made through nva_rd32 & co.,
+ * used by hwtest to record and replay hardware results.  size is 1, 2 or 4.
+ */
+struct nva_hook {
+	uint32_t (*rd)(void *priv, int bar, uint32_t addr, int size);
+	void (*wr)(void *priv, int bar, uint32_t addr, uint32_t val, int size);
+};
+
 struct nva_card {
 	enum nva_card_type type;
 	enum nva_bus_type bus_type;
@@ -64,6 +73,8 @@ struct nva_card {
 	size_t iobarlen;
 	void *rawmem;
 	struct pci_io_handle *rawio;
+	const struct nva_hook *hook;
+	void *hook_priv;
 };
 
 int nva_init();
@@ -78,6 +89,14 @@ static inline void nva_gwr32(void *base, uint32_t addr, uint32_t val) {
 	*((volatile uint32_t*)(((volatile uint8_t *)base) + addr)) = val;
 }
 
+static inline uint32_t nva_grd16(void *base, uint32_t addr) {
+	return *((volatile uint16_t*)(((volatile uint8_t *)base) + addr));
+}
+
+static inline void nva_gwr16(void *base, uint32_t addr, uint32_t val) {
+	*((volatile uint16_t*)(((volatile uint8_t *)base) + addr)) = val;
+}
+
 static inline uint32_t nva_grd8(void *base, uint32_t addr) {
 	return *(((volatile uint8_t *)base) + addr);
 }
@@ -87,19 +106,56 @@ static inline void nva_gwr8(void *base, uint32_t addr, uint32_t val) {
 }
 
 static inline uint32_t nva_rd32(int card, uint32_t addr) {
-	return nva_grd32(nva_cards[card]->bar0, addr);
+	struct nva_card *c = nva_cards[card];
+	if (c->hook)
+		return c->hook->rd(c->hook_priv, 0, addr, 4);
+	return nva_grd32(c->bar0, addr);
 }
 
 static inline void nva_wr32(int card, uint32_t addr, uint32_t val) {
-	nva_gwr32(nva_cards[card]->bar0, addr, val);
+	struct nva_card *c = nva_cards[card];
+	if (c->hook)
+		c->hook->wr(c->hook_priv, 0, addr, val, 4);
+	else
+		nva_gwr32(c->bar0, addr, val);
+}
+
+static inline void nva_wr16(int card, uint32_t addr, uint32_t val) {
+	struct nva_card *c = nva_cards[card];
+	if (c->hook)
+		c->hook->wr(c->hook_priv, 0, addr, val, 2);
+	else
+		nva_gwr16(c->bar0, addr, val);
 }
 
 static inline uint32_t nva_rd8(int card, uint32_t addr) {
-	return nva_grd8(nva_cards[card]->bar0, addr);
+	struct nva_card *c = nva_cards[card];
+	if (c->hook)
+		return c->hook->rd(c->hook_priv, 0, addr, 1);
+	return nva_grd8(c->bar0, addr);
 }
 
 static inline void nva_wr8(int card, uint32_t addr, uint32_t val) {
-	nva_gwr8(nva_cards[card]->bar0, addr, val);
+	struct nva_card *c = nva_cards[card];
+	if (c->hook)
+		c->hook->wr(c->hook_priv, 0, addr, val, 1);
+	else
+		nva_gwr8(c->bar0, addr, val);
+}
+
+static inline uint32_t nva_bar1_rd32(int card, uint32_t addr) {
+	struct nva_card *c = nva_cards[card];
+	if (c->hook)
+		return c->hook->rd(c->hook_priv, 1, addr, 4);
+	return nva_grd32(c->bar1, addr);
+}
+
+static inline void nva_bar1_wr32(int card, uint32_t addr, uint32_t val) {
+	struct nva_card *c = nva_cards[card];
+	if (c->hook)
+		c->hook->wr(c->hook_priv, 1, addr, val, 4);
+	else
+		nva_gwr32(c->bar1, addr, val);
 }
 
 static inline uint32_t nva_mask(int cnum, uint32_t reg, uint32_t mask, uint32_t val)
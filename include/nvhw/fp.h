@@ -559,6 +559,30 @@ uint64_t fp64_to_u64(uint64_t x, enum fp_rm rm);
 uint32_t fp32_from_u64(uint64_t x, enum fp_rm rm);
 uint64_t fp64_from_u64(uint64_t x, enum fp_rm rm);
 
+/* Array-at-a-time versions of the above, results are identical to calling
+   the scalar function on each element.  Lanes that the host FPU computes
+   the same way as the hardware are done with SIMD, the rest (zeros,
+   denormals, NaNs, infinities, overflow) fall back to the scalar model.
+   res must not overlap the inputs.  */
+
+enum fp_simd {
+	FP_SIMD_NONE,
+	FP_SIMD_SSE2,
+	FP_SIMD_AVX2,
+};
+
+/* Selects the instruction set used by the batch functions, clamped to what
+   the host supports.  Returns the one actually selected.  */
+enum fp_simd fp_batch_set_simd(enum fp_simd simd);
+
+void fp32_add_batch(uint32_t *res, const uint32_t *a, const uint32_t *b, int num, enum fp_rm rm);
+void fp32_mul_batch(uint32_t *res, const uint32_t *a, const uint32_t *b, int num, enum fp_rm rm, bool zero_wins);
+void fp32_mad_batch(uint32_t *res, const uint32_t *a, const uint32_t *b, const uint32_t *c, int num, bool zero_wins);
+void fp32_to_fp16_batch(uint16_t *res, const uint32_t *x, int num, enum fp_rm rm, bool rint);
+void fp64_add_batch(uint64_t *res, const uint64_t *a, const uint64_t *b, int num, enum fp_rm rm);
+void fp64_mul_batch(uint64_t *res, const uint64_t *a, const uint64_t *b, int num, enum fp_rm rm);
+void fp64_fma_batch(uint64_t *res, const uint64_t *a, const uint64_t *b, const uint64_t *c, int num, enum fp_rm rm);
+
 #ifdef __cplusplus
 }
 #endif
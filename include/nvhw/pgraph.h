@@ -285,6 +285,7 @@ int nv03_pgraph_cpp(struct pgraph_state *state);
 int nv01_pgraph_dither_10to5(int val, int x, int y, bool isg);
 uint32_t nv03_pgraph_rop(struct pgraph_state *state, int x, int y, uint32_t pixel, struct pgraph_color src);
 uint32_t nv03_pgraph_solid_rop(struct pgraph_state *state, int x, int y, uint32_t pixel);
+uint8_t nv01_pgraph_xlat_rop(int op, uint8_t rop);
 bool pgraph_cliprect_pass(struct pgraph_state *state, int32_t x, int32_t y);
 void pgraph_prep_draw(struct pgraph_state *state, bool poly, bool noclip);
 void pgraph_set_surf_format(struct pgraph_state *state, int which, uint32_t fmt);
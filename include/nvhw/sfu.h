@@ -43,6 +43,24 @@ uint32_t sfu_rsqrt(uint32_t x);
 uint32_t sfu_sincos(uint32_t x, bool cos);
 uint32_t sfu_ex2(uint32_t x);
 uint32_t sfu_lg2(uint32_t x);
+
+/* All of the above, selectable at runtime - for batch evaluation.  */
+enum sfu_op {
+	SFU_OP_RCP,
+	SFU_OP_RSQRT,
+	SFU_OP_SIN,
+	SFU_OP_COS,
+	SFU_OP_EX2,
+	SFU_OP_LG2,
+	SFU_OP_PRE_SIN,
+	SFU_OP_PRE_EX2,
+	SFU_OP_NUM,
+};
+
+uint32_t sfu_eval(enum sfu_op op, uint32_t x);
+void sfu_eval_batch(enum sfu_op op, uint32_t *res, const uint32_t *x, int num);
+/* evaluates inputs start .. start+num-1 */
+void sfu_eval_range(enum sfu_op op, uint32_t *res, uint32_t start, uint32_t num);
 #if 0
 uint32_t sfu_rcp64h(uint32_t x);
 uint32_t sfu_rsqrt64h(uint32_t x);
@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2014 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef NVHW_VP1_H
+#define NVHW_VP1_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Architectural state of the VP1 vector processor.  */
+struct vp1_ctx {
+	uint32_t uc_cfg;
+	uint32_t a[32];
+	uint32_t r[31];
+	uint8_t v[32][16];
+	uint32_t vc[4];
+	uint32_t va[16];
+	uint8_t vx[16];
+	uint16_t b[4];
+	uint16_t c[4];
+	uint32_t m[64];
+	uint32_t x[16];
+	uint8_t ds[0x10][0x200];
+};
+
+/* Simulates one bundle: opcode[0..3] go to the A, S, V and B units.  */
+void vp1_simulate_bundle(struct vp1_ctx *ctx, const uint32_t opcode[4], int chipset);
+
+/* Unit an instruction word belongs to - consecutive words of increasing
+   kind within an aligned group of 4 form a bundle.  */
+enum vp1_kind {
+	VP1_KIND_A = 0,
+	VP1_KIND_S = 1,
+	VP1_KIND_V = 2,
+	VP1_KIND_B = 3,
+};
+
+int vp1_kind(uint32_t opcode);
+
+/* Runs microcode from a code array, with branches, calls and loops.  Every
+   bundle is decoded the first time it is reached and reused after that.  */
+
+enum vp1_sim_res {
+	VP1_SIM_EXIT,	/* hit an exit instruction */
+	VP1_SIM_LIMIT,	/* ran max_bundles bundles */
+	VP1_SIM_FAULT,	/* pc ran off the end of the code */
+};
+
+struct vp1_sim {
+	int chipset;
+	struct vp1_ctx ctx;
+	/* word index of the next bundle */
+	uint32_t pc;
+	/* return address of the last call */
+	uint32_t ret;
+	/* a taken branch lands here after one delay bundle */
+	int branch_pending;
+	uint32_t branch_target;
+	/* bundles executed so far */
+	uint64_t bundles;
+	const uint32_t *code;
+	uint32_t ncode;
+	struct vp1_pbundle **cache;
+};
+
+struct vp1_sim *vp1_sim_new(int chipset, const uint32_t *code, uint32_t ncode);
+void vp1_sim_del(struct vp1_sim *sim);
+/* Runs from sim->pc until exit, or for at most max_bundles bundles.  */
+enum vp1_sim_res vp1_sim_run(struct vp1_sim *sim, uint64_t max_bundles);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -51,6 +51,18 @@ int has_large_tile(int chipset);
 int tile_bankoff_bits(int chipset);
 uint32_t tile_translate_addr(int chipset, uint32_t pitch, uint32_t address, int mode, int bankoff, const struct mc_config *mcc, int *ppart, int *ptag);
 
+/* Precomputed tile_translate_addr mapping of a whole size-byte surface, for
+   converting between tiled and linear layout.  Returns NULL if the pitch is
+   invalid.  */
+struct tile_map;
+struct tile_map *tile_map_new(int chipset, uint32_t pitch, uint32_t size, int mode, int bankoff, const struct mc_config *mcc);
+void tile_map_del(struct tile_map *map);
+/* linear[a] = tiled[tile_translate_addr(a)] for every a < size.  Both buffers
+   are size bytes; addresses translated past the end are skipped.  */
+void tile_untile(const struct tile_map *map, uint8_t *linear, const uint8_t *tiled);
+/* The reverse: tiled[tile_translate_addr(a)] = linear[a].  */
+void tile_tile(const struct tile_map *map, uint8_t *tiled, const uint8_t *linear);
+
 enum comp_type {
 	COMP_NONE,
 	COMP_NV20,
@@ -82,6 +94,18 @@ int comp_format_bpp(int chipset, int format);
 
 void comp_decompress(int chipset, int format, uint8_t *data, int tag);
 
+/* Size in bytes of a compression tile, as passed to comp_decompress.  */
+int comp_tile_size(int chipset);
+/* Decompresses num consecutive tiles of a surface, tile i with tag tags[i].
+   Results are identical to calling comp_decompress on each tile.  */
+void comp_decompress_tiles(int chipset, int format, uint8_t *data, const uint8_t *tags, int num);
+/* The same, split across nthreads threads.  Lives in libnvhw_mt, so that
+   libnvhw itself doesn't need pthreads.  */
+void comp_decompress_tiles_mt(int chipset, int format, uint8_t *data, const uint8_t *tags, int num, int nthreads);
+
+/* interpolation weights of the NV40 A8R8G8B8 format: [endpoint][y][x] */
+extern const int8_t comp_interp_weight[16][4][4];
+
 #ifdef __cplusplus
 }
 #endif
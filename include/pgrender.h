@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2016 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef PGRENDER_H
+#define PGRENDER_H
+
+#include "nvhw/pgraph.h"
+#include <stdio.h>
+
+/*
+ * Software renderer for the NV03 2D PGRAPH classes.  Feeds a method stream
+ * through the nvhw PGRAPH models and draws into a VRAM image.  Primitives
+ * are rasterized into spans; a span's per-pixel ROP is collapsed into
+ * a bitwise "keep these bits, set those bits" table wherever the model
+ * allows it, so the nvhw ROP only gets called once per pattern/dither
+ * phase instead of once per pixel.
+ */
+
+struct pgrender {
+	struct pgraph_state state;
+	uint8_t *vram;
+	uint32_t vram_size;
+	/* ctx_switch word of each bound object class */
+	uint32_t ctx[0x20];
+	/* evaluate every pixel with nv03_pgraph_rop, for reference */
+	int slow;
+	/* current primitive state */
+	int32_t vtx[3][2];
+	int npoly;
+	int ifc_in[2];
+	int ifc_out[2];
+	int ifc_idx;
+	int32_t clip_min[2];
+	int32_t clip_max[2];
+	/* span ROP table: pixel = set ^ (pixel & flip), per pattern/dither phase */
+	uint32_t span_key[14];
+	int span_table;
+	int span_px, span_py;
+	struct pgraph_color span_color;
+	uint64_t span_valid[64];
+	uint32_t span_set[64][64];
+	uint32_t span_flip[64][64];
+	uint64_t pixels;
+};
+
+struct pgrender *pgrender_new(uint32_t pmc_id, uint32_t vram_size);
+void pgrender_del(struct pgrender *ctx);
+void pgrender_bind(struct pgrender *ctx, int cls, uint32_t ctx_switch);
+int pgrender_mthd(struct pgrender *ctx, int cls, uint32_t mthd, uint32_t val);
+uint32_t pgrender_rd_pixel(struct pgrender *ctx, int buf, int32_t x, int32_t y);
+
+/* image output: w x h pixels of surface buf, converted to 8-bit RGB */
+int pgrender_write_ppm(struct pgrender *ctx, FILE *out, int buf, int w, int h);
+int pgrender_write_png(struct pgrender *ctx, FILE *out, int buf, int w, int h);
+
+#endif
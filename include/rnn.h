@@ -45,6 +45,9 @@ struct rnncopyright {
 	struct rnnauthor **authors;
 	int authorsnum;
 	int authorsmax;
+	char **files;	/* where the copyright tags were found */
+	int filesnum;
+	int filesmax;
 };
 
 struct rnndb {
@@ -67,12 +70,21 @@ struct rnndb {
 	char **files;
 	int filesnum;
 	int filesmax;
+	int varinfosnum;
+	int parsethreads; /* for rnn_parsefile, 0 means one per CPU */
+	struct rnnparse *parse;
+	/*
+	 * Immutable data created by rnn_prepdb and interned, so that identical
+	 * copies are stored once: variant arrays and fullnames.
+	 * Freed along with the db.
+	 */
+	struct rnnpool *pool;
 	int estatus;
 };
 
 struct rnnvarset {
 	struct rnnenum *venum;
-	int *variants;
+	int *variants; /* interned, may be shared with other varsets */
 };
 
 struct rnnvarinfo {
@@ -81,10 +93,22 @@ struct rnnvarinfo {
 	char *variantsstr;
 	int dead;
 	struct rnnenum *prefenum;
-	char *prefix;
+	char *prefix; /* name of a prefenum value, not a copy */
 	struct rnnvarset **varsets;
 	int varsetsnum;
 	int varsetsmax;
+	int idx; /* 1-based index among varinfos with varsets, for rnndec */
+};
+
+/*
+ * Index of enum values by value, built by rnn_prepdb.  Values hashing to
+ * a bucket are chained in vals order, so the first one that matches is the
+ * same one a scan of vals would find.
+ */
+struct rnnvalhash {
+	int *heads;
+	int *next;
+	int size;
 };
 
 struct rnnenum {
@@ -95,6 +119,7 @@ struct rnnenum {
 	struct rnnvalue **vals;
 	int valsnum;
 	int valsmax;
+	struct rnnvalhash valhash;
 	char *fullname;
 	int prepared;
 	char *file;
@@ -134,6 +159,7 @@ struct rnntypeinfo {
 	struct rnnvalue **vals;
 	int valsnum;
 	int valsmax;
+	struct rnnvalhash valhash;
 	int shr;
 	int add;
 	uint64_t min, max, align, radix;
@@ -207,6 +233,7 @@ struct rnndelem {
 	struct rnntypeinfo typeinfo;
 	char *fullname;
 	char *file;
+	char *srcfile; /* for copies made by use-group, where the original came from */
 };
 
 struct rnnspectype {
@@ -226,4 +253,8 @@ struct rnnbitset *rnn_findbitset (struct rnndb *db, const char *name);
 struct rnndomain *rnn_finddomain (struct rnndb *db, const char *name);
 struct rnnspectype *rnn_findspectype (struct rnndb *db, const char *name);
 
+static inline uint32_t rnn_valhash_bucket (const struct rnnvalhash *vh, uint64_t value) {
+	return (uint32_t)((value * UINT64_C(0x9e3779b97f4a7c15)) >> 32) & (vh->size - 1);
+}
+
 #endif
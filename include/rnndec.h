@@ -39,6 +39,12 @@ struct rnndeccontext {
 	int varsnum;
 	int varsmax;
 	const struct envy_colors *colors;
+	/* rnndec_varmatch results, valid when equal to vargen << 1 | match */
+	uint32_t *varmemo;
+	int varmemonum;
+	uint32_t vargen;
+	/* rnndec_decodeaddr_cached results, allocated on first use */
+	struct rnndecaddrcache *addrcache;
 };
 
 struct rnndecaddrinfo {
@@ -55,6 +61,8 @@ int rnndec_varmod(struct rnndeccontext *ctx, char *varset, char *variant);
 int rnndec_varmatch(struct rnndeccontext *ctx, struct rnnvarinfo *vi);
 char *rnndec_decodeval(struct rnndeccontext *ctx, struct rnntypeinfo *ti, uint64_t value, int width);
 struct rnndecaddrinfo *rnndec_decodeaddr(struct rnndeccontext *ctx, struct rnndomain *domain, uint64_t addr, int write);
+/* like rnndec_decodeaddr, but the result belongs to ctx and is only valid until the next call */
+const struct rnndecaddrinfo *rnndec_decodeaddr_cached(struct rnndeccontext *ctx, struct rnndomain *domain, uint64_t addr, int write);
 void rnndec_free_decaddrinfo(struct rnndecaddrinfo *a);
 
 #endif
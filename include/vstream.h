@@ -26,6 +26,7 @@
 #define VSTREAM_H
 
 #include <inttypes.h>
+#include <stdio.h>
 
 struct bitstream {
 	enum vs_dir {
@@ -77,6 +78,74 @@ int vs_search_start(struct bitstream *str);
 
 struct bitstream *vs_new_encode(enum vs_type type);
 struct bitstream *vs_new_decode(enum vs_type type, uint8_t *bytes, int bytesnum);
+void vs_reset_decode(struct bitstream *str, uint8_t *bytes, int bytesnum);
 void vs_destroy(struct bitstream *str);
 
+/* splits a byte-oriented stream into start code delimited units as it's read */
+struct vs_splitter {
+	FILE *file;
+	uint8_t *buf;
+	int bufnum;
+	int bufmax;
+	int start;
+	int scanpos;
+	int eof;
+};
+
+int vs_find_start(const uint8_t *bytes, int num);
+struct vs_splitter *vs_new_splitter(FILE *file);
+int vs_splitter_next(struct vs_splitter *sp, uint8_t **bytes, int *bytesnum);
+void vs_del_splitter(struct vs_splitter *sp);
+uint8_t *vs_read_all(FILE *file, int *bytesnum);
+
+
+/* compact binary syntax trace, an alternative to the text dumps */
+#define VS_TRACE_VERSION 1
+
+enum vs_trace_tag {
+	VS_TRACE_UNIT = 1,	/* start code of the unit that follows */
+	VS_TRACE_ERROR,		/* current unit failed to decode */
+	VS_TRACE_H264_SEQPARM,
+	VS_TRACE_H264_SEQPARM_EXT,
+	VS_TRACE_H264_PICPARM,
+	VS_TRACE_H264_SLICE_HEADER,
+	VS_TRACE_H264_MACROBLOCK,
+	VS_TRACE_H262_SEQPARM,
+	VS_TRACE_H262_PICPARM,
+	VS_TRACE_H262_GOP,
+	VS_TRACE_H262_SLICE,
+	VS_TRACE_H262_MACROBLOCK,
+};
+
+struct vs_trace {
+	FILE *file;
+	int tag;
+	uint8_t *buf;
+	int bufnum;
+	int bufmax;
+};
+
+struct vs_trace_record {
+	int tag;
+	uint8_t *bytes;
+	uint32_t bytesnum;
+	uint32_t bytesmax;
+	int32_t *vals;
+	uint32_t valsnum;
+	uint32_t valsmax;
+};
+
+struct vs_trace *vs_trace_new(FILE *file);
+void vs_trace_begin(struct vs_trace *tr, enum vs_trace_tag tag);
+void vs_trace_val(struct vs_trace *tr, int32_t val);
+void vs_trace_vals(struct vs_trace *tr, const int32_t *vals, int num);
+void vs_trace_uvals(struct vs_trace *tr, const uint32_t *vals, int num);
+void vs_trace_end(struct vs_trace *tr);
+void vs_trace_unit(struct vs_trace *tr, uint32_t start_code);
+void vs_trace_error(struct vs_trace *tr);
+void vs_trace_del(struct vs_trace *tr);
+int vs_trace_read_header(FILE *file);
+int vs_trace_read(FILE *file, struct vs_trace_record *rec);
+void vs_trace_record_fini(struct vs_trace_record *rec);
+
 #endif
@@ -439,6 +439,105 @@ static int rbits(char *bit, int *ppos, int n) {
 	return res;
 }
 
+const int8_t comp_interp_weight[16][4][4] = {
+	{
+		{ 3, 4, 2, 1 },
+		{ 2, 3, 1, 0 },
+		{ 0, 0, 0, 0 },
+		{ 0, 0, 0, 0 },
+	},
+	{
+		{ 0, 0, 2, 3 },
+		{ 0, 0, 3, 4 },
+		{ 0, 0, 1, 2 },
+		{ 0, 0, 0, 1 },
+	},
+	{
+		{ 1, 0, 0, 0 },
+		{ 2, 1, 0, 0 },
+		{ 4, 3, 0, 0 },
+		{ 3, 2, 0, 0 },
+	},
+	{
+		{ 0, 0, 0, 0 },
+		{ 0, 0, 0, 0 },
+		{ 0, 1, 3, 2 },
+		{ 1, 2, 4, 3 },
+	},
+	{
+		{ 0, 0, 4, 2 },
+		{ 0, 0, 2, 0 },
+		{ 0, 0, 0, 0 },
+		{ 0, 0, 0, 0 },
+	},
+	{
+		{ 2, 0, 0, 0 },
+		{ 4, 2, 0, 0 },
+		{ 0, 0, 0, 0 },
+		{ 0, 0, 0, 0 },
+	},
+	{
+		{ 0, 0, 0, 0 },
+		{ 0, 0, 0, 0 },
+		{ 0, 0, 2, 4 },
+		{ 0, 0, 0, 2 },
+	},
+	{
+		{ 0, 0, 0, 0 },
+		{ 0, 0, 0, 0 },
+		{ 0, 2, 0, 0 },
+		{ 2, 4, 0, 0 },
+	},
+	{
+		{ 4, 0, 0, 0 },
+		{ 0, 0, 0, 0 },
+		{ 0, 0, 0, 0 },
+		{ 0, 0, 0, 0 },
+	},
+	{
+		{ 0, 0, 0, 4 },
+		{ 0, 0, 0, 0 },
+		{ 0, 0, 0, 0 },
+		{ 0, 0, 0, 0 },
+	},
+	{
+		{ 0, 0, 0, 0 },
+		{ 0, 4, 0, 0 },
+		{ 0, 0, 0, 0 },
+		{ 0, 0, 0, 0 },
+	},
+	{
+		{ 0, 0, 0, 0 },
+		{ 0, 0, 4, 0 },
+		{ 0, 0, 0, 0 },
+		{ 0, 0, 0, 0 },
+	},
+	{
+		{ 0, 0, 0, 0 },
+		{ 0, 0, 0, 0 },
+		{ 0, 4, 0, 0 },
+		{ 0, 0, 0, 0 },
+	},
+	{
+		{ 0, 0, 0, 0 },
+		{ 0, 0, 0, 0 },
+		{ 0, 0, 4, 0 },
+		{ 0, 0, 0, 0 },
+	},
+	{
+		{ 0, 0, 0, 0 },
+		{ 0, 0, 0, 0 },
+		{ 0, 0, 0, 0 },
+		{ 4, 0, 0, 0 },
+	},
+	{
+		{ 0, 0, 0, 0 },
+		{ 0, 0, 0, 0 },
+		{ 0, 0, 0, 0 },
+		{ 0, 0, 0, 4 },
+	},
+};
+
 static void comp_a8r8g8b8_interp_decompress(int chipset, uint32_t cd[8], uint32_t od32[4][8]) {
 	/* fuck performance. */
 	char bit[255];
@@ -487,104 +586,6 @@ static void comp_a8r8g8b8_interp_decompress(int chipset, uint32_t cd[8], uint32_
 		if (i == 0)
 			alpha = rbits(bit, &pos, mode == 1 ? 1 : 8);
 	}
-	static const int8_t weight[16][4][4] = {
-		{
-			{ 3, 4, 2, 1 },
-			{ 2, 3, 1, 0 },
-			{ 0, 0, 0, 0 },
-			{ 0, 0, 0, 0 },
-		},
-		{
-			{ 0, 0, 2, 3 },
-			{ 0, 0, 3, 4 },
-			{ 0, 0, 1, 2 },
-			{ 0, 0, 0, 1 },
-		},
-		{
-			{ 1, 0, 0, 0 },
-			{ 2, 1, 0, 0 },
-			{ 4, 3, 0, 0 },
-			{ 3, 2, 0, 0 },
-		},
-		{
-			{ 0, 0, 0, 0 },
-			{ 0, 0, 0, 0 },
-			{ 0, 1, 3, 2 },
-			{ 1, 2, 4, 3 },
-		},
-		{
-			{ 0, 0, 4, 2 },
-			{ 0, 0, 2, 0 },
-			{ 0, 0, 0, 0 },
-			{ 0, 0, 0, 0 },
-		},
-		{
-			{ 2, 0, 0, 0 },
-			{ 4, 2, 0, 0 },
-			{ 0, 0, 0, 0 },
-			{ 0, 0, 0, 0 },
-		},
-		{
-			{ 0, 0, 0, 0 },
-			{ 0, 0, 0, 0 },
-			{ 0, 0, 2, 4 },
-			{ 0, 0, 0, 2 },
-		},
-		{
-			{ 0, 0, 0, 0 },
-			{ 0, 0, 0, 0 },
-			{ 0, 2, 0, 0 },
-			{ 2, 4, 0, 0 },
-		},
-		{
-			{ 4, 0, 0, 0 },
-			{ 0, 0, 0, 0 },
-			{ 0, 0, 0, 0 },
-			{ 0, 0, 0, 0 },
-		},
-		{
-			{ 0, 0, 0, 4 },
-			{ 0, 0, 0, 0 },
-			{ 0, 0, 0, 0 },
-			{ 0, 0, 0, 0 },
-		},
-		{
-			{ 0, 0, 0, 0 },
-			{ 0, 4, 0, 0 },
-			{ 0, 0, 0, 0 },
-			{ 0, 0, 0, 0 },
-		},
-		{
-			{ 0, 0, 0, 0 },
-			{ 0, 0, 4, 0 },
-			{ 0, 0, 0, 0 },
-			{ 0, 0, 0, 0 },
-		},
-		{
-			{ 0, 0, 0, 0 },
-			{ 0, 0, 0, 0 },
-			{ 0, 4, 0, 0 },
-			{ 0, 0, 0, 0 },
-		},
-		{
-			{ 0, 0, 0, 0 },
-			{ 0, 0, 0, 0 },
-			{ 0, 0, 4, 0 },
-			{ 0, 0, 0, 0 },
-		},
-		{
-			{ 0, 0, 0, 0 },
-			{ 0, 0, 0, 0 },
-			{ 0, 0, 0, 0 },
-			{ 4, 0, 0, 0 },
-		},
-		{
-			{ 0, 0, 0, 0 },
-			{ 0, 0, 0, 0 },
-			{ 0, 0, 0, 0 },
-			{ 0, 0, 0, 4 },
-		},
-	};
 	int y, x;
 	for (y = 0; y < 4; y++) {
 		for (x = 0; x < 4; x++) {
@@ -595,7 +596,7 @@ static void comp_a8r8g8b8_interp_decompress(int chipset, uint32_t cd[8], uint32_
 					pixel = raw[0][k];
 				} else {
 					for (i = 0; i < 16; i++)
-						pixel += raw[i][k] * weight[i][y][x];
+						pixel += raw[i][k] * comp_interp_weight[i][y][x];
 					pixel >>= 2;
 				}
 				res |= (pixel & 0xff) << 8 * k;
@@ -0,0 +1,538 @@
+/*
+ * Copyright (C) 2016 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "nvhw/chipset.h"
+#include "nvhw/vram.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__))
+#define COMP_BATCH_SSE2
+#include <emmintrin.h>
+#endif
+
+/*
+ * Surface-level version of comp_decompress.  Everything that depends only on
+ * the chipset and format is worked out once per surface in comp_batch_prep:
+ * the format type, the gradient multipliers of every pixel and which delta
+ * field it takes, and the nonzero interpolation weights.  Per tile, what's
+ * left is unpacking the fields and one multiply-add per pixel, which the
+ * SSE2 path does four pixels at a time.
+ */
+
+struct comp_batch {
+	int ctype;
+	int ftype;
+	int ms;
+	int is_be;
+	int bpp;
+	int twidth;
+	int tsize;
+	/* Z16/Z24S8 gradient: z = (gc + dx * gx + dy * gy) >> shift, plus
+	   delta gdi (the last delta slot is always 0) */
+	int16_t gxy[32][2];
+	int32_t gc[32];
+	uint8_t gdi[32];
+	/* Z24 split gradient: multipliers of dxp, dxn, dy */
+	int32_t sgm[32][3];
+	/* A8R8G8B8 gradient, per pixel pair */
+	int8_t arx[16], ary[16];
+	int8_t adi[16];
+	/* A8R8G8B8 interpolation: nonzero weights of every pixel */
+	uint8_t iwnum[16];
+	uint8_t iwidx[16][16];
+	uint8_t iw[16][16];
+};
+
+static inline int32_t comp_sext(uint32_t val, int bits) {
+	return (int32_t)(val << (32 - bits)) >> (32 - bits);
+}
+
+/* n bits at pos of a little-endian bit stream in 64-bit words */
+static inline uint32_t comp_field(const uint64_t *w, int pos, int n) {
+	int s = pos & 63;
+	uint64_t v = w[pos >> 6] >> s;
+	if (s + n > 64)
+		v |= w[(pos >> 6) + 1] << (64 - s);
+	return v & ((1ull << n) - 1);
+}
+
+static void comp_batch_prep(struct comp_batch *b, int chipset, int format) {
+	int x, y, i, di;
+	memset(b, 0, sizeof *b);
+	b->ctype = comp_type(chipset);
+	b->ftype = comp_format_type(chipset, format);
+	if (b->ftype == COMP_FORMAT_OFF)
+		return;
+	b->twidth = b->ctype >= COMP_NV40 ? 0x20 : 0x10;
+	b->tsize = b->twidth * 4;
+	b->is_be = comp_format_endian(chipset, format);
+	b->bpp = comp_format_bpp(chipset, format);
+	if (b->ftype != COMP_FORMAT_Z24S8_SPLIT && b->ftype != COMP_FORMAT_FLAT)
+		b->ms = comp_format_ms(chipset, format);
+	switch (b->ftype) {
+		case COMP_FORMAT_Z16_GRAD: {
+			int x0 = b->ctype == COMP_NV20 ? 2 : 3, y0 = 0;
+			int half_dx = b->ctype >= COMP_NV30;
+			di = 0;
+			for (y = 0; y < 4; y++)
+				for (x = 0; x < 8; x++) {
+					int p = y * 8 + x;
+					int need_delta = 1;
+					if (x == x0 && (y == y0 || y == y0 + 2))
+						need_delta = 0;
+					if (y == y0 && x == x0 + (half_dx ? 4 : 2))
+						need_delta = 0;
+					b->gdi[p] = need_delta ? di++ : 29;
+					int rx = 2 * (x - x0);
+					int ry = 2 * (y - y0);
+					if (b->ms == 1)
+						ry -= (x - x0) & 1;
+					b->gc[p] = 6;
+					if (b->ctype < COMP_NV30)
+						b->gc[p] -= ry >= 0;
+					b->gxy[p][0] = rx * (2 - half_dx);
+					b->gxy[p][1] = ry * 2;
+				}
+			break;
+		}
+		case COMP_FORMAT_Z24S8_GRAD: {
+			int x0 = 1, y0 = 1;
+			int half_dx = b->ms == 1;
+			di = 0;
+			for (y = 0; y < 4; y++)
+				for (x = 0; x < 4; x++) {
+					int p = y * 4 + x;
+					int need_delta = 1;
+					if (x == x0 && (y == y0 || y == y0 + 1))
+						need_delta = 0;
+					if (x == x0 + 1 + half_dx && y == y0)
+						need_delta = 0;
+					b->gdi[p] = need_delta ? di++ : 13;
+					int rx = x - x0;
+					int ry = 2 * (y - y0);
+					if (b->ms == 1)
+						ry -= rx & 1;
+					else
+						rx <<= 1;
+					b->gc[p] = 1;
+					b->gxy[p][0] = rx;
+					b->gxy[p][1] = ry;
+				}
+			break;
+		}
+		case COMP_FORMAT_A8R8G8B8_GRAD: {
+			int x0 = 0, y0 = 1;
+			int pw = b->twidth / 8;
+			di = 0;
+			for (y = 0; y < 4; y++)
+				for (x = 0; x < pw; x++) {
+					int p = y * pw + x;
+					int need_delta = 1;
+					if (y == y0)
+						need_delta = 0;
+					if (x == x0 && y == y0 + 2)
+						need_delta = 0;
+					b->adi[p] = need_delta ? di++ : -1;
+					b->arx[p] = x - x0;
+					b->ary[p] = y - y0;
+				}
+			break;
+		}
+		case COMP_FORMAT_A8R8G8B8_INTERP:
+			for (y = 0; y < 4; y++)
+				for (x = 0; x < 4; x++) {
+					int p = y * 4 + x;
+					for (i = 0; i < 16; i++)
+						if (comp_interp_weight[i][y][x]) {
+							b->iwidx[p][b->iwnum[p]] = i;
+							b->iw[p][b->iwnum[p]++] = comp_interp_weight[i][y][x];
+						}
+				}
+			break;
+		case COMP_FORMAT_Z24S8_SPLIT_GRAD: {
+			int x0 = 3, y0 = 0;
+			for (y = 0; y < 4; y++)
+				for (x = 0; x < 8; x++) {
+					int p = y * 8 + x;
+					int rx = 2 * (x - x0);
+					int ry = 2 * (y - y0);
+					if (b->ms == 1) {
+						ry -= ((x - x0) & 1);
+					} else if (b->ms == 2) {
+						ry -= ((x - x0) & 1);
+						rx -= ((y - y0) & 1);
+					}
+					b->sgm[p][0] = rx > 0 ? rx : 0;
+					b->sgm[p][1] = rx > 0 ? 0 : -2 * rx;
+					b->sgm[p][2] = 2 * ry;
+				}
+			break;
+		}
+	}
+}
+
+static void comp_batch_z16_grad(const struct comp_batch *b, const uint32_t cd[8], uint16_t *od16) {
+	uint64_t w0 = cd[0] | (uint64_t)cd[1] << 32;
+	uint64_t w1 = cd[2] | (uint64_t)cd[3] << 32;
+	uint16_t base = w0;
+	int p;
+	if (w0 >> 63) {
+		if (b->ctype >= COMP_NV30) {
+			for (p = 0; p < 32; p++)
+				od16[p] = base;
+			return;
+		}
+		w1 = 0;
+	}
+	int32_t dx = comp_sext(w0 >> 16, 12);
+	int32_t dy = comp_sext(w0 >> 28, 12);
+	/* the deltas continue from bit 62 of w0 straight into w1 */
+	uint64_t s[3] = { (w0 >> 40 & 0x7fffff) | w1 << 23, w1 >> 41, 0 };
+	int16_t rdelta[30];
+	for (p = 0; p < 29; p++)
+		rdelta[p] = comp_sext(comp_field(s, 3 * p, 3), 3);
+	rdelta[29] = 0;
+#ifdef COMP_BATCH_SSE2
+	__m128i dxy = _mm_set1_epi32((uint16_t)dx | (uint32_t)dy << 16);
+	__m128i vbase = _mm_set1_epi32(base);
+	for (p = 0; p < 32; p += 8) {
+		__m128i z0 = _mm_madd_epi16(dxy, _mm_loadu_si128((const __m128i *)b->gxy[p]));
+		__m128i z1 = _mm_madd_epi16(dxy, _mm_loadu_si128((const __m128i *)b->gxy[p + 4]));
+		z0 = _mm_srai_epi32(_mm_add_epi32(z0, _mm_loadu_si128((const __m128i *)&b->gc[p])), 3);
+		z1 = _mm_srai_epi32(_mm_add_epi32(z1, _mm_loadu_si128((const __m128i *)&b->gc[p + 4])), 3);
+		/* wrap to 16 bits before packing, packs would saturate */
+		z0 = _mm_srai_epi32(_mm_slli_epi32(_mm_add_epi32(z0, vbase), 16), 16);
+		z1 = _mm_srai_epi32(_mm_slli_epi32(_mm_add_epi32(z1, vbase), 16), 16);
+		__m128i d = _mm_setr_epi16(rdelta[b->gdi[p]], rdelta[b->gdi[p + 1]], rdelta[b->gdi[p + 2]], rdelta[b->gdi[p + 3]],
+				rdelta[b->gdi[p + 4]], rdelta[b->gdi[p + 5]], rdelta[b->gdi[p + 6]], rdelta[b->gdi[p + 7]]);
+		_mm_storeu_si128((__m128i *)&od16[p], _mm_add_epi16(_mm_packs_epi32(z0, z1), d));
+	}
+#else
+	for (p = 0; p < 32; p++) {
+		int32_t dz = (b->gc[p] + dx * b->gxy[p][0] + dy * b->gxy[p][1]) >> 3;
+		od16[p] = base + dz + rdelta[b->gdi[p]];
+	}
+#endif
+}
+
+static void comp_batch_z24s8_grad(const struct comp_batch *b, const uint32_t cd[8], uint32_t *od32) {
+	uint64_t w0 = cd[0] | (uint64_t)cd[1] << 32;
+	uint64_t w1 = cd[2] | (uint64_t)cd[3] << 32;
+	uint32_t stencil = w0 & 0xff;
+	uint32_t base = w0 >> 8 & 0xffffff;
+	int p;
+	if (w0 >> 63) {
+		if (b->ctype >= COMP_NV30) {
+			for (p = 0; p < 16; p++)
+				od32[p] = base << 8 | stencil;
+			return;
+		}
+		w1 = 0;
+	}
+	int32_t dx = comp_sext(w0 >> 32, 15);
+	int32_t dy = comp_sext(w0 >> 47, 15);
+	uint64_t s[3] = { (w0 >> 62 & 1) | w1 << 1, w1 >> 63, 0 };
+	int32_t rdelta[14];
+	for (p = 0; p < 13; p++)
+		rdelta[p] = comp_sext(comp_field(s, 5 * p, 5), 5);
+	rdelta[13] = 0;
+#ifdef COMP_BATCH_SSE2
+	__m128i dxy = _mm_set1_epi32((uint16_t)dx | (uint32_t)dy << 16);
+	__m128i vbase = _mm_set1_epi32(base);
+	__m128i vstencil = _mm_set1_epi32(stencil);
+	for (p = 0; p < 16; p += 4) {
+		__m128i z = _mm_madd_epi16(dxy, _mm_loadu_si128((const __m128i *)b->gxy[p]));
+		z = _mm_srai_epi32(_mm_add_epi32(z, _mm_loadu_si128((const __m128i *)&b->gc[p])), 1);
+		__m128i d = _mm_setr_epi32(rdelta[b->gdi[p]], rdelta[b->gdi[p + 1]], rdelta[b->gdi[p + 2]], rdelta[b->gdi[p + 3]]);
+		z = _mm_add_epi32(_mm_add_epi32(z, vbase), d);
+		_mm_storeu_si128((__m128i *)&od32[p], _mm_or_si128(_mm_slli_epi32(z, 8), vstencil));
+	}
+#else
+	for (p = 0; p < 16; p++) {
+		int32_t dz = (b->gc[p] + dx * b->gxy[p][0] + dy * b->gxy[p][1]) >> 1;
+		od32[p] = (base + dz + rdelta[b->gdi[p]]) << 8 | stencil;
+	}
+#endif
+}
+
+static void comp_batch_a8r8g8b8_grad(const struct comp_batch *b, const uint32_t cd[8], uint32_t *od32) {
+	uint64_t w0 = cd[0] | (uint64_t)cd[1] << 32;
+	uint64_t w1 = cd[2] | (uint64_t)cd[3] << 32;
+	int is_const = 0;
+	uint8_t base[4];
+	int8_t dx[3], dy[3];
+	int8_t delta[6][3] = { { 0 } };
+	int i, p;
+	if (w0 >> 63) {
+		if (b->ctype < COMP_NV30)
+			w1 = 0;
+		else
+			is_const = 1;
+	}
+	for (i = 0; i < 4; i++)
+		base[i] = w0 >> 8 * i;
+	int pw = b->twidth / 8;
+	if (is_const) {
+		uint32_t res = base[0] | base[1] << 8 | base[2] << 16 | (uint32_t)base[3] << 24;
+		for (p = 0; p < 4 * pw; p++)
+			od32[2 * p] = od32[2 * p + 1] = res;
+		return;
+	}
+	if (!(w0 >> 62 & 1)) {
+		dx[0] = comp_sext(w0 >> 32, 5);
+		dx[1] = comp_sext(w0 >> 37, 5);
+		dx[2] = comp_sext(w0 >> 42, 6);
+		dy[0] = comp_sext(w0 >> 48, 6);
+		dy[1] = comp_sext(w0 >> 54, 6);
+		dy[2] = comp_sext(w0 >> 60 | w1 << 2, 6);
+		for (i = 0; i < 15; i++)
+			delta[i / 3][i % 3] = comp_sext(w1 >> (4 + i * 4), 4);
+	} else {
+		base[3] = comp_sext(w0 >> 24, 1);
+		dx[0] = comp_sext(w0 >> 25, 4);
+		dx[1] = comp_sext(w0 >> 29, 4);
+		dx[2] = comp_sext(w0 >> 33, 4);
+		dy[0] = comp_sext(w0 >> 37, 4);
+		dy[1] = comp_sext(w0 >> 41, 5);
+		dy[2] = comp_sext(w0 >> 46, 5);
+		delta[0][0] = comp_sext(w0 >> 51, 5);
+		delta[0][1] = comp_sext(w0 >> 56, 5);
+		delta[0][2] = comp_sext((w0 >> 61 & 1) | w1 << 1, 5);
+		for (i = 0; i < 12; i++)
+			delta[1 + i / 3][i % 3] = comp_sext(w1 >> (4 + i * 5), 5);
+	}
+	for (p = 0; p < 4 * pw; p++) {
+		uint32_t res = (uint32_t)base[3] << 24;
+		const int8_t *d = b->adi[p] < 0 ? delta[5] : delta[(int)b->adi[p]];
+		for (i = 0; i < 3; i++) {
+			uint8_t c = base[i] + b->arx[p] * dx[i] + ((b->ary[p] * dy[i] + 1) >> 1) + d[i];
+			res |= c << 8 * i;
+		}
+		od32[2 * p] = od32[2 * p + 1] = res;
+	}
+}
+
+static void comp_batch_a8r8g8b8_interp(const struct comp_batch *b, const uint32_t cd[8], uint32_t *od32) {
+	int mode = 0;
+	if (cd[3] & 1 << 31)
+		mode = cd[3] & 1 << 30 ? 2 : 1;
+	/* the bit stream skips the mode bits at the end of the first half */
+	int split = 127 - mode;
+	uint64_t s[5];
+	uint64_t h0 = cd[4] | (uint64_t)cd[5] << 32;
+	uint64_t h1 = cd[6] | (uint64_t)cd[7] << 32;
+	s[0] = cd[0] | (uint64_t)cd[1] << 32;
+	s[1] = (cd[2] | (uint64_t)cd[3] << 32) & ((1ull << (split - 64)) - 1);
+	s[1] |= h0 << (split - 64);
+	s[2] = h0 >> (128 - split) | h1 << (split - 64);
+	s[3] = h1 >> (128 - split);
+	s[4] = 0;
+	int pos = 0;
+	uint16_t raw[16][3];
+	uint8_t alpha = 0;
+	int i, p, k;
+	for (i = 0; i < (mode == 2 ? 1 : 16); i++) {
+		int rbsize, gsize, is_l;
+		if (i < 4)
+			rbsize = gsize = 8, is_l = 0;
+		else if (!mode) {
+			if (i < 11)
+				rbsize = 4, gsize = 5, is_l = 1;
+			else
+				rbsize = gsize = 4, is_l = 1;
+		} else {
+			if (i < 5)
+				rbsize = 4, gsize = 6, is_l = 1;
+			else
+				rbsize = 4, gsize = 5, is_l = 1;
+		}
+		int bl = comp_sext(comp_field(s, pos, rbsize), rbsize);
+		int g = comp_sext(comp_field(s, pos + rbsize, gsize), gsize);
+		int r = comp_sext(comp_field(s, pos + rbsize + gsize, rbsize), rbsize);
+		pos += 2 * rbsize + gsize;
+		if (is_l)
+			r += g, bl += g;
+		else
+			r &= 0xff, g &= 0xff, bl &= 0xff;
+		raw[i][0] = bl;
+		raw[i][1] = g;
+		raw[i][2] = r;
+		if (i == 0) {
+			int abits = mode == 1 ? 1 : 8;
+			alpha = comp_sext(comp_field(s, pos, abits), abits);
+			pos += abits;
+		}
+	}
+	for (p = 0; p < 16; p++) {
+		uint32_t res = alpha << 24;
+		for (k = 0; k < 3; k++) {
+			int pixel;
+			if (mode == 2) {
+				pixel = raw[0][k];
+			} else {
+				pixel = 3;
+				for (i = 0; i < b->iwnum[p]; i++)
+					pixel += raw[b->iwidx[p][i]][k] * b->iw[p][i];
+				pixel >>= 2;
+			}
+			res |= (pixel & 0xff) << 8 * k;
+		}
+		od32[2 * p] = od32[2 * p + 1] = res;
+	}
+}
+
+static void comp_batch_z24_grad(const struct comp_batch *b, const uint32_t cd[8], uint32_t *od32) {
+	/* bit position and size of the delta of every pixel, 0 size for none */
+	static const uint8_t dpos[32] = {
+		75, 0, 82, 0, 88, 94, 101, 0,
+		108, 115, 121, 128, 134, 140, 147, 154,
+		160, 167, 173, 0, 179, 185, 192, 199,
+		205, 212, 218, 224, 230, 236, 243, 250,
+	};
+	static const uint8_t dbits[32] = {
+		7, 0, 6, 0, 6, 7, 7, 0,
+		7, 6, 6, 6, 6, 7, 7, 6,
+		7, 6, 6, 0, 6, 7, 7, 6,
+		7, 6, 6, 6, 6, 7, 7, 6,
+	};
+	uint64_t s[5] = {
+		cd[0] | (uint64_t)cd[1] << 32,
+		cd[2] | (uint64_t)cd[3] << 32,
+		cd[4] | (uint64_t)cd[5] << 32,
+		cd[6] | (uint64_t)cd[7] << 32,
+		0,
+	};
+	uint32_t base = cd[0] & 0xffffff;
+	int p;
+	if (cd[3] >> 31) {
+		for (p = 0; p < 32; p++)
+			od32[p] = base;
+		return;
+	}
+	int32_t dxp = comp_sext(comp_field(s, 24, 17), 17);
+	int32_t dxn = comp_sext(comp_field(s, 41, 17), 17);
+	int32_t dy = comp_sext(comp_field(s, 58, 17), 17);
+	for (p = 0; p < 32; p++) {
+		int32_t dz = 7 + b->sgm[p][0] * dxp + b->sgm[p][1] * dxn + b->sgm[p][2] * dy;
+		int32_t delta = dbits[p] ? comp_sext(comp_field(s, dpos[p], dbits[p]), dbits[p]) : 0;
+		od32[p] = base + (dz >> 3) + delta;
+	}
+}
+
+static void comp_batch_tile(const struct comp_batch *b, uint8_t *data, int tag) {
+	uint32_t cd[8];
+	uint32_t od32[32];
+	uint16_t od16[32];
+	int i, x, y;
+	int n = b->twidth / 4;
+	for (i = 0; i < 8; i++) {
+		int dp;
+		if (b->ctype < COMP_NV40)
+			dp = 4 * i;
+		else
+			dp = 4 * (4 + (i & 3) + (~i >> 2 & 1) * 8);
+		cd[i] = data[dp] | data[dp + 1] << 8 | data[dp + 2] << 16 | (uint32_t)data[dp + 3] << 24;
+	}
+	switch (b->ftype) {
+		case COMP_FORMAT_FLAT:
+			if (!tag)
+				return;
+			for (y = 0; y < 4; y++)
+				for (x = 0; x < n; x++)
+					od32[y * n + x] = cd[(x >> 1) + (y >> 1) * (b->twidth >> 3)];
+			break;
+		case COMP_FORMAT_Z16_GRAD:
+			if (!tag)
+				return;
+			comp_batch_z16_grad(b, cd, od16);
+			break;
+		case COMP_FORMAT_Z24S8_GRAD:
+			if (!tag)
+				return;
+			comp_batch_z24s8_grad(b, cd, od32);
+			break;
+		case COMP_FORMAT_A8R8G8B8_GRAD:
+			if (!tag)
+				return;
+			comp_batch_a8r8g8b8_grad(b, cd, od32);
+			break;
+		case COMP_FORMAT_A8R8G8B8_INTERP:
+			if (!tag)
+				return;
+			comp_batch_a8r8g8b8_interp(b, cd, od32);
+			break;
+		case COMP_FORMAT_Z24S8_SPLIT:
+		case COMP_FORMAT_Z24S8_SPLIT_GRAD:
+			if (tag && b->ftype == COMP_FORMAT_Z24S8_SPLIT_GRAD) {
+				comp_batch_z24_grad(b, cd, od32);
+			} else {
+				uint8_t rbuf[0x60];
+				for (i = 0; i < 6; i++)
+					memcpy(rbuf + i * 0x10, data + "\x10\x30\x50\x40\x60\x70"[i], 0x10);
+				for (y = 0; y < 4; y++)
+					for (x = 0; x < 8; x++) {
+						int di = 3 * ((x & 4) << 2 | y << 2 | (x & 3));
+						od32[y * 8 + x] = rbuf[di] | rbuf[di + 1] << 8 | rbuf[di + 2] << 16;
+					}
+			}
+			for (y = 0; y < 4; y++)
+				for (x = 0; x < 8; x++)
+					od32[y * 8 + x] = od32[y * 8 + x] << 8 | data[y * 4 + (x & 3) + (x & 4) * 8];
+			break;
+	}
+	if (b->bpp == 16) {
+		for (i = 0; i < b->tsize / 2; i++) {
+			uint16_t v = od16[i];
+			if (b->is_be)
+				v = v >> 8 | v << 8;
+			data[2 * i] = v;
+			data[2 * i + 1] = v >> 8;
+		}
+	} else {
+		for (i = 0; i < b->tsize / 4; i++) {
+			uint32_t v = od32[i];
+			if (b->is_be)
+				v = __builtin_bswap32(v);
+			data[4 * i] = v;
+			data[4 * i + 1] = v >> 8;
+			data[4 * i + 2] = v >> 16;
+			data[4 * i + 3] = v >> 24;
+		}
+	}
+}
+
+int comp_tile_size(int chipset) {
+	return comp_type(chipset) >= COMP_NV40 ? 0x80 : 0x40;
+}
+
+void comp_decompress_tiles(int chipset, int format, uint8_t *data, const uint8_t *tags, int num) {
+	struct comp_batch b;
+	int i;
+	comp_batch_prep(&b, chipset, format);
+	if (b.ftype == COMP_FORMAT_OFF)
+		return;
+	for (i = 0; i < num; i++)
+		comp_batch_tile(&b, data + (size_t)i * b.tsize, tags[i]);
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2016 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "nvhw/vram.h"
+#include <stdlib.h>
+#include <pthread.h>
+
+/*
+ * Threaded wrapper for comp_decompress_tiles.  Kept out of libnvhw proper,
+ * so that its other users don't have to link pthreads.
+ */
+
+struct comp_job {
+	int chipset;
+	int format;
+	uint8_t *data;
+	const uint8_t *tags;
+	int num;
+};
+
+static void *comp_job_run(void *arg) {
+	struct comp_job *job = arg;
+	comp_decompress_tiles(job->chipset, job->format, job->data, job->tags, job->num);
+	return 0;
+}
+
+/* below this many tiles per thread, thread startup costs more than it saves */
+#define COMP_MIN_TILES_PER_THREAD 0x400
+
+void comp_decompress_tiles_mt(int chipset, int format, uint8_t *data, const uint8_t *tags, int num, int nthreads) {
+	int tsize = comp_tile_size(chipset);
+	int i;
+	if (num <= 0)
+		return;
+	if (nthreads > num / COMP_MIN_TILES_PER_THREAD)
+		nthreads = num / COMP_MIN_TILES_PER_THREAD;
+	if (nthreads < 1)
+		nthreads = 1;
+	struct comp_job *jobs = calloc(nthreads, sizeof *jobs);
+	pthread_t *threads = calloc(nthreads, sizeof *threads);
+	int *started = calloc(nthreads, sizeof *started);
+	int start = 0;
+	for (i = 0; i < nthreads; i++) {
+		int end = (int64_t)num * (i + 1) / nthreads;
+		jobs[i].chipset = chipset;
+		jobs[i].format = format;
+		jobs[i].data = data + (size_t)start * tsize;
+		jobs[i].tags = tags + start;
+		jobs[i].num = end - start;
+		start = end;
+	}
+	/* a job whose thread can't be created is just run here */
+	for (i = 1; i < nthreads; i++)
+		started[i] = !pthread_create(&threads[i], 0, comp_job_run, &jobs[i]);
+	comp_job_run(&jobs[0]);
+	for (i = 1; i < nthreads; i++) {
+		if (started[i])
+			pthread_join(threads[i], 0);
+		else
+			comp_job_run(&jobs[i]);
+	}
+	free(jobs);
+	free(threads);
+	free(started);
+}
@@ -0,0 +1,486 @@
+/*
+ * Copyright (C) 2016 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "nvhw/fp.h"
+
+/*
+ * The host FPU, in the matching rounding mode, gives the same results as the
+ * models whenever all inputs and the result are normal numbers well away
+ * from the edges of the range - that's the bulk of any real workload.  The
+ * SIMD paths compute whole vectors that way, then redo the lanes that fall
+ * outside of that (zero, denormal, tiny, Inf, NaN, overflow) with the scalar
+ * model.  FP_RT has no host equivalent and always goes scalar.
+ */
+
+#if defined(__GNUC__) && defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__))
+#define FP_BATCH_X86
+#include <immintrin.h>
+#define FP_AVX2 __attribute__((target("avx2,fma,f16c")))
+#endif
+
+static int fp_simd_cur = -1;
+
+static enum fp_simd fp_simd_max(void) {
+#ifdef FP_BATCH_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c"))
+		return FP_SIMD_AVX2;
+	return FP_SIMD_SSE2;
+#else
+	return FP_SIMD_NONE;
+#endif
+}
+
+enum fp_simd fp_batch_set_simd(enum fp_simd simd) {
+	enum fp_simd max = fp_simd_max();
+	fp_simd_cur = simd < max ? simd : max;
+	return fp_simd_cur;
+}
+
+static enum fp_simd fp_simd_get(enum fp_rm rm) {
+	if (rm == FP_RT)
+		return FP_SIMD_NONE;
+	if (fp_simd_cur == -1)
+		fp_simd_cur = fp_simd_max();
+	return fp_simd_cur;
+}
+
+#ifdef FP_BATCH_X86
+
+/* smallest input and result magnitudes the SIMD paths accept */
+#define FP32_IN_MIN 0x00800000u
+#define FP32_OUT_MIN 0x01000000u
+/* largest finite number, results equal to it could have come from overflow */
+#define FP32_OUT_MAX 0x7f7fffffu
+/* fp32_to_fp16 flushes anything below 2^-33 to 0 regardless of rounding */
+#define FP32_F16_IN_MIN 0x2f000000u
+#define FP64_IN_MIN 0x0010000000000000ull
+#define FP64_OUT_MIN 0x0020000000000000ull
+#define FP64_OUT_MAX 0x7fefffffffffffffull
+
+/* Switches the host rounding mode, with denormals honored.  Returns the
+   previous MXCSR for fp_batch_leave.  */
+static unsigned fp_batch_enter(enum fp_rm rm) {
+	static const unsigned rc[4] = {
+		[FP_RN] = _MM_ROUND_NEAREST,
+		[FP_RM] = _MM_ROUND_DOWN,
+		[FP_RP] = _MM_ROUND_UP,
+		[FP_RZ] = _MM_ROUND_TOWARD_ZERO,
+	};
+	unsigned old = _mm_getcsr();
+	/* 0x40 is DAZ */
+	_mm_setcsr((old & ~(_MM_ROUND_MASK | _MM_FLUSH_ZERO_MASK | 0x40)) | rc[rm]);
+	return old;
+}
+
+static void fp_batch_leave(unsigned csr) {
+	_mm_setcsr(csr);
+}
+
+/* Returns a bitmask of lanes whose magnitude isn't in [min, max) (or NaN). */
+
+static inline int fp32_bad_sse2(__m128 x, uint32_t min, uint32_t max) {
+	__m128 ax = _mm_and_ps(x, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)));
+	__m128 good = _mm_and_ps(_mm_cmpge_ps(ax, _mm_castsi128_ps(_mm_set1_epi32(min))),
+			_mm_cmplt_ps(ax, _mm_castsi128_ps(_mm_set1_epi32(max))));
+	return ~_mm_movemask_ps(good) & 0xf;
+}
+
+static inline int fp64_bad_sse2(__m128d x, uint64_t min, uint64_t max) {
+	__m128d ax = _mm_and_pd(x, _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffll)));
+	__m128d good = _mm_and_pd(_mm_cmpge_pd(ax, _mm_castsi128_pd(_mm_set1_epi64x(min))),
+			_mm_cmplt_pd(ax, _mm_castsi128_pd(_mm_set1_epi64x(max))));
+	return ~_mm_movemask_pd(good) & 0x3;
+}
+
+FP_AVX2 static inline int fp32_bad_avx2(__m256 x, uint32_t min, uint32_t max) {
+	__m256 ax = _mm256_and_ps(x, _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff)));
+	__m256 good = _mm256_and_ps(_mm256_cmp_ps(ax, _mm256_castsi256_ps(_mm256_set1_epi32(min)), _CMP_GE_OQ),
+			_mm256_cmp_ps(ax, _mm256_castsi256_ps(_mm256_set1_epi32(max)), _CMP_LT_OQ));
+	return ~_mm256_movemask_ps(good) & 0xff;
+}
+
+FP_AVX2 static inline int fp64_bad_avx2(__m256d x, uint64_t min, uint64_t max) {
+	__m256d ax = _mm256_and_pd(x, _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffll)));
+	__m256d good = _mm256_and_pd(_mm256_cmp_pd(ax, _mm256_castsi256_pd(_mm256_set1_epi64x(min)), _CMP_GE_OQ),
+			_mm256_cmp_pd(ax, _mm256_castsi256_pd(_mm256_set1_epi64x(max)), _CMP_LT_OQ));
+	return ~_mm256_movemask_pd(good) & 0xf;
+}
+
+/* The fp32_mad product: exact in double, then truncated to 24 bits - which
+   is the RZ rounding the model does, as long as it stays a normal fp32.  */
+
+static inline __m128 fp32_mul_rz_sse2(__m128 a, __m128 b) {
+	__m128d mask = _mm_castsi128_pd(_mm_set1_epi64x(~0x1fffffffll));
+	__m128d lo = _mm_mul_pd(_mm_cvtps_pd(a), _mm_cvtps_pd(b));
+	__m128d hi = _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(a, a)), _mm_cvtps_pd(_mm_movehl_ps(b, b)));
+	lo = _mm_and_pd(lo, mask);
+	hi = _mm_and_pd(hi, mask);
+	return _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi));
+}
+
+FP_AVX2 static inline __m256 fp32_mul_rz_avx2(__m256 a, __m256 b) {
+	__m256d mask = _mm256_castsi256_pd(_mm256_set1_epi64x(~0x1fffffffll));
+	__m256d lo = _mm256_mul_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(a)), _mm256_cvtps_pd(_mm256_castps256_ps128(b)));
+	__m256d hi = _mm256_mul_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(a, 1)), _mm256_cvtps_pd(_mm256_extractf128_ps(b, 1)));
+	lo = _mm256_and_pd(lo, mask);
+	hi = _mm256_and_pd(hi, mask);
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(lo)), _mm256_cvtpd_ps(hi), 1);
+}
+
+static int fp32_add_sse2(uint32_t *res, const uint32_t *a, const uint32_t *b, int num, enum fp_rm rm) {
+	int i, j, bad;
+	unsigned csr = fp_batch_enter(rm);
+	for (i = 0; i + 4 <= num; i += 4) {
+		__m128 va = _mm_loadu_ps((const float *)(a + i));
+		__m128 vb = _mm_loadu_ps((const float *)(b + i));
+		__m128 vr = _mm_add_ps(va, vb);
+		_mm_storeu_ps((float *)(res + i), vr);
+		bad = fp32_bad_sse2(va, FP32_IN_MIN, FP32_OUT_MAX + 1) | fp32_bad_sse2(vb, FP32_IN_MIN, FP32_OUT_MAX + 1) | fp32_bad_sse2(vr, FP32_OUT_MIN, FP32_OUT_MAX);
+		for (j = 0; bad; j++, bad >>= 1)
+			if (bad & 1)
+				res[i+j] = fp32_add(a[i+j], b[i+j], rm);
+	}
+	fp_batch_leave(csr);
+	return i;
+}
+
+FP_AVX2 static int fp32_add_avx2(uint32_t *res, const uint32_t *a, const uint32_t *b, int num, enum fp_rm rm) {
+	int i, j, bad;
+	unsigned csr = fp_batch_enter(rm);
+	for (i = 0; i + 8 <= num; i += 8) {
+		__m256 va = _mm256_loadu_ps((const float *)(a + i));
+		__m256 vb = _mm256_loadu_ps((const float *)(b + i));
+		__m256 vr = _mm256_add_ps(va, vb);
+		_mm256_storeu_ps((float *)(res + i), vr);
+		bad = fp32_bad_avx2(va, FP32_IN_MIN, FP32_OUT_MAX + 1) | fp32_bad_avx2(vb, FP32_IN_MIN, FP32_OUT_MAX + 1) | fp32_bad_avx2(vr, FP32_OUT_MIN, FP32_OUT_MAX);
+		for (j = 0; bad; j++, bad >>= 1)
+			if (bad & 1)
+				res[i+j] = fp32_add(a[i+j], b[i+j], rm);
+	}
+	fp_batch_leave(csr);
+	return i;
+}
+
+static int fp32_mul_sse2(uint32_t *res, const uint32_t *a, const uint32_t *b, int num, enum fp_rm rm, bool zero_wins) {
+	int i, j, bad;
+	unsigned csr = fp_batch_enter(rm);
+	for (i = 0; i + 4 <= num; i += 4) {
+		__m128 va = _mm_loadu_ps((const float *)(a + i));
+		__m128 vb = _mm_loadu_ps((const float *)(b + i));
+		__m128 vr = _mm_mul_ps(va, vb);
+		_mm_storeu_ps((float *)(res + i), vr);
+		bad = fp32_bad_sse2(va, FP32_IN_MIN, FP32_OUT_MAX + 1) | fp32_bad_sse2(vb, FP32_IN_MIN, FP32_OUT_MAX + 1) | fp32_bad_sse2(vr, FP32_OUT_MIN, FP32_OUT_MAX);
+		for (j = 0; bad; j++, bad >>= 1)
+			if (bad & 1)
+				res[i+j] = fp32_mul(a[i+j], b[i+j], rm, zero_wins);
+	}
+	fp_batch_leave(csr);
+	return i;
+}
+
+FP_AVX2 static int fp32_mul_avx2(uint32_t *res, const uint32_t *a, const uint32_t *b, int num, enum fp_rm rm, bool zero_wins) {
+	int i, j, bad;
+	unsigned csr = fp_batch_enter(rm);
+	for (i = 0; i + 8 <= num; i += 8) {
+		__m256 va = _mm256_loadu_ps((const float *)(a + i));
+		__m256 vb = _mm256_loadu_ps((const float *)(b + i));
+		__m256 vr = _mm256_mul_ps(va, vb);
+		_mm256_storeu_ps((float *)(res + i), vr);
+		bad = fp32_bad_avx2(va, FP32_IN_MIN, FP32_OUT_MAX + 1) | fp32_bad_avx2(vb, FP32_IN_MIN, FP32_OUT_MAX + 1) | fp32_bad_avx2(vr, FP32_OUT_MIN, FP32_OUT_MAX);
+		for (j = 0; bad; j++, bad >>= 1)
+			if (bad & 1)
+				res[i+j] = fp32_mul(a[i+j], b[i+j], rm, zero_wins);
+	}
+	fp_batch_leave(csr);
+	return i;
+}
+
+static int fp32_mad_sse2(uint32_t *res, const uint32_t *a, const uint32_t *b, const uint32_t *c, int num, bool zero_wins) {
+	int i, j, bad;
+	unsigned csr = fp_batch_enter(FP_RN);
+	for (i = 0; i + 4 <= num; i += 4) {
+		__m128 va = _mm_loadu_ps((const float *)(a + i));
+		__m128 vb = _mm_loadu_ps((const float *)(b + i));
+		__m128 vc = _mm_loadu_ps((const float *)(c + i));
+		__m128 vp = fp32_mul_rz_sse2(va, vb);
+		__m128 vr = _mm_add_ps(vp, vc);
+		_mm_storeu_ps((float *)(res + i), vr);
+		bad = fp32_bad_sse2(va, FP32_IN_MIN, FP32_OUT_MAX + 1) | fp32_bad_sse2(vb, FP32_IN_MIN, FP32_OUT_MAX + 1) | fp32_bad_sse2(vc, FP32_IN_MIN, FP32_OUT_MAX + 1);
+		bad |= fp32_bad_sse2(vp, FP32_OUT_MIN, FP32_OUT_MAX) | fp32_bad_sse2(vr, FP32_OUT_MIN, FP32_OUT_MAX);
+		for (j = 0; bad; j++, bad >>= 1)
+			if (bad & 1)
+				res[i+j] = fp32_mad(a[i+j], b[i+j], c[i+j], zero_wins);
+	}
+	fp_batch_leave(csr);
+	return i;
+}
+
+FP_AVX2 static int fp32_mad_avx2(uint32_t *res, const uint32_t *a, const uint32_t *b, const uint32_t *c, int num, bool zero_wins) {
+	int i, j, bad;
+	unsigned csr = fp_batch_enter(FP_RN);
+	for (i = 0; i + 8 <= num; i += 8) {
+		__m256 va = _mm256_loadu_ps((const float *)(a + i));
+		__m256 vb = _mm256_loadu_ps((const float *)(b + i));
+		__m256 vc = _mm256_loadu_ps((const float *)(c + i));
+		__m256 vp = fp32_mul_rz_avx2(va, vb);
+		__m256 vr = _mm256_add_ps(vp, vc);
+		_mm256_storeu_ps((float *)(res + i), vr);
+		bad = fp32_bad_avx2(va, FP32_IN_MIN, FP32_OUT_MAX + 1) | fp32_bad_avx2(vb, FP32_IN_MIN, FP32_OUT_MAX + 1) | fp32_bad_avx2(vc, FP32_IN_MIN, FP32_OUT_MAX + 1);
+		bad |= fp32_bad_avx2(vp, FP32_OUT_MIN, FP32_OUT_MAX) | fp32_bad_avx2(vr, FP32_OUT_MIN, FP32_OUT_MAX);
+		for (j = 0; bad; j++, bad >>= 1)
+			if (bad & 1)
+				res[i+j] = fp32_mad(a[i+j], b[i+j], c[i+j], zero_wins);
+	}
+	fp_batch_leave(csr);
+	return i;
+}
+
+FP_AVX2 static int fp32_to_fp16_avx2(uint16_t *res, const uint32_t *x, int num, enum fp_rm rm) {
+	int i, j, bad;
+	unsigned csr = fp_batch_enter(rm);
+	for (i = 0; i + 8 <= num; i += 8) {
+		__m256 vx = _mm256_loadu_ps((const float *)(x + i));
+		_mm_storeu_si128((__m128i *)(res + i), _mm256_cvtps_ph(vx, _MM_FROUND_CUR_DIRECTION));
+		bad = fp32_bad_avx2(vx, FP32_F16_IN_MIN, FP32_OUT_MAX + 1);
+		for (j = 0; bad; j++, bad >>= 1)
+			if (bad & 1)
+				res[i+j] = fp32_to_fp16(x[i+j], rm, false);
+	}
+	fp_batch_leave(csr);
+	return i;
+}
+
+static int fp64_add_sse2(uint64_t *res, const uint64_t *a, const uint64_t *b, int num, enum fp_rm rm) {
+	int i, j, bad;
+	unsigned csr = fp_batch_enter(rm);
+	for (i = 0; i + 2 <= num; i += 2) {
+		__m128d va = _mm_loadu_pd((const double *)(a + i));
+		__m128d vb = _mm_loadu_pd((const double *)(b + i));
+		__m128d vr = _mm_add_pd(va, vb);
+		_mm_storeu_pd((double *)(res + i), vr);
+		bad = fp64_bad_sse2(va, FP64_IN_MIN, FP64_OUT_MAX + 1) | fp64_bad_sse2(vb, FP64_IN_MIN, FP64_OUT_MAX + 1) | fp64_bad_sse2(vr, FP64_OUT_MIN, FP64_OUT_MAX);
+		for (j = 0; bad; j++, bad >>= 1)
+			if (bad & 1)
+				res[i+j] = fp64_add(a[i+j], b[i+j], rm);
+	}
+	fp_batch_leave(csr);
+	return i;
+}
+
+FP_AVX2 static int fp64_add_avx2(uint64_t *res, const uint64_t *a, const uint64_t *b, int num, enum fp_rm rm) {
+	int i, j, bad;
+	unsigned csr = fp_batch_enter(rm);
+	for (i = 0; i + 4 <= num; i += 4) {
+		__m256d va = _mm256_loadu_pd((const double *)(a + i));
+		__m256d vb = _mm256_loadu_pd((const double *)(b + i));
+		__m256d vr = _mm256_add_pd(va, vb);
+		_mm256_storeu_pd((double *)(res + i), vr);
+		bad = fp64_bad_avx2(va, FP64_IN_MIN, FP64_OUT_MAX + 1) | fp64_bad_avx2(vb, FP64_IN_MIN, FP64_OUT_MAX + 1) | fp64_bad_avx2(vr, FP64_OUT_MIN, FP64_OUT_MAX);
+		for (j = 0; bad; j++, bad >>= 1)
+			if (bad & 1)
+				res[i+j] = fp64_add(a[i+j], b[i+j], rm);
+	}
+	fp_batch_leave(csr);
+	return i;
+}
+
+static int fp64_mul_sse2(uint64_t *res, const uint64_t *a, const uint64_t *b, int num, enum fp_rm rm) {
+	int i, j, bad;
+	unsigned csr = fp_batch_enter(rm);
+	for (i = 0; i + 2 <= num; i += 2) {
+		__m128d va = _mm_loadu_pd((const double *)(a + i));
+		__m128d vb = _mm_loadu_pd((const double *)(b + i));
+		__m128d vr = _mm_mul_pd(va, vb);
+		_mm_storeu_pd((double *)(res + i), vr);
+		bad = fp64_bad_sse2(va, FP64_IN_MIN, FP64_OUT_MAX + 1) | fp64_bad_sse2(vb, FP64_IN_MIN, FP64_OUT_MAX + 1) | fp64_bad_sse2(vr, FP64_OUT_MIN, FP64_OUT_MAX);
+		for (j = 0; bad; j++, bad >>= 1)
+			if (bad & 1)
+				res[i+j] = fp64_mul(a[i+j], b[i+j], rm);
+	}
+	fp_batch_leave(csr);
+	return i;
+}
+
+FP_AVX2 static int fp64_mul_avx2(uint64_t *res, const uint64_t *a, const uint64_t *b, int num, enum fp_rm rm) {
+	int i, j, bad;
+	unsigned csr = fp_batch_enter(rm);
+	for (i = 0; i + 4 <= num; i += 4) {
+		__m256d va = _mm256_loadu_pd((const double *)(a + i));
+		__m256d vb = _mm256_loadu_pd((const double *)(b + i));
+		__m256d vr = _mm256_mul_pd(va, vb);
+		_mm256_storeu_pd((double *)(res + i), vr);
+		bad = fp64_bad_avx2(va, FP64_IN_MIN, FP64_OUT_MAX + 1) | fp64_bad_avx2(vb, FP64_IN_MIN, FP64_OUT_MAX + 1) | fp64_bad_avx2(vr, FP64_OUT_MIN, FP64_OUT_MAX);
+		for (j = 0; bad; j++, bad >>= 1)
+			if (bad & 1)
+				res[i+j] = fp64_mul(a[i+j], b[i+j], rm);
+	}
+	fp_batch_leave(csr);
+	return i;
+}
+
+FP_AVX2 static int fp64_fma_avx2(uint64_t *res, const uint64_t *a, const uint64_t *b, const uint64_t *c, int num, enum fp_rm rm) {
+	int i, j, bad;
+	unsigned csr = fp_batch_enter(rm);
+	for (i = 0; i + 4 <= num; i += 4) {
+		__m256d va = _mm256_loadu_pd((const double *)(a + i));
+		__m256d vb = _mm256_loadu_pd((const double *)(b + i));
+		__m256d vc = _mm256_loadu_pd((const double *)(c + i));
+		__m256d vr = _mm256_fmadd_pd(va, vb, vc);
+		_mm256_storeu_pd((double *)(res + i), vr);
+		bad = fp64_bad_avx2(va, FP64_IN_MIN, FP64_OUT_MAX + 1) | fp64_bad_avx2(vb, FP64_IN_MIN, FP64_OUT_MAX + 1) | fp64_bad_avx2(vc, FP64_IN_MIN, FP64_OUT_MAX + 1);
+		bad |= fp64_bad_avx2(vr, FP64_OUT_MIN, FP64_OUT_MAX);
+		for (j = 0; bad; j++, bad >>= 1)
+			if (bad & 1)
+				res[i+j] = fp64_fma(a[i+j], b[i+j], c[i+j], rm);
+	}
+	fp_batch_leave(csr);
+	return i;
+}
+
+#endif
+
+/* Each SIMD path returns how many elements it did, the tail goes scalar. */
+
+void fp32_add_batch(uint32_t *res, const uint32_t *a, const uint32_t *b, int num, enum fp_rm rm) {
+	int i = 0;
+	switch (fp_simd_get(rm)) {
+#ifdef FP_BATCH_X86
+		case FP_SIMD_AVX2:
+			i = fp32_add_avx2(res, a, b, num, rm);
+			break;
+		case FP_SIMD_SSE2:
+			i = fp32_add_sse2(res, a, b, num, rm);
+			break;
+#endif
+		default:
+			break;
+	}
+	for (; i < num; i++)
+		res[i] = fp32_add(a[i], b[i], rm);
+}
+
+void fp32_mul_batch(uint32_t *res, const uint32_t *a, const uint32_t *b, int num, enum fp_rm rm, bool zero_wins) {
+	int i = 0;
+	switch (fp_simd_get(rm)) {
+#ifdef FP_BATCH_X86
+		case FP_SIMD_AVX2:
+			i = fp32_mul_avx2(res, a, b, num, rm, zero_wins);
+			break;
+		case FP_SIMD_SSE2:
+			i = fp32_mul_sse2(res, a, b, num, rm, zero_wins);
+			break;
+#endif
+		default:
+			break;
+	}
+	for (; i < num; i++)
+		res[i] = fp32_mul(a[i], b[i], rm, zero_wins);
+}
+
+void fp32_mad_batch(uint32_t *res, const uint32_t *a, const uint32_t *b, const uint32_t *c, int num, bool zero_wins) {
+	int i = 0;
+	switch (fp_simd_get(FP_RN)) {
+#ifdef FP_BATCH_X86
+		case FP_SIMD_AVX2:
+			i = fp32_mad_avx2(res, a, b, c, num, zero_wins);
+			break;
+		case FP_SIMD_SSE2:
+			i = fp32_mad_sse2(res, a, b, c, num, zero_wins);
+			break;
+#endif
+		default:
+			break;
+	}
+	for (; i < num; i++)
+		res[i] = fp32_mad(a[i], b[i], c[i], zero_wins);
+}
+
+void fp32_to_fp16_batch(uint16_t *res, const uint32_t *x, int num, enum fp_rm rm, bool rint) {
+	int i = 0;
+	/* F16C comes with AVX2 here, there is no SSE2 path */
+	switch (rint ? FP_SIMD_NONE : fp_simd_get(rm)) {
+#ifdef FP_BATCH_X86
+		case FP_SIMD_AVX2:
+			i = fp32_to_fp16_avx2(res, x, num, rm);
+			break;
+#endif
+		default:
+			break;
+	}
+	for (; i < num; i++)
+		res[i] = fp32_to_fp16(x[i], rm, rint);
+}
+
+void fp64_add_batch(uint64_t *res, const uint64_t *a, const uint64_t *b, int num, enum fp_rm rm) {
+	int i = 0;
+	switch (fp_simd_get(rm)) {
+#ifdef FP_BATCH_X86
+		case FP_SIMD_AVX2:
+			i = fp64_add_avx2(res, a, b, num, rm);
+			break;
+		case FP_SIMD_SSE2:
+			i = fp64_add_sse2(res, a, b, num, rm);
+			break;
+#endif
+		default:
+			break;
+	}
+	for (; i < num; i++)
+		res[i] = fp64_add(a[i], b[i], rm);
+}
+
+void fp64_mul_batch(uint64_t *res, const uint64_t *a, const uint64_t *b, int num, enum fp_rm rm) {
+	int i = 0;
+	switch (fp_simd_get(rm)) {
+#ifdef FP_BATCH_X86
+		case FP_SIMD_AVX2:
+			i = fp64_mul_avx2(res, a, b, num, rm);
+			break;
+		case FP_SIMD_SSE2:
+			i = fp64_mul_sse2(res, a, b, num, rm);
+			break;
+#endif
+		default:
+			break;
+	}
+	for (; i < num; i++)
+		res[i] = fp64_mul(a[i], b[i], rm);
+}
+
+void fp64_fma_batch(uint64_t *res, const uint64_t *a, const uint64_t *b, const uint64_t *c, int num, enum fp_rm rm) {
+	int i = 0;
+	/* SSE2 has no fused multiply-add */
+	switch (fp_simd_get(rm)) {
+#ifdef FP_BATCH_X86
+		case FP_SIMD_AVX2:
+			i = fp64_fma_avx2(res, a, b, c, num, rm);
+			break;
+#endif
+		default:
+			break;
+	}
+	for (; i < num; i++)
+		res[i] = fp64_fma(a[i], b[i], c[i], rm);
+}
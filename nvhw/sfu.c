@@ -25,6 +25,7 @@
 #include "nvhw/sfu.h"
 #include "nvhw/fp.h"
 #include <assert.h>
+#include <stdlib.h>
 
 uint32_t sfu_pre(uint32_t x, enum sfu_pre_mode mode) {
 	bool sx;
@@ -63,12 +64,40 @@ uint32_t sfu_pre(uint32_t x, enum sfu_pre_mode mode) {
 	return fx | sx << 31;
 }
 
-static uint32_t sfu_square(uint32_t x) {
+/*
+ * The squarer sums x >> (18 - i) over all set bits i of x, ie. all products
+ * of bit pairs with weight >= 2^18.  Split x into h (bits 12-16), m (bits 6-11)
+ * and l (bits 0-5): h*h and h*m pairs are never truncated, m*l and l*l pairs
+ * always are, leaving only h*l and m*m to be looked up.
+ */
+static uint32_t sfu_square_hl[32][64];
+static uint32_t sfu_square_mm[64];
+
+__attribute__((constructor)) static void sfu_square_init(void) {
+	uint32_t h, m, l, s;
 	int i;
-	uint32_t res = 0;
-	for (i = 0; i < 17; i++)
-		if (x & 1 << i)
-			res += x >> (18 - i);
+	for (h = 0; h < 32; h++) {
+		for (l = 0; l < 64; l++) {
+			s = 0;
+			for (i = 0; i < 5; i++)
+				if (h & 1 << i)
+					s += l >> (6 - i);
+			/* counted for both orders of the pair */
+			sfu_square_hl[h][l] = s * 2;
+		}
+	}
+	for (m = 0; m < 64; m++) {
+		s = 0;
+		for (i = 1; i < 6; i++)
+			if (m & 1 << i)
+				s += m >> (6 - i);
+		sfu_square_mm[m] = s;
+	}
+}
+
+static uint32_t sfu_square(uint32_t x) {
+	uint32_t h = x >> 12, m = x >> 6 & 0x3f, l = x & 0x3f;
+	uint32_t res = (h * h << 6) + h * m * 2 + sfu_square_hl[h][l] + sfu_square_mm[m];
 	return res >> 1;
 }
 
@@ -249,3 +278,51 @@ uint32_t sfu_lg2(uint32_t x) {
 	fx = res >> 19;
 	return fp32_mkfin(sx, ex, fx, FP_RN, true);
 }
+
+uint32_t sfu_eval(enum sfu_op op, uint32_t x) {
+	switch (op) {
+		case SFU_OP_RCP:
+			return sfu_rcp(x);
+		case SFU_OP_RSQRT:
+			return sfu_rsqrt(x);
+		case SFU_OP_SIN:
+			return sfu_sincos(x, false);
+		case SFU_OP_COS:
+			return sfu_sincos(x, true);
+		case SFU_OP_EX2:
+			return sfu_ex2(x);
+		case SFU_OP_LG2:
+			return sfu_lg2(x);
+		case SFU_OP_PRE_SIN:
+			return sfu_pre(x, SFU_PRE_SIN);
+		case SFU_OP_PRE_EX2:
+			return sfu_pre(x, SFU_PRE_EX2);
+		default:
+			abort();
+	}
+}
+
+/* The op switch is hoisted out of the loop, letting each model get inlined
+   into its own loop.  */
+#define SFU_BATCH_LOOP(op, res, num, in) do { \
+	uint32_t i_; \
+	switch (op) { \
+		case SFU_OP_RCP: for (i_ = 0; i_ < (num); i_++) (res)[i_] = sfu_rcp(in); break; \
+		case SFU_OP_RSQRT: for (i_ = 0; i_ < (num); i_++) (res)[i_] = sfu_rsqrt(in); break; \
+		case SFU_OP_SIN: for (i_ = 0; i_ < (num); i_++) (res)[i_] = sfu_sincos(in, false); break; \
+		case SFU_OP_COS: for (i_ = 0; i_ < (num); i_++) (res)[i_] = sfu_sincos(in, true); break; \
+		case SFU_OP_EX2: for (i_ = 0; i_ < (num); i_++) (res)[i_] = sfu_ex2(in); break; \
+		case SFU_OP_LG2: for (i_ = 0; i_ < (num); i_++) (res)[i_] = sfu_lg2(in); break; \
+		case SFU_OP_PRE_SIN: for (i_ = 0; i_ < (num); i_++) (res)[i_] = sfu_pre(in, SFU_PRE_SIN); break; \
+		case SFU_OP_PRE_EX2: for (i_ = 0; i_ < (num); i_++) (res)[i_] = sfu_pre(in, SFU_PRE_EX2); break; \
+		default: abort(); \
+	} \
+} while (0)
+
+void sfu_eval_batch(enum sfu_op op, uint32_t *res, const uint32_t *x, int num) {
+	SFU_BATCH_LOOP(op, res, (uint32_t)num, x[i_]);
+}
+
+void sfu_eval_range(enum sfu_op op, uint32_t *res, uint32_t start, uint32_t num) {
+	SFU_BATCH_LOOP(op, res, num, start + i_);
+}
@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2016 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "nvhw/sfu.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+/*
+ * Runs the SFU models over all 2^32 inputs and prints a checksum of the
+ * results for every 2^bits-sized range, one line per range:
+ *
+ *	<op> <first input> <checksum>
+ *
+ * Given a previous output with -c, prints only the ranges that changed,
+ * which narrows a model regression down to a range that's cheap to dump.
+ */
+
+static const char *const opnames[SFU_OP_NUM] = {
+	[SFU_OP_RCP] = "rcp",
+	[SFU_OP_RSQRT] = "rsqrt",
+	[SFU_OP_SIN] = "sin",
+	[SFU_OP_COS] = "cos",
+	[SFU_OP_EX2] = "ex2",
+	[SFU_OP_LG2] = "lg2",
+	[SFU_OP_PRE_SIN] = "presin",
+	[SFU_OP_PRE_EX2] = "preex2",
+};
+
+#define CHUNK 0x10000
+
+struct job {
+	enum sfu_op op;
+	uint32_t start;
+	uint64_t sum;
+};
+
+static struct job *jobs;
+static int jobsnum;
+static int job_next;
+static int range_bits = 24;
+static pthread_mutex_t job_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* FNV-1a over the result words */
+static uint64_t checksum(uint64_t sum, const uint32_t *res, int num) {
+	int i;
+	for (i = 0; i < num; i++) {
+		sum ^= res[i];
+		sum *= 0x100000001b3ull;
+	}
+	return sum;
+}
+
+static void *worker(void *arg) {
+	uint32_t *res = malloc(CHUNK * sizeof *res);
+	uint64_t size = 1ull << range_bits;
+	while (1) {
+		pthread_mutex_lock(&job_mutex);
+		int idx = job_next++;
+		pthread_mutex_unlock(&job_mutex);
+		if (idx >= jobsnum)
+			break;
+		struct job *job = &jobs[idx];
+		uint64_t sum = 0xcbf29ce484222325ull;
+		uint64_t pos;
+		for (pos = 0; pos < size; pos += CHUNK) {
+			uint32_t num = size - pos < CHUNK ? size - pos : CHUNK;
+			sfu_eval_range(job->op, res, job->start + pos, num);
+			sum = checksum(sum, res, num);
+		}
+		job->sum = sum;
+	}
+	free(res);
+	return 0;
+}
+
+static int find_op(const char *name) {
+	int i;
+	for (i = 0; i < SFU_OP_NUM; i++)
+		if (!strcmp(name, opnames[i]))
+			return i;
+	return -1;
+}
+
+int main(int argc, char **argv) {
+	int nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	const char *ref = 0;
+	int ops[SFU_OP_NUM];
+	int opsnum = 0;
+	int c, i, j;
+	while ((c = getopt (argc, argv, "j:b:c:")) != -1)
+		switch (c) {
+			case 'j':
+				nthreads = atoi(optarg);
+				break;
+			case 'b':
+				range_bits = atoi(optarg);
+				break;
+			case 'c':
+				ref = optarg;
+				break;
+			default:
+				goto usage;
+		}
+	if (nthreads < 1)
+		nthreads = 1;
+	if (range_bits < 16 || range_bits > 32)
+		goto usage;
+	for (i = optind; i < argc; i++) {
+		if ((ops[opsnum] = find_op(argv[i])) == -1) {
+			fprintf(stderr, "Unknown op %s\n", argv[i]);
+			goto usage;
+		}
+		opsnum++;
+	}
+	if (!opsnum)
+		for (opsnum = 0; opsnum < SFU_OP_NUM; opsnum++)
+			ops[opsnum] = opsnum;
+	uint64_t nranges = 1ull << (32 - range_bits);
+	jobsnum = opsnum * nranges;
+	jobs = calloc(jobsnum, sizeof *jobs);
+	for (i = 0; i < opsnum; i++)
+		for (j = 0; j < nranges; j++) {
+			jobs[i * nranges + j].op = ops[i];
+			jobs[i * nranges + j].start = (uint64_t)j << range_bits;
+		}
+	pthread_t *threads = calloc(nthreads, sizeof *threads);
+	for (i = 0; i < nthreads; i++)
+		pthread_create(&threads[i], 0, worker, 0);
+	for (i = 0; i < nthreads; i++)
+		pthread_join(threads[i], 0);
+	free(threads);
+	if (!ref) {
+		for (i = 0; i < jobsnum; i++)
+			printf("%s %08x %016llx\n", opnames[jobs[i].op], jobs[i].start, (unsigned long long)jobs[i].sum);
+		free(jobs);
+		return 0;
+	}
+	FILE *file = fopen(ref, "r");
+	if (!file) {
+		perror(ref);
+		return 1;
+	}
+	char name[16];
+	unsigned start;
+	unsigned long long sum;
+	int bad = 0, found = 0;
+	while (fscanf(file, "%15s %x %llx", name, &start, &sum) == 3) {
+		int op = find_op(name);
+		for (i = 0; i < jobsnum; i++)
+			if (jobs[i].op == op && jobs[i].start == start)
+				break;
+		if (i == jobsnum)
+			continue;
+		found++;
+		if (jobs[i].sum != sum) {
+			printf("%s %08x: %016llx, expected %016llx\n", name, start, (unsigned long long)jobs[i].sum, sum);
+			bad = 1;
+		}
+	}
+	fclose(file);
+	if (found != jobsnum) {
+		fprintf(stderr, "%d ranges missing from %s - range size mismatch?\n", jobsnum - found, ref);
+		bad = 1;
+	}
+	free(jobs);
+	return bad;
+usage:
+	fprintf(stderr, "Usage: %s [-j threads] [-b range_bits] [-c reference] [op...]\n", argv[0]);
+	fprintf(stderr, "Ops:");
+	for (i = 0; i < SFU_OP_NUM; i++)
+		fprintf(stderr, " %s", opnames[i]);
+	fprintf(stderr, "\n");
+	return 1;
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2016 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "nvhw/chipset.h"
+#include "nvhw/vram.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Checks comp_decompress_tiles and comp_decompress_tiles_mt against
+ * comp_decompress on every compressed format of every compression type,
+ * on random tile data and tags.
+ */
+
+#define NUM 0x1000
+
+static uint32_t seed = 1;
+
+static uint32_t rnd(void) {
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}
+
+int main() {
+	static const int chipsets[] = { 0x20, 0x25, 0x30, 0x35, 0x36, 0x40 };
+	int ci, format, nthreads, i, j, bad = 0;
+	uint8_t *orig = malloc(NUM * 0x80);
+	uint8_t *ref = malloc(NUM * 0x80);
+	uint8_t *res = malloc(NUM * 0x80);
+	uint8_t *tags = malloc(NUM);
+	for (ci = 0; ci < sizeof chipsets / sizeof *chipsets; ci++) {
+		int chipset = chipsets[ci];
+		int tsize = comp_tile_size(chipset);
+		if (comp_type(chipset) == COMP_NONE) {
+			printf("chipset %02x: no compression\n", chipset);
+			bad = 1;
+			continue;
+		}
+		for (format = 0; format < 0x20; format++) {
+			if (comp_format_type(chipset, format) == COMP_FORMAT_OFF)
+				continue;
+			for (i = 0; i < NUM * tsize; i++)
+				orig[i] = rnd();
+			for (i = 0; i < NUM; i++)
+				tags[i] = rnd() & 1;
+			memcpy(ref, orig, NUM * tsize);
+			for (i = 0; i < NUM; i++)
+				comp_decompress(chipset, format, ref + i * tsize, tags[i]);
+			for (nthreads = 1; nthreads <= 3; nthreads += 2) {
+				memcpy(res, orig, NUM * tsize);
+				if (nthreads == 1)
+					comp_decompress_tiles(chipset, format, res, tags, NUM);
+				else
+					comp_decompress_tiles_mt(chipset, format, res, tags, NUM, nthreads);
+				for (i = 0; i < NUM; i++) {
+					if (memcmp(res + i * tsize, ref + i * tsize, tsize)) {
+						printf("chipset %02x format %02x tile %d tag %d threads %d:\n", chipset, format, i, tags[i], nthreads);
+						for (j = 0; j < tsize; j++)
+							printf("%02x%02x%c", res[i * tsize + j], ref[i * tsize + j], (j & 0xf) == 0xf ? '\n' : ' ');
+						bad = 1;
+						break;
+					}
+				}
+			}
+		}
+	}
+	free(orig);
+	free(ref);
+	free(res);
+	free(tags);
+	if (!bad)
+		fprintf(stderr, "All ok!\n");
+	return bad;
+}
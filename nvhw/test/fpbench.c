@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2016 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "nvhw/fp.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+ * Times the batch fp functions at each SIMD level on random normal inputs,
+ * the common case for hwtest runs.
+ */
+
+#define NUM 0x100000
+#define REPS 16
+
+static uint32_t a32[NUM], b32[NUM], c32[NUM], r32[NUM];
+static uint16_t r16[NUM];
+static uint64_t a64[NUM], b64[NUM], c64[NUM], r64[NUM];
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void report(const char *op, int simd, double t) {
+	printf("%-14s simd %d: %7.2f ns/op\n", op, simd, t * 1e9 / NUM / REPS);
+}
+
+int main() {
+	int simd, rep, i;
+	double t;
+	srand(1);
+	for (i = 0; i < NUM; i++) {
+		/* normal numbers with exponents in a narrow band */
+		a32[i] = (rand() & 0x807fffff) | (0x3c000000 + (rand() % 16 << 23));
+		b32[i] = (rand() & 0x807fffff) | (0x3c000000 + (rand() % 16 << 23));
+		c32[i] = (rand() & 0x807fffff) | (0x3c000000 + (rand() % 16 << 23));
+		a64[i] = fp32_to_fp64(a32[i]) ^ rand();
+		b64[i] = fp32_to_fp64(b32[i]) ^ rand();
+		c64[i] = fp32_to_fp64(c32[i]) ^ rand();
+	}
+	for (simd = FP_SIMD_NONE; simd <= FP_SIMD_AVX2; simd++) {
+		if (fp_batch_set_simd(simd) != simd)
+			break;
+		t = now();
+		for (rep = 0; rep < REPS; rep++)
+			fp32_add_batch(r32, a32, b32, NUM, FP_RN);
+		report("fp32_add", simd, now() - t);
+		t = now();
+		for (rep = 0; rep < REPS; rep++)
+			fp32_mul_batch(r32, a32, b32, NUM, FP_RZ, false);
+		report("fp32_mul", simd, now() - t);
+		t = now();
+		for (rep = 0; rep < REPS; rep++)
+			fp32_mad_batch(r32, a32, b32, c32, NUM, false);
+		report("fp32_mad", simd, now() - t);
+		t = now();
+		for (rep = 0; rep < REPS; rep++)
+			fp32_to_fp16_batch(r16, a32, NUM, FP_RN, false);
+		report("fp32_to_fp16", simd, now() - t);
+		t = now();
+		for (rep = 0; rep < REPS; rep++)
+			fp64_add_batch(r64, a64, b64, NUM, FP_RN);
+		report("fp64_add", simd, now() - t);
+		t = now();
+		for (rep = 0; rep < REPS; rep++)
+			fp64_mul_batch(r64, a64, b64, NUM, FP_RP);
+		report("fp64_mul", simd, now() - t);
+		t = now();
+		for (rep = 0; rep < REPS; rep++)
+			fp64_fma_batch(r64, a64, b64, c64, NUM, FP_RN);
+		report("fp64_fma", simd, now() - t);
+	}
+	return 0;
+}
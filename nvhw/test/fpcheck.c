@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2016 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "nvhw/fp.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Cross-checks the batch fp functions against the scalar models, for every
+ * rounding mode and every SIMD level the host has.
+ */
+
+#define NUM 0x10000
+
+static uint64_t rng_state = 0x123456789abcdefull;
+
+static uint64_t rnd(void) {
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return rng_state;
+}
+
+/* random fp32 biased towards interesting values */
+static uint32_t rnd32(uint32_t other) {
+	static const uint32_t special[] = {
+		0x00000000, 0x80000000, 0x00000001, 0x007fffff, 0x00800000, 0x00800001,
+		0x01000000, 0x3f800000, 0xbf800000, 0x7f7fffff, 0xff7fffff, 0x7f800000,
+		0xff800000, 0x7fc00000, 0x7f800001, 0xffffffff, 0x2f000000, 0x33000000,
+		0x387fe000, 0x38800000, 0x477fe000, 0x477ff000, 0x477fffff, 0x47800000,
+	};
+	uint32_t r = rnd();
+	switch (rnd() % 8) {
+		case 0:
+			return special[rnd() % (sizeof special / sizeof *special)];
+		case 1:
+		case 2:
+			/* close to the other operand, for cancellation */
+			return (other & 0x7f800000) + (r & 0x807fffff) + ((r >> 8 & 0x3) - 1) * 0x800000;
+		case 3:
+			/* tiny or huge */
+			return (r & 0x80ffffff) | (r >> 8 & 1 ? 0x7e000000 : 0);
+		default:
+			return r;
+	}
+}
+
+static uint64_t rnd64(uint64_t other) {
+	static const uint64_t special[] = {
+		0x0000000000000000ull, 0x8000000000000000ull, 0x0000000000000001ull,
+		0x000fffffffffffffull, 0x0010000000000000ull, 0x0020000000000000ull,
+		0x3ff0000000000000ull, 0xbff0000000000000ull, 0x7fefffffffffffffull,
+		0x7ff0000000000000ull, 0xfff0000000000000ull, 0x7ff8000000000000ull,
+		0x7ff0000000000001ull, 0xffffffffffffffffull,
+	};
+	uint64_t r = rnd();
+	switch (rnd() % 8) {
+		case 0:
+			return special[rnd() % (sizeof special / sizeof *special)];
+		case 1:
+		case 2:
+			return (other & 0x7ff0000000000000ull) + (r & 0x800fffffffffffffull) + ((r >> 8 & 0x3) - 1) * 0x0010000000000000ull;
+		case 3:
+			return (r & 0x801fffffffffffffull) | (r >> 8 & 1 ? 0x7fc0000000000000ull : 0);
+		default:
+			return r;
+	}
+}
+
+static uint32_t a32[NUM], b32[NUM], c32[NUM], r32[NUM];
+static uint16_t r16[NUM];
+static uint64_t a64[NUM], b64[NUM], c64[NUM], r64[NUM];
+
+static int fail(const char *op, int simd, int rm, int i) {
+	fprintf(stderr, "%s mismatch: simd %d rm %d element %d\n", op, simd, rm, i);
+	return 1;
+}
+
+static int check(int simd, int rm, int num) {
+	int i;
+	fp32_add_batch(r32, a32, b32, num, rm);
+	for (i = 0; i < num; i++)
+		if (r32[i] != fp32_add(a32[i], b32[i], rm))
+			return fail("fp32_add", simd, rm, i);
+	fp32_mul_batch(r32, a32, b32, num, rm, rm & 1);
+	for (i = 0; i < num; i++)
+		if (r32[i] != fp32_mul(a32[i], b32[i], rm, rm & 1))
+			return fail("fp32_mul", simd, rm, i);
+	fp32_mad_batch(r32, a32, b32, c32, num, rm & 1);
+	for (i = 0; i < num; i++)
+		if (r32[i] != fp32_mad(a32[i], b32[i], c32[i], rm & 1))
+			return fail("fp32_mad", simd, rm, i);
+	fp32_to_fp16_batch(r16, a32, num, rm, false);
+	for (i = 0; i < num; i++)
+		if (r16[i] != fp32_to_fp16(a32[i], rm, false))
+			return fail("fp32_to_fp16", simd, rm, i);
+	fp32_to_fp16_batch(r16, a32, num, rm, true);
+	for (i = 0; i < num; i++)
+		if (r16[i] != fp32_to_fp16(a32[i], rm, true))
+			return fail("fp32_to_fp16 rint", simd, rm, i);
+	fp64_add_batch(r64, a64, b64, num, rm);
+	for (i = 0; i < num; i++)
+		if (r64[i] != fp64_add(a64[i], b64[i], rm))
+			return fail("fp64_add", simd, rm, i);
+	fp64_mul_batch(r64, a64, b64, num, rm);
+	for (i = 0; i < num; i++)
+		if (r64[i] != fp64_mul(a64[i], b64[i], rm))
+			return fail("fp64_mul", simd, rm, i);
+	fp64_fma_batch(r64, a64, b64, c64, num, rm);
+	for (i = 0; i < num; i++)
+		if (r64[i] != fp64_fma(a64[i], b64[i], c64[i], rm))
+			return fail("fp64_fma", simd, rm, i);
+	return 0;
+}
+
+int main() {
+	int simd, rm, iter, i;
+	for (iter = 0; iter < 4; iter++) {
+		for (i = 0; i < NUM; i++) {
+			a32[i] = rnd32(rnd());
+			b32[i] = rnd32(a32[i]);
+			/* make some products land next to the addend */
+			c32[i] = rnd32(fp32_mul(a32[i], b32[i], FP_RN, false));
+			a64[i] = rnd64(rnd());
+			b64[i] = rnd64(a64[i]);
+			c64[i] = rnd64(fp64_mul(a64[i], b64[i], FP_RN));
+		}
+		/* the fp32 to fp16 conversion gets every sign, exponent and
+		   top 7 fraction bits, with random low bits */
+		if (iter == 0)
+			for (i = 0; i < NUM; i++)
+				a32[i] = i << 16 | (rnd() & 0xffff);
+		for (simd = FP_SIMD_NONE; simd <= FP_SIMD_AVX2; simd++) {
+			if (fp_batch_set_simd(simd) != simd)
+				break;
+			for (rm = FP_RN; rm <= FP_RT; rm++)
+				/* odd length to exercise the scalar tail */
+				if (check(simd, rm, NUM - 3))
+					return 1;
+		}
+	}
+	fprintf(stderr, "All ok!\n");
+	return 0;
+}
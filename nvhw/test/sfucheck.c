@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2016 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "nvhw/sfu.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Checks the batch SFU functions against the scalar models, and the models
+ * themselves against checksums taken from the original bit-serial squarer.
+ */
+
+#define NUM 0x40000
+
+/* FNV-1a of the results for inputs i * 0x9e3779b1, i < NUM */
+static const uint64_t expected[SFU_OP_NUM] = {
+	[SFU_OP_RCP] = 0x13d61368e96ebc9dull,
+	[SFU_OP_RSQRT] = 0x08d9303332cd6892ull,
+	[SFU_OP_SIN] = 0x8d5ef609fcf3a657ull,
+	[SFU_OP_COS] = 0x60875f4f0ca3326aull,
+	[SFU_OP_EX2] = 0xdf3101893eafa573ull,
+	[SFU_OP_LG2] = 0xb40eb7ad7b0aa391ull,
+	[SFU_OP_PRE_SIN] = 0xaaea21ed679360dcull,
+	[SFU_OP_PRE_EX2] = 0x241a56784791ca2aull,
+};
+
+int main() {
+	uint32_t *x = malloc(NUM * sizeof *x);
+	uint32_t *res = malloc(NUM * sizeof *res);
+	int op, i, bad = 0;
+	for (i = 0; i < NUM; i++)
+		x[i] = i * 0x9e3779b1u;
+	for (op = 0; op < SFU_OP_NUM; op++) {
+		uint64_t sum = 0xcbf29ce484222325ull;
+		sfu_eval_batch(op, res, x, NUM);
+		for (i = 0; i < NUM; i++) {
+			if (res[i] != sfu_eval(op, x[i])) {
+				printf("op %d: batch %08x -> %08x, scalar %08x\n", op, x[i], res[i], sfu_eval(op, x[i]));
+				bad = 1;
+				break;
+			}
+			sum ^= res[i];
+			sum *= 0x100000001b3ull;
+		}
+		if (sum != expected[op]) {
+			printf("op %d: checksum %016llx, expected %016llx\n", op, (unsigned long long)sum, (unsigned long long)expected[op]);
+			bad = 1;
+		}
+		/* ranges straddling an exponent change */
+		sfu_eval_range(op, res, 0x3f7fff00, 0x200);
+		for (i = 0; i < 0x200; i++) {
+			if (res[i] != sfu_eval(op, 0x3f7fff00 + i)) {
+				printf("op %d: range %08x -> %08x, scalar %08x\n", op, 0x3f7fff00 + i, res[i], sfu_eval(op, 0x3f7fff00 + i));
+				bad = 1;
+				break;
+			}
+		}
+	}
+	free(x);
+	free(res);
+	if (!bad)
+		fprintf(stderr, "All ok!\n");
+	return bad;
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2016 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "nvhw/chipset.h"
+#include "nvhw/vram.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Times untiling a 2048x1536x32bpp surface per dword with
+ * tile_translate_addr versus with a tile_map, on each memory controller
+ * type.
+ */
+
+#define PITCH 0x2000
+#define SIZE (PITCH * 1536)
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main() {
+	static const int chipsets[] = { 0x10, 0x25, 0x35, 0x40, 0x47, 0x44 };
+	uint8_t *tiled = malloc(SIZE);
+	uint8_t *linear = malloc(SIZE);
+	int ci;
+	uint32_t a;
+	memset(tiled, 0x5a, SIZE);
+	for (ci = 0; ci < sizeof chipsets / sizeof *chipsets; ci++) {
+		int chipset = chipsets[ci];
+		struct mc_config mcc;
+		memset(&mcc, 0, sizeof mcc);
+		mcc.mcbits = chipset < 0x40 || pfb_type(chipset) == PFB_NV44 ? 2 : 3;
+		mcc.partbits = pfb_type(chipset) == PFB_NV44 ? 1 : 2;
+		mcc.parts = 1 << mcc.partbits;
+		mcc.colbits = mcc.colbits_lo = 9;
+		mcc.burstbits = 1;
+		mcc.partshift = 8;
+		double t = now();
+		for (a = 0; a < SIZE; a += 4) {
+			uint32_t phys = tile_translate_addr(chipset, PITCH, a, 1, 0, &mcc, 0, 0);
+			memcpy(linear + a, tiled + phys, 4);
+		}
+		double tslow = now() - t;
+		t = now();
+		struct tile_map *map = tile_map_new(chipset, PITCH, SIZE, 1, 0, &mcc);
+		double tnew = now() - t;
+		t = now();
+		tile_untile(map, linear, tiled);
+		double tfast = now() - t;
+		tile_map_del(map);
+		printf("chipset %02x: per-dword %7.2f ms, map %7.2f ms + untile %7.2f ms\n", chipset, tslow * 1e3, tnew * 1e3, tfast * 1e3);
+	}
+	free(tiled);
+	free(linear);
+	return 0;
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2016 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "nvhw/chipset.h"
+#include "nvhw/vram.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Checks tile_untile and tile_tile against tile_translate_addr at every
+ * dword of surfaces spanning more than one template period, for every valid
+ * pitch of a range of memory configurations, every bank offset and every
+ * tile mode tile_map_new handles: 0 (bank rows of 0x1000 bytes), and 1 and 4
+ * (bank rows sized by the memory config).
+ */
+
+static const int modes[] = { 0, 1, 4 };
+
+struct cfg {
+	int chipset;
+	int mcbits;
+	int partbits;
+	int colbits_lo;
+	int burstbits;
+	int partshift;
+};
+
+static const struct cfg cfgs[] = {
+	{ 0x10, 2, 0, 8, 0, 0 },
+	{ 0x11, 2, 1, 9, 1, 0 },
+	{ 0x17, 2, 2, 8, 1, 0 },
+	{ 0x20, 2, 1, 8, 0, 0 },
+	{ 0x25, 3, 2, 8, 0, 0 },
+	{ 0x30, 2, 0, 9, 0, 0 },
+	{ 0x35, 3, 1, 8, 0, 0 },
+	{ 0x40, 3, 2, 8, 1, 8 },
+	{ 0x41, 3, 1, 8, 1, 8 },
+	{ 0x43, 3, 1, 8, 2, 8 },
+	{ 0x47, 3, 2, 8, 2, 7 },
+	{ 0x49, 3, 1, 8, 1, 7 },
+	{ 0x44, 2, 1, 8, 1, 0 },
+	{ 0x4a, 2, 0, 9, 2, 0 },
+	{ 0x4e, 2, 0, 8, 1, 0 },
+};
+
+/* keeps the largest pitches from taking forever */
+#define MAX_SIZE 0x40000
+
+int main() {
+	uint32_t *tiled = malloc(MAX_SIZE);
+	uint32_t *linear = malloc(MAX_SIZE);
+	uint32_t *phys = malloc(MAX_SIZE);
+	int ci, mi, shape, bankoff, bad = 0;
+	uint32_t pitch, a;
+	for (ci = 0; ci < sizeof cfgs / sizeof *cfgs && !bad; ci++) {
+		const struct cfg *cfg = &cfgs[ci];
+		struct mc_config mcc;
+		memset(&mcc, 0, sizeof mcc);
+		mcc.mcbits = cfg->mcbits;
+		mcc.partbits = cfg->partbits;
+		mcc.parts = 1 << cfg->partbits;
+		mcc.colbits = mcc.colbits_lo = cfg->colbits_lo;
+		mcc.burstbits = cfg->burstbits;
+		mcc.partshift = cfg->partshift;
+		for (pitch = 0x100; pitch <= 0x10000 && !bad; pitch += 0x100) {
+			if (!tile_pitch_valid(cfg->chipset, pitch, 0, 0))
+				continue;
+			for (mi = 0; mi < sizeof modes / sizeof *modes; mi++)
+			for (shape = 0; shape < 2; shape++)
+			for (bankoff = 0; bankoff < 1 << tile_bankoff_bits(cfg->chipset) && !bad; bankoff++) {
+				int mode = modes[mi];
+				int bankshift = mode ? cfg->mcbits + cfg->partbits + cfg->colbits_lo : 12;
+				if (is_igp(cfg->chipset))
+					bankshift = 12;
+				uint64_t period = (uint64_t)pitch << (bankshift - 5);
+				uint64_t size;
+				if (!shape) {
+					/* two template periods and a bit, ending mid-chunk */
+					size = period * 2 + pitch * 3 + 0x34;
+					if (size > MAX_SIZE)
+						size = MAX_SIZE - 0xc;
+				} else {
+					/* whole lines, but not a whole number of periods */
+					size = period + pitch * 5;
+					if (size > MAX_SIZE)
+						size = MAX_SIZE / pitch * pitch;
+				}
+				struct tile_map *map = tile_map_new(cfg->chipset, pitch, size, mode, bankoff, &mcc);
+				if (!map) {
+					printf("chipset %02x pitch %05x: no map\n", cfg->chipset, pitch);
+					bad = 1;
+					break;
+				}
+				for (a = 0; a < size; a += 4) {
+					phys[a / 4] = tile_translate_addr(cfg->chipset, pitch, a, mode, bankoff, &mcc, 0, 0);
+					tiled[a / 4] = a;
+				}
+				memset(linear, 0xff, size);
+				tile_untile(map, (uint8_t *)linear, (const uint8_t *)tiled);
+				for (a = 0; a < size; a += 4) {
+					uint32_t exp = phys[a / 4] < size ? phys[a / 4] : 0xffffffff;
+					if (linear[a / 4] != exp) {
+						printf("chipset %02x pitch %05x mode %d bankoff %d: untile %08x -> %08x, expected %08x\n", cfg->chipset, pitch, mode, bankoff, a, linear[a / 4], exp);
+						bad = 1;
+						break;
+					}
+				}
+				for (a = 0; a < size; a += 4)
+					linear[a / 4] = a;
+				memset(tiled, 0xff, size);
+				tile_tile(map, (uint8_t *)tiled, (const uint8_t *)linear);
+				for (a = 0; a < size && !bad; a += 4) {
+					if (phys[a / 4] < size && tiled[phys[a / 4] / 4] != a) {
+						printf("chipset %02x pitch %05x mode %d bankoff %d: tile %08x -> %08x, found %08x\n", cfg->chipset, pitch, mode, bankoff, a, phys[a / 4], tiled[phys[a / 4] / 4]);
+						bad = 1;
+					}
+				}
+				tile_map_del(map);
+			}
+		}
+	}
+	free(tiled);
+	free(linear);
+	free(phys);
+	if (!bad)
+		fprintf(stderr, "All ok!\n");
+	return bad;
+}
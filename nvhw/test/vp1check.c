@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2016 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "nvhw/vp1.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Checks the predecoding microcode runner against vp1_simulate_bundle on
+ * random straight-line code, and a counted loop against its known result.
+ */
+
+#define GROUPS 0x40
+#define TRIES 1000
+
+static uint32_t seed = 1;
+
+static uint32_t rnd(void) {
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8 ^ seed << 16;
+}
+
+static uint32_t gen_op(int kind) {
+	uint32_t op = rnd();
+	switch (kind) {
+		case VP1_KIND_A:
+			op = 0xc0000000 | (op & 0x1fffffff);
+			/* DMA opcodes need the outside world */
+			switch (op >> 24 & 0x1f) {
+				case 0x03:
+				case 0x07:
+				case 0x0e:
+				case 0x0f:
+				case 0x1b:
+					op = 0xdf000000;
+			}
+			return op;
+		case VP1_KIND_S:
+			op &= 0x7fffffff;
+			/* special registers */
+			if ((op >> 24 == 0x6a || op >> 24 == 0x6b)) {
+				int rfile = op >> 3 & 0x1f;
+				if (rfile == 8 || rfile == 9 || rfile == 0xa || rfile == 0x16 || rfile == 0x17)
+					op = 0x4f000000;
+			}
+			return op;
+		case VP1_KIND_V:
+			return 0x80000000 | (op & 0x3fffffff);
+		default:
+			/* no control flow: bnop or mov to $l */
+			return op & 1 ? 0xef000000 : 0xf0000000 | (op & 0x1fffff);
+	}
+}
+
+static void gen_ctx(struct vp1_ctx *ctx) {
+	uint8_t *p = (uint8_t *)ctx;
+	int i;
+	for (i = 0; i < sizeof *ctx; i++)
+		p[i] = rnd();
+	for (i = 0; i < 4; i++)
+		ctx->c[i] = (ctx->c[i] & 0x27ff) | 0x8000;
+}
+
+static const uint32_t nops[4] = { 0xdfffffff, 0x4fffffff, 0xbfffffff, 0xefffffff };
+
+/* reference: split into bundles by hand, up to the final exit */
+static void ref_run(struct vp1_ctx *ctx, const uint32_t *code, uint32_t num) {
+	uint32_t pc = 0;
+	while (pc < num) {
+		uint32_t opcode[4];
+		int last = -1;
+		memcpy(opcode, nops, sizeof opcode);
+		do {
+			int kind = vp1_kind(code[pc]);
+			if (kind <= last)
+				break;
+			opcode[kind] = code[pc++];
+			last = kind;
+		} while (pc & 3);
+		vp1_simulate_bundle(ctx, opcode, 0x84);
+	}
+}
+
+int main() {
+	static uint32_t code[GROUPS * 4 + 1];
+	struct vp1_ctx octx, ectx;
+	int try, i, bad = 0;
+	for (try = 0; try < TRIES && !bad; try++) {
+		for (i = 0; i < GROUPS * 4; i++)
+			code[i] = gen_op(rnd() & 3);
+		code[GROUPS * 4] = 0xff000000;
+		gen_ctx(&octx);
+		ectx = octx;
+		ref_run(&ectx, code, GROUPS * 4 + 1);
+		struct vp1_sim *sim = vp1_sim_new(0x84, code, GROUPS * 4 + 1);
+		/* twice, the second time from the decoded bundles */
+		for (i = 0; i < 2 && !bad; i++) {
+			sim->ctx = octx;
+			sim->pc = 0;
+			int res = vp1_sim_run(sim, 1000);
+			if (res != VP1_SIM_EXIT || sim->pc != GROUPS * 4 + 1) {
+				printf("try %d run %d: result %d pc %x\n", try, i, res, sim->pc);
+				bad = 1;
+			} else if (memcmp(&sim->ctx, &ectx, sizeof ectx)) {
+				printf("try %d run %d: state mismatch\n", try, i);
+				bad = 1;
+			}
+		}
+		vp1_sim_del(sim);
+	}
+	/* mov $l0 $c0 3; loop: add $r1 $r1 1 + bra loop $l0 $c0 $l0 not lzf loop; delay snop; exit */
+	static const uint32_t loop[] = {
+		0xf0000003, 0xefffffff, 0xefffffff, 0xefffffff,
+		0x6c08400f, 0xe30001a0, 0x4f000000, 0x4f000000,
+		0xff000000,
+	};
+	struct vp1_sim *sim = vp1_sim_new(0x84, loop, sizeof loop / sizeof *loop);
+	sim->ctx.r[1] = 10;
+	if (vp1_sim_run(sim, 100) != VP1_SIM_EXIT || sim->ctx.r[1] != 14) {
+		printf("loop: r1 %d after %d bundles\n", sim->ctx.r[1], (int)sim->bundles);
+		bad = 1;
+	}
+	vp1_sim_del(sim);
+	if (!bad)
+		fprintf(stderr, "All ok!\n");
+	return bad;
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2016 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "nvhw/chipset.h"
+#include "nvhw/vram.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Whole-surface version of tile_translate_addr.  Within a tiled surface,
+ * the translation only depends on the position inside a 16-byte chunk, the
+ * low bits of the tile column and row, and the bank row modulo 8 (bank and
+ * partition swizzles never look further than that).  So the mapping of the
+ * first 8 bank rows, 8 << (bankshift - 8) lines, is a template that repeats
+ * over the rest of the surface with the same offset on both sides.  The
+ * template is kept as runs of chunks contiguous on both sides, which comes
+ * out as whole 256-byte rows on NV10 and NV44 and single chunks elsewhere.
+ */
+
+struct tile_run {
+	uint32_t lin;
+	uint32_t phys;
+	uint32_t len;
+};
+
+struct tile_map {
+	uint32_t size;
+	uint32_t period;
+	int nruns;
+	struct tile_run *runs;
+};
+
+struct tile_map *tile_map_new(int chipset, uint32_t pitch, uint32_t size, int mode, int bankoff, const struct mc_config *mcc) {
+	if (!tile_pitch_valid(chipset, pitch, 0, 0))
+		return 0;
+	int bankshift = mcc->mcbits + mcc->partbits + mcc->colbits_lo;
+	if (is_igp(chipset) || (mode != 1 && mode != 4))
+		bankshift = 12;
+	struct tile_map *map = calloc(1, sizeof *map);
+	uint64_t period = (uint64_t)pitch << (bankshift - 5);
+	uint64_t tlen = (size + 0xf) & ~0xfull;
+	if (tlen > period)
+		tlen = period;
+	map->size = size;
+	map->period = tlen;
+	map->runs = malloc((tlen >> 4) * sizeof *map->runs);
+	uint64_t lin;
+	for (lin = 0; lin < tlen; lin += 0x10) {
+		uint32_t phys = tile_translate_addr(chipset, pitch, lin, mode, bankoff, mcc, 0, 0);
+		struct tile_run *prev = map->nruns ? &map->runs[map->nruns - 1] : 0;
+		if (prev && prev->lin + prev->len == lin && prev->phys + prev->len == phys) {
+			prev->len += 0x10;
+		} else {
+			struct tile_run *run = &map->runs[map->nruns++];
+			run->lin = lin;
+			run->phys = phys;
+			run->len = 0x10;
+		}
+	}
+	map->runs = realloc(map->runs, map->nruns * sizeof *map->runs);
+	return map;
+}
+
+void tile_map_del(struct tile_map *map) {
+	if (!map)
+		return;
+	free(map->runs);
+	free(map);
+}
+
+static void tile_map_copy(const struct tile_map *map, uint8_t *linear, uint8_t *tiled, int to_tiled) {
+	uint64_t size = map->size;
+	uint64_t base;
+	int i;
+	for (base = 0; base < size; base += map->period) {
+		for (i = 0; i < map->nruns; i++) {
+			const struct tile_run *run = &map->runs[i];
+			uint64_t lin = base + run->lin;
+			uint64_t phys = base + run->phys;
+			uint64_t len = run->len;
+			if (lin >= size)
+				break;
+			if (phys >= size)
+				continue;
+			if (len > size - lin)
+				len = size - lin;
+			if (len > size - phys)
+				len = size - phys;
+			uint8_t *dst = to_tiled ? tiled + phys : linear + lin;
+			const uint8_t *src = to_tiled ? linear + lin : tiled + phys;
+			/* fixed-size copy of the common case compiles to a single
+			   unaligned vector move */
+			if (len == 0x10)
+				memcpy(dst, src, 0x10);
+			else
+				memcpy(dst, src, len);
+		}
+	}
+}
+
+void tile_untile(const struct tile_map *map, uint8_t *linear, const uint8_t *tiled) {
+	tile_map_copy(map, linear, (uint8_t *)tiled, 0);
+}
+
+void tile_tile(const struct tile_map *map, uint8_t *tiled, const uint8_t *linear) {
+	tile_map_copy(map, (uint8_t *)linear, tiled, 1);
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2016 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "nvhw/vp1.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+/*
+ * Runs VP1 microcode on the simulator.  The code file is raw little-endian
+ * instruction words.  With -d, the data file is split into data store
+ * images (sizeof ctx.ds bytes each, in vp1_ctx layout) and the microcode is
+ * run once per image, starting at -p each time with the rest of the state
+ * carried over - the way a kernel is run once per macroblock of a frame.
+ * The resulting data store images go to the -o file.
+ */
+
+static uint32_t *read_code(const char *name, uint32_t *pnum) {
+	FILE *f = fopen(name, "rb");
+	if (!f) {
+		perror(name);
+		exit(1);
+	}
+	uint32_t *code = 0;
+	int num = 0, max = 0;
+	uint8_t b[4];
+	while (fread(b, 4, 1, f) == 1) {
+		if (num == max) {
+			max = max ? max * 2 : 0x100;
+			code = realloc(code, max * sizeof *code);
+		}
+		code[num++] = b[0] | b[1] << 8 | b[2] << 16 | (uint32_t)b[3] << 24;
+	}
+	fclose(f);
+	*pnum = num;
+	return code;
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv) {
+	int chipset = 0x84;
+	uint32_t start = 0;
+	uint64_t max_bundles = 1000000000;
+	const char *dsin = 0, *dsout = 0;
+	int dump = 0;
+	int c, i;
+	while ((c = getopt (argc, argv, "c:p:n:d:o:r")) != -1)
+		switch (c) {
+			case 'c':
+				chipset = strtoul(optarg, 0, 16);
+				break;
+			case 'p':
+				start = strtoul(optarg, 0, 0);
+				break;
+			case 'n':
+				max_bundles = strtoull(optarg, 0, 0);
+				break;
+			case 'd':
+				dsin = optarg;
+				break;
+			case 'o':
+				dsout = optarg;
+				break;
+			case 'r':
+				dump = 1;
+				break;
+			default:
+				fprintf(stderr, "Usage: %s [-c chipset] [-p pc] [-n max_bundles] [-d dsin] [-o dsout] [-r] code\n", argv[0]);
+				return 1;
+		}
+	if (optind + 1 != argc) {
+		fprintf(stderr, "No code file given.\n");
+		return 1;
+	}
+	uint32_t ncode;
+	uint32_t *code = read_code(argv[optind], &ncode);
+	struct vp1_sim *sim = vp1_sim_new(chipset, code, ncode);
+	FILE *fin = 0, *fout = 0;
+	if (dsin && !(fin = fopen(dsin, "rb"))) {
+		perror(dsin);
+		return 1;
+	}
+	if (dsout && !(fout = fopen(dsout, "wb"))) {
+		perror(dsout);
+		return 1;
+	}
+	int runs = 0, res = 0;
+	double t = now();
+	do {
+		if (fin && fread(sim->ctx.ds, sizeof sim->ctx.ds, 1, fin) != 1)
+			break;
+		sim->pc = start;
+		sim->branch_pending = 0;
+		res = vp1_sim_run(sim, max_bundles);
+		runs++;
+		if (res == VP1_SIM_FAULT) {
+			fprintf(stderr, "Run %d: pc 0x%x out of code\n", runs - 1, sim->pc);
+			break;
+		}
+		if (res == VP1_SIM_LIMIT)
+			fprintf(stderr, "Run %d: bundle limit reached at pc 0x%x\n", runs - 1, sim->pc);
+		if (fout)
+			fwrite(sim->ctx.ds, sizeof sim->ctx.ds, 1, fout);
+	} while (fin);
+	t = now() - t;
+	fprintf(stderr, "%d runs, %llu bundles, %.3fs\n", runs, (unsigned long long)sim->bundles, t);
+	if (dump) {
+		for (i = 0; i < 31; i++)
+			printf("$r%d = 0x%08x\n", i, sim->ctx.r[i]);
+		for (i = 0; i < 32; i++)
+			printf("$a%d = 0x%08x\n", i, sim->ctx.a[i]);
+		for (i = 0; i < 4; i++)
+			printf("$c%d = 0x%04x\n", i, sim->ctx.c[i]);
+		for (i = 0; i < 4; i++)
+			printf("$l%d = 0x%04x\n", i, sim->ctx.b[i]);
+	}
+	if (fin)
+		fclose(fin);
+	if (fout)
+		fclose(fout);
+	vp1_sim_del(sim);
+	free(code);
+	return res == VP1_SIM_FAULT;
+}
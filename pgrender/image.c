@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2016 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "pgrender.h"
+#include "util.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* converts surface buf to packed 8-bit RGB */
+static uint8_t *pgrender_rgb(struct pgrender *ctx, int buf, int w, int h) {
+	int fmt = extr(ctx->state.surf_format, 4 * buf, 2);
+	uint8_t *res = malloc(w * h * 3);
+	int x, y;
+	for (y = 0; y < h; y++)
+		for (x = 0; x < w; x++) {
+			uint32_t pixel = pgrender_rd_pixel(ctx, buf, x, y);
+			uint8_t *p = res + (y * w + x) * 3;
+			if (fmt == 1) {
+				p[0] = p[1] = p[2] = pixel;
+			} else if (fmt == 3) {
+				p[0] = extr(pixel, 16, 8);
+				p[1] = extr(pixel, 8, 8);
+				p[2] = extr(pixel, 0, 8);
+			} else {
+				p[0] = extr(pixel, 10, 5) << 3 | extr(pixel, 12, 3);
+				p[1] = extr(pixel, 5, 5) << 3 | extr(pixel, 7, 3);
+				p[2] = extr(pixel, 0, 5) << 3 | extr(pixel, 2, 3);
+			}
+		}
+	return res;
+}
+
+int pgrender_write_ppm(struct pgrender *ctx, FILE *out, int buf, int w, int h) {
+	uint8_t *rgb = pgrender_rgb(ctx, buf, w, h);
+	fprintf(out, "P6\n%d %d\n255\n", w, h);
+	fwrite(rgb, 3, w * h, out);
+	free(rgb);
+	return ferror(out) ? -1 : 0;
+}
+
+static uint32_t crc_tab[256];
+
+static uint32_t pgrender_crc32(uint32_t crc, const uint8_t *data, size_t len) {
+	if (!crc_tab[1]) {
+		uint32_t i, j;
+		for (i = 0; i < 256; i++) {
+			uint32_t c = i;
+			for (j = 0; j < 8; j++)
+				c = c & 1 ? 0xedb88320 ^ c >> 1 : c >> 1;
+			crc_tab[i] = c;
+		}
+	}
+	crc = ~crc;
+	while (len--)
+		crc = crc_tab[(crc ^ *data++) & 0xff] ^ crc >> 8;
+	return ~crc;
+}
+
+static void put_be32(uint8_t *p, uint32_t val) {
+	p[0] = val >> 24;
+	p[1] = val >> 16;
+	p[2] = val >> 8;
+	p[3] = val;
+}
+
+static void pgrender_png_chunk(FILE *out, const char *type, const uint8_t *data, size_t len) {
+	uint8_t hdr[8];
+	put_be32(hdr, len);
+	memcpy(hdr + 4, type, 4);
+	fwrite(hdr, 8, 1, out);
+	fwrite(data, 1, len, out);
+	uint32_t crc = pgrender_crc32(pgrender_crc32(0, hdr + 4, 4), data, len);
+	put_be32(hdr, crc);
+	fwrite(hdr, 4, 1, out);
+}
+
+/*
+ * The image data is wrapped in stored (uncompressed) deflate blocks, so we
+ * don't need zlib.  Frames are meant to be diffed, not archived.
+ */
+int pgrender_write_png(struct pgrender *ctx, FILE *out, int buf, int w, int h) {
+	uint8_t *rgb = pgrender_rgb(ctx, buf, w, h);
+	size_t rawlen = (size_t)h * (w * 3 + 1);
+	uint8_t *raw = malloc(rawlen);
+	int y;
+	for (y = 0; y < h; y++) {
+		raw[y * (w * 3 + 1)] = 0;
+		memcpy(raw + y * (w * 3 + 1) + 1, rgb + y * w * 3, w * 3);
+	}
+	free(rgb);
+	size_t nblk = rawlen / 0xffff + 1;
+	uint8_t *z = malloc(rawlen + nblk * 5 + 6);
+	size_t zlen = 0, pos = 0;
+	z[zlen++] = 0x78;
+	z[zlen++] = 0x01;
+	do {
+		size_t n = min(rawlen - pos, (size_t)0xffff);
+		z[zlen++] = pos + n == rawlen;
+		z[zlen++] = n;
+		z[zlen++] = n >> 8;
+		z[zlen++] = ~n;
+		z[zlen++] = ~n >> 8;
+		memcpy(z + zlen, raw + pos, n);
+		zlen += n;
+		pos += n;
+	} while (pos < rawlen);
+	uint32_t a = 1, b = 0;
+	for (pos = 0; pos < rawlen; pos++) {
+		a = (a + raw[pos]) % 65521;
+		b = (b + a) % 65521;
+	}
+	put_be32(z + zlen, b << 16 | a);
+	zlen += 4;
+	free(raw);
+	static const uint8_t sig[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	uint8_t ihdr[13];
+	put_be32(ihdr, w);
+	put_be32(ihdr + 4, h);
+	ihdr[8] = 8;	/* bit depth */
+	ihdr[9] = 2;	/* RGB */
+	ihdr[10] = ihdr[11] = ihdr[12] = 0;
+	fwrite(sig, 8, 1, out);
+	pgrender_png_chunk(out, "IHDR", ihdr, 13);
+	pgrender_png_chunk(out, "IDAT", z, zlen);
+	pgrender_png_chunk(out, "IEND", 0, 0);
+	free(z);
+	return ferror(out) ? -1 : 0;
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2016 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "pgrender.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Renders an NV03 2D method stream to image files.  The input is text, one
+ * command per line.  Class, method, data and ctx_switch are in hex, the
+ * frame buffer index, width and height in decimal:
+ *
+ *   bind <class> <ctx_switch>	- sets the object context used for a class
+ *   <class> <mthd> <data>	- submits a method
+ *   frame <file> <buf> <w> <h>	- writes surface buf to a .png or .ppm file
+ *
+ * Lines starting with # are ignored.
+ */
+
+static int write_frame(struct pgrender *ctx, const char *name, int buf, int w, int h) {
+	FILE *out = fopen(name, "wb");
+	if (!out) {
+		perror(name);
+		return -1;
+	}
+	size_t len = strlen(name);
+	int res;
+	if (len > 4 && !strcmp(name + len - 4, ".ppm"))
+		res = pgrender_write_ppm(ctx, out, buf, w, h);
+	else
+		res = pgrender_write_png(ctx, out, buf, w, h);
+	fclose(out);
+	return res;
+}
+
+int main(int argc, char **argv) {
+	uint32_t pmc_id = 0x00030100;
+	uint32_t vram_size = 4 << 20;
+	int slow = 0;
+	int c;
+	while ((c = getopt(argc, argv, "c:m:s")) != -1)
+		switch (c) {
+			case 'c':
+				pmc_id = strtoul(optarg, 0, 16);
+				break;
+			case 'm':
+				vram_size = strtoul(optarg, 0, 0) << 20;
+				break;
+			case 's':
+				slow = 1;
+				break;
+			default:
+				fprintf(stderr, "Usage: %s [-c pmc_id] [-m vram_mb] [-s] [input]\n", argv[0]);
+				return 2;
+		}
+	FILE *in = stdin;
+	if (optind < argc) {
+		if (!(in = fopen(argv[optind], "r"))) {
+			perror(argv[optind]);
+			return 2;
+		}
+	}
+	struct pgrender *ctx = pgrender_new(pmc_id, vram_size);
+	if (!ctx) {
+		fprintf(stderr, "PMC_ID %08x is not an NV03 card\n", pmc_id);
+		return 2;
+	}
+	ctx->slow = slow;
+	char line[1024], name[1024];
+	int lnum = 0, res = 0;
+	while (fgets(line, sizeof line, in)) {
+		uint32_t cls, mthd, val;
+		int buf, w, h;
+		lnum++;
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+		if (sscanf(line, "bind %x %x", &cls, &val) == 2) {
+			pgrender_bind(ctx, cls, val);
+		} else if (sscanf(line, "frame %1023s %d %d %d", name, &buf, &w, &h) == 4) {
+			if (write_frame(ctx, name, buf & 3, w, h))
+				res = 1;
+		} else if (sscanf(line, "%x %x %x", &cls, &mthd, &val) == 3) {
+			if (pgrender_mthd(ctx, cls, mthd, val)) {
+				fprintf(stderr, "%d: unhandled method %02x.%04x %08x\n", lnum, cls, mthd, val);
+				res = 1;
+			}
+		} else {
+			fprintf(stderr, "%d: can't parse line\n", lnum);
+			res = 1;
+		}
+	}
+	fprintf(stderr, "%llu pixels drawn\n", (unsigned long long)ctx->pixels);
+	pgrender_del(ctx);
+	return res;
+}
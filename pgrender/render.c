@@ -0,0 +1,571 @@
+/*
+ * Copyright (C) 2016 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "pgrender.h"
+#include "util.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct pgrender *pgrender_new(uint32_t pmc_id, uint32_t vram_size) {
+	struct pgrender *ctx = calloc(sizeof *ctx, 1);
+	struct pgraph_state *state = &ctx->state;
+	if (parse_pmc_id(pmc_id, &state->chipset) || state->chipset.card_type != 3) {
+		free(ctx);
+		return 0;
+	}
+	ctx->vram = calloc(vram_size, 1);
+	ctx->vram_size = vram_size;
+	pgraph_reset(state);
+	state->dst_canvas_min = 0;
+	state->dst_canvas_max = 0x3fff07ff;
+	state->rop = 0xcc;
+	state->beta = 0x7f800000;
+	state->pattern_mono_rgb[0] = state->pattern_mono_rgb[1] = 0x3fffffff;
+	state->pattern_mono_a[0] = state->pattern_mono_a[1] = 0xff;
+	state->pattern_mono_bitmap[0] = state->pattern_mono_bitmap[1] = 0xffffffff;
+	return ctx;
+}
+
+void pgrender_del(struct pgrender *ctx) {
+	free(ctx->vram);
+	free(ctx);
+}
+
+void pgrender_bind(struct pgrender *ctx, int cls, uint32_t ctx_switch) {
+	ctx->ctx[cls & 0x1f] = ctx_switch;
+}
+
+static uint32_t pgrender_rd(const uint8_t *p, int cpp) {
+	switch (cpp) {
+		case 1:
+			return p[0];
+		case 2:
+			return p[0] | p[1] << 8;
+		default:
+			return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+	}
+}
+
+static void pgrender_wr(uint8_t *p, int cpp, uint32_t val) {
+	p[0] = val;
+	if (cpp == 1)
+		return;
+	p[1] = val >> 8;
+	if (cpp == 2)
+		return;
+	p[2] = val >> 16;
+	p[3] = val >> 24;
+}
+
+uint32_t pgrender_rd_pixel(struct pgrender *ctx, int buf, int32_t x, int32_t y) {
+	struct pgraph_state *state = &ctx->state;
+	static const int cpp_tab[4] = { 2, 1, 2, 4 };
+	int cpp = cpp_tab[extr(state->surf_format, 4 * buf, 2)];
+	uint64_t addr = state->surf_offset[buf] + (int64_t)y * state->surf_pitch[buf] + (int64_t)x * cpp;
+	if (x < 0 || y < 0 || addr + cpp > ctx->vram_size)
+		return 0;
+	return pgrender_rd(ctx->vram + addr, cpp);
+}
+
+static bool pgrender_op_ok(struct pgraph_state *state) {
+	int op = extr(state->ctx_switch[0], 24, 5);
+	return op <= 0x15 || op == 0x17 || op == 0x19 || op == 0x1a || op == 0x1d;
+}
+
+static void pgrender_clip(struct pgrender *ctx) {
+	struct pgraph_state *state = &ctx->state;
+	int xy;
+	for (xy = 0; xy < 2; xy++) {
+		int32_t min = extr(state->dst_canvas_min, xy * 16, 16);
+		int32_t max = extr(state->dst_canvas_max, xy * 16, 16);
+		if (extr(state->ctx_switch[0], 15, 1)) {
+			if (min < (int32_t)state->uclip_min[0][xy])
+				min = state->uclip_min[0][xy];
+			if (max > (int32_t)state->uclip_max[0][xy])
+				max = state->uclip_max[0][xy];
+		}
+		ctx->clip_min[xy] = min;
+		ctx->clip_max[xy] = max;
+	}
+}
+
+/*
+ * Decide how spans of the current solid color get drawn.  Outside of the
+ * blend ops, nv03_pgraph_rop is a bitwise function of the destination
+ * pixel (each result bit depends only on the same destination bit) unless
+ * the color goes through the 10-bit upconvert + dither or the chroma key
+ * compares the whole result.  Even then, the result doesn't depend on the
+ * destination at all if the ROP ignores D.  In both cases the ROP at a
+ * given position is fully described by its results for an all-zeros and
+ * an all-ones destination.  The position only matters through the pattern
+ * and dither phase, so the table only needs that many entries.
+ */
+static void pgrender_span_prep(struct pgrender *ctx) {
+	struct pgraph_state *state = &ctx->state;
+	uint32_t key[14] = {
+		state->ctx_switch[0], state->misc32[0], state->rop, state->beta, state->chroma,
+		state->pattern_config, state->pattern_mono_rgb[0], state->pattern_mono_rgb[1],
+		state->pattern_mono_a[0], state->pattern_mono_a[1],
+		state->pattern_mono_bitmap[0], state->pattern_mono_bitmap[1], state->surf_format,
+		state->debug[0],
+	};
+	if (ctx->span_px && !memcmp(key, ctx->span_key, sizeof key))
+		return;
+	memcpy(ctx->span_key, key, sizeof key);
+	memset(ctx->span_valid, 0, sizeof ctx->span_valid);
+	struct pgraph_color s = pgraph_expand_color(state, state->misc32[0]);
+	ctx->span_color = s;
+	int op = extr(state->ctx_switch[0], 24, 5);
+	int fmt = nv03_pgraph_surf_format(state) & 3;
+	bool rgb10 = fmt == 3 || !(fmt == 1 || (fmt == 0 && s.mode == COLOR_MODE_Y16) || s.mode == COLOR_MODE_RGB5);
+	bool dither = fmt != 3 && rgb10;
+	bool chroma = extr(state->ctx_switch[0], 13, 1);
+	ctx->span_px = ctx->span_py = 1;
+	ctx->span_table = 0;
+	if (ctx->slow || op > 0x17)
+		return;
+	uint8_t rop = nv01_pgraph_xlat_rop(op, state->rop);
+	bool dst_free = !((rop ^ rop >> 1) & 0x55);
+	if (!dst_free && (dither || chroma))
+		return;
+	ctx->span_table = 1;
+	if (state->pattern_mono_rgb[0] != state->pattern_mono_rgb[1] || state->pattern_mono_a[0] != state->pattern_mono_a[1]) {
+		static const int px[4] = { 8, 64, 1, 64 };
+		static const int py[4] = { 8, 1, 64, 64 };
+		ctx->span_px = px[extr(state->pattern_config, 0, 2)];
+		ctx->span_py = py[extr(state->pattern_config, 0, 2)];
+	}
+	if (dither) {
+		if (ctx->span_px < 16)
+			ctx->span_px = 16;
+		if (ctx->span_py < 16)
+			ctx->span_py = 16;
+	}
+}
+
+static void pgrender_span_fill(struct pgrender *ctx, int32_t x, int32_t y, int cpp) {
+	struct pgraph_state *state = &ctx->state;
+	int ph = x & (ctx->span_px - 1);
+	int row = y & (ctx->span_py - 1);
+	uint32_t a = nv03_pgraph_rop(state, x, y, bflmask(cpp * 8), ctx->span_color);
+	uint32_t b = nv03_pgraph_rop(state, x, y, 0, ctx->span_color);
+	ctx->span_set[row][ph] = b;
+	ctx->span_flip[row][ph] = a ^ b;
+	ctx->span_valid[row] |= 1ull << ph;
+}
+
+/* draws [x0, x1) on row y with the current solid color */
+static void pgrender_span(struct pgrender *ctx, int32_t y, int32_t x0, int32_t x1) {
+	struct pgraph_state *state = &ctx->state;
+	if (y < ctx->clip_min[1] || y >= ctx->clip_max[1])
+		return;
+	if (x0 < ctx->clip_min[0])
+		x0 = ctx->clip_min[0];
+	if (x1 > ctx->clip_max[0])
+		x1 = ctx->clip_max[0];
+	if (x0 >= x1)
+		return;
+	int cpp = nv03_pgraph_cpp(state);
+	bool crect = extr(state->cliprect_ctrl, 0, 2) != 0;
+	int row = y & (ctx->span_py - 1);
+	int j;
+	for (j = 0; j < 4; j++) {
+		if (!extr(state->ctx_switch[0], 20 + j, 1))
+			continue;
+		uint64_t addr = state->surf_offset[j] + (uint64_t)y * state->surf_pitch[j] + (uint64_t)x0 * cpp;
+		if (addr >= ctx->vram_size)
+			continue;
+		int32_t end = x1;
+		if (addr + (uint64_t)(x1 - x0) * cpp > ctx->vram_size)
+			end = x0 + (ctx->vram_size - addr) / cpp;
+		uint8_t *p = ctx->vram + addr;
+		int32_t x;
+		if (!ctx->span_table || crect) {
+			for (x = x0; x < end; x++, p += cpp) {
+				if (crect && !pgraph_cliprect_pass(state, x, y))
+					continue;
+				uint32_t pixel = pgrender_rd(p, cpp);
+				if (ctx->slow) {
+					pixel = nv03_pgraph_solid_rop(state, x, y, pixel);
+				} else if (ctx->span_table) {
+					int ph = x & (ctx->span_px - 1);
+					if (!(ctx->span_valid[row] >> ph & 1))
+						pgrender_span_fill(ctx, x, y, cpp);
+					pixel = ctx->span_set[row][ph] ^ (pixel & ctx->span_flip[row][ph]);
+				} else {
+					pixel = nv03_pgraph_rop(state, x, y, pixel, ctx->span_color);
+				}
+				pgrender_wr(p, cpp, pixel);
+			}
+		} else if (ctx->span_px == 1) {
+			if (!ctx->span_valid[row])
+				pgrender_span_fill(ctx, x0, y, cpp);
+			uint32_t set = ctx->span_set[row][0];
+			uint32_t flip = ctx->span_flip[row][0];
+			if (flip == bflmask(cpp * 8) && !set)
+				continue;
+			for (x = x0; x < end; x++, p += cpp)
+				pgrender_wr(p, cpp, set ^ (flip ? pgrender_rd(p, cpp) & flip : 0));
+		} else {
+			for (x = x0; x < end; x++, p += cpp) {
+				int ph = x & (ctx->span_px - 1);
+				if (!(ctx->span_valid[row] >> ph & 1))
+					pgrender_span_fill(ctx, x, y, cpp);
+				uint32_t flip = ctx->span_flip[row][ph];
+				pgrender_wr(p, cpp, ctx->span_set[row][ph] ^ (flip ? pgrender_rd(p, cpp) & flip : 0));
+			}
+		}
+	}
+	ctx->pixels += x1 - x0;
+}
+
+/* draws a single pixel with its own source color, for blit and IFC */
+static void pgrender_pixel(struct pgrender *ctx, int32_t x, int32_t y, struct pgraph_color s) {
+	struct pgraph_state *state = &ctx->state;
+	if (x < ctx->clip_min[0] || x >= ctx->clip_max[0] || y < ctx->clip_min[1] || y >= ctx->clip_max[1])
+		return;
+	if (!pgraph_cliprect_pass(state, x, y))
+		return;
+	int cpp = nv03_pgraph_cpp(state);
+	int j;
+	for (j = 0; j < 4; j++) {
+		if (!extr(state->ctx_switch[0], 20 + j, 1))
+			continue;
+		uint64_t addr = state->surf_offset[j] + (uint64_t)y * state->surf_pitch[j] + (uint64_t)x * cpp;
+		if (addr + cpp > ctx->vram_size)
+			continue;
+		uint8_t *p = ctx->vram + addr;
+		pgrender_wr(p, cpp, nv03_pgraph_rop(state, x, y, pgrender_rd(p, cpp), s));
+	}
+	ctx->pixels++;
+}
+
+static int pgrender_begin(struct pgrender *ctx) {
+	if (!pgrender_op_ok(&ctx->state))
+		return -1;
+	pgrender_clip(ctx);
+	pgrender_span_prep(ctx);
+	return 0;
+}
+
+static int pgrender_rect(struct pgrender *ctx, int32_t x, int32_t y, int32_t w, int32_t h) {
+	if (pgrender_begin(ctx))
+		return -1;
+	if (y < ctx->clip_min[1]) {
+		h -= ctx->clip_min[1] - y;
+		y = ctx->clip_min[1];
+	}
+	if (h > ctx->clip_max[1] - y)
+		h = ctx->clip_max[1] - y;
+	int32_t i;
+	for (i = 0; i < h; i++)
+		pgrender_span(ctx, y + i, x, x + w);
+	return 0;
+}
+
+/* Bresenham, with the pixels of each row merged into one span */
+static int pgrender_line(struct pgrender *ctx, int32_t x0, int32_t y0, int32_t x1, int32_t y1, bool last) {
+	if (pgrender_begin(ctx))
+		return -1;
+	int32_t dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+	int32_t dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+	int32_t err = dx + dy;
+	int32_t n = max(dx, -dy) + last;
+	int32_t ry = y0, rmin = x0, rmax = x0;
+	int32_t i;
+	for (i = 0; i < n; i++) {
+		if (y0 != ry) {
+			pgrender_span(ctx, ry, rmin, rmax + 1);
+			ry = y0;
+			rmin = rmax = x0;
+		}
+		rmin = min(rmin, x0);
+		rmax = max(rmax, x0);
+		int32_t e2 = 2 * err;
+		if (e2 >= dy) {
+			err += dy;
+			x0 += sx;
+		}
+		if (e2 <= dx) {
+			err += dx;
+			y0 += sy;
+		}
+	}
+	if (n)
+		pgrender_span(ctx, ry, rmin, rmax + 1);
+	return 0;
+}
+
+static int64_t pgrender_floordiv(int64_t a, int64_t b) {
+	return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+/* samples at integer positions, with a top-left style rule for shared edges */
+static int pgrender_tri(struct pgrender *ctx, int32_t v[3][2]) {
+	if (pgrender_begin(ctx))
+		return -1;
+	int32_t t[3][2];
+	memcpy(t, v, sizeof t);
+	int64_t area = (int64_t)(t[1][0] - t[0][0]) * (t[2][1] - t[0][1]) - (int64_t)(t[2][0] - t[0][0]) * (t[1][1] - t[0][1]);
+	if (!area)
+		return 0;
+	if (area < 0) {
+		int32_t tmp[2] = { t[1][0], t[1][1] };
+		t[1][0] = t[2][0], t[1][1] = t[2][1];
+		t[2][0] = tmp[0], t[2][1] = tmp[1];
+	}
+	int32_t ymin = min(t[0][1], min(t[1][1], t[2][1]));
+	int32_t ymax = max(t[0][1], max(t[1][1], t[2][1]));
+	if (ymin < ctx->clip_min[1])
+		ymin = ctx->clip_min[1];
+	if (ymax > ctx->clip_max[1] - 1)
+		ymax = ctx->clip_max[1] - 1;
+	int32_t y;
+	for (y = ymin; y <= ymax; y++) {
+		int64_t xl = ctx->clip_min[0], xr = ctx->clip_max[0] - 1;
+		int i;
+		for (i = 0; i < 3; i++) {
+			int32_t *a = t[i], *b = t[(i + 1) % 3];
+			int64_t dx = b[0] - a[0], dy = b[1] - a[1];
+			/* E(x) = -dy * x + k; inside is E > 0, or E == 0 on top/left edges */
+			int64_t k = dx * (y - a[1]) + dy * a[0];
+			int bias = (dy < 0 || (dy == 0 && dx > 0)) ? 0 : 1;
+			if (dy < 0) {
+				int64_t lim = -pgrender_floordiv(k - bias, -dy);
+				if (xl < lim)
+					xl = lim;
+			} else if (dy > 0) {
+				int64_t lim = pgrender_floordiv(k - bias, dy);
+				if (xr > lim)
+					xr = lim;
+			} else if (k < bias) {
+				xr = xl - 1;
+			}
+		}
+		if (xl <= xr)
+			pgrender_span(ctx, y, xl, xr + 1);
+	}
+	return 0;
+}
+
+static int pgrender_blit(struct pgrender *ctx, int32_t sx, int32_t sy, int32_t dx, int32_t dy, int32_t w, int32_t h) {
+	struct pgraph_state *state = &ctx->state;
+	if (pgrender_begin(ctx))
+		return -1;
+	int ss = extr(state->ctx_switch[0], 16, 2);
+	int fmt = nv03_pgraph_surf_format(state) & 3;
+	uint32_t *tmp = malloc(sizeof *tmp * w * h);
+	int32_t i, j;
+	/* read the whole source first, so that overlapping copies work */
+	for (i = 0; i < h; i++)
+		for (j = 0; j < w; j++)
+			tmp[i * w + j] = pgrender_rd_pixel(ctx, ss, sx + j, sy + i);
+	for (i = 0; i < h; i++)
+		for (j = 0; j < w; j++)
+			pgrender_pixel(ctx, dx + j, dy + i, nv03_pgraph_expand_surf(fmt, tmp[i * w + j]));
+	free(tmp);
+	return 0;
+}
+
+static int pgrender_ifc_data(struct pgrender *ctx, uint32_t val) {
+	struct pgraph_state *state = &ctx->state;
+	if (pgrender_begin(ctx))
+		return -1;
+	int fmt = extr(state->ctx_switch[0], 0, 3);
+	int n = (fmt == 0 || fmt == 3) ? 2 : 1;
+	int i;
+	for (i = 0; i < n; i++) {
+		if (!ctx->ifc_in[0] || ctx->ifc_idx >= ctx->ifc_in[0] * ctx->ifc_in[1])
+			return 0;
+		int32_t x = ctx->ifc_idx % ctx->ifc_in[0];
+		int32_t y = ctx->ifc_idx / ctx->ifc_in[0];
+		uint32_t color = n == 2 ? extr(val, 16 * i, 16) : val;
+		if (x < ctx->ifc_out[0] && y < ctx->ifc_out[1])
+			pgrender_pixel(ctx, ctx->vtx[0][0] + x, ctx->vtx[0][1] + y, pgraph_expand_color(state, color));
+		ctx->ifc_idx++;
+	}
+	return 0;
+}
+
+static void pgrender_set_xy(struct pgrender *ctx, int idx, uint32_t val) {
+	ctx->vtx[idx][0] = extrs(val, 0, 16);
+	ctx->vtx[idx][1] = extrs(val, 16, 16);
+}
+
+int pgrender_mthd(struct pgrender *ctx, int cls, uint32_t mthd, uint32_t val) {
+	struct pgraph_state *state = &ctx->state;
+	cls &= 0x1f;
+	state->ctx_switch[0] = ctx->ctx[cls];
+	insrt(state->ctx_user, 16, 5, cls);
+	if (mthd < 0x200)
+		return 0;
+	if (!(cls == 0x09 || cls == 0x0a) || mthd < 0x500)
+		ctx->npoly = 0;
+	switch (cls) {
+		case 0x01: /* beta */
+			if (mthd != 0x300)
+				break;
+			state->beta = val;
+			if (state->beta & 0x80000000)
+				state->beta = 0;
+			state->beta &= 0x7f800000;
+			return 0;
+		case 0x02: /* rop */
+			if (mthd != 0x300)
+				break;
+			state->rop = val & 0xff;
+			return 0;
+		case 0x03: /* chroma */
+			if (mthd != 0x304)
+				break;
+			state->chroma = pgraph_to_a1r10g10b10(pgraph_expand_color(state, val));
+			return 0;
+		case 0x05: /* clip */
+			if (mthd == 0x300) {
+				state->uclip_min[0][0] = extrs(val, 0, 16);
+				state->uclip_min[0][1] = extrs(val, 16, 16);
+				return 0;
+			} else if (mthd == 0x304) {
+				state->uclip_max[0][0] = state->uclip_min[0][0] + extr(val, 0, 16);
+				state->uclip_max[0][1] = state->uclip_min[0][1] + extr(val, 16, 16);
+				return 0;
+			}
+			break;
+		case 0x06: /* pattern */
+			if (mthd == 0x308) {
+				insrt(state->pattern_config, 0, 2, val);
+				return 0;
+			} else if (mthd == 0x310 || mthd == 0x314) {
+				struct pgraph_color c = pgraph_expand_color(state, val);
+				int which = mthd >> 2 & 1;
+				state->pattern_mono_rgb[which] = c.r << 20 | c.g << 10 | c.b;
+				state->pattern_mono_a[which] = c.a;
+				return 0;
+			} else if (mthd == 0x318 || mthd == 0x31c) {
+				state->pattern_mono_bitmap[mthd >> 2 & 1] = pgraph_expand_mono(state, val);
+				return 0;
+			}
+			break;
+		case 0x07: /* rect */
+			if (mthd == 0x304) {
+				state->misc32[0] = val;
+				return 0;
+			} else if (mthd >= 0x400 && mthd < 0x480) {
+				if (!(mthd & 4)) {
+					pgrender_set_xy(ctx, 0, val);
+					return 0;
+				}
+				return pgrender_rect(ctx, ctx->vtx[0][0], ctx->vtx[0][1], extr(val, 0, 16), extr(val, 16, 16));
+			}
+			break;
+		case 0x08: /* point */
+			if (mthd == 0x304) {
+				state->misc32[0] = val;
+				return 0;
+			} else if (mthd >= 0x400 && mthd < 0x480) {
+				pgrender_set_xy(ctx, 0, val);
+				return pgrender_rect(ctx, ctx->vtx[0][0], ctx->vtx[0][1], 1, 1);
+			}
+			break;
+		case 0x09: /* line */
+		case 0x0a: /* lin */
+			if (mthd == 0x304) {
+				state->misc32[0] = val;
+				return 0;
+			} else if (mthd >= 0x400 && mthd < 0x480) {
+				pgrender_set_xy(ctx, mthd >> 2 & 1, val);
+				if (!(mthd & 4))
+					return 0;
+			} else if (mthd >= 0x500 && mthd < 0x580) {
+				ctx->vtx[0][0] = ctx->vtx[1][0];
+				ctx->vtx[0][1] = ctx->vtx[1][1];
+				pgrender_set_xy(ctx, 1, val);
+				if (!ctx->npoly++)
+					return 0;
+			} else {
+				break;
+			}
+			return pgrender_line(ctx, ctx->vtx[0][0], ctx->vtx[0][1], ctx->vtx[1][0], ctx->vtx[1][1], cls == 0x09);
+		case 0x0b: /* tri */
+			if (mthd == 0x304) {
+				state->misc32[0] = val;
+				return 0;
+			} else if (mthd >= 0x310 && mthd < 0x31c) {
+				pgrender_set_xy(ctx, (mthd - 0x310) >> 2, val);
+				if (mthd != 0x318)
+					return 0;
+				return pgrender_tri(ctx, ctx->vtx);
+			}
+			break;
+		case 0x10: /* blit */
+			if (mthd == 0x300 || mthd == 0x304) {
+				pgrender_set_xy(ctx, mthd >> 2 & 1, val);
+				return 0;
+			} else if (mthd == 0x308) {
+				return pgrender_blit(ctx, ctx->vtx[0][0], ctx->vtx[0][1], ctx->vtx[1][0], ctx->vtx[1][1], extr(val, 0, 16), extr(val, 16, 16));
+			}
+			break;
+		case 0x11: /* ifc */
+			if (mthd == 0x304) {
+				pgrender_set_xy(ctx, 0, val);
+				return 0;
+			} else if (mthd == 0x308) {
+				ctx->ifc_out[0] = extr(val, 0, 16);
+				ctx->ifc_out[1] = extr(val, 16, 16);
+				return 0;
+			} else if (mthd == 0x30c) {
+				ctx->ifc_in[0] = extr(val, 0, 16);
+				ctx->ifc_in[1] = extr(val, 16, 16);
+				ctx->ifc_idx = 0;
+				return 0;
+			} else if (mthd >= 0x400 && mthd < 0x600) {
+				return pgrender_ifc_data(ctx, val);
+			}
+			break;
+		case 0x1c: /* surf */
+			{
+				int which = extr(state->ctx_switch[0], 16, 2);
+				if (mthd == 0x300) {
+					int f = 1;
+					if (extr(val, 0, 1))
+						f = 0;
+					if (!extr(val, 16, 1))
+						f = 2;
+					if (!extr(val, 24, 1))
+						f = 3;
+					insrt(state->surf_format, 4 * which, 3, f | 4);
+					return 0;
+				} else if (mthd == 0x308) {
+					state->surf_pitch[which] = val & pgraph_pitch_mask(&state->chipset);
+					return 0;
+				} else if (mthd == 0x30c) {
+					state->surf_offset[which] = val & pgraph_offset_mask(&state->chipset);
+					return 0;
+				}
+			}
+			break;
+	}
+	return -1;
+}
@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2016 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "pgrender.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Runs random NV03 method streams through the span renderer and through
+ * the per-pixel nv03_pgraph_solid_rop reference, and compares the VRAM.
+ */
+
+#define VRAM_SIZE 0x100000
+#define PRIMS 600
+
+static uint32_t seed = 1;
+
+static uint32_t rnd() {
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+static int both(struct pgrender *ctx[2], int cls, uint32_t mthd, uint32_t val) {
+	int r0 = pgrender_mthd(ctx[0], cls, mthd, val);
+	int r1 = pgrender_mthd(ctx[1], cls, mthd, val);
+	if (r0 != r1) {
+		printf("%02x.%04x %08x: result %d vs %d\n", cls, mthd, val, r0, r1);
+		return -1;
+	}
+	return 0;
+}
+
+static uint32_t rnd_ctx() {
+	static const int ops[] = { 0x00, 0x01, 0x03, 0x08, 0x0a, 0x0f, 0x10, 0x12, 0x15, 0x17, 0x17, 0x17, 0x19, 0x1a, 0x1d };
+	uint32_t res = rnd();
+	insrt(res, 24, 5, ops[rnd() % (sizeof ops / sizeof *ops)]);
+	if (!extr(res, 20, 4))
+		insrt(res, 20, 1, 1);
+	if (rnd() & 1)
+		insrt(res, 13, 1, 0);
+	return res;
+}
+
+static uint32_t rnd_xy(int range) {
+	return ((rnd() % range - 8) & 0xffff) | ((rnd() % range - 8) & 0xffff) << 16;
+}
+
+static uint32_t rnd_size(int range) {
+	return rnd() % range | (rnd() % range) << 16;
+}
+
+static int run(struct pgrender *ctx[2]) {
+	int i, j, k;
+	for (j = 0; j < 4; j++) {
+		for (k = 0; k < 2; k++)
+			pgrender_bind(ctx[k], 0x1c, j << 16);
+		if (both(ctx, 0x1c, 0x300, (uint32_t []){ 1, 0x01000000, 0x01010000, 0x01010001 }[rnd() & 3]) ||
+			both(ctx, 0x1c, 0x308, 0x400) ||
+			both(ctx, 0x1c, 0x30c, j << 18))
+			return -1;
+	}
+	for (k = 0; k < 2; k++)
+		ctx[k]->state.dst_canvas_max = 0x01000100;
+	for (i = 0; i < PRIMS; i++) {
+		uint32_t sw = rnd_ctx();
+		int cls = (int []){ 0x07, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x10, 0x11 }[rnd() & 7];
+		for (k = 0; k < 2; k++) {
+			pgrender_bind(ctx[k], cls, sw);
+			pgrender_bind(ctx[k], 0x06, sw);
+			pgrender_bind(ctx[k], 0x03, sw);
+		}
+		/* state changes */
+		switch (rnd() & 7) {
+			case 0:
+				if (both(ctx, 0x02, 0x300, rnd()))
+					return -1;
+				break;
+			case 1:
+				if (both(ctx, 0x01, 0x300, rnd()))
+					return -1;
+				break;
+			case 2:
+				if (both(ctx, 0x06, 0x308, rnd() % 3) ||
+					both(ctx, 0x06, 0x310, rnd()) ||
+					both(ctx, 0x06, 0x314, rnd()) ||
+					both(ctx, 0x06, 0x318, rnd()) ||
+					both(ctx, 0x06, 0x31c, rnd()))
+					return -1;
+				break;
+			case 3:
+				if (both(ctx, 0x03, 0x304, rnd()))
+					return -1;
+				break;
+			case 4:
+				if (both(ctx, 0x05, 0x300, rnd_xy(0x100)) ||
+					both(ctx, 0x05, 0x304, rnd_size(0x100)))
+					return -1;
+				break;
+			case 5:
+				{
+					uint32_t ctrl = rnd() & 0x13;
+					uint32_t cmin = rnd_xy(0x100), cmax = rnd_xy(0x100);
+					for (k = 0; k < 2; k++) {
+						ctx[k]->state.cliprect_ctrl = ctrl;
+						ctx[k]->state.cliprect_min[0] = cmin;
+						ctx[k]->state.cliprect_max[0] = cmax;
+					}
+				}
+				break;
+		}
+		uint32_t color = rnd();
+		switch (cls) {
+			case 0x07:
+				if (both(ctx, cls, 0x304, color) ||
+					both(ctx, cls, 0x400, rnd_xy(0x100)) ||
+					both(ctx, cls, 0x404, rnd_size(0x60)))
+					return -1;
+				break;
+			case 0x08:
+				if (both(ctx, cls, 0x304, color))
+					return -1;
+				for (j = 0; j < 8; j++)
+					if (both(ctx, cls, 0x400 + j * 4, rnd_xy(0x110)))
+						return -1;
+				break;
+			case 0x09:
+			case 0x0a:
+				if (both(ctx, cls, 0x304, color) ||
+					both(ctx, cls, 0x400, rnd_xy(0x110)) ||
+					both(ctx, cls, 0x404, rnd_xy(0x110)))
+					return -1;
+				for (j = 0; j < 3; j++)
+					if (both(ctx, cls, 0x500 + j * 4, rnd_xy(0x110)))
+						return -1;
+				break;
+			case 0x0b:
+				if (both(ctx, cls, 0x304, color) ||
+					both(ctx, cls, 0x310, rnd_xy(0x110)) ||
+					both(ctx, cls, 0x314, rnd_xy(0x110)) ||
+					both(ctx, cls, 0x318, rnd_xy(0x110)))
+					return -1;
+				break;
+			case 0x10:
+				if (both(ctx, cls, 0x300, rnd_xy(0x100)) ||
+					both(ctx, cls, 0x304, rnd_xy(0x100)) ||
+					both(ctx, cls, 0x308, rnd_size(0x30)))
+					return -1;
+				break;
+			case 0x11:
+				if (both(ctx, cls, 0x304, rnd_xy(0x100)) ||
+					both(ctx, cls, 0x308, rnd_size(0x10)) ||
+					both(ctx, cls, 0x30c, rnd_size(0x10)))
+					return -1;
+				for (j = 0; j < 0x40; j++)
+					if (both(ctx, cls, 0x400 + j * 4, rnd()))
+						return -1;
+				break;
+		}
+		if (memcmp(ctx[0]->vram, ctx[1]->vram, VRAM_SIZE)) {
+			for (j = 0; j < VRAM_SIZE && ctx[0]->vram[j] == ctx[1]->vram[j]; j++);
+			printf("primitive %d (class %02x, ctx %08x): VRAM differs at %06x: %02x vs %02x\n", i, cls, sw, j, ctx[0]->vram[j], ctx[1]->vram[j]);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+int main() {
+	int bad = 0;
+	uint64_t pixels = 0;
+	int i;
+	for (i = 0; i < 8 && !bad; i++) {
+		struct pgrender *ctx[2];
+		ctx[0] = pgrender_new(0x00030100, VRAM_SIZE);
+		ctx[1] = pgrender_new(0x00030100, VRAM_SIZE);
+		ctx[1]->slow = 1;
+		if (run(ctx))
+			bad = 1;
+		pixels += ctx[0]->pixels;
+		pgrender_del(ctx[0]);
+		pgrender_del(ctx[1]);
+	}
+	if (bad)
+		return 1;
+	fprintf(stderr, "All ok! (%llu pixels)\n", (unsigned long long)pixels);
+	return 0;
+}
@@ -77,6 +77,23 @@ struct cctx {
 struct cctx *cctx = 0;
 int cctxnum = 0, cctxmax = 0;
 
+/* with -r, a run of identical plain MMIO reads is printed once, plus a count */
+struct {
+	int valid;
+	int cci;
+	int width;
+	uint64_t rawaddr, addr, value;
+	double timestamp;
+	int count;
+} lastread;
+
+void flushrepeats () {
+	if (lastread.valid && lastread.count)
+		printf ("[%d] %lf MMIO%d R 0x%06"PRIx64" 0x%08"PRIx64" repeated %d more times\n", lastread.cci, lastread.timestamp, lastread.width, lastread.addr, lastread.value, lastread.count);
+	lastread.valid = 0;
+	lastread.count = 0;
+}
+
 struct mpage {
 	uint64_t tag;
 	uint32_t contents[0x1000/4];
@@ -210,8 +227,8 @@ void doi2cw (struct cctx *cc, struct i2c_ctx *ctx, int byte) {
 
 int main(int argc, char **argv) {
 	char *file = NULL;
-	int c,use_colors=1;
-	while ((c = getopt (argc, argv, "f:c")) != -1) {
+	int c,use_colors=1,collapse=0;
+	while ((c = getopt (argc, argv, "f:cr")) != -1) {
 		switch (c) {
 			case 'f':{
 				file = strdup(optarg);
@@ -221,6 +238,10 @@ int main(int argc, char **argv) {
 				use_colors = 0;
 				break;
 			}
+			case 'r':{
+				collapse = 1;
+				break;
+			}
 			default:{
 				break;
 			}
@@ -259,6 +280,7 @@ int main(int argc, char **argv) {
 		if (!fgets(line, sizeof(line), fin))
 			break;
 		if (!strncmp(line, "PCIDEV ", 7)) {
+			flushrepeats();
 			uint64_t bar[4], len[4], pciid;
 			sscanf (line, "%*s %*s %"SCNx64" %*s %"SCNx64" %"SCNx64" %"SCNx64" %"SCNx64" %*s %*s %*s %"SCNx64" %"SCNx64" %"SCNx64" %"SCNx64"", &pciid, &bar[0], &bar[1], &bar[2], &bar[3], &len[0], &len[1], &len[2], &len[3]);
 			if ((pciid >> 16) == 0x10de && bar[0] && (bar[0] & 0xf) == 0 && bar[1] && (bar[1] & 0x1) == 0x0) {
@@ -289,6 +311,15 @@ int main(int argc, char **argv) {
 			sscanf (line, "%*s %d %lf %*d %"SCNx64" %"SCNx64, &width, &timestamp, &addr, &value);
 			width *= 8;
 
+			if (lastread.valid && line[0] == 'R' && addr == lastread.rawaddr && width == lastread.width && value == lastread.value) {
+				lastread.count++;
+				lastread.timestamp = timestamp;
+				timestamp_old = timestamp;
+				continue;
+			}
+			flushrepeats();
+			uint64_t rawaddr = addr;
+
 			/* Add a SLEEP line when two mmio accesses are more distant than 100µs */
 			if (!sleep_disabled && timestamp_old > 0 && (timestamp - timestamp_old) > 0.0001)
 				printf("SLEEP %lfms\n", (timestamp - timestamp_old)*1000.0);
@@ -333,17 +364,15 @@ int main(int argc, char **argv) {
 					} else if (addr == 0x6033d4) {
 						cc->crx1 = value & 0xff;
 					} else if (addr == 0x6013d5) {
-						struct rnndecaddrinfo *ai = rnndec_decodeaddr(cc->ctx, crdom, cc->crx0, line[0] == 'W');
+						const struct rnndecaddrinfo *ai = rnndec_decodeaddr_cached(cc->ctx, crdom, cc->crx0, line[0] == 'W');
 						char *decoded_val = rnndec_decodeval(cc->ctx, ai->typeinfo, value, ai->width);
 						printf ("[%d] %lf HEAD0 %c     0x%02x       0x%02"PRIx64" %s %s %s\n", cci, timestamp, line[0], cc->crx0, value, ai->name, line[0]=='W'?"<=":"=>", decoded_val);
-						rnndec_free_decaddrinfo(ai);
 						free(decoded_val);
 						skip = 1;
 					} else if (addr == 0x6033d5) {
-						struct rnndecaddrinfo *ai = rnndec_decodeaddr(cc->ctx, crdom, cc->crx1, line[0] == 'W');
+						const struct rnndecaddrinfo *ai = rnndec_decodeaddr_cached(cc->ctx, crdom, cc->crx1, line[0] == 'W');
 						char *decoded_val = rnndec_decodeval(cc->ctx, ai->typeinfo, value, ai->width);
 						printf ("[%d] %lf HEAD1 %c     0x%02x       0x%02"PRIx64" %s %s %s\n", cci, timestamp, line[0], cc->crx1, value, ai->name, line[0]=='W'?"<=":"=>", decoded_val);
-						rnndec_free_decaddrinfo(ai);
 						free(decoded_val);
 						skip = 1;
 					} else if (cc->chipset.card_type >= 0x50 && (addr & 0xfff000) == 0xe000) {
@@ -352,9 +381,8 @@ int main(int argc, char **argv) {
 							if (cc->i2cip != bus) {
 								if (cc->i2cip != -1)
 									printf ("\n");
-								struct rnndecaddrinfo *ai = rnndec_decodeaddr(cc->ctx, mmiodom, addr, line[0] == 'W');
+								const struct rnndecaddrinfo *ai = rnndec_decodeaddr_cached(cc->ctx, mmiodom, addr, line[0] == 'W');
 								printf ("[%d] I2C      0x%06"PRIx64"            %s ", cci, addr, ai->name);
-								rnndec_free_decaddrinfo(ai);
 								cc->i2cip = bus;
 							}
 							if (line[0] == 'R') {
@@ -369,9 +397,8 @@ int main(int argc, char **argv) {
 						skip = 1;
 					} else if (addr == 0x1400 || addr == 0x80000 || (addr == cc->hwsqnext && cc->hwsqip)) {
 						if (!cc->hwsqip) {
-							struct rnndecaddrinfo *ai = rnndec_decodeaddr(cc->ctx, mmiodom, addr, line[0] == 'W');
+							const struct rnndecaddrinfo *ai = rnndec_decodeaddr_cached(cc->ctx, mmiodom, addr, line[0] == 'W');
 							printf ("[%d] HWSQ     0x%06"PRIx64"            %s\n", cci, addr, ai->name);
-							rnndec_free_decaddrinfo(ai);
 						}
 						cc->hwsq[(addr & 0x1fc) + 0] = value;
 						cc->hwsq[(addr & 0x1fc) + 1] = value >> 8;
@@ -409,11 +436,10 @@ int main(int argc, char **argv) {
 						param[1] = value >> 8;
 						param[2] = value >> 16;
 						param[3] = value >> 24;
-						struct rnndecaddrinfo *ai = rnndec_decodeaddr(cc->ctx, mmiodom, addr, line[0] == 'W');
+						const struct rnndecaddrinfo *ai = rnndec_decodeaddr_cached(cc->ctx, mmiodom, addr, line[0] == 'W');
 						printf ("[%d] MMIO%d %c 0x%06"PRIx64" 0x%08"PRIx64" %s %s ", cci, width, line[0], addr, value, ai->name, line[0]=='W'?"<=":"=>");
 						envydis(ctx_isa, stdout, param, cc->ctxpos, 1, (cc->chipset.card_type == 0x50 ? ctx_var_g80 : ctx_var_nv40), 0, 0, 0, colors);
 						cc->ctxpos++;
-						rnndec_free_decaddrinfo(ai);
 						skip = 1;
 					}
 					if (!skip && (cc->i2cip != -1)) {
@@ -426,14 +452,13 @@ int main(int argc, char **argv) {
 						printf ("[%d] %lf, MEM%d %"PRIx64" %s %"PRIx64"\n", cci, timestamp, width, addr, line[0]=='W'?"<=":"=>", value);
 						*findmem(cc, addr) = value;
 					} else if (!skip) {
-						struct rnndecaddrinfo *ai = rnndec_decodeaddr(cc->ctx, mmiodom, addr, line[0] == 'W');
+						const struct rnndecaddrinfo *ai = rnndec_decodeaddr_cached(cc->ctx, mmiodom, addr, line[0] == 'W');
 						if (width == 32 && ai->width == 8) {
 							/* 32-bit write to 8-bit location - split it up */
 							int b;
-							rnndec_free_decaddrinfo(ai);
 							int cnt;
 							for (b = 0; b < 4; b++) {
-								struct rnndecaddrinfo *ai = rnndec_decodeaddr(cc->ctx, mmiodom, addr+b, line[0] == 'W');
+								const struct rnndecaddrinfo *ai = rnndec_decodeaddr_cached(cc->ctx, mmiodom, addr+b, line[0] == 'W');
 								char *decoded_val = rnndec_decodeval(cc->ctx, ai->typeinfo, value >> b * 8 & 0xff, ai->width);
 								if (b == 0) {
 									printf ("[%d] %lf MMIO%d %c 0x%06"PRIx64" 0x%08"PRIx64" %n%s %s %s\n", cci, timestamp, width, line[0], addr, value, &cnt, ai->name, line[0]=='W'?"<=":"=>", decoded_val);
@@ -443,16 +468,21 @@ int main(int argc, char **argv) {
 										printf(" ");
 									printf ("%s %s %s\n", ai->name, line[0]=='W'?"<=":"=>", decoded_val);
 								}
-								rnndec_free_decaddrinfo(ai);
 								free(decoded_val);
 							}
 						} else {
 							char *decoded_val = rnndec_decodeval(cc->ctx, ai->typeinfo, value, ai->width);
 							printf ("[%d] %lf MMIO%d %c 0x%06"PRIx64" 0x%08"PRIx64" %s %s %s\n", cci, timestamp, width, line[0], addr, value, ai->name, line[0]=='W'?"<=":"=>", decoded_val);
-							free(ai->name);
-							free(ai);
 							free(decoded_val);
 						}
+						if (collapse && line[0] == 'R') {
+							lastread.valid = 1;
+							lastread.cci = cci;
+							lastread.width = width;
+							lastread.rawaddr = rawaddr;
+							lastread.addr = addr;
+							lastread.value = value;
+						}
 					}
 				} else if (cc->bar1 && addr >= cc->bar1 && addr < cc->bar1+cc->bar1l) {
 					addr -= cc->bar1;
@@ -494,9 +524,11 @@ int main(int argc, char **argv) {
 				}
 			}
 		} else {
+			flushrepeats();
 			printf ("%s", line);
 		}
 	}
+	flushrepeats();
 
 	rnn_freedb(db);
 	rnn_fini();
@@ -26,6 +26,7 @@
 
 #include "rnn.h"
 #include "util.h"
+#include "symtab.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <inttypes.h>
@@ -33,25 +34,67 @@
 #include <ctype.h>
 #include <unistd.h>
 #include <string.h>
+#include <pthread.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
 
-uint64_t *strides = 0;
-int stridesnum = 0;
-int stridesmax = 0;
+/*
+ * Headers are generated in two passes.  The first one walks the database
+ * without printing anything, noting for every output the source files that
+ * contribute to it and the top-level items that print into it.  The second
+ * one generates the outputs into memory on a pool of threads, each output
+ * walking only its own items.  An output is only written if it differs from
+ * what's already on disk, so that unchanged headers keep their mtimes.
+ */
+
+#define MAX_THREADS 16
 
 int startcol = 64;
 
+struct item {
+	enum {
+		ITEM_ENUM,
+		ITEM_BITSET,
+		ITEM_DOMAIN_SIZE,
+		ITEM_DOMAIN_ELEM,
+	} type;
+	int idx;
+	int sub;
+};
+
 struct fout {
 	char *name;
-	FILE *file;
 	char *guard;
+	char *deps;	/* indexed like db->files, nonzero for the files it's generated from */
+	struct item *items;
+	int itemsnum;
+	int itemsmax;
+	int changed;
 };
 
 struct fout *fouts = 0;
 int foutsnum = 0;
 int foutsmax = 0;
 
+struct rnndb *db;
+struct symtab *fileidx;	/* file name -> index in db->files and fouts */
+char **fileinfo;	/* size and mtime of each db->files entry, for the header */
+
+struct genctx {
+	int out;	/* the output being generated, or -1 when scanning */
+	FILE *file;
+	struct item item;
+	uint64_t *strides;
+	int stridesnum;
+	int stridesmax;
+	/* when scanning, the files the current element and its parents come from */
+	int *srcs;
+	int srcsnum;
+	int srcsmax;
+	char *lastsrc;
+	int lastsrcidx;
+};
+
 void seekcol (FILE *f, int src, int dst) {
 	if (dst <= src)
 		fprintf (f, "\t");
@@ -68,21 +111,58 @@ void seekcol (FILE *f, int src, int dst) {
 	}
 }
 
-FILE *findfout (char *file) {
+int findfile (struct genctx *ctx, char *file) {
 	int i;
-	for (i = 0; i < foutsnum; i++)
-		if (!strcmp(fouts[i].name, file))
-			break;
-	if (i == foutsnum) {
+	if (file == ctx->lastsrc)
+		return ctx->lastsrcidx;
+	if (symtab_get(fileidx, file, 0, &i) == -1) {
 		fprintf (stderr, "AIII, didn't open file %s.\n", file);
 		exit(1);
 	}
-	return fouts[i].file;
+	ctx->lastsrc = file;
+	ctx->lastsrcidx = i;
+	return i;
+}
+
+void addsrc (struct genctx *ctx, char *file) {
+	if (ctx->out == -1 && file)
+		ADDARRAY(ctx->srcs, findfile(ctx, file));
+}
+
+void addvarinfo (struct genctx *ctx, struct rnnvarinfo *vi) {
+	int i;
+	if (ctx->out != -1)
+		return;
+	if (vi->prefenum)
+		addsrc(ctx, vi->prefenum->file);
+	for (i = 0; i < vi->varsetsnum; i++)
+		addsrc(ctx, vi->varsets[i]->venum->file);
+}
+
+/*
+ * Returns where to print things belonging to the given file, or NULL if
+ * they're to be skipped.  When scanning, notes the dependencies instead.
+ */
+FILE *findfout (struct genctx *ctx, char *file) {
+	if (ctx->out != -1) {
+		char *name = fouts[ctx->out].name;
+		return file == name || !strcmp(file, name) ? ctx->file : 0;
+	}
+	struct fout *f = &fouts[findfile(ctx, file)];
+	int i;
+	for (i = 0; i < ctx->srcsnum; i++)
+		f->deps[ctx->srcs[i]] = 1;
+	struct item *last = f->itemsnum ? &f->items[f->itemsnum-1] : 0;
+	if (!last || last->type != ctx->item.type || last->idx != ctx->item.idx || last->sub != ctx->item.sub)
+		ADDARRAY(f->items, ctx->item);
+	return 0;
 }
 
-void printdef (char *name, char *suf, int type, uint64_t val, char *file) {
-	FILE *dst = findfout(file);
+void printdef (struct genctx *ctx, char *name, char *suf, int type, uint64_t val, char *file) {
+	FILE *dst = findfout(ctx, file);
 	int len;
+	if (!dst)
+		return;
 	if (suf)
 		fprintf (dst, "#define %s__%s%n", name, suf, &len);
 	else
@@ -104,57 +184,91 @@ void printdef (char *name, char *suf, int type, uint64_t val, char *file) {
 	}
 }
 
-void printvalue (struct rnnvalue *val, int shift) {
+void printvalue (struct genctx *ctx, struct rnnvalue *val, int shift) {
 	if (val->varinfo.dead)
 		return;
+	int srcsnum = ctx->srcsnum;
+	addsrc(ctx, val->file);
+	addvarinfo(ctx, &val->varinfo);
 	if (val->valvalid)
-		printdef (val->fullname, 0, 0, val->value << shift, val->file);
+		printdef (ctx, val->fullname, 0, 0, val->value << shift, val->file);
+	ctx->srcsnum = srcsnum;
 }
 
-void printbitfield (struct rnnbitfield *bf, int shift);
+void printbitfield (struct genctx *ctx, struct rnnbitfield *bf, int shift);
 
-void printtypeinfo (struct rnntypeinfo *ti, char *prefix, int shift, char *file) {
+void printtypeinfo (struct genctx *ctx, struct rnntypeinfo *ti, char *prefix, int shift, char *file) {
+	int srcsnum = ctx->srcsnum;
+	int i;
+	/* inline enums and bitsets are copied in, but still come from elsewhere */
+	if (ctx->out == -1 && ti->type == RNN_TTYPE_INLINE_ENUM && ti->name) {
+		struct rnnenum *en = rnn_findenum(db, ti->name);
+		if (en) {
+			addsrc(ctx, en->file);
+			addvarinfo(ctx, &en->varinfo);
+			for (i = 0; i < en->valsnum; i++)
+				addsrc(ctx, en->vals[i]->file);
+		}
+	}
+	if (ctx->out == -1 && ti->type == RNN_TTYPE_INLINE_BITSET && ti->name) {
+		struct rnnbitset *bs = rnn_findbitset(db, ti->name);
+		if (bs) {
+			addsrc(ctx, bs->file);
+			addvarinfo(ctx, &bs->varinfo);
+			for (i = 0; i < bs->bitfieldsnum; i++)
+				addsrc(ctx, bs->bitfields[i]->file);
+		}
+	}
 	if (ti->shr)
-		printdef (prefix, "SHR", 1, ti->shr, file);
+		printdef (ctx, prefix, "SHR", 1, ti->shr, file);
 	if (ti->minvalid)
-		printdef (prefix, "MIN", 0, ti->min, file);
+		printdef (ctx, prefix, "MIN", 0, ti->min, file);
 	if (ti->maxvalid)
-		printdef (prefix, "MAX", 0, ti->max, file);
+		printdef (ctx, prefix, "MAX", 0, ti->max, file);
 	if (ti->alignvalid)
-		printdef (prefix, "ALIGN", 0, ti->align, file);
+		printdef (ctx, prefix, "ALIGN", 0, ti->align, file);
 	if (ti->radixvalid)
-		printdef (prefix, "RADIX", 0, ti->radix, file);
-	int i;
+		printdef (ctx, prefix, "RADIX", 0, ti->radix, file);
 	for (i = 0; i < ti->valsnum; i++)
-		printvalue(ti->vals[i], shift);
+		printvalue(ctx, ti->vals[i], shift);
 	for (i = 0; i < ti->bitfieldsnum; i++)
-		printbitfield(ti->bitfields[i], shift);
+		printbitfield(ctx, ti->bitfields[i], shift);
+	ctx->srcsnum = srcsnum;
 }
 
-void printbitfield (struct rnnbitfield *bf, int shift) {
+void printbitfield (struct genctx *ctx, struct rnnbitfield *bf, int shift) {
 	if (bf->varinfo.dead)
 		return;
+	int srcsnum = ctx->srcsnum;
+	addsrc(ctx, bf->file);
+	addvarinfo(ctx, &bf->varinfo);
 	if (bf->typeinfo.type == RNN_TTYPE_BOOLEAN) {
-		printdef (bf->fullname, 0, 0, bf->mask << shift, bf->file);
+		printdef (ctx, bf->fullname, 0, 0, bf->mask << shift, bf->file);
 	} else {
-		printdef (bf->fullname, "MASK", 0, bf->mask << shift, bf->file);
-		printdef (bf->fullname, "SHIFT", 1, bf->low + shift, bf->file);
+		printdef (ctx, bf->fullname, "MASK", 0, bf->mask << shift, bf->file);
+		printdef (ctx, bf->fullname, "SHIFT", 1, bf->low + shift, bf->file);
 	}
-	printtypeinfo (&bf->typeinfo, bf->fullname, bf->low + shift, bf->file);
+	printtypeinfo (ctx, &bf->typeinfo, bf->fullname, bf->low + shift, bf->file);
+	ctx->srcsnum = srcsnum;
 }
 
-void printdelem (struct rnndelem *elem, uint64_t offset) {
+void printdelem (struct genctx *ctx, struct rnndelem *elem, uint64_t offset) {
 	if (elem->varinfo.dead)
 		return;
+	int srcsnum = ctx->srcsnum;
+	addsrc(ctx, elem->file);
+	addsrc(ctx, elem->srcfile);
+	addvarinfo(ctx, &elem->varinfo);
 	if (elem->length != 1)
-		ADDARRAY(strides, elem->stride);
+		ADDARRAY(ctx->strides, elem->stride);
 	if (elem->name) {
-		if (stridesnum) {
+		FILE *dst = findfout(ctx, elem->file);
+		if (!dst) {
+		} else if (ctx->stridesnum) {
 			int len, total;
-			FILE *dst = findfout(elem->file);
 			fprintf (dst, "#define %s(%n", elem->fullname, &total);
 			int i;
-			for (i = 0; i < stridesnum; i++) {
+			for (i = 0; i < ctx->stridesnum; i++) {
 				if (i) {
 					fprintf(dst, ", ");
 					total += 2;
@@ -166,51 +280,113 @@ void printdelem (struct rnndelem *elem, uint64_t offset) {
 			total++;
 			seekcol (dst, total, startcol-1);
 			fprintf (dst, "(0x%08"PRIx64"", offset + elem->offset);
-			for (i = 0; i < stridesnum; i++)
-				fprintf (dst, " + %#" PRIx64 "*(i%d)", strides[i], i);
+			for (i = 0; i < ctx->stridesnum; i++)
+				fprintf (dst, " + %#" PRIx64 "*(i%d)", ctx->strides[i], i);
 			fprintf (dst, ")\n");
 		} else
-			printdef (elem->fullname, 0, 0, offset + elem->offset, elem->file);
+			printdef (ctx, elem->fullname, 0, 0, offset + elem->offset, elem->file);
 		if (elem->stride)
-			printdef (elem->fullname, "ESIZE", 0, elem->stride, elem->file);
+			printdef (ctx, elem->fullname, "ESIZE", 0, elem->stride, elem->file);
 		if (elem->length != 1)
-			printdef (elem->fullname, "LEN", 0, elem->length, elem->file);
-		printtypeinfo (&elem->typeinfo, elem->fullname, 0, elem->file);
+			printdef (ctx, elem->fullname, "LEN", 0, elem->length, elem->file);
+		printtypeinfo (ctx, &elem->typeinfo, elem->fullname, 0, elem->file);
 	}
-	fprintf (findfout(elem->file), "\n");
+	FILE *dst = findfout(ctx, elem->file);
+	if (dst)
+		fprintf (dst, "\n");
 	int j;
 	for (j = 0; j < elem->subelemsnum; j++) {
-		printdelem(elem->subelems[j], offset + elem->offset);
+		printdelem(ctx, elem->subelems[j], offset + elem->offset);
 	}
-	if (elem->length != 1) stridesnum--;
+	if (elem->length != 1) ctx->stridesnum--;
+	ctx->srcsnum = srcsnum;
 }
 
-void print_file_info_(FILE *dst, struct stat* sb, struct tm* tm)
-{
-	char timestr[64];
-	strftime(timestr, sizeof(timestr), "%Y-%m-%d %H:%M:%S", tm);
-	fprintf(dst, "(%7Lu bytes, from %s)\n", (unsigned long long)sb->st_size, timestr);
+void printitem (struct genctx *ctx, struct item *item) {
+	int j;
+	ctx->item = *item;
+	ctx->srcsnum = 0;
+	if (item->type == ITEM_ENUM) {
+		struct rnnenum *en = db->enums[item->idx];
+		addsrc(ctx, en->file);
+		addvarinfo(ctx, &en->varinfo);
+		for (j = 0; j < en->valsnum; j++)
+			printvalue (ctx, en->vals[j], 0);
+	} else if (item->type == ITEM_BITSET) {
+		struct rnnbitset *bs = db->bitsets[item->idx];
+		addsrc(ctx, bs->file);
+		addvarinfo(ctx, &bs->varinfo);
+		for (j = 0; j < bs->bitfieldsnum; j++)
+			printbitfield (ctx, bs->bitfields[j], 0);
+	} else {
+		struct rnndomain *dom = db->domains[item->idx];
+		addsrc(ctx, dom->file);
+		addvarinfo(ctx, &dom->varinfo);
+		if (item->type == ITEM_DOMAIN_SIZE)
+			printdef (ctx, dom->fullname, "SIZE", 0, dom->size, dom->file);
+		else
+			printdelem(ctx, dom->subelems[item->sub], 0);
+	}
+}
+
+/* the dependency pass */
+void scan (void) {
+	struct genctx ctx = { -1 };
+	struct item item;
+	int i, j;
+	for (i = 0; i < db->enumsnum; i++) {
+		if (db->enums[i]->isinline)
+			continue;
+		item = (struct item){ ITEM_ENUM, i };
+		printitem(&ctx, &item);
+	}
+	for (i = 0; i < db->bitsetsnum; i++) {
+		if (db->bitsets[i]->isinline)
+			continue;
+		item = (struct item){ ITEM_BITSET, i };
+		printitem(&ctx, &item);
+	}
+	for (i = 0; i < db->domainsnum; i++) {
+		if (db->domains[i]->size) {
+			item = (struct item){ ITEM_DOMAIN_SIZE, i };
+			printitem(&ctx, &item);
+		}
+		for (j = 0; j < db->domains[i]->subelemsnum; j++) {
+			item = (struct item){ ITEM_DOMAIN_ELEM, i, j };
+			printitem(&ctx, &item);
+		}
+	}
+	/* the copyright notice goes into every header */
+	for (i = 0; i < foutsnum; i++) {
+		fouts[i].deps[i] = 1;
+		for (j = 0; j < db->copyright.filesnum; j++)
+			fouts[i].deps[findfile(&ctx, db->copyright.files[j])] = 1;
+	}
+	free(ctx.strides);
+	free(ctx.srcs);
 }
 
-void print_file_info(FILE *dst, const char* file)
+char *file_info(const char* file)
 {
 	struct stat sb;
 	struct tm tm;
+	char timestr[64];
 	stat(file, &sb);
 	gmtime_r(&sb.st_mtime, &tm);
-	print_file_info_(dst, &sb, &tm);
+	strftime(timestr, sizeof(timestr), "%Y-%m-%d %H:%M:%S", &tm);
+	return aprintf("(%7Lu bytes, from %s)\n", (unsigned long long)sb.st_size, timestr);
 }
 
-void printhead(struct fout f, struct rnndb *db) {
+void printhead(FILE *dst, struct fout *f) {
 	int i, j;
 	struct stat sb;
 	struct tm tm;
-	stat(f.name, &sb);
+	stat(f->name, &sb);
 	gmtime_r(&sb.st_mtime, &tm);
-	fprintf (f.file, "#ifndef %s\n", f.guard);
-	fprintf (f.file, "#define %s\n", f.guard);
-	fprintf (f.file, "\n");
-	fprintf(f.file,
+	fprintf (dst, "#ifndef %s\n", f->guard);
+	fprintf (dst, "#define %s\n", f->guard);
+	fprintf (dst, "\n");
+	fprintf(dst,
 		"/* Autogenerated file, DO NOT EDIT manually!\n"
 		"\n"
 		"This file was generated by the rules-ng-ng headergen tool in this git repository:\n"
@@ -221,66 +397,145 @@ void printhead(struct fout f, struct rnndb *db) {
 	unsigned maxlen = 0;
 	for(i = 0; i < db->filesnum; ++i) {
 		unsigned len = strlen(db->files[i]);
-		if(len > maxlen)
+		if(f->deps[i] && len > maxlen)
 			maxlen = len;
 	}
 	for(i = 0; i < db->filesnum; ++i) {
+		if (!f->deps[i])
+			continue;
 		unsigned len = strlen(db->files[i]);
-		fprintf(f.file, "- %s%*s ", db->files[i], maxlen - len, "");
-		print_file_info(f.file, db->files[i]);
+		fprintf(dst, "- %s%*s %s", db->files[i], maxlen - len, "", fileinfo[i]);
 	}
-	fprintf(f.file,
+	fprintf(dst,
 		"\n"
 		"Copyright (C) ");
 	if(db->copyright.firstyear && db->copyright.firstyear < (1900 + tm.tm_year))
-		fprintf(f.file, "%u-", db->copyright.firstyear);
-	fprintf(f.file, "%u", 1900 + tm.tm_year);
+		fprintf(dst, "%u-", db->copyright.firstyear);
+	fprintf(dst, "%u", 1900 + tm.tm_year);
 	if(db->copyright.authorsnum) {
-		fprintf(f.file, " by the following authors:");
+		fprintf(dst, " by the following authors:");
 		for(i = 0; i < db->copyright.authorsnum; ++i) {
-			fprintf(f.file, "\n- ");
+			fprintf(dst, "\n- ");
 			if(db->copyright.authors[i]->name)
-				fprintf(f.file, "%s", db->copyright.authors[i]->name);
+				fprintf(dst, "%s", db->copyright.authors[i]->name);
 			if(db->copyright.authors[i]->email)
-				fprintf(f.file, " <%s>", db->copyright.authors[i]->email);
+				fprintf(dst, " <%s>", db->copyright.authors[i]->email);
 			if(db->copyright.authors[i]->nicknamesnum) {
 				for(j = 0; j < db->copyright.authors[i]->nicknamesnum; ++j) {
-					fprintf(f.file, "%s%s", (j ? ", " : " ("), db->copyright.authors[i]->nicknames[j]);
+					fprintf(dst, "%s%s", (j ? ", " : " ("), db->copyright.authors[i]->nicknames[j]);
 				}
-				fprintf(f.file, ")");
+				fprintf(dst, ")");
 			}
 		}
 	}
-	fprintf(f.file, "\n");
+	fprintf(dst, "\n");
 	if(db->copyright.license)
-		fprintf(f.file, "\n%s\n", db->copyright.license);
-	fprintf(f.file, "*/\n\n\n");
+		fprintf(dst, "\n%s\n", db->copyright.license);
+	fprintf(dst, "*/\n\n\n");
+}
+
+/* returns 1 if the file exists and has exactly the given contents */
+int samecontents(const char *name, const char *buf, size_t len) {
+	FILE *f = fopen(name, "r");
+	struct stat sb;
+	int res = 0;
+	if (!f)
+		return 0;
+	if (!fstat(fileno(f), &sb) && sb.st_size == len) {
+		char *old = malloc(len + 1);
+		res = fread(old, 1, len + 1, f) == len && !memcmp(old, buf, len);
+		free(old);
+	}
+	fclose(f);
+	return res;
+}
+
+int genfile(int idx) {
+	struct fout *f = &fouts[idx];
+	struct genctx ctx = { idx };
+	char *buf;
+	size_t len;
+	int i;
+	ctx.file = open_memstream(&buf, &len);
+	printhead(ctx.file, f);
+	for (i = 0; i < f->itemsnum; i++)
+		printitem(&ctx, &f->items[i]);
+	fprintf (ctx.file, "\n#endif /* %s */\n", f->guard);
+	fclose(ctx.file);
+	free(ctx.strides);
+
+	char *dstname = aprintf("%s.h", f->name);
+	int res = 0;
+	if (!samecontents(dstname, buf, len)) {
+		FILE *dst = fopen(dstname, "w");
+		if (!dst || fwrite(buf, 1, len, dst) != len || fclose(dst)) {
+			perror(dstname);
+			res = 1;
+		}
+		f->changed = 1;
+	}
+	free(dstname);
+	free(buf);
+	return res;
+}
+
+pthread_mutex_t genlock = PTHREAD_MUTEX_INITIALIZER;
+int nextfile = 0;
+int generrors = 0;
+
+void *genworker(void *arg) {
+	while (1) {
+		pthread_mutex_lock(&genlock);
+		int idx = nextfile++;
+		pthread_mutex_unlock(&genlock);
+		if (idx >= foutsnum)
+			break;
+		if (genfile(idx)) {
+			pthread_mutex_lock(&genlock);
+			generrors++;
+			pthread_mutex_unlock(&genlock);
+		}
+	}
+	return 0;
+}
+
+void usage() {
+	fprintf(stderr, "Usage:\n"
+			"\theadergen [-j threads] [-v] database-file\n"
+			"Headers that would come out the same as the existing ones are left alone.\n"
+			"-j 0 (the default) uses one thread per CPU, -v lists the headers written.\n");
+	exit(1);
 }
 
 int main(int argc, char **argv) {
-	struct rnndb *db;
 	int i, j, ret;
+	int nthreads = 0;
+	int verbose = 0;
+	int c;
 
-	if (argc < 2) {
-		fprintf(stderr, "Usage:\n\theadergen database-file\n");
-		exit(1);
-	}
+	while ((c = getopt(argc, argv, "j:v")) != -1)
+		switch (c) {
+			case 'j':
+				nthreads = strtol(optarg, 0, 0);
+				break;
+			case 'v':
+				verbose = 1;
+				break;
+			default:
+				usage();
+		}
+	if (optind + 1 != argc)
+		usage();
 
 	rnn_init();
 	db = rnn_newdb();
-	rnn_parsefile (db, argv[1]);
+	rnn_parsefile (db, argv[optind]);
 	rnn_prepdb (db);
+	fileidx = symtab_new();
+	fileinfo = calloc(db->filesnum, sizeof *fileinfo);
 	for(i = 0; i < db->filesnum; ++i) {
-		char *dstname = malloc(strlen(db->files[i]) + 3);
 		char *pretty;
-		strcpy(dstname, db->files[i]);
-		strcat(dstname, ".h");
-		struct fout f = { db->files[i], fopen(dstname, "w") };
-		if (!f.file) {
-			perror(dstname);
-			exit(1);
-		}
-		free(dstname);
+		struct fout f = { db->files[i] };
 		pretty = strrchr(f.name, '/');
 		if (pretty)
 			pretty += 1;
@@ -292,36 +547,42 @@ int main(int argc, char **argv) {
 				f.guard[j] = toupper(f.guard[j]);
 			else
 				f.guard[j] = '_';
+		f.deps = calloc(db->filesnum, 1);
 		ADDARRAY(fouts, f);
-		printhead(f, db);
+		symtab_put(fileidx, f.name, 0, i);
+		fileinfo[i] = file_info(f.name);
 	}
 
-	for (i = 0; i < db->enumsnum; i++) {
-		if (db->enums[i]->isinline)
-			continue;
-		int j;
-		for (j = 0; j < db->enums[i]->valsnum; j++)
-			printvalue (db->enums[i]->vals[j], 0);
-	}
-	for (i = 0; i < db->bitsetsnum; i++) {
-		if (db->bitsets[i]->isinline)
-			continue;
-		int j;
-		for (j = 0; j < db->bitsets[i]->bitfieldsnum; j++)
-			printbitfield (db->bitsets[i]->bitfields[j], 0);
-	}
-	for (i = 0; i < db->domainsnum; i++) {
-		if (db->domains[i]->size)
-			printdef (db->domains[i]->fullname, "SIZE", 0, db->domains[i]->size, db->domains[i]->file);
-		int j;
-		for (j = 0; j < db->domains[i]->subelemsnum; j++) {
-			printdelem(db->domains[i]->subelems[j], 0);
+	scan();
+
+	if (nthreads <= 0)
+		nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (nthreads > MAX_THREADS)
+		nthreads = MAX_THREADS;
+	if (nthreads > foutsnum)
+		nthreads = foutsnum;
+	pthread_t threads[MAX_THREADS];
+	for (i = 1; i < nthreads; i++)
+		if (pthread_create(&threads[i], 0, genworker, 0)) {
+			perror("pthread_create");
+			exit(1);
 		}
+	genworker(0);
+	for (i = 1; i < nthreads; i++)
+		pthread_join(threads[i], 0);
+
+	for (i = 0; i < foutsnum; i++) {
+		if (verbose && fouts[i].changed)
+			printf("%s.h\n", fouts[i].name);
+		free(fouts[i].guard);
+		free(fouts[i].deps);
+		free(fouts[i].items);
+		free(fileinfo[i]);
 	}
-	for(i = 0; i < foutsnum; ++i) {
-		fprintf (fouts[i].file, "\n#endif /* %s */\n", fouts[i].guard);
-	}
-	ret = db->estatus;
+	free(fouts);
+	free(fileinfo);
+	symtab_del(fileidx);
+	ret = db->estatus || generrors;
 
 	rnn_freedb(db);
 	rnn_fini();
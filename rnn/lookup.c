@@ -27,11 +27,19 @@
 #define _GNU_SOURCE // for asprintf
 #include "rnn.h"
 #include "rnndec.h"
+#include "util.h"
+#include "symtab.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <inttypes.h>
 #include <string.h>
 #include <getopt.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 
 void usage()
 {
@@ -40,141 +48,362 @@ void usage()
 			"\tlookup [-f file.xml] [-a NVXX] -b bitset-name [-- -v attribute value] value\n"
 			"\tlookup [-f file.xml] [-a NVXX] [-d domain-name] [-- -v attribute value] address\n"
 			"\tlookup [-f file.xml] [-a NVXX] [-d domain-name] [-- -v attribute value] address value\n"
+			"\tlookup [-f file.xml] [-a NVXX] [-d domain-name] [-- -v attribute value] -i query-file\n"
+			"\tlookup [-f file.xml] [-a NVXX] [-d domain-name] [-- -v attribute value] -S socket-path\n"
+			"\n"
+			"With -i (- for stdin) or -S, the database is loaded once and queries are\n"
+			"read one per line, in the same form as the arguments above:\n"
+			"\t[-a NVXX] [-d domain-name|-e enum-name|-b bitset-name] [-v attribute value]... address [value]\n"
+			"Anything not given in a query defaults to the command line.  Each query\n"
+			"gets exactly one line of reply.  Empty lines and lines starting with #\n"
+			"are skipped.\n"
 		);
 	exit(2);
 }
 
+struct query {
+	int mode;
+	char *name;
+	char *variant;
+	uint64_t chip;
+	char **vars;	/* -v attribute/value pairs */
+	int varsnum;
+	int varsmax;
+	uint64_t reg;
+	uint64_t val;
+};
+
+/*
+ * Decoding contexts, one per distinct set of variants.  They're kept around
+ * for the whole run, so that queries with the same variants share the
+ * rnndec_varmatch results.
+ */
+
+static struct rnndb *db;
+static int colors = 1;
+static struct symtab *ctxnames;
+static struct rnndeccontext **ctxs;
+static int ctxsnum;
+static int ctxsmax;
+
+static struct rnndeccontext *getcontext(struct query *q) {
+	char *key;
+	int i, idx;
+	if (q->variant)
+		key = aprintf("%s", q->variant);
+	else
+		key = aprintf("%#"PRIx64, q->chip);
+	for (i = 0; i < q->varsnum; i += 2) {
+		char *nkey = aprintf("%s %s=%s", key, q->vars[i], q->vars[i+1]);
+		free(key);
+		key = nkey;
+	}
+	if (symtab_get(ctxnames, key, 0, &idx) != -1) {
+		free(key);
+		return ctxs[idx];
+	}
+	struct rnndeccontext *vc = rnndec_newcontext(db);
+	if (colors)
+		vc->colors = &envy_def_colors;
+	if (q->variant)
+		rnndec_varadd(vc, "chipset", q->variant);
+	else if (q->chip)
+		rnndec_varaddvalue(vc, "chipset", q->chip);
+	for (i = 0; i < q->varsnum; i += 2)
+		rnndec_varadd(vc, q->vars[i], q->vars[i+1]);
+	symtab_put(ctxnames, key, 0, ctxsnum);
+	ADDARRAY(ctxs, vc);
+	free(key);
+	return vc;
+}
+
+static void setchip(struct query *q, char *arg) {
+	q->chip = strtoull(arg, NULL, 16);
+	q->variant = q->chip ? NULL : arg;
+}
+
+/* errors go to err, so that a query server always answers with one line */
+static int doquery(struct query *q, FILE *out, FILE *err) {
+	struct rnndeccontext *vc = getcontext(q);
+	uint64_t reg = q->reg;
+	char *name = q->name;
+
+	if (q->mode == 'e') {
+		struct rnnenum *en = rnn_findenum (db, name);
+		if (en) {
+			int i;
+			int dec = 0;
+			for (i = 0; i < en->valsnum; i++)
+				if (en->vals[i]->valvalid && en->vals[i]->value == reg) {
+					fprintf (out, "%s\n", en->vals[i]->name);
+					dec = 1;
+					break;
+				}
+			if (!dec)
+				fprintf (out, "%#"PRIx64"\n", reg);
+			return 0;
+		} else {
+			fprintf(err, "Not an enum: '%s'\n", name);
+			return 1;
+		}
+	} else if (q->mode == 'b') {
+		struct rnnbitset *bs = rnn_findbitset (db, name);
+
+		if (bs) {
+			fprintf(out, "TODO\n");
+			return 0;
+		} else {
+			fprintf(err, "Not a bitset: '%s'\n", name);
+			return 1;
+		}
+
+	} else if (q->mode == 'd') {
+		struct rnndomain *dom = rnn_finddomain (db, name);
+
+		if (dom) {
+			struct rnndecaddrinfo *info = rnndec_decodeaddr(vc, dom, reg, 0);
+			if (info->typeinfo) {
+				char *res = rnndec_decodeval(vc, info->typeinfo, q->val, info->width);
+				fprintf (out, "%s => %s\n", info->name, res);
+				free(res);
+			} else {
+				fprintf (out, "%s\n", info->name);
+			}
+			rnndec_free_decaddrinfo(info);
+			return 0;
+		} else {
+			fprintf(err, "Not a domain: '%s'\n", name);
+			return 1;
+		}
+	}
+	return 1;
+}
+
+/* parses one query line on top of the defaults in q */
+static int parsequery(struct query *q, char *line, FILE *out) {
+	char *tok[64];
+	int toknum = 0;
+	int i, pos = 0;
+	char *save;
+	char *t;
+	for (t = strtok_r(line, " \t\r", &save); t; t = strtok_r(NULL, " \t\r", &save)) {
+		if (toknum == 64) {
+			fprintf(out, "Too many words in query\n");
+			return 1;
+		}
+		tok[toknum++] = t;
+	}
+	for (i = 0; i < toknum; i++) {
+		if (!strcmp(tok[i], "--")) {
+			continue;
+		} else if (tok[i][0] == '-' && tok[i][1] && !tok[i][2] && strchr("adebv", tok[i][1])) {
+			int need = tok[i][1] == 'v' ? 2 : 1;
+			if (i + need >= toknum) {
+				fprintf(out, "Missing argument to %s\n", tok[i]);
+				return 1;
+			}
+			switch (tok[i][1]) {
+				case 'a':
+					setchip(q, tok[i+1]);
+					break;
+				case 'v':
+					ADDARRAY(q->vars, tok[i+1]);
+					ADDARRAY(q->vars, tok[i+2]);
+					break;
+				default:
+					q->mode = tok[i][1];
+					q->name = tok[i+1];
+					break;
+			}
+			i += need;
+		} else if (pos < 2) {
+			char *end;
+			uint64_t v = strtoull(tok[i], &end, 16);
+			if (*end) {
+				fprintf(out, "Not a number: '%s'\n", tok[i]);
+				return 1;
+			}
+			if (pos++)
+				q->val = v;
+			else
+				q->reg = v;
+		} else {
+			fprintf(out, "Too many numbers in query\n");
+			return 1;
+		}
+	}
+	if (!pos) {
+		fprintf(out, "No address specified.\n");
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * Answers queries read from fd until EOF.  Input is taken in large chunks and
+ * the replies are only flushed before waiting for more, so that batch files
+ * and pipelined clients don't pay for a syscall per query.
+ */
+static void serve(struct query *def, int fd, FILE *out) {
+	int bufmax = 0x10000;
+	char *buf = malloc(bufmax);
+	int start = 0, end = 0;
+	int eof = 0;
+	while (!eof || start < end) {
+		char *nl = memchr(buf + start, '\n', end - start);
+		if (!nl && !eof) {
+			fflush(out);
+			memmove(buf, buf + start, end - start);
+			end -= start;
+			start = 0;
+			if (end == bufmax) {
+				bufmax *= 2;
+				buf = realloc(buf, bufmax);
+			}
+			ssize_t len = read(fd, buf + end, bufmax - end);
+			if (len <= 0)
+				eof = 1;
+			else
+				end += len;
+			continue;
+		}
+		if (!nl)
+			nl = buf + end++;
+		*nl = 0;
+		char *line = buf + start;
+		start = nl + 1 - buf;
+		line += strspn(line, " \t\r");
+		if (*line && *line != '#') {
+			struct query q = *def;
+			int i;
+			q.vars = NULL;
+			q.varsnum = q.varsmax = 0;
+			for (i = 0; i < def->varsnum; i++)
+				ADDARRAY(q.vars, def->vars[i]);
+			if (!parsequery(&q, line, out))
+				doquery(&q, out, out);
+			free(q.vars);
+		}
+	}
+	fflush(out);
+	free(buf);
+}
+
+/* answers one connection at a time, forever */
+static int listensocket(struct query *def, const char *path) {
+	struct sockaddr_un addr = { AF_UNIX };
+	struct stat st;
+	if (strlen(path) >= sizeof addr.sun_path) {
+		fprintf(stderr, "Socket path too long: %s\n", path);
+		return 1;
+	}
+	strcpy(addr.sun_path, path);
+	if (!stat(path, &st) && S_ISSOCK(st.st_mode))
+		unlink(path);
+	int sfd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sfd < 0 || bind(sfd, (struct sockaddr *)&addr, sizeof addr) || listen(sfd, 16)) {
+		perror(path);
+		return 1;
+	}
+	/* a client going away mid-reply shouldn't kill the server */
+	signal(SIGPIPE, SIG_IGN);
+	while (1) {
+		int fd = accept(sfd, NULL, NULL);
+		if (fd < 0) {
+			perror("accept");
+			continue;
+		}
+		FILE *out = fdopen(dup(fd), "w");
+		if (out) {
+			serve(def, fd, out);
+			fclose(out);
+		}
+		close(fd);
+	}
+}
+
 int main(int argc, char **argv) {
 	char *file = "root.xml";
-	char *name = "NV_MMIO";
-	char *variant = NULL;
-	int c, mode = 'd', chip = 0;
-	uint64_t reg, colors=1, val = 0;
-	struct rnndeccontext *vc;
+	char *input = NULL;
+	char *sockpath = NULL;
+	int c;
+	struct query def = { 'd', "NV_MMIO" };
 	int ret;
 
 	rnn_init();
 	if (argc < 2) {
 		usage();
 	}
-	struct rnndb *db = rnn_newdb();
+	db = rnn_newdb();
 
 	/* Arguments parsing */
-	while ((c = getopt (argc, argv, "f:a:d:e:b:c")) != -1) {
+	while ((c = getopt (argc, argv, "f:a:d:e:b:ci:S:")) != -1) {
 		switch (c) {
 			case 'f':
-				file = strdup(optarg);
+				file = optarg;
 				break;
 			case 'e':
-				mode = 'e';
-				name = strdup(optarg);
-				break;
 			case 'b':
-				mode = 'b';
-				name = strdup(optarg);
-				break;
 			case 'd':
-				mode = 'd';
-				name = strdup(optarg);
+				def.mode = c;
+				def.name = optarg;
 				break;
 			case 'a':
-				chip = strtoull(optarg, NULL, 16);
-				if (!chip)
-					variant = strdup(optarg);
-				else {
-					free(variant);
-					variant = NULL;
-				}
+				setchip(&def, optarg);
 				break;
 			case 'c':
 				colors = 0;
 				break;
+			case 'i':
+				input = optarg;
+				break;
+			case 'S':
+				sockpath = optarg;
+				break;
 			default: usage();
 		}
 	}
 
 	rnn_parsefile (db, file);
 	rnn_prepdb (db);
-	vc = rnndec_newcontext(db);
-	if(colors)
-		vc->colors = &envy_def_colors;
-
-	if (variant)
-		rnndec_varadd(vc, "chipset", variant);
-	else if (chip)
-		rnndec_varaddvalue(vc, "chipset",  chip);
+	ctxnames = symtab_new();
 
 	/* Parse extra arguments */
-	while (!strcmp (argv[optind], "-v")) {
-		rnndec_varadd(vc, argv[optind+1], argv[optind+2]);
+	while (optind + 2 < argc && !strcmp (argv[optind], "-v")) {
+		ADDARRAY(def.vars, argv[optind+1]);
+		ADDARRAY(def.vars, argv[optind+2]);
 		optind+=3;
 	}
 
-	if (optind >= argc) {
-		fprintf (stderr, "No address specified.\n");
-		return 1;
-	}
-
-	reg = strtoull(argv[optind], 0, 16);
-	if (optind + 1 < argc)
-		val = strtoull(argv[optind + 1], 0, 16);
-
-	if (mode == 'e') {
-		struct rnnenum *en = rnn_findenum (db, name);
-		if (en) {
-			int i;
-			int dec = 0;
-			for (i = 0; i < en->valsnum; i++)
-				if (en->vals[i]->valvalid && en->vals[i]->value == reg) {
-					printf ("%s\n", en->vals[i]->name);
-					dec = 1;
-					break;
-				}
-			if (!dec)
-				printf ("%#"PRIx64"\n", reg);
-
-			ret = 0;
-		} else {
-			fprintf(stderr, "Not an enum: '%s'\n", name);
-			ret = 1;
-		}
-	} else if (mode == 'b') {
-		struct rnnbitset *bs = rnn_findbitset (db, name);
-
-		if (bs) {
-			printf("TODO\n");
-			ret = 0;
-		} else {
-			fprintf(stderr, "Not a bitset: '%s'\n", name);
+	if (sockpath) {
+		ret = listensocket(&def, sockpath);
+	} else if (input) {
+		int fd = strcmp(input, "-") ? open(input, O_RDONLY) : 0;
+		if (fd < 0) {
+			perror(input);
 			ret = 1;
-		}
-
-	} else if (mode == 'd') {
-		struct rnndomain *dom = rnn_finddomain (db, name);
-
-		if (dom) {
-			struct rnndecaddrinfo *info = rnndec_decodeaddr(vc, dom, reg, 0);
-			if (info && info->typeinfo) {
-				char *res = rnndec_decodeval(vc, info->typeinfo, val, info->width);
-				printf ("%s => %s\n", info->name, res);
-				free(res);
-				rnndec_free_decaddrinfo(info);
-				ret = 0;
-			} else if (info) {
-				printf ("%s\n", info->name);
-				rnndec_free_decaddrinfo(info);
-				ret = 0;
-			} else
-				ret = 1;
 		} else {
-			fprintf(stderr, "Not a domain: '%s'\n", name);
-			ret = 1;
+			serve(&def, fd, stdout);
+			if (fd)
+				close(fd);
+			ret = 0;
 		}
+	} else if (optind >= argc) {
+		fprintf (stderr, "No address specified.\n");
+		return 1;
 	} else {
-		ret = 1;
+		def.reg = strtoull(argv[optind], 0, 16);
+		if (optind + 1 < argc)
+			def.val = strtoull(argv[optind + 1], 0, 16);
+		ret = doquery(&def, stdout, stderr);
 	}
 
-	rnndec_freecontext(vc);
+	int i;
+	for (i = 0; i < ctxsnum; i++)
+		rnndec_freecontext(ctxs[i]);
+	free(ctxs);
+	symtab_del(ctxnames);
+	free(def.vars);
 	rnn_freedb(db);
 	rnn_fini();
 
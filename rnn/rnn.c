@@ -35,9 +35,12 @@
 #include <limits.h>
 #include <ctype.h>
 #include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
 #include "rnn.h"
 #include "rnn_path.h"
 #include "util.h"
+#include "symtab.h"
 
 static char *catstr (char *a, char *b) {
 	if (!a)
@@ -53,6 +56,124 @@ static int strdiff (const char *a, const char *b) {
 	return strcmp (a, b);
 }
 
+/*
+ * Interning pool for immutable prepared data.  Variant arrays are mostly
+ * inherited unchanged or narrowed the same way many times over, and plenty
+ * of fullnames repeat across copies of groups, so each distinct blob is
+ * stored just once, packed into large chunks.
+ */
+
+struct rnnpoolent {
+	const void *data;
+	uint32_t len;
+	uint32_t hash;
+};
+
+struct rnnpool {
+	struct rnnpoolent *tab;
+	int tabsize;
+	int tabnum;
+	char **chunks;
+	int chunksnum;
+	int chunksmax;
+	char *chunkpos;
+	size_t chunkleft;
+};
+
+#define RNN_POOL_CHUNK 0x10000
+
+static uint32_t poolhash (const void *data, size_t len) {
+	const unsigned char *p = data;
+	uint32_t hash = 2166136261u;
+	size_t i;
+	/* a word at a time - variant arrays are long and mostly zero */
+	for (i = 0; i + 4 <= len; i += 4) {
+		uint32_t w;
+		memcpy(&w, p + i, 4);
+		hash = (hash ^ w) * 16777619u;
+		hash ^= hash >> 15;
+	}
+	for (; i < len; i++)
+		hash = (hash ^ p[i]) * 16777619u;
+	return hash;
+}
+
+static void poolgrow (struct rnnpool *pool) {
+	int oldsize = pool->tabsize;
+	struct rnnpoolent *old = pool->tab;
+	int i;
+	pool->tabsize = oldsize ? oldsize * 2 : 0x4000;
+	pool->tab = calloc(pool->tabsize, sizeof *pool->tab);
+	for (i = 0; i < oldsize; i++)
+		if (old[i].data) {
+			int j = old[i].hash & (pool->tabsize - 1);
+			while (pool->tab[j].data)
+				j = (j + 1) & (pool->tabsize - 1);
+			pool->tab[j] = old[i];
+		}
+	free(old);
+}
+
+static void *poolalloc (struct rnnpool *pool, size_t len) {
+	char *res;
+	/* keep everything int-aligned, variant arrays live here too */
+	len = (len + sizeof(int) - 1) & ~(sizeof(int) - 1);
+	if (len > RNN_POOL_CHUNK / 4) {
+		res = malloc(len);
+		ADDARRAY(pool->chunks, res);
+		return res;
+	}
+	if (len > pool->chunkleft) {
+		pool->chunkpos = malloc(RNN_POOL_CHUNK);
+		pool->chunkleft = RNN_POOL_CHUNK;
+		ADDARRAY(pool->chunks, pool->chunkpos);
+	}
+	res = pool->chunkpos;
+	pool->chunkpos += len;
+	pool->chunkleft -= len;
+	return res;
+}
+
+static void *poolintern (struct rnndb *db, const void *data, size_t len) {
+	struct rnnpool *pool = db->pool;
+	if (!pool)
+		pool = db->pool = calloc(sizeof *pool, 1);
+	if (pool->tabnum * 2 >= pool->tabsize)
+		poolgrow(pool);
+	uint32_t hash = poolhash(data, len);
+	int i = hash & (pool->tabsize - 1);
+	while (pool->tab[i].data) {
+		if (pool->tab[i].hash == hash && pool->tab[i].len == len && !memcmp(pool->tab[i].data, data, len))
+			return (void *)pool->tab[i].data;
+		i = (i + 1) & (pool->tabsize - 1);
+	}
+	void *res = poolalloc(pool, len);
+	memcpy(res, data, len);
+	pool->tab[i].data = res;
+	pool->tab[i].len = len;
+	pool->tab[i].hash = hash;
+	pool->tabnum++;
+	return res;
+}
+
+/* takes ownership of str, returns the interned copy */
+static char *poolstr (struct rnndb *db, char *str) {
+	char *res = poolintern(db, str, strlen(str) + 1);
+	free(str);
+	return res;
+}
+
+static void freepool (struct rnnpool *pool) {
+	int i;
+	if (!pool)
+		return;
+	for (i = 0; i < pool->chunksnum; i++)
+		free(pool->chunks[i]);
+	free(pool->chunks);
+	free(pool->tab);
+	free(pool);
+}
+
 void rnn_init() {
 	LIBXML_TEST_VERSION
 	xmlInitParser();
@@ -735,6 +856,7 @@ static void parsedomain(struct rnndb *db, char *file, xmlNode *node) {
 static void parsecopyright(struct rnndb *db, char *file, xmlNode *node) {
 	struct rnncopyright* copyright = &db->copyright;
 	xmlAttr *attr = node->properties;
+	ADDARRAY(copyright->files, file);
 	while (attr) {
 		if (!strcmp(attr->name, "year")) {
 			unsigned firstyear = getnumattrib(db, file, node->line, attr);
@@ -826,6 +948,7 @@ static void cleanupcopyright(struct rnncopyright *copyright) {
 		freeauthor(copyright->authors[i]);
 	free(copyright->authors);
 	free(copyright->license);
+	free(copyright->files);
 }
 
 static int trytop (struct rnndb *db, char *file, xmlNode *node) {
@@ -870,30 +993,132 @@ static int trytop (struct rnndb *db, char *file, xmlNode *node) {
 	return 0;
 }
 
-void rnn_parsefile (struct rnndb *db, char *file_orig) {
-	int i;
-	char *fname;
-	const char *rnn_path = getenv("RNN_PATH");
+/*
+ * Import scheduling
+ *
+ * The top-level rnn_parsefile call first finds the whole set of files
+ * reachable through <import> tags and parses them on a pool of threads,
+ * each worker scanning the documents it parsed for further imports.  Then
+ * the documents are merged into the database by walking them in the usual
+ * order, exactly as if every import was parsed at the point it appears.
+ * Import names and full paths are looked up in hash tables, so each name is
+ * searched for in RNN_PATH only once.
+ */
 
-	if (!rnn_path)
-		rnn_path = RNN_DEF_PATH;
+#define RNN_MAX_PARSE_THREADS 8
 
-	FILE *file = find_in_path(file_orig, rnn_path, &fname);
+struct rnnparsefile {
+	char *fname;
+	xmlDocPtr doc;
+	int parsed;
+	int merged;
+};
+
+struct rnnparse {
+	const char *path;
+	struct symtab *names;	/* import name -> file index, or -1 if not found */
+	struct symtab *fnames;	/* full path -> file index */
+	struct rnnparsefile *files;
+	int filesnum;
+	int filesmax;
+	int next;
+	int busy;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+};
+
+/* called with the lock held, drops it while searching RNN_PATH */
+static int resolvefile(struct rnnparse *p, const char *name) {
+	int res;
+	if (symtab_get(p->names, name, 0, &res) != -1)
+		return res;
+	char *fname;
+	pthread_mutex_unlock(&p->lock);
+	FILE *file = find_in_path(name, p->path, &fname);
+	if (file)
+		fclose(file);
+	pthread_mutex_lock(&p->lock);
+	if (symtab_get(p->names, name, 0, &res) != -1) {
+		if (file)
+			free(fname);
+		return res;
+	}
 	if (!file) {
+		res = -1;
+	} else if (symtab_get(p->fnames, fname, 0, &res) != -1) {
+		free(fname);
+	} else {
+		struct rnnparsefile pf = { fname };
+		res = p->filesnum;
+		ADDARRAY(p->files, pf);
+		symtab_put(p->fnames, fname, 0, res);
+		pthread_cond_broadcast(&p->cond);
+	}
+	symtab_put(p->names, name, 0, res);
+	return res;
+}
+
+static void findimports(struct rnnparse *p, xmlNode *node) {
+	for (; node; node = node->next) {
+		if (node->type != XML_ELEMENT_NODE)
+			continue;
+		if (!strcmp(node->name, "import")) {
+			xmlAttr *attr;
+			for (attr = node->properties; attr; attr = attr->next)
+				if (!strcmp(attr->name, "file") && attr->children && attr->children->type == XML_TEXT_NODE)
+					resolvefile(p, attr->children->content);
+		} else {
+			findimports(p, node->children);
+		}
+	}
+}
+
+static void *parseworker(void *arg) {
+	struct rnnparse *p = arg;
+	pthread_mutex_lock(&p->lock);
+	while (1) {
+		if (p->next < p->filesnum) {
+			int i = p->next++;
+			char *fname = p->files[i].fname;
+			p->busy++;
+			pthread_mutex_unlock(&p->lock);
+			xmlDocPtr doc = xmlParseFile(fname);
+			pthread_mutex_lock(&p->lock);
+			if (doc)
+				findimports(p, doc->children);
+			p->files[i].doc = doc;
+			p->files[i].parsed = 1;
+			p->busy--;
+			pthread_cond_broadcast(&p->cond);
+		} else if (!p->busy) {
+			break;
+		} else {
+			pthread_cond_wait(&p->cond, &p->lock);
+		}
+	}
+	pthread_mutex_unlock(&p->lock);
+	return 0;
+}
+
+static void mergefile (struct rnndb *db, char *file_orig) {
+	struct rnnparse *p = db->parse;
+	pthread_mutex_lock(&p->lock);
+	int idx = resolvefile(p, file_orig);
+	pthread_mutex_unlock(&p->lock);
+	if (idx == -1) {
 		fprintf (stderr, "%s: couldn't find database file. Please set the env var RNN_PATH.\n", file_orig);
 		db->estatus = 1;
 		return;
 	}
-	fclose(file);
-
-	for (i = 0; i < db->filesnum; i++)
-		if (!strcmp(db->files[i], fname)) {
-			free(fname);
-			return;
-		}
-		
+	struct rnnparsefile *pf = &p->files[idx];
+	if (pf->merged)
+		return;
+	pf->merged = 1;
+	char *fname = pf->fname;
+	/* the scan for imports should have found everything, but just in case */
+	xmlDocPtr doc = pf->parsed ? pf->doc : xmlParseFile(fname);
+	pf->doc = 0;
 	ADDARRAY(db->files, fname);
-	xmlDocPtr doc = xmlParseFile(fname);
 	if (!doc) {
 		fprintf (stderr, "%s: couldn't open database file. Please set the env var RNN_PATH.\n", fname);
 		db->estatus = 1;
@@ -921,13 +1146,69 @@ void rnn_parsefile (struct rnndb *db, char *file_orig) {
 	xmlFreeDoc(doc);
 }
 
+void rnn_parsefile (struct rnndb *db, char *file_orig) {
+	int i;
+	if (db->parse) {
+		/* an import */
+		mergefile(db, file_orig);
+		return;
+	}
+	struct rnnparse *p = calloc(sizeof *p, 1);
+	p->path = getenv("RNN_PATH");
+	if (!p->path)
+		p->path = RNN_DEF_PATH;
+	p->names = symtab_new();
+	p->fnames = symtab_new();
+	pthread_mutex_init(&p->lock, 0);
+	pthread_cond_init(&p->cond, 0);
+	/* files from earlier calls are done already */
+	for (i = 0; i < db->filesnum; i++) {
+		struct rnnparsefile pf = { db->files[i], 0, 1, 1 };
+		symtab_put(p->fnames, db->files[i], 0, p->filesnum);
+		ADDARRAY(p->files, pf);
+	}
+	p->next = p->filesnum;
+	pthread_mutex_lock(&p->lock);
+	resolvefile(p, file_orig);
+	pthread_mutex_unlock(&p->lock);
+	int nthreads = db->parsethreads;
+	if (nthreads <= 0) {
+		nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+		if (nthreads > RNN_MAX_PARSE_THREADS)
+			nthreads = RNN_MAX_PARSE_THREADS;
+	}
+	pthread_t *threads = calloc(nthreads, sizeof *threads);
+	int nstarted;
+	for (nstarted = 0; nstarted < nthreads - 1; nstarted++)
+		if (pthread_create(&threads[nstarted], 0, parseworker, p))
+			break;
+	parseworker(p);
+	for (i = 0; i < nstarted; i++)
+		pthread_join(threads[i], 0);
+	free(threads);
+	db->parse = p;
+	mergefile(db, file_orig);
+	db->parse = 0;
+	/* imports only reached from tags that turned out to be invalid */
+	for (i = 0; i < p->filesnum; i++)
+		if (!p->files[i].merged) {
+			xmlFreeDoc(p->files[i].doc);
+			free(p->files[i].fname);
+		}
+	free(p->files);
+	symtab_del(p->names);
+	symtab_del(p->fnames);
+	pthread_mutex_destroy(&p->lock);
+	pthread_cond_destroy(&p->cond);
+	free(p);
+}
+
 static struct rnnvarset *copyvarset (struct rnnvarset *varset);
 
 static void copyvarinfo (struct rnnvarinfo *dst, struct rnnvarinfo *src) {
 	int i;
 	memset(dst, 0, sizeof(*dst));
-	if (src->prefix)
-		dst->prefix = strdup(src->prefix);
+	dst->prefix = src->prefix;
 	if (src->prefixstr)
 		dst->prefixstr = strdup(src->prefixstr);
 	if (src->varsetstr)
@@ -994,6 +1275,7 @@ static struct rnndelem *copydelem (struct rnndelem *elem, char *file) {
 	res->stride = elem->stride;
 	copyvarinfo(&res->varinfo, &elem->varinfo);
 	res->file = file;
+	res->srcfile = elem->srcfile ? elem->srcfile : elem->file;
 	copytypeinfo(&res->typeinfo, &elem->typeinfo, file);
 	int i;
 	for (i = 0; i < elem->subelemsnum; i++)
@@ -1004,15 +1286,12 @@ static struct rnndelem *copydelem (struct rnndelem *elem, char *file) {
 static struct rnnvarset *copyvarset (struct rnnvarset *varset) {
 	struct rnnvarset *res = calloc(sizeof *res, 1);
 	res->venum = varset->venum;
-	res->variants = calloc(sizeof *res->variants, res->venum->valsnum);
-	int i;
-	for (i = 0; i < res->venum->valsnum; i++)
-		res->variants[i] = varset->variants[i];
+	/* interned, so sharing is fine - prepvarinfo never modifies it in place */
+	res->variants = varset->variants;
 	return res;
 }
 
 static void freevarset(struct rnnvarset *varset) {
-	free(varset->variants);
 	free(varset);
 }
 
@@ -1055,17 +1334,19 @@ static void prepvarinfo (struct rnndb *db, char *what, struct rnnvarinfo *vi, st
 		}
 		struct rnnvarset *vs = 0;
 		int nvars = varset->valsnum;
+		int *variants = malloc(nvars * sizeof *variants);
 		for (i = 0; i < vi->varsetsnum; i++)
 			if (vi->varsets[i]->venum == varset) {
 				vs = vi->varsets[i];
 				break;
 			}
-		if (!vs) {
+		if (vs) {
+			memcpy(variants, vs->variants, nvars * sizeof *variants);
+		} else {
 			vs = calloc (sizeof *vs, 1);
 			vs->venum = varset;
-			vs->variants = calloc(sizeof *vs->variants, nvars);
 			for (i = 0; i < nvars; i++)
-				vs->variants[i] = 1;
+				variants[i] = 1;
 			ADDARRAY(vi->varsets, vs);
 		}
 		while (1) {
@@ -1081,7 +1362,7 @@ static void prepvarinfo (struct rnndb *db, char *what, struct rnnvarinfo *vi, st
 			if (*split == ' ' || *split == 0) {
 				int idx = findvidx(db, varset, first);
 				if (idx != -1)
-					vs->variants[idx] |= 2;
+					variants[idx] |= 2;
 				vars = split;
 			} else {
 				char *end = split+1;
@@ -1101,7 +1382,7 @@ static void prepvarinfo (struct rnndb *db, char *what, struct rnnvarinfo *vi, st
 				}
 				if (idx1 != -1 && idx2 != -1)
 					for (i = idx1; i < idx2; i++)
-						vs->variants[i] |= 2;
+						variants[i] |= 2;
 				vars = end;
 				free(second);
 			}
@@ -1109,13 +1390,19 @@ static void prepvarinfo (struct rnndb *db, char *what, struct rnnvarinfo *vi, st
 		}
 		vi->dead = 1;
 		for (i = 0; i < nvars; i++) {
-			vs->variants[i] = (vs->variants[i] == 3);
-			if (vs->variants[i])
+			variants[i] = (variants[i] == 3);
+			if (variants[i])
 				vi->dead = 0;
 		}
+		/* narrowing an inherited varset often changes nothing */
+		if (!vs->variants || memcmp(vs->variants, variants, nvars * sizeof *variants))
+			vs->variants = poolintern(db, variants, nvars * sizeof *variants);
+		free(variants);
 	}
 	if (vi->dead)
 		return;
+	if (vi->varsetsnum)
+		vi->idx = ++db->varinfosnum;
 	if (vi->prefenum) {
 		struct rnnvarset *vs = 0;
 		for (i = 0; i < vi->varsetsnum; i++)
@@ -1126,17 +1413,16 @@ static void prepvarinfo (struct rnndb *db, char *what, struct rnnvarinfo *vi, st
 		if (vs) {
 			for (i = 0; i < vi->prefenum->valsnum; i++)
 				if (vs->variants[i]) {
-					vi->prefix = strdup(vi->prefenum->vals[i]->name);
+					vi->prefix = vi->prefenum->vals[i]->name;
 					return;
 				}
 		} else {
-			vi->prefix = strdup(vi->prefenum->vals[0]->name);
+			vi->prefix = vi->prefenum->vals[0]->name;
 		}
 	}
 }
 
 static void cleanupvarinfo(struct rnnvarinfo *vi) {
-	free(vi->prefix);
 	free(vi->prefixstr);
 	free(vi->varsetstr);
 	free(vi->variantsstr);
@@ -1148,20 +1434,47 @@ static void cleanupvarinfo(struct rnnvarinfo *vi) {
 }
 
 static void prepvalue(struct rnndb *db, struct rnnvalue *val, char *prefix, struct rnnvarinfo *parvi) {
-	val->fullname = catstr(prefix, val->name);
-	prepvarinfo (db, val->fullname, &val->varinfo, parvi);
-	if (val->varinfo.dead)
-		return;
-	if (val->varinfo.prefix) {
-		char *tmp = val->fullname;
-		val->fullname = catstr(val->varinfo.prefix, val->fullname);
+	char *fullname = catstr(prefix, val->name);
+	prepvarinfo (db, fullname, &val->varinfo, parvi);
+	if (!val->varinfo.dead && val->varinfo.prefix) {
+		char *tmp = fullname;
+		fullname = catstr(val->varinfo.prefix, fullname);
 		free(tmp);
 	}
+	val->fullname = poolstr(db, fullname);
+}
+
+static void prepvalhash(struct rnnvalhash *vh, struct rnnvalue **vals, int valsnum) {
+	int i, cnt = 0;
+	for (i = 0; i < valsnum; i++)
+		if (vals[i]->valvalid)
+			cnt++;
+	if (!cnt)
+		return;
+	vh->size = 1;
+	while (vh->size < cnt * 2)
+		vh->size <<= 1;
+	vh->heads = malloc(vh->size * sizeof *vh->heads);
+	vh->next = malloc(valsnum * sizeof *vh->next);
+	for (i = 0; i < vh->size; i++)
+		vh->heads[i] = -1;
+	for (i = valsnum - 1; i >= 0; i--) {
+		vh->next[i] = -1;
+		if (!vals[i]->valvalid)
+			continue;
+		int *head = &vh->heads[rnn_valhash_bucket(vh, vals[i]->value)];
+		vh->next[i] = *head;
+		*head = i;
+	}
+}
+
+static void cleanupvalhash(struct rnnvalhash *vh) {
+	free(vh->heads);
+	free(vh->next);
 }
 
 static void freevalue(struct rnnvalue *val) {
 	cleanupvarinfo(&val->varinfo);
-	free(val->fullname);
 	free(val->name);
 	free(val);
 }
@@ -1237,6 +1550,8 @@ static void preptypeinfo(struct rnndb *db, struct rnntypeinfo *ti, char *prefix,
 		prepbitfield(db,  ti->bitfields[i], prefix, vi);
 	for (i = 0; i < ti->valsnum; i++)
 		prepvalue(db, ti->vals[i], prefix, vi);
+	if (ti->type == RNN_TTYPE_INLINE_ENUM)
+		prepvalhash(&ti->valhash, ti->vals, ti->valsnum);
 }
 
 static void freebitfield(struct rnnbitfield *bf);
@@ -1250,6 +1565,7 @@ static void cleanuptypeinfo(struct rnntypeinfo *ti) {
 	for (i = 0; i < ti->valsnum; i++)
 		freevalue(ti->vals[i]);
 	free(ti->vals);
+	cleanupvalhash(&ti->valhash);
 
 	free(ti->name);
 }
@@ -1257,24 +1573,24 @@ static void cleanuptypeinfo(struct rnntypeinfo *ti) {
 static void prepbitfield(struct rnndb *db, struct rnnbitfield *bf, char *prefix, struct rnnvarinfo *parvi) {
 	bf->fullname = catstr(prefix, bf->name);
 	prepvarinfo (db, bf->fullname, &bf->varinfo, parvi);
-	if (bf->varinfo.dead)
-		return;
-	if (bf->high == 63)
-		bf->mask = - (1ULL<<bf->low);
-	else
-		bf->mask = (1ULL<<(bf->high+1)) - (1ULL<<bf->low);
-	preptypeinfo(db, &bf->typeinfo, bf->fullname, &bf->varinfo, bf->high - bf->low + 1, bf->file);
-	if (bf->varinfo.prefix) {
-		char *tmp = bf->fullname;
-		bf->fullname = catstr(bf->varinfo.prefix, bf->fullname);
-		free(tmp);
+	if (!bf->varinfo.dead) {
+		if (bf->high == 63)
+			bf->mask = - (1ULL<<bf->low);
+		else
+			bf->mask = (1ULL<<(bf->high+1)) - (1ULL<<bf->low);
+		preptypeinfo(db, &bf->typeinfo, bf->fullname, &bf->varinfo, bf->high - bf->low + 1, bf->file);
+		if (bf->varinfo.prefix) {
+			char *tmp = bf->fullname;
+			bf->fullname = catstr(bf->varinfo.prefix, bf->fullname);
+			free(tmp);
+		}
 	}
+	bf->fullname = poolstr(db, bf->fullname);
 }
 
 static void freebitfield(struct rnnbitfield *bf) {
 	cleanupvarinfo (&bf->varinfo);
 	cleanuptypeinfo(&bf->typeinfo);
-	free(bf->fullname);
 	free(bf->name);
 	free(bf);
 }
@@ -1303,26 +1619,28 @@ static void prepdelem(struct rnndb *db, struct rnndelem *elem, char *prefix, str
 	if (elem->name)
 		elem->fullname = catstr(prefix, elem->name);
 	prepvarinfo (db, elem->fullname?elem->fullname:prefix, &elem->varinfo, parvi);
-	if (elem->varinfo.dead)
-		return;
-	if (elem->length != 1 && !elem->stride) {
-		if (elem->type != RNN_ETYPE_REG) {
-			fprintf (stderr, "%s has non-1 length, but no stride!\n", elem->fullname);
-			db->estatus = 1;
-		} else {
-			elem->stride = elem->width/width;
+	if (!elem->varinfo.dead) {
+		if (elem->length != 1 && !elem->stride) {
+			if (elem->type != RNN_ETYPE_REG) {
+				fprintf (stderr, "%s has non-1 length, but no stride!\n", elem->fullname);
+				db->estatus = 1;
+			} else {
+				elem->stride = elem->width/width;
+			}
 		}
-	}
-	preptypeinfo(db, &elem->typeinfo, elem->name?elem->fullname:prefix, &elem->varinfo, elem->width, elem->file);
+		preptypeinfo(db, &elem->typeinfo, elem->name?elem->fullname:prefix, &elem->varinfo, elem->width, elem->file);
 
-	int i;
-	for (i = 0; i < elem->subelemsnum; i++)
-		prepdelem(db,  elem->subelems[i], elem->name?elem->fullname:prefix, &elem->varinfo, width);
-	if (elem->varinfo.prefix && elem->name) {
-		char *tmp = elem->fullname;
-		elem->fullname = catstr(elem->varinfo.prefix, elem->fullname);
-		free(tmp);
+		int i;
+		for (i = 0; i < elem->subelemsnum; i++)
+			prepdelem(db,  elem->subelems[i], elem->name?elem->fullname:prefix, &elem->varinfo, width);
+		if (elem->varinfo.prefix && elem->name) {
+			char *tmp = elem->fullname;
+			elem->fullname = catstr(elem->varinfo.prefix, elem->fullname);
+			free(tmp);
+		}
 	}
+	if (elem->fullname)
+		elem->fullname = poolstr(db, elem->fullname);
 }
 
 static void freedelem(struct rnndelem *elem) {
@@ -1333,7 +1651,6 @@ static void freedelem(struct rnndelem *elem) {
 		freedelem(elem->subelems[i]);
 	free(elem->subelems);
 
-	free(elem->fullname);
 	free(elem->name);
 	free(elem);
 }
@@ -1343,7 +1660,7 @@ static void prepdomain(struct rnndb *db, struct rnndomain *dom) {
 	int i;
 	for (i = 0; i < dom->subelemsnum; i++)
 		prepdelem(db, dom->subelems[i], dom->bare?0:dom->name, &dom->varinfo, dom->width);
-	dom->fullname = catstr(dom->varinfo.prefix, dom->name);
+	dom->fullname = poolstr(db, catstr(dom->varinfo.prefix, dom->name));
 }
 
 static void freedomain(struct rnndomain *dom) {
@@ -1353,7 +1670,6 @@ static void freedomain(struct rnndomain *dom) {
 		freedelem(dom->subelems[i]);
 	free(dom->subelems);
 
-	free(dom->fullname);
 	free(dom->name);
 	free(dom);
 }
@@ -1367,7 +1683,8 @@ static void prepenum(struct rnndb *db, struct rnnenum *en) {
 		return;
 	for (i = 0; i < en->valsnum; i++)
 		prepvalue(db, en->vals[i], en->bare?0:en->name, &en->varinfo);
-	en->fullname = catstr(en->varinfo.prefix, en->name);
+	prepvalhash(&en->valhash, en->vals, en->valsnum);
+	en->fullname = poolstr(db, catstr(en->varinfo.prefix, en->name));
 	en->prepared = 1;
 }
 
@@ -1378,8 +1695,8 @@ static void freeenum(struct rnnenum *en) {
 	for (i = 0; i < en->valsnum; i++)
 		freevalue(en->vals[i]);
 	free(en->vals);
+	cleanupvalhash(&en->valhash);
 
-	free(en->fullname);
 	free(en->name);
 	free(en);
 }
@@ -1391,7 +1708,7 @@ static void prepbitset(struct rnndb *db, struct rnnbitset *bs) {
 		return;
 	for (i = 0; i < bs->bitfieldsnum; i++)
 		prepbitfield(db, bs->bitfields[i], bs->bare?0:bs->name, &bs->varinfo);
-	bs->fullname = catstr(bs->varinfo.prefix, bs->name);
+	bs->fullname = poolstr(db, catstr(bs->varinfo.prefix, bs->name));
 }
 
 static void freebitset(struct rnnbitset *bs) {
@@ -1400,7 +1717,6 @@ static void freebitset(struct rnnbitset *bs) {
 	for (i = 0; i < bs->bitfieldsnum; i++)
 		freebitfield(bs->bitfields[i]);
 	free(bs->bitfields);
-	free(bs->fullname);
 	free(bs->name);
 	free(bs);
 }
@@ -1498,5 +1814,6 @@ void rnn_freedb (struct rnndb *db) {
 		free(db->files[i]);
 	free(db->files);
 
+	freepool(db->pool);
 	free(db);
 }
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2016 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "rnn.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Measures database startup time: loads the given file (and everything it
+ * imports) repeatedly, reporting the time taken by rnn_parsefile and
+ * rnn_prepdb.
+ */
+
+void usage()
+{
+	fprintf (stderr, "Usage:\n"
+			"\trnnbench [-n repeats] [-j threads] [file.xml]\n"
+			"-j 0 (the default) uses one thread per CPU.\n"
+		);
+	exit(2);
+}
+
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv) {
+	int repeats = 20;
+	int nthreads = 0;
+	int c, i;
+	while ((c = getopt (argc, argv, "n:j:")) != -1)
+		switch (c) {
+			case 'n':
+				repeats = strtol(optarg, 0, 0);
+				break;
+			case 'j':
+				nthreads = strtol(optarg, 0, 0);
+				break;
+			default:
+				usage();
+		}
+	if (repeats < 1 || optind + 1 < argc)
+		usage();
+	char *file = optind < argc ? argv[optind] : "root.xml";
+	rnn_init();
+	double tparse = 0, tprep = 0, best = 0;
+	int files = 0, estatus = 0;
+	for (i = 0; i < repeats; i++) {
+		double t0 = now();
+		struct rnndb *db = rnn_newdb();
+		db->parsethreads = nthreads;
+		rnn_parsefile (db, file);
+		double t1 = now();
+		rnn_prepdb (db);
+		double t2 = now();
+		tparse += t1 - t0;
+		tprep += t2 - t1;
+		if (!i || t2 - t0 < best)
+			best = t2 - t0;
+		files = db->filesnum;
+		estatus |= db->estatus;
+		rnn_freedb(db);
+	}
+	printf ("%s: %d files, parse %.2fms, prep %.2fms, total %.2fms (best %.2fms) per load\n", file, files,
+			tparse * 1e3 / repeats, tprep * 1e3 / repeats, (tparse + tprep) * 1e3 / repeats, best * 1e3);
+	rnn_fini();
+	return estatus;
+}
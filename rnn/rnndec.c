@@ -29,23 +29,63 @@
 #include <string.h>
 #include <stdlib.h>
 #include <inttypes.h>
+#include <stdarg.h>
 #include "util.h"
 
 struct rnndeccontext *rnndec_newcontext(struct rnndb *db) {
 	struct rnndeccontext *res = calloc (sizeof *res, 1);
 	res->db = db;
 	res->colors = &envy_null_colors;
+	res->vargen = 1;
 	return res;
 }
 
+/*
+ * Decoded addresses, direct-mapped by domain, address and direction.  An
+ * entry is only valid for the vargen it was decoded under.
+ */
+#define RNNDEC_ADDRCACHE_SIZE 0x1000
+
+struct rnndecaddrcache {
+	struct rnndomain *domain;
+	uint64_t addr;
+	int write;
+	uint32_t vargen;
+	const struct envy_colors *colors;
+	struct rnndecaddrinfo *info;
+};
+
+static void flushaddrcache(struct rnndeccontext *ctx) {
+	int i;
+	if (!ctx->addrcache)
+		return;
+	for (i = 0; i < RNNDEC_ADDRCACHE_SIZE; i++)
+		if (ctx->addrcache[i].info)
+			rnndec_free_decaddrinfo(ctx->addrcache[i].info);
+	memset(ctx->addrcache, 0, RNNDEC_ADDRCACHE_SIZE * sizeof *ctx->addrcache);
+}
+
 void rnndec_freecontext(struct rnndeccontext *ctx) {
 	int i;
 	for (i = 0; i < ctx->varsnum; ++i)
 		free(ctx->vars[i]);
 	free(ctx->vars);
+	free(ctx->varmemo);
+	flushaddrcache(ctx);
+	free(ctx->addrcache);
 	free(ctx);
 }
 
+/* forgets all rnndec_varmatch and decoded address results, called when the variants change */
+static void varchanged(struct rnndeccontext *ctx) {
+	ctx->vargen++;
+	if (ctx->vargen >= 1u << 31) {
+		memset(ctx->varmemo, 0, ctx->varmemonum * sizeof *ctx->varmemo);
+		flushaddrcache(ctx);
+		ctx->vargen = 1;
+	}
+}
+
 int rnndec_varadd(struct rnndeccontext *ctx, char *varset, char *variant) {
 	struct rnnenum *en = rnn_findenum(ctx->db, varset);
 	if (!en) {
@@ -59,6 +99,7 @@ int rnndec_varadd(struct rnndeccontext *ctx, char *varset, char *variant) {
 			ci->en = en;
 			ci->variant = i;
 			ADDARRAY(ctx->vars, ci);
+			varchanged(ctx);
 			return 1;
 		}
 	fprintf (stderr, "Variant %s doesn't exist in enum %s!\n", variant, varset);
@@ -79,6 +120,7 @@ int rnndec_varaddvalue(struct rnndeccontext *ctx, char *varset, uint64_t value)
 			ci->en = en;
 			ci->variant = i;
 			ADDARRAY(ctx->vars, ci);
+			varchanged(ctx);
 			return 1;
 		}
 
@@ -97,7 +139,10 @@ int rnndec_varmod(struct rnndeccontext *ctx, char *varset, char *variant) {
 		if (!strcasecmp(en->vals[i]->name, variant)) {
 			struct rnndecvariant *ci = NULL;
 			FINDARRAY(ctx->vars, ci, ci->en == en);
-			ci->variant = i;
+			if (ci->variant != i) {
+				ci->variant = i;
+				varchanged(ctx);
+			}
 			return 1;
 		}
 	fprintf (stderr, "Variant %s doesn't exist in enum %s!\n", variant, varset);
@@ -105,9 +150,7 @@ int rnndec_varmod(struct rnndeccontext *ctx, char *varset, char *variant) {
 }
 
 
-int rnndec_varmatch(struct rnndeccontext *ctx, struct rnnvarinfo *vi) {
-	if (vi->dead)
-		return 0;
+static int varmatch(struct rnndeccontext *ctx, struct rnnvarinfo *vi) {
 	int i;
 	for (i = 0; i < vi->varsetsnum; i++) {
 		int j;
@@ -124,6 +167,31 @@ int rnndec_varmatch(struct rnndeccontext *ctx, struct rnnvarinfo *vi) {
 	return 1;
 }
 
+/*
+ * The answer only changes with the variants, so it's remembered per varinfo
+ * until the next rnndec_varadd/varaddvalue/varmod.
+ */
+int rnndec_varmatch(struct rnndeccontext *ctx, struct rnnvarinfo *vi) {
+	if (vi->dead)
+		return 0;
+	if (!vi->varsetsnum)
+		return 1;
+	if (!vi->idx)
+		return varmatch(ctx, vi);
+	if (vi->idx >= ctx->varmemonum) {
+		int num = ctx->db->varinfosnum + 1;
+		if (vi->idx >= num)
+			return varmatch(ctx, vi);
+		ctx->varmemo = realloc(ctx->varmemo, num * sizeof *ctx->varmemo);
+		memset(ctx->varmemo + ctx->varmemonum, 0, (num - ctx->varmemonum) * sizeof *ctx->varmemo);
+		ctx->varmemonum = num;
+	}
+	uint32_t *memo = &ctx->varmemo[vi->idx];
+	if (*memo >> 1 != ctx->vargen)
+		*memo = ctx->vargen << 1 | varmatch(ctx, vi);
+	return *memo & 1;
+}
+
 /* see https://en.wikipedia.org/wiki/Half-precision_floating-point_format */
 static uint32_t float16i(uint16_t val)
 {
@@ -156,15 +224,59 @@ static float float16(uint16_t val)
 	return u.f;
 }
 
-char *rnndec_decodeval(struct rnndeccontext *ctx, struct rnntypeinfo *ti, uint64_t value, int width) {
-	char *res = 0;
+/*
+ * Values are formatted into a single growing buffer, with bitfields
+ * recursing into it, instead of a fresh string per field.
+ */
+
+struct decbuf {
+	char *str;
+	size_t len;
+	size_t max;
+};
+
+static void bufprintf(struct decbuf *buf, const char *fmt, ...) {
+	va_list va;
+	int len;
+	va_start(va, fmt);
+	len = vsnprintf(buf->str + buf->len, buf->max - buf->len, fmt, va);
+	va_end(va);
+	if (buf->len + len >= buf->max) {
+		while (buf->len + len >= buf->max)
+			buf->max = buf->max ? buf->max * 2 : 64;
+		buf->str = realloc(buf->str, buf->max);
+		va_start(va, fmt);
+		vsnprintf(buf->str + buf->len, buf->max - buf->len, fmt, va);
+		va_end(va);
+	}
+	buf->len += len;
+}
+
+static struct rnnvalue *findval(struct rnndeccontext *ctx, struct rnnvalue **vals, int valsnum, struct rnnvalhash *vh, uint64_t value) {
+	int i;
+	if (!vh->heads) {
+		/* not indexed: no valid values, or a db that wasn't prepared */
+		for (i = 0; i < valsnum; i++)
+			if (rnndec_varmatch(ctx, &vals[i]->varinfo) && vals[i]->valvalid && vals[i]->value == value)
+				return vals[i];
+		return 0;
+	}
+	for (i = vh->heads[rnn_valhash_bucket(vh, value)]; i != -1; i = vh->next[i])
+		if (vals[i]->value == value && rnndec_varmatch(ctx, &vals[i]->varinfo))
+			return vals[i];
+	return 0;
+}
+
+static void decodeval(struct rnndeccontext *ctx, struct decbuf *buf, struct rnntypeinfo *ti, uint64_t value, int width) {
 	int i;
 	struct rnnvalue **vals;
 	int valsnum;
+	struct rnnvalhash *vh;
+	struct rnnvalue *val;
 	struct rnnbitfield **bitfields;
 	int bitfieldsnum;
-	char *tmp;
 	uint64_t mask;
+	int first;
 	if (!ti)
 		goto failhex;
 	if (ti->shr) value <<= ti->shr;
@@ -173,17 +285,18 @@ char *rnndec_decodeval(struct rnndeccontext *ctx, struct rnntypeinfo *ti, uint64
 		case RNN_TTYPE_ENUM:
 			vals = ti->eenum->vals;
 			valsnum = ti->eenum->valsnum;
+			vh = &ti->eenum->valhash;
 			goto doenum;
 		case RNN_TTYPE_INLINE_ENUM:
 			vals = ti->vals;
 			valsnum = ti->valsnum;
+			vh = &ti->valhash;
 			goto doenum;
 		doenum:
-			for (i = 0; i < valsnum; i++)
-				if (rnndec_varmatch(ctx, &vals[i]->varinfo) && vals[i]->valvalid && vals[i]->value == value) {
-					asprintf (&res, "%s%s%s", ctx->colors->eval, vals[i]->name, ctx->colors->reset);
-					return res;
-				}
+			if ((val = findval(ctx, vals, valsnum, vh, value))) {
+				bufprintf (buf, "%s%s%s", ctx->colors->eval, val->name, ctx->colors->reset);
+				return;
+			}
 			goto failhex;
 		case RNN_TTYPE_BITSET:
 			bitfields = ti->ebitset->bitfields;
@@ -195,6 +308,8 @@ char *rnndec_decodeval(struct rnndeccontext *ctx, struct rnntypeinfo *ti, uint64
 			goto dobitset;
 		dobitset:
 			mask = 0;
+			first = 1;
+			bufprintf (buf, "{ ");
 			for (i = 0; i < bitfieldsnum; i++) {
 				if (!rnndec_varmatch(ctx, &bitfields[i]->varinfo))
 					continue;
@@ -204,100 +319,89 @@ char *rnndec_decodeval(struct rnndeccontext *ctx, struct rnntypeinfo *ti, uint64
 					if (sval == 0)
 						continue;
 					else if (sval == 1) {
-						if (!res)
-							asprintf (&res, "%s%s%s", ctx->colors->mod, bitfields[i]->name, ctx->colors->reset);
-						else {
-							asprintf (&tmp, "%s | %s%s%s", res, ctx->colors->mod, bitfields[i]->name, ctx->colors->reset);
-							free(res);
-							res = tmp;
-						}
+						bufprintf (buf, "%s%s%s%s", first ? "" : " | ", ctx->colors->mod, bitfields[i]->name, ctx->colors->reset);
+						first = 0;
 						continue;
 					}
 				}
-				char *subval = rnndec_decodeval(ctx, &bitfields[i]->typeinfo, sval, bitfields[i]->high - bitfields[i]->low + 1);
-				if (!res)
-					asprintf (&res, "%s%s%s = %s", ctx->colors->rname, bitfields[i]->name, ctx->colors->reset, subval);
-				else {
-					asprintf (&tmp, "%s | %s%s%s = %s", res, ctx->colors->rname, bitfields[i]->name, ctx->colors->reset, subval);
-					free(res);
-					res = tmp;
-				}
-				free(subval);
+				bufprintf (buf, "%s%s%s%s = ", first ? "" : " | ", ctx->colors->rname, bitfields[i]->name, ctx->colors->reset);
+				first = 0;
+				decodeval(ctx, buf, &bitfields[i]->typeinfo, sval, bitfields[i]->high - bitfields[i]->low + 1);
 			}
 			if (value & ~mask) {
-				if (!res)
-					asprintf (&res, "%s%#"PRIx64"%s", ctx->colors->err, value & ~mask, ctx->colors->reset);
-				else {
-					asprintf (&tmp, "%s | %s%#"PRIx64"%s", res, ctx->colors->err, value & ~mask, ctx->colors->reset);
-					free(res);
-					res = tmp;
-				}
+				bufprintf (buf, "%s%s%#"PRIx64"%s", first ? "" : " | ", ctx->colors->err, value & ~mask, ctx->colors->reset);
+				first = 0;
 			}
-			if (!res)
-				asprintf (&res, "%s0%s", ctx->colors->num, ctx->colors->reset);
-			asprintf (&tmp, "{ %s }", res);
-			free(res);
-			return tmp;
+			if (first)
+				bufprintf (buf, "%s0%s", ctx->colors->num, ctx->colors->reset);
+			bufprintf (buf, " }");
+			return;
 		case RNN_TTYPE_SPECTYPE:
-			return rnndec_decodeval(ctx, &ti->spectype->typeinfo, value, width);
+			decodeval(ctx, buf, &ti->spectype->typeinfo, value, width);
+			return;
 		case RNN_TTYPE_HEX:
-			asprintf (&res, "%s%#"PRIx64"%s", ctx->colors->num, value, ctx->colors->reset);
-			return res;
+			bufprintf (buf, "%s%#"PRIx64"%s", ctx->colors->num, value, ctx->colors->reset);
+			return;
 		case RNN_TTYPE_FIXED:
 			if (value & UINT64_C(1) << (width-1)) {
-				asprintf (&res, "%s-%lf%s (%08"PRIx64")", ctx->colors->num,
+				bufprintf (buf, "%s-%lf%s (%08"PRIx64")", ctx->colors->num,
 						((double)((UINT64_C(1) << width) - value)) / ((double)(1 << ti->radix)),
 						ctx->colors->reset, value);
-				return res;
+				return;
 			}
 			/* fallthrough */
 		case RNN_TTYPE_UFIXED:
-			asprintf (&res, "%s%lf%s (%08"PRIx64")", ctx->colors->num,
+			bufprintf (buf, "%s%lf%s (%08"PRIx64")", ctx->colors->num,
 					((double)value) / ((double)(1 << ti->radix)),
 					ctx->colors->reset, value);
-			return res;
+			return;
 		case RNN_TTYPE_UINT:
-			asprintf (&res, "%s%"PRIu64"%s", ctx->colors->num, value, ctx->colors->reset);
-			return res;
+			bufprintf (buf, "%s%"PRIu64"%s", ctx->colors->num, value, ctx->colors->reset);
+			return;
 		case RNN_TTYPE_INT:
 			if (value & UINT64_C(1) << (width-1))
-				asprintf (&res, "%s-%"PRIi64"%s", ctx->colors->num, (UINT64_C(1) << width) - value, ctx->colors->reset);
+				bufprintf (buf, "%s-%"PRIi64"%s", ctx->colors->num, (UINT64_C(1) << width) - value, ctx->colors->reset);
 			else
-				asprintf (&res, "%s%"PRIi64"%s", ctx->colors->num, value, ctx->colors->reset);
-			return res;
+				bufprintf (buf, "%s%"PRIi64"%s", ctx->colors->num, value, ctx->colors->reset);
+			return;
 		case RNN_TTYPE_BOOLEAN:
 			if (value == 0) {
-				asprintf (&res, "%sFALSE%s", ctx->colors->eval, ctx->colors->reset);
-				return res;
+				bufprintf (buf, "%sFALSE%s", ctx->colors->eval, ctx->colors->reset);
+				return;
 			} else if (value == 1) {
-				asprintf (&res, "%sTRUE%s", ctx->colors->eval, ctx->colors->reset);
-				return res;
+				bufprintf (buf, "%sTRUE%s", ctx->colors->eval, ctx->colors->reset);
+				return;
 			}
 		case RNN_TTYPE_FLOAT: {
 			union { uint64_t i; float f; double d; } val;
 			val.i = value;
 			if (width == 64)
-				asprintf(&res, "%s%f%s", ctx->colors->num,
+				bufprintf(buf, "%s%f%s", ctx->colors->num,
 					val.d, ctx->colors->reset);
 			else if (width == 32)
-				asprintf(&res, "%s%f%s", ctx->colors->num,
+				bufprintf(buf, "%s%f%s", ctx->colors->num,
 					val.f, ctx->colors->reset);
 			else if (width == 16)
-				asprintf(&res, "%s%f%s", ctx->colors->num,
+				bufprintf(buf, "%s%f%s", ctx->colors->num,
 					float16(value), ctx->colors->reset);
 			else
 				goto failhex;
 
-			return res;
+			return;
 		}
 		failhex:
 		default:
-			asprintf (&res, "%s%#"PRIx64"%s", ctx->colors->num, value, ctx->colors->reset);
-			return res;
-			break;
+			bufprintf (buf, "%s%#"PRIx64"%s", ctx->colors->num, value, ctx->colors->reset);
+			return;
 	}
 }
 
+char *rnndec_decodeval(struct rnndeccontext *ctx, struct rnntypeinfo *ti, uint64_t value, int width) {
+	struct decbuf buf = { 0 };
+	decodeval(ctx, &buf, ti, value, width);
+	return buf.str;
+}
+
 static char *appendidx (struct rnndeccontext *ctx, char *name, uint64_t idx) {
 	char *res;
 	asprintf (&res, "%s[%s%#"PRIx64"%s]", name, ctx->colors->num, idx, ctx->colors->reset);
@@ -413,6 +517,24 @@ struct rnndecaddrinfo *rnndec_decodeaddr(struct rnndeccontext *ctx, struct rnndo
 	return res;
 }
 
+const struct rnndecaddrinfo *rnndec_decodeaddr_cached(struct rnndeccontext *ctx, struct rnndomain *domain, uint64_t addr, int write) {
+	if (!ctx->addrcache)
+		ctx->addrcache = calloc(RNNDEC_ADDRCACHE_SIZE, sizeof *ctx->addrcache);
+	uint64_t key = (addr << 1 | !!write) ^ (uintptr_t)domain;
+	struct rnndecaddrcache *e = &ctx->addrcache[(key * 0x9e3779b97f4a7c15ull) >> 52 & (RNNDEC_ADDRCACHE_SIZE - 1)];
+	if (e->info && e->domain == domain && e->addr == addr && e->write == !!write && e->vargen == ctx->vargen && e->colors == ctx->colors)
+		return e->info;
+	if (e->info)
+		rnndec_free_decaddrinfo(e->info);
+	e->domain = domain;
+	e->addr = addr;
+	e->write = !!write;
+	e->vargen = ctx->vargen;
+	e->colors = ctx->colors;
+	e->info = rnndec_decodeaddr(ctx, domain, addr, write);
+	return e->info;
+}
+
 void rnndec_free_decaddrinfo(struct rnndecaddrinfo *a) {
 	free(a->name);
 	free(a);
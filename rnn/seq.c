@@ -28,6 +28,7 @@
 #include <string.h>
 #include "rnn.h"
 #include "rnndec.h"
+#include "seq.h"
 
 /**
  * SEQ script decoder
@@ -36,323 +37,377 @@
  * decoding for two reasons
  * 1) envydis does not seem to allow operations beyond 8 bytes.
  * 2) envydis does not support opcodes of arbitrary length, as required for 0x21
- * A possibly useful intermediate solution now is adding a main() to this file
- * that decodes an isolated script from stdin or file. I don't think we need
- * assembly support, since we implement our own PDAEMON scripting language
- * anyway.
+ * In the meantime, seqdis decodes isolated scripts, or finds them in PMU
+ * memory dumps.  We don't need assembly support, since we implement our own
+ * PDAEMON scripting language anyway.
+ *
+ * Every opcode has an entry in seq_ops below, giving its minimum length and
+ * the function printing it.  Most of them only differ in their format
+ * string, which is kept in the table as well.
  */
 
+struct seq_env {
+	FILE *out;
+	const uint32_t *script;
+	struct rnndeccontext *ctx;
+	struct rnndomain *mmiodom;
+};
+
+struct seq_op;
+
+typedef void (*seq_print_fn)(struct seq_env *env, const struct seq_op *o, unsigned pc, unsigned op, unsigned size);
+
 struct seq_op {
 	const char *txt;
 	const char *binop;
 	unsigned int min_size;
+	seq_print_fn print;
+	const char *fmt;
 };
 
-#define OP_MOV(l) {"MOV", ":= ", l}
-#define OP_OR(l)  {"OR" , "|= ", l}
-#define OP_AND(l) {"AND", "&= ", l}
-#define OP_ADD(l) {"ADD", "+= ", l}
-#define OP_SHL(l) {"SHL", "<<=", l}
-#define OP(str,l) {str , "", l}
+static void seq_last(struct seq_env *, const struct seq_op *, unsigned, unsigned, unsigned);
+static void seq_load(struct seq_env *, const struct seq_op *, unsigned, unsigned, unsigned);
+static void seq_store(struct seq_env *, const struct seq_op *, unsigned, unsigned, unsigned);
+static void seq_none(struct seq_env *, const struct seq_op *, unsigned, unsigned, unsigned);
+static void seq_p1(struct seq_env *, const struct seq_op *, unsigned, unsigned, unsigned);
+/* the format may use the second parameter twice */
+static void seq_p1p2(struct seq_env *, const struct seq_op *, unsigned, unsigned, unsigned);
+static void seq_p1op(struct seq_env *, const struct seq_op *, unsigned, unsigned, unsigned);
+static void seq_opp1(struct seq_env *, const struct seq_op *, unsigned, unsigned, unsigned);
+static void seq_wait_status(struct seq_env *, const struct seq_op *, unsigned, unsigned, unsigned);
+static void seq_branch(struct seq_env *, const struct seq_op *, unsigned, unsigned, unsigned);
+static void seq_fb(struct seq_env *, const struct seq_op *, unsigned, unsigned, unsigned);
+static void seq_setregs(struct seq_env *, const struct seq_op *, unsigned, unsigned, unsigned);
 
-const struct seq_op seq_ops[] = {
+#define OP_MOV(l,p,f) {"MOV", ":= ", l, p, f}
+#define OP_OR(l,p,f)  {"OR" , "|= ", l, p, f}
+#define OP_AND(l,p,f) {"AND", "&= ", l, p, f}
+#define OP_ADD(l,p,f) {"ADD", "+= ", l, p, f}
+#define OP_SHL(l,p,f) {"SHL", "<<=", l, p, f}
+#define OP(str,l,p,f) {str , "", l, p, f}
+
+static const struct seq_op seq_ops[] = {
 	/* 0x00 */
-	OP_MOV(2),
-	OP_MOV(2),
-	OP_OR(2),
-	OP_OR(2),
-	OP_AND(2),
-	OP_AND(2),
-	OP_ADD(2),
-	OP_ADD(2),
-	OP_SHL(2),
-	OP_SHL(2),
-	OP_MOV(1),
-	OP_MOV(2),
-	OP_MOV(2),
-	OP_MOV(1),
-	OP_MOV(2),
-	OP_MOV(2),
+	OP_MOV(2, seq_last, 0),
+	OP_MOV(2, seq_last, 0),
+	OP_OR(2, seq_last, 0),
+	OP_OR(2, seq_last, 0),
+	OP_AND(2, seq_last, 0),
+	OP_AND(2, seq_last, 0),
+	OP_ADD(2, seq_last, 0),
+	OP_ADD(2, seq_last, 0),
+	OP_SHL(2, seq_last, 0),
+	OP_SHL(2, seq_last, 0),
+	OP_MOV(1, seq_load, 0),
+	OP_MOV(2, seq_load, 0),
+	OP_MOV(2, seq_load, 0),
+	OP_MOV(1, seq_store, 0),
+	OP_MOV(2, seq_store, 0),
+	OP_MOV(2, seq_store, 0),
 	/* 0x10 */
-	OP("EXIT",1),
-	OP("EXIT",1),
-	OP("EXIT",1),
-	OP("WAIT",2),
-	OP("WAIT STATUS",3),
-	OP("WAIT BITMASK",3),
-	OP("EXIT",2),
-	OP("CMP",2),
-	OP("BRANCH EQ",2),
-	OP("BRANCH NEQ",2),
-	OP("BRANCH LT",2),
-	OP("BRANCH GT",2),
-	OP("BRANCH",2),
-	OP("IRQ DISABLE",1),
-	OP("IRQ ENABLE",1),
-	OP_AND(2),
+	OP("EXIT",1, seq_none, 0),
+	OP("EXIT",1, seq_none, 0),
+	OP("EXIT",1, seq_none, 0),
+	OP("WAIT",2, seq_p1, "%u ns\n"),
+	OP("WAIT STATUS",3, seq_wait_status, 0),
+	OP("WAIT BITMASK",3, seq_p1p2, "R[last_reg] & 0x%08x == val_last, %u ns\n"),
+	OP("EXIT",2, seq_none, 0),
+	OP("CMP",2, seq_p1, "val_last, %08x\n"),
+	OP("BRANCH EQ",2, seq_branch, 0),
+	OP("BRANCH NEQ",2, seq_branch, 0),
+	OP("BRANCH LT",2, seq_branch, 0),
+	OP("BRANCH GT",2, seq_branch, 0),
+	OP("BRANCH",2, seq_branch, 0),
+	OP("IRQ DISABLE",1, seq_none, 0),
+	OP("IRQ ENABLE",1, seq_none, 0),
+	OP_AND(2, seq_opp1, "val_last      %s R[0x%06x]\n"),
 	/* 0x20 */
-	OP("",2),
-	OP_MOV(3),
-	OP_MOV(2),
-	OP_MOV(2),
-	OP_MOV(3),
-	OP_MOV(3),
-	OP_MOV(2),
-	OP_MOV(2),
-	OP_MOV(2),
-	OP_MOV(2),
-	OP_ADD(3),
-	OP("CMP",2),
-	OP_OR(2),
-	OP("DISPLAY UNK",3),
-	OP("WAIT",2),
-	OP("EXIT",1),
+	OP("",2, seq_fb, 0),
+	OP_MOV(3, seq_setregs, 0),
+	OP_MOV(2, seq_p1op, "OUT[0x%x]      %s val_last\n"),
+	OP_MOV(2, seq_p1op, "OUT[OUT[0x%x]] %s val_last\n"),
+	OP_MOV(3, seq_p1p2, "OUT[0x%x]      :=  %08x\n"),
+	OP_MOV(3, seq_p1p2, "OUT[OUT[0x%x]] :=  %08x\n"),
+	OP_MOV(2, seq_opp1, "val_last      %s OUT[0x%x]\n"),
+	OP_MOV(2, seq_opp1, "val_last      %s OUT[OUT[0x%x]]\n"),
+	OP_MOV(2, seq_p1, "reg_last      :=  OUT[0x%x]\n"),
+	OP_MOV(2, seq_p1, "reg_last      :=  OUT[OUT[0x%x]]\n"),
+	OP_ADD(3, seq_p1p2, "OUT[0x%x]      +=  0x%08x (%d)\n"),
+	OP("CMP",2, seq_p1p2, "OUT[0x%x], 0x%08x\n"),
+	OP_OR(2, seq_opp1, "val_last      %s R[0x%06x]\n"),
+	OP("DISPLAY UNK",3, seq_p1p2, "HEAD%d HEAD%d\n"),
+	OP("WAIT",2, seq_p1, "%u ns\n"),
+	OP("EXIT",1, seq_none, 0),
 	/* 0x30 */
-	OP_OR(2),
-	OP_OR(2),
-	OP_AND(2),
-	OP_AND(2),
-	OP("MOV TS",2),
-	OP("MOV TS",2),
-	OP("EXIT",1),
-	OP("EXIT",1),
-	OP("NOP",0),
-	OP("EXIT",1),
-	OP("EXIT",1),
-	OP_ADD(2),
-	OP_ADD(2),
+	OP_OR(2, seq_p1op, "OUT[0x%x]      %s val_last\n"),
+	OP_OR(2, seq_p1op, "OUT[OUT[0x%x]] %s val_last\n"),
+	OP_AND(2, seq_p1op, "OUT[0x%x]      %s val_last\n"),
+	OP_AND(2, seq_p1op, "OUT[OUT[0x%x]] %s val_last\n"),
+	OP("MOV TS",2, seq_p1, "OUT[0x%x]\n"),
+	OP("MOV TS",2, seq_p1, "OUT[OUT[0x%x]]\n"),
+	OP("EXIT",1, seq_none, 0),
+	OP("EXIT",1, seq_none, 0),
+	OP("NOP",0, seq_none, 0),
+	OP("EXIT",1, seq_none, 0),
+	OP("EXIT",1, seq_none, 0),
+	OP_ADD(2, seq_opp1, "val_last      %s OUT[0x%x]\n"),
+	OP_ADD(2, seq_opp1, "val_last      %s OUT[OUT[0x%x]]\n"),
 };
 
-const char * const seq_wait_status[] = {
-	"UNK01",
-	"!UNK01",
-	"FB_PAUSED",
-	"!FB_PAUSED",
-	"HEAD0_VBLANK",
-	"!HEAD0_VBLANK",
-	"HEAD1_VBLANK",
-	"!HEAD1_VBLANK",
-	"HEAD0_HBLANK",
-	"!HEAD0_HBLANK",
-	"HEAD1_HBLANK",
-	"!HEAD1_HBLANK",
-};
+#define SEQ_OPS_NUM (sizeof seq_ops / sizeof *seq_ops)
 
-#define seq_out(p,s,...) printf("%06x: "s,((p) << 2), ##__VA_ARGS__)
+#define seq_out(p,s,...) fprintf(env->out, "%06x: "s,((p) << 2), ##__VA_ARGS__)
 #define seq_out_op(p,op,s,...) seq_out(p,"%-14s"s, seq_ops[op].txt, ##__VA_ARGS__)
-#define seq_outlast(p,op,val) \
-	seq_out_op(p,op,"%s      %s 0x%08x\n", \
-			((op) & 0x1) ? "reg_last":"val_last", \
-			seq_ops[((op) >> 1)].binop, \
-			(val))
 
-/**
- * Print a SEQ script to stdout in human-readable format.
- * @param script Script to print, native endianness, in 32-bit words.
- * @param len Length of the script in 32-bit words.
- */
-void
-seq_print(uint32_t *script, uint32_t len, struct rnndeccontext *ctx, struct rnndomain *mmiodom)
+static void seq_last(struct seq_env *env, const struct seq_op *o, unsigned pc, unsigned op, unsigned size) {
+	seq_out_op(pc,op,"%s      %s 0x%08x\n",
+			(op & 0x1) ? "reg_last":"val_last",
+			seq_ops[op >> 1].binop,
+			env->script[pc+1]);
+}
+
+static void seq_load(struct seq_env *env, const struct seq_op *o, unsigned pc, unsigned op, unsigned size) {
+	const char *reg0 = (op == 0xa || op == 0xc) ? "reg_last+" : "";
+	unsigned reg1 = (op == 0xb || op == 0xc) ? env->script[pc+1] : 0;
+	seq_out_op(pc,op,"val_last   :=  R[%s0x%06x]\n",reg0,reg1);
+}
+
+static void seq_store(struct seq_env *env, const struct seq_op *o, unsigned pc, unsigned op, unsigned size) {
+	const char *reg0 = (op == 0xd || op == 0xf) ? "reg_last+" : "";
+	unsigned reg1 = (op == 0xe || op == 0xf) ? env->script[pc+1] : 0;
+	seq_out_op(pc,op,"R[%s0x%06x]   :=  val_last\n",reg0,reg1);
+}
+
+static void seq_none(struct seq_env *env, const struct seq_op *o, unsigned pc, unsigned op, unsigned size) {
+	seq_out_op(pc,op,"\n");
+}
+
+static void seq_p1(struct seq_env *env, const struct seq_op *o, unsigned pc, unsigned op, unsigned size) {
+	fprintf(env->out, "%06x: %-14s", pc << 2, o->txt);
+	fprintf(env->out, o->fmt, env->script[pc+1]);
+}
+
+/* the format may use the second parameter twice */
+static void seq_p1p2(struct seq_env *env, const struct seq_op *o, unsigned pc, unsigned op, unsigned size) {
+	fprintf(env->out, "%06x: %-14s", pc << 2, o->txt);
+	fprintf(env->out, o->fmt, env->script[pc+1], env->script[pc+2], env->script[pc+2]);
+}
+
+static void seq_p1op(struct seq_env *env, const struct seq_op *o, unsigned pc, unsigned op, unsigned size) {
+	fprintf(env->out, "%06x: %-14s", pc << 2, o->txt);
+	fprintf(env->out, o->fmt, env->script[pc+1], o->binop);
+}
+
+static void seq_opp1(struct seq_env *env, const struct seq_op *o, unsigned pc, unsigned op, unsigned size) {
+	fprintf(env->out, "%06x: %-14s", pc << 2, o->txt);
+	fprintf(env->out, o->fmt, o->binop, env->script[pc+1]);
+}
+
+static void seq_wait_status(struct seq_env *env, const struct seq_op *o, unsigned pc, unsigned op, unsigned size) {
+	const uint32_t *script = env->script;
+	const char *wait_op;
+	switch(script[pc+1] & 0xffff) {
+	case 0x0:
+		wait_op = "HEAD0_VBLANK";
+		break;
+	case 0x1:
+		wait_op = "HEAD1_VBLANK";
+		break;
+	case 0x100:
+		wait_op = "HEAD0_HBLANK";
+		break;
+	case 0x101:
+		wait_op = "HEAD1_HBLANK";
+		break;
+	case 0x300:
+		wait_op = "FB_PAUSED   ";
+		break;
+	case 0x400:
+		wait_op = "PGRAPH_IDLE ";
+		break;
+	default:
+		wait_op = "(unknown)   ";
+		seq_out(pc,"Invalid param %08x for op 0x14\n", script[pc+1]);
+	}
+
+	if(script[pc+1] & 0x10000) {
+		seq_out_op(pc,op,"!%s , %u ns\n",wait_op,script[pc+2]);
+	} else {
+		seq_out_op(pc,op,"%s  , %u ns\n",wait_op,script[pc+2]);
+	}
+}
+
+static void seq_branch(struct seq_env *env, const struct seq_op *o, unsigned pc, unsigned op, unsigned size) {
+	seq_out_op(pc,op,"0x%06x\n", env->script[pc+1] << 2);
+}
+
+static void seq_fb(struct seq_env *env, const struct seq_op *o, unsigned pc, unsigned op, unsigned size) {
+	if(env->script[pc+1] == 1)
+		seq_out(pc,"FB PAUSE\n");
+	else
+		seq_out(pc,"FB RESUME\n");
+}
+
+static void seq_setregs(struct seq_env *env, const struct seq_op *o, unsigned pc, unsigned op, unsigned size) {
+	const uint32_t *script = env->script;
+	unsigned i;
+	seq_out(pc,"SET REGISTERS:\n");
+	/* pairs only - an even size leaves one stray word at the end */
+	for (i = 1; i + 1 < size; i += 2) {
+		if (env->mmiodom) {
+			struct rnndecaddrinfo *ai = rnndec_decodeaddr(env->ctx, env->mmiodom, script[pc+i], 1);
+			seq_out(pc+i,"              R[0x%06x]   :=  0x%08x     # %s\n", script[pc+i], script[pc+i+1], ai->name);
+			rnndec_free_decaddrinfo(ai);
+		} else {
+			seq_out(pc+i,"              R[0x%06x]   :=  0x%08x\n", script[pc+i], script[pc+i+1]);
+		}
+	}
+	seq_out(pc+i-2,"              reg_last      :=  0x%08x\n", script[pc+i-2]);
+	seq_out(pc+i-2,"              val_last      :=  0x%08x\n", script[pc+i-1]);
+	if (i < size)
+		seq_out(pc+i,"Invalid trailing word %08x for op 0x21\n", script[pc+i]);
+}
+
+int seq_oplen(uint32_t word) {
+	unsigned op = word & 0xffff;
+	unsigned size = word >> 16;
+	if (op >= SEQ_OPS_NUM || size > 0x3ff || size == 0 || size < seq_ops[op].min_size)
+		return 0;
+	return size;
+}
+
+int
+seq_fprint(FILE *out, const uint32_t *script, uint32_t len, struct rnndeccontext *ctx, struct rnndomain *mmiodom)
 {
+	struct seq_env env_ = { out, script, ctx, mmiodom }, *env = &env_;
 	unsigned int pc, op, size;
-	char *reg0;
-	unsigned int reg1, i;
-	const char *wait_op;
 
 	/* Validate script, bail if invalid */
 	for(pc = 0; pc < len; pc += size) {
 		op = script[pc] & 0xffff;
 		size = (script[pc] & 0xffff0000) >> 16;
 
-		if(op > 0x3c || size > 0x3ff || size == 0)
-			return;
+		if(op >= SEQ_OPS_NUM || size > 0x3ff || size == 0)
+			return -1;
 
 		if(pc + size > len)
-			return;
+			return -1;
 	}
 
-	printf("SEQ script, size: %uB\n", len << 2);
+	fprintf(out, "SEQ script, size: %uB\n", len << 2);
 
 	for(pc = 0; pc < len; pc += size) {
 		op = script[pc] & 0xffff;
 		size = (script[pc] & 0xffff0000) >> 16;
 
-		if(op > 0x3c) {
-			seq_out(pc,"Invalid op\n");
-			return;
-		}
-
 		if(seq_ops[op].min_size > size){
 			seq_out(pc,"Opcode size too small\n");
-			return;
+			return -1;
 		}
 
-		switch(op) {
-		case 0x0:
-		case 0x1:
-		case 0x2:
-		case 0x3:
-		case 0x4:
-		case 0x5:
-		case 0x6:
-		case 0x7:
-		case 0x8:
-		case 0x9:
-			seq_outlast(pc,op,script[pc+1]);
-			break;
-		case 0xa:
-		case 0xb:
-		case 0xc:
-			reg0 = "";
-			reg1 = 0;
-
-			if(op == 0xa || op == 0x0c) {
-			        reg0 = "reg_last+";
-			}
+		seq_ops[op].print(env, &seq_ops[op], pc, op, size);
+	}
+	return 0;
+}
 
-			if (op == 0xb || op == 0xc) {
-				reg1 = script[pc+1];
-			}
-			seq_out_op(pc,op,"val_last   :=  R[%s0x%06x]\n",reg0,reg1);
-			break;
-		case 0xd:
-		case 0xe:
-		case 0xf:
-			reg0 = "";
-			reg1 = 0;
-
-			if(op == 0xd || op == 0xf) {
-			        reg0 = "reg_last+";
-			}
+void
+seq_print(uint32_t *script, uint32_t len, struct rnndeccontext *ctx, struct rnndomain *mmiodom)
+{
+	seq_fprint(stdout, script, len, ctx, mmiodom);
+}
 
-			if (op == 0xe || op == 0xf) {
-				reg1 = script[pc+1];
-			}
-			seq_out_op(pc,op,"R[%s0x%06x]   :=  val_last\n",reg0,reg1);
-			break;
-		case 0x13:
-		case 0x2e:
-			seq_out_op(pc,op,"%u ns\n",script[pc+1]);
-			break;
-		case 0x14:
-			//seq_out_op(pc,op,"%s, %u ns\n",seq_wait_status[script[pc+1] & 0xff],script[pc+2]);
-			switch(script[pc+1] & 0xffff) {
-			case 0x0:
-				wait_op = "HEAD0_VBLANK";
-				break;
-			case 0x1:
-				wait_op = "HEAD1_VBLANK";
-				break;
-			case 0x100:
-				wait_op = "HEAD0_HBLANK";
-				break;
-			case 0x101:
-				wait_op = "HEAD1_HBLANK";
-				break;
-			case 0x300:
-				wait_op = "FB_PAUSED   ";
-				break;
-			case 0x400:
-				wait_op = "PGRAPH_IDLE ";
-				break;
-			default:
-				wait_op = "(unknown)   ";
-				seq_out(pc,"Invalid param %08x for op 0x14\n", script[pc+1]);
-			}
+/*
+ * Script scanner.  The words seen so far are kept in a window, which always
+ * starts with the first word of a possible script.  It's parsed op by op
+ * until the terminating 0 word, in which case the script is passed on.  If
+ * anything else is found, the script candidate starts one word later.
+ */
+
+struct seq_scanner {
+	int minops;
+	seq_found_fn found;
+	void *arg;
+	uint32_t *win;
+	int winstart;	/* index of the first word still in use */
+	int winnum;
+	int winmax;
+	uint64_t pos;	/* stream position of win[winstart], in words */
+	int cur;	/* parsed this many words of the candidate, at an op boundary */
+	int ops;
+};
+
+struct seq_scanner *seq_scanner_new(int minops, seq_found_fn found, void *arg) {
+	struct seq_scanner *s = calloc(sizeof *s, 1);
+	s->minops = minops < 1 ? 1 : minops;
+	s->found = found;
+	s->arg = arg;
+	return s;
+}
+
+void seq_scanner_del(struct seq_scanner *s) {
+	free(s->win);
+	free(s);
+}
 
-			if(script[pc+1] & 0x10000) {
-				seq_out_op(pc,op,"!%s , %u ns\n",wait_op,script[pc+2]);
-			} else {
-				seq_out_op(pc,op,"%s  , %u ns\n",wait_op,script[pc+2]);
+static void seq_scanner_drop(struct seq_scanner *s, int num) {
+	s->winstart += num;
+	s->pos += num;
+	s->cur = 0;
+	s->ops = 0;
+}
+
+static void seq_scan(struct seq_scanner *s, int eof) {
+	while (s->winstart < s->winnum) {
+		uint32_t *cand = s->win + s->winstart;
+		int avail = s->winnum - s->winstart;
+		if (s->cur < avail) {
+			int len = seq_oplen(cand[s->cur]);
+			if (!cand[s->cur] && s->ops >= s->minops) {
+				s->found(s->arg, s->pos, cand, s->cur);
+				seq_scanner_drop(s, s->cur + 1);
+				continue;
+			}
+			if (len && s->cur + len <= SEQ_MAX_LEN) {
+				if (s->cur + len <= avail) {
+					s->cur += len;
+					s->ops++;
+					continue;
+				}
+				if (!eof)
+					return;
 			}
-			break;
-		case 0x15:
-			seq_out_op(pc,op,"R[last_reg] & 0x%08x == val_last, %u ns\n",script[pc+1],script[pc+2]);
-			break;
-		case 0x16:
-			seq_out_op(pc,op,"\n");
-			break;
-		case 0x17:
-			seq_out_op(pc,op,"val_last, %08x\n", script[pc+1]);
-			break;
-		case 0x18:
-		case 0x19:
-		case 0x1a:
-		case 0x1b:
-		case 0x1c:
-			seq_out_op(pc,op,"0x%06x\n", script[pc+1] << 2);
-			break;
-		case 0x1d:
-		case 0x1e:
-			seq_out_op(pc,op,"\n");
-			break;
-		case 0x1f:
-		case 0x2c:
-			seq_out_op(pc,op,"val_last      %s R[0x%06x]\n", seq_ops[op].binop, script[pc+1]);
-			break;
-		case 0x20:
-			if(script[pc+1] == 1)
-				seq_out(pc,"FB PAUSE\n");
-			else
-				seq_out(pc,"FB RESUME\n");
-			break;
-		case 0x21:
-			seq_out(pc,"SET REGISTERS:\n");
-			for (i = 1; i < size; i += 2) {
-				struct rnndecaddrinfo *ai = rnndec_decodeaddr(ctx, mmiodom, script[pc+i], 1);
-				seq_out(pc+i,"              R[0x%06x]   :=  0x%08x     # %s\n", script[pc+i], script[pc+i+1], ai->name);
+		} else {
+			if (!eof)
+				return;
+			/* unterminated script at the end of input */
+			if (s->ops >= s->minops) {
+				s->found(s->arg, s->pos, cand, s->cur);
+				seq_scanner_drop(s, s->cur);
+				continue;
 			}
-			seq_out(pc+i-2,"              reg_last      :=  0x%08x\n", script[pc+i-2]);
-			seq_out(pc+i-2,"              val_last      :=  0x%08x\n", script[pc+i-1]);
-			break;
-		case 0x22:
-		case 0x30:
-		case 0x32:
-			seq_out_op(pc,op,"OUT[0x%x]      %s val_last\n", script[pc+1], seq_ops[op].binop);
-			break;
-		case 0x23:
-		case 0x31:
-		case 0x33:
-			seq_out_op(pc,op,"OUT[OUT[0x%x]] %s val_last\n", script[pc+1], seq_ops[op].binop);
-			break;
-		case 0x24:
-			seq_out_op(pc,op,"OUT[0x%x]      :=  %08x\n", script[pc+1], script[pc+2]);
-			break;
-		case 0x25:
-			seq_out_op(pc,op,"OUT[OUT[0x%x]] :=  %08x\n", script[pc+1], script[pc+2]);
-			break;
-		case 0x26:
-		case 0x3b:
-			seq_out_op(pc,op,"val_last      %s OUT[0x%x]\n", seq_ops[op].binop, script[pc+1]);
-			break;
-		case 0x27:
-		case 0x3c:
-			seq_out_op(pc,op,"val_last      %s OUT[OUT[0x%x]]\n", seq_ops[op].binop, script[pc+1]);
-			break;
-		case 0x28:
-			seq_out_op(pc,op,"reg_last      :=  OUT[0x%x]\n", script[pc+1]);
-			break;
-		case 0x29:
-			seq_out_op(pc,op,"reg_last      :=  OUT[OUT[0x%x]]\n", script[pc+1]);
-			break;
-		case 0x2a:
-			seq_out_op(pc,op,"OUT[0x%x]      +=  0x%08x (%d)\n", script[pc+1], script[pc+2], script[pc+2]);
-			break;
-		case 0x2b:
-			seq_out_op(pc,op,"OUT[0x%x], 0x%08x\n", script[pc+1], script[pc+2]);
-			break;
-		case 0x2d:
-			seq_out_op(pc,op,"HEAD%d HEAD%d\n", script[pc+1], script[pc+2]);
-			break;
-		case 0x34:
-			seq_out_op(pc,op,"OUT[0x%x]\n", script[pc+1]);
-			break;
-		case 0x35:
-			seq_out_op(pc,op,"OUT[OUT[0x%x]]\n", script[pc+1]);
-			break;
-		default:
-			seq_out_op(pc,op,"\n");
-			break;
 		}
+		/* no script starting here */
+		seq_scanner_drop(s, 1);
 	}
 }
+
+void seq_scanner_feed(struct seq_scanner *s, const uint32_t *words, int num) {
+	if (s->winstart) {
+		memmove(s->win, s->win + s->winstart, (s->winnum - s->winstart) * sizeof *s->win);
+		s->winnum -= s->winstart;
+		s->winstart = 0;
+	}
+	if (s->winnum + num > s->winmax) {
+		s->winmax = s->winnum + num;
+		s->win = realloc(s->win, s->winmax * sizeof *s->win);
+	}
+	memcpy(s->win + s->winnum, words, num * sizeof *words);
+	s->winnum += num;
+	seq_scan(s, 0);
+}
+
+void seq_scanner_end(struct seq_scanner *s) {
+	seq_scan(s, 1);
+	s->winstart = s->winnum = 0;
+	s->pos = 0;
+}
@@ -25,9 +25,15 @@
 #ifndef SEQ_H
 #define SEQ_H
 
+#include <stdio.h>
+#include <stdint.h>
+
 struct rnndomain;
 struct rnndeccontext;
 
+/* longest script the scanner will consider, in 32-bit words */
+#define SEQ_MAX_LEN 0x10000
+
 /**
  * Print a SEQ script to stdout in human-readable format.
  * @param script Script to print, native endianness, in 32-bit words.
@@ -36,4 +42,32 @@ struct rnndeccontext;
 extern void seq_print(uint32_t *script, uint32_t len, struct rnndeccontext *ctx,
 				struct rnndomain *mmiodom);
 
+/**
+ * Like seq_print, but to the given file.  mmiodom may be NULL, in which case
+ * register names aren't looked up.
+ * @return 0 if the script was valid, -1 otherwise.
+ */
+extern int seq_fprint(FILE *out, const uint32_t *script, uint32_t len,
+				struct rnndeccontext *ctx, struct rnndomain *mmiodom);
+
+/**
+ * Length of the op starting with the given word, in 32-bit words, or 0 if
+ * it's not a valid op.
+ */
+extern int seq_oplen(uint32_t word);
+
+/**
+ * Streaming script finder.  Words are fed in any amounts, and found is
+ * called for every run of at least minops valid ops followed by a 0 word
+ * (or the end of input).  pos is the offset of the script in the stream, in
+ * 32-bit words.
+ */
+typedef void (*seq_found_fn)(void *arg, uint64_t pos, const uint32_t *script, uint32_t len);
+struct seq_scanner;
+extern struct seq_scanner *seq_scanner_new(int minops, seq_found_fn found, void *arg);
+extern void seq_scanner_feed(struct seq_scanner *s, const uint32_t *words, int num);
+/* flushes the scanner at the end of a stream, it can be fed another one after */
+extern void seq_scanner_end(struct seq_scanner *s);
+extern void seq_scanner_del(struct seq_scanner *s);
+
 #endif /* SEQ_H */
@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2016 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "rnn.h"
+#include "rnndec.h"
+#include "util.h"
+#include "seq.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+/*
+ * Decodes PDAEMON SEQ scripts.  By default, inputs are scanned for scripts,
+ * so that whole PMU memory dumps can be thrown at it; with -r, every input
+ * is taken to be a single script.  Inputs are read in chunks and fed to the
+ * scanner as they come, so their size doesn't matter.
+ */
+
+void usage()
+{
+	fprintf (stderr, "Usage:\n"
+			"\tseqdis [-f file.xml] [-a NVXX] [-n] [-x] [-r] [-m min-ops] [file|directory]...\n"
+			"Inputs are binary little-endian 32-bit words, or hex words with -x.\n"
+			"Directories are searched for files.  Without any inputs, stdin is read.\n"
+			"-r: each input is a single script, instead of being searched for scripts\n"
+			"-m: only report scripts of at least this many ops, default 3\n"
+			"-n: don't load the database, SET REGISTERS won't name the registers\n"
+		);
+	exit(2);
+}
+
+static int hex, raw;
+static int minops = 3;
+static struct rnndeccontext *ctx;
+static struct rnndomain *mmiodom;
+static char **inputs;
+static int inputsnum;
+static int inputsmax;
+
+static int namecmp(const void *a, const void *b) {
+	return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static int addinput(char *name) {
+	struct stat st;
+	if (strcmp(name, "-") && !stat(name, &st) && S_ISDIR(st.st_mode)) {
+		DIR *dir = opendir(name);
+		struct dirent *ent;
+		char **names = 0;
+		int namesnum = 0;
+		int namesmax = 0;
+		int i, res = 0;
+		if (!dir) {
+			perror(name);
+			return 1;
+		}
+		while ((ent = readdir(dir))) {
+			if (ent->d_name[0] == '.')
+				continue;
+			char *sub = aprintf("%s/%s", name, ent->d_name);
+			ADDARRAY(names, sub);
+		}
+		closedir(dir);
+		/* so that the output order doesn't depend on the filesystem */
+		qsort(names, namesnum, sizeof *names, namecmp);
+		for (i = 0; i < namesnum; i++) {
+			res |= addinput(names[i]);
+			free(names[i]);
+		}
+		free(names);
+		return res;
+	}
+	ADDARRAY(inputs, strdup(name));
+	return 0;
+}
+
+/* reads up to max words, returns how many were read */
+static int readwords(FILE *f, uint32_t *words, int max) {
+	int num = 0;
+	if (hex) {
+		unsigned t;
+		while (num < max && fscanf (f, "%x", &t) == 1) {
+			words[num++] = t;
+			fscanf (f, " ,");
+		}
+	} else {
+		uint8_t buf[0x1000];
+		if (max > sizeof buf / 4)
+			max = sizeof buf / 4;
+		int len = fread(buf, 4, max, f);
+		for (num = 0; num < len; num++)
+			words[num] = buf[num*4] | buf[num*4+1] << 8 | buf[num*4+2] << 16 | (uint32_t)buf[num*4+3] << 24;
+	}
+	return num;
+}
+
+static void found(void *arg, uint64_t pos, const uint32_t *script, uint32_t len) {
+	printf ("Script at 0x%06"PRIx64":\n", pos << 2);
+	seq_fprint(stdout, script, len, ctx, mmiodom);
+	printf ("\n");
+}
+
+static int dofile(const char *name, FILE *f, struct seq_scanner *scanner) {
+	uint32_t words[0x400];
+	int num;
+	if (!raw) {
+		while ((num = readwords(f, words, 0x400)))
+			seq_scanner_feed(scanner, words, num);
+		seq_scanner_end(scanner);
+		return 0;
+	}
+	/* a single script, up to the terminating 0 word - operands can be 0 too */
+	uint32_t *script = 0;
+	int scriptnum = 0;
+	int scriptmax = 0;
+	int i, done = 0, left = 0;
+	while (!done && (num = readwords(f, words, 0x400)))
+		for (i = 0; i < num && !done; i++) {
+			if (!left) {
+				if (!words[i]) {
+					done = 1;
+					break;
+				}
+				/* invalid ops are passed on for seq_fprint to reject */
+				left = seq_oplen(words[i]);
+				if (!left)
+					left = 1;
+			}
+			ADDARRAY(script, words[i]);
+			left--;
+		}
+	int res = 0;
+	if (seq_fprint(stdout, script, scriptnum, ctx, mmiodom)) {
+		fprintf (stderr, "%s: not a valid SEQ script\n", name);
+		res = 1;
+	}
+	free(script);
+	return res;
+}
+
+int main(int argc, char **argv) {
+	char *file = "root.xml";
+	char *variant = NULL;
+	uint64_t chip = 0;
+	int nodb = 0;
+	int c, i, res = 0;
+
+	while ((c = getopt (argc, argv, "f:a:nxrm:")) != -1) {
+		switch (c) {
+			case 'f':
+				file = optarg;
+				break;
+			case 'a':
+				chip = strtoull(optarg, NULL, 16);
+				variant = chip ? NULL : optarg;
+				break;
+			case 'n':
+				nodb = 1;
+				break;
+			case 'x':
+				hex = 1;
+				break;
+			case 'r':
+				raw = 1;
+				break;
+			case 'm':
+				minops = strtol(optarg, 0, 0);
+				break;
+			default:
+				usage();
+		}
+	}
+	for (i = optind; i < argc; i++)
+		res |= addinput(argv[i]);
+	if (optind == argc)
+		addinput("-");
+
+	struct rnndb *db = 0;
+	if (!nodb) {
+		rnn_init();
+		db = rnn_newdb();
+		rnn_parsefile (db, file);
+		rnn_prepdb (db);
+		ctx = rnndec_newcontext(db);
+		if (variant)
+			rnndec_varadd(ctx, "chipset", variant);
+		else if (chip)
+			rnndec_varaddvalue(ctx, "chipset", chip);
+		mmiodom = rnn_finddomain(db, "NV_MMIO");
+	}
+
+	struct seq_scanner *scanner = seq_scanner_new(minops, found, 0);
+	for (i = 0; i < inputsnum; i++) {
+		FILE *f = strcmp(inputs[i], "-") ? fopen(inputs[i], "r") : stdin;
+		if (!f) {
+			perror(inputs[i]);
+			res = 1;
+		} else {
+			if (inputsnum > 1)
+				printf ("==> %s <==\n", inputs[i]);
+			res |= dofile(inputs[i], f, scanner);
+			if (f != stdin)
+				fclose(f);
+		}
+		free(inputs[i]);
+	}
+	seq_scanner_del(scanner);
+	free(inputs);
+
+	if (db) {
+		rnndec_freecontext(ctx);
+		rnn_freedb(db);
+		rnn_fini();
+	}
+	return res;
+}
@@ -346,9 +346,11 @@ int vs_search_start(struct bitstream *str) {
 			if (vs_bit(str, &bit)) return 0;
 		}
 	} else {
+		int i, pos;
 		str->hasbyte = 0;
 		str->bitpos = 7;
-		while (1) {
+		/* the first two bytes may complete a start code whose zeros we've already seen */
+		for (i = 0; i < 2; i++) {
 			if (str->bytepos >= str->bytesnum)
 				return 0;
 			if (str->zero_bytes == 2 && str->bytes[str->bytepos] == 1)
@@ -361,6 +363,19 @@ int vs_search_start(struct bitstream *str) {
 			}
 			str->bytepos++;
 		}
+		/* past that, zero_bytes only depends on the buffer, so jump straight to the next start code */
+		pos = vs_find_start(str->bytes + str->bytepos - 2, str->bytesnum - str->bytepos + 2);
+		if (pos != -1) {
+			str->bytepos += pos;
+			str->zero_bytes = 2;
+			return 1;
+		}
+		str->bytepos = str->bytesnum;
+		if (str->bytes[str->bytepos - 1])
+			str->zero_bytes = 0;
+		else
+			str->zero_bytes = str->bytes[str->bytepos - 2] ? 1 : 2;
+		return 0;
 	}
 }
 
@@ -477,12 +492,22 @@ struct bitstream *vs_new_decode(enum vs_type type, uint8_t *bytes, int bytesnum)
 	struct bitstream *res = calloc(sizeof *res, 1);
 	res->dir = VS_DECODE;
 	res->type = type;
-	res->bytes = bytes;
-	res->bytesnum = bytesnum;
-	res->bitpos = 7;
+	vs_reset_decode(res, bytes, bytesnum);
 	return res;
 }
 
+void vs_reset_decode(struct bitstream *str, uint8_t *bytes, int bytesnum) {
+	str->bytes = bytes;
+	str->bytesnum = bytesnum;
+	str->bytesmax = 0;
+	str->curbyte = 0;
+	str->bitpos = 7;
+	str->bytepos = 0;
+	str->zero_bytes = 0;
+	str->zero_bits = 0;
+	str->hasbyte = 0;
+}
+
 int vs_mark(struct bitstream *str, uint32_t val, int size) {
 	uint32_t tmp = val;
 	if (vs_u(str, &tmp, size)) return 1;
@@ -29,14 +29,10 @@
 #include <stdlib.h>
 
 int main() {
-	uint8_t *bytes = 0;
-	int bytesnum = 0;
-	int bytesmax = 0;
-	int c;
+	/* H.261 start codes aren't byte-aligned, so there's no splitting it into units up front */
+	int bytesnum;
+	uint8_t *bytes = vs_read_all(stdin, &bytesnum);
 	int res;
-	while ((c = getchar()) != EOF) {
-		ADDARRAY(bytes, c);
-	}
 	struct bitstream *str = vs_new_decode(VS_H261, bytes, bytesnum);
 	struct h261_picparm *picparm = calloc(sizeof *picparm, 1);
 	while (1) {
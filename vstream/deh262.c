@@ -27,65 +27,112 @@
 #include "util.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 
-int main() {
-	uint8_t *bytes = 0;
-	int bytesnum = 0;
-	int bytesmax = 0;
+/* binary trace output, replaces the text dump when given */
+static struct vs_trace *trace;
+
+static void dump_seqparm(struct h262_seqparm *seqparm) {
+	if (trace)
+		h262_trace_seqparm(trace, seqparm);
+	else
+		h262_print_seqparm(seqparm);
+}
+
+static void dump_picparm(struct h262_picparm *picparm) {
+	if (trace)
+		h262_trace_picparm(trace, picparm);
+	else
+		h262_print_picparm(picparm);
+}
+
+static void dump_slice(struct h262_seqparm *seqparm, struct h262_picparm *picparm, struct h262_slice *slice) {
+	if (trace)
+		h262_trace_slice(trace, seqparm, picparm, slice);
+	else
+		h262_print_slice(seqparm, picparm, slice);
+}
+
+int main(int argc, char **argv) {
+	FILE *tracefile = 0;
 	int c;
-	int res;
-	while ((c = getchar()) != EOF) {
-		ADDARRAY(bytes, c);
-	}
-	struct bitstream *str = vs_new_decode(VS_H262, bytes, bytesnum);
+	while ((c = getopt (argc, argv, "t:")) != -1)
+		switch (c) {
+			case 't':
+				if (!(tracefile = fopen(optarg, "wb"))) {
+					perror(optarg);
+					return 1;
+				}
+				trace = vs_trace_new(tracefile);
+				break;
+			default:
+				fprintf(stderr, "Usage: %s [-t tracefile] < stream\n", argv[0]);
+				return 1;
+		}
+	struct vs_splitter *sp = vs_new_splitter(stdin);
+	uint8_t *bytes;
+	int bytesnum;
+	int failed = 0;
+	struct bitstream *str = vs_new_decode(VS_H262, 0, 0);
 	struct h262_seqparm *seqparm = calloc(sizeof *seqparm, 1);
 	struct h262_picparm *picparm = calloc(sizeof *picparm, 1);
 	struct h262_gop *gop = calloc(sizeof *gop, 1);
 	struct h262_slice *slice;
-	while (1) {
+	while (vs_splitter_next(sp, &bytes, &bytesnum)) {
 		uint32_t start_code;
 		uint32_t ext_start_code;
+		if (failed && !trace)
+			printf("\n");
+		failed = 0;
+		vs_reset_decode(str, bytes, bytesnum);
 		if (vs_start(str, &start_code)) goto err;
-		printf("Start code: %02x\n", start_code);
+		if (trace)
+			vs_trace_unit(trace, start_code);
+		else
+			printf("Start code: %02x\n", start_code);
 		switch (start_code) {
 			case H262_START_CODE_SEQPARM:
 				if (h262_seqparm(str, seqparm))
 					goto err;
 				if (vs_end(str))
 					goto err;
-				h262_print_seqparm(seqparm);
+				dump_seqparm(seqparm);
 				break;
 			case H262_START_CODE_PICPARM:
 				if (h262_picparm(str, seqparm, picparm))
 					goto err;
 				if (vs_end(str))
 					goto err;
-				h262_print_picparm(picparm);
+				dump_picparm(picparm);
 				break;
 			case H262_START_CODE_GOP:
 				if (h262_gop(str, gop))
 					goto err;
 				if (vs_end(str))
 					goto err;
-				h262_print_gop(gop);
+				if (trace)
+					h262_trace_gop(trace, gop);
+				else
+					h262_print_gop(gop);
 				break;
 			case H262_START_CODE_EXTENSION:
 				if (vs_u(str, &ext_start_code, 4)) goto err;
-				printf("Extension start code: %d\n", ext_start_code);
+				if (!trace)
+					printf("Extension start code: %d\n", ext_start_code);
 				switch (ext_start_code) {
 					case H262_EXT_SEQUENCE:
 						if (h262_seqparm_ext(str, seqparm))
 							goto err;
 						if (vs_end(str))
 							goto err;
-						h262_print_seqparm(seqparm);
+						dump_seqparm(seqparm);
 						break;
 					case H262_EXT_PIC_CODING:
 						if (h262_picparm_ext(str, seqparm, picparm))
 							goto err;
 						if (vs_end(str))
 							goto err;
-						h262_print_picparm(picparm);
+						dump_picparm(picparm);
 						break;
 					default:
 						fprintf(stderr, "Unknown extension start code\n");
@@ -93,7 +140,8 @@ int main() {
 				}
 				break;
 			case H262_START_CODE_END:
-				printf ("End of sequence.\n");
+				if (!trace)
+					printf ("End of sequence.\n");
 				break;
 			default:
 				if (start_code >= H262_START_CODE_SLICE_BASE && start_code <= H262_START_CODE_SLICE_LAST) {
@@ -117,11 +165,11 @@ int main() {
 						goto err;
 					}
 					if (h262_slice(str, seqparm, picparm, slice)) {
-						h262_print_slice(seqparm, picparm, slice);
+						dump_slice(seqparm, picparm, slice);
 						h262_del_slice(slice);
 						goto err;
 					}
-					h262_print_slice(seqparm, picparm, slice);
+					dump_slice(seqparm, picparm, slice);
 					if (vs_end(str)) {
 						h262_del_slice(slice);
 						goto err;
@@ -133,15 +181,18 @@ int main() {
 					goto err;
 				}
 		}
-		printf("NAL decoded successfully\n\n");
+		if (!trace)
+			printf("NAL decoded successfully\n\n");
 		continue;
 err:
-		res = vs_search_start(str);
-		if (res == -1)
-			return 1;
-		if (!res)
-			break;
-		printf("\n");
+		if (trace)
+			vs_trace_error(trace);
+		failed = 1;
+	}
+	vs_del_splitter(sp);
+	if (trace) {
+		vs_trace_del(trace);
+		fclose(tracefile);
 	}
 	return 0;
 }
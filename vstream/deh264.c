@@ -26,23 +26,222 @@
 #include "vstream.h"
 #include "util.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
 
-int main() {
-	uint8_t *bytes = 0;
-	int bytesnum = 0;
-	int bytesmax = 0;
+/*
+ * Slices are parsed as jobs, possibly on worker threads (-j).  Output for
+ * them is always printed by the main thread in stream order.  Parameter sets
+ * can only change while no slice jobs are in flight.
+ */
+
+struct slice_job {
+	uint8_t *bytes;
+	int bytesnum;
+	struct h264_seqparm **seqparms;
+	struct h264_picparm **picparms;
+	struct h264_slice *slice;
+	struct h264_mb_arena *arena;
+	enum {
+		SLICE_FAIL_HEADER,
+		SLICE_FAIL_DATA,
+		SLICE_OK,
+	} status;
+	int done;
+};
+
+static int nthreads;
+static pthread_t *threads;
+static pthread_mutex_t job_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t job_cond_work = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t job_cond_done = PTHREAD_COND_INITIALIZER;
+static struct slice_job **jobs;
+/* one macroblock arena per job slot, a slot is only reused once its job is printed */
+static struct h264_mb_arena *arenas;
+static int jobsmax;
+/* free-running counters, indexing jobs modulo jobsmax */
+static int job_head, job_claim, job_tail;
+static int job_quit;
+static int failed;
+/* binary trace output, replaces the text dump when given */
+static struct vs_trace *trace;
+
+static void begin_nal(void) {
+	if (failed && !trace)
+		printf("\n");
+	failed = 0;
+}
+
+static void print_nal_header(uint32_t nal_ref_idc, uint32_t nal_unit_type) {
+	if (trace) {
+		vs_trace_unit(trace, nal_ref_idc << 5 | nal_unit_type);
+		return;
+	}
+	printf("NAL unit:\n");
+	printf("\tnal_ref_idc = %d\n", nal_ref_idc);
+	printf("\tnal_unit_type = %d\n", nal_unit_type);
+}
+
+static void end_nal(int ok) {
+	if (!ok) {
+		if (trace)
+			vs_trace_error(trace);
+		failed = 1;
+	} else if (!trace) {
+		printf("NAL decoded successfully\n\n");
+	}
+}
+
+static void parse_slice(struct slice_job *job) {
+	struct bitstream *str = vs_new_decode(VS_H264, job->bytes, job->bytesnum);
+	struct h264_slice *slice = job->slice;
+	uint32_t start_code;
+	job->status = SLICE_FAIL_HEADER;
+	if (vs_start(str, &start_code))
+		goto out;
+	if (h264_slice_header(str, job->seqparms, job->picparms, slice))
+		goto out;
+	job->status = SLICE_FAIL_DATA;
+	h264_mb_arena_attach(job->arena, slice);
+	if (h264_slice_data(str, slice))
+		goto out;
+	job->status = SLICE_OK;
+out:
+	vs_destroy(str);
+}
+
+static void retire_slice(struct slice_job *job) {
+	begin_nal();
+	print_nal_header(job->slice->nal_ref_idc, job->slice->nal_unit_type);
+	if (job->status != SLICE_FAIL_HEADER) {
+		if (trace) {
+			h264_trace_slice_header(trace, job->slice);
+			h264_trace_slice_data(trace, job->slice);
+		} else {
+			h264_print_slice_header(job->slice);
+			h264_print_slice_data(job->slice);
+		}
+	}
+	end_nal(job->status == SLICE_OK);
+	h264_del_slice(job->slice);
+	free(job);
+}
+
+static void *slice_worker(void *arg) {
+	pthread_mutex_lock(&job_mutex);
+	while (1) {
+		while (!job_quit && job_claim == job_tail)
+			pthread_cond_wait(&job_cond_work, &job_mutex);
+		if (job_claim == job_tail)
+			break;
+		struct slice_job *job = jobs[job_claim++ % jobsmax];
+		pthread_mutex_unlock(&job_mutex);
+		parse_slice(job);
+		pthread_mutex_lock(&job_mutex);
+		job->done = 1;
+		pthread_cond_broadcast(&job_cond_done);
+	}
+	pthread_mutex_unlock(&job_mutex);
+	return 0;
+}
+
+static void retire_oldest(void) {
+	pthread_mutex_lock(&job_mutex);
+	struct slice_job *job = jobs[job_head % jobsmax];
+	while (!job->done)
+		pthread_cond_wait(&job_cond_done, &job_mutex);
+	job_head++;
+	pthread_mutex_unlock(&job_mutex);
+	retire_slice(job);
+}
+
+static void flush_slices(void) {
+	while (job_head != job_tail)
+		retire_oldest();
+}
+
+static void queue_slice(struct slice_job *job) {
+	if (!nthreads) {
+		job->arena = &arenas[0];
+		parse_slice(job);
+		retire_slice(job);
+		return;
+	}
+	if (job_tail - job_head == jobsmax)
+		retire_oldest();
+	job->arena = &arenas[job_tail % jobsmax];
+	pthread_mutex_lock(&job_mutex);
+	jobs[job_tail++ % jobsmax] = job;
+	pthread_cond_signal(&job_cond_work);
+	pthread_mutex_unlock(&job_mutex);
+}
+
+static void start_workers(void) {
+	int i;
+	jobsmax = nthreads * 4;
+	jobs = calloc(sizeof *jobs, jobsmax);
+	arenas = calloc(sizeof *arenas, jobsmax);
+	threads = calloc(sizeof *threads, nthreads);
+	for (i = 0; i < nthreads; i++)
+		pthread_create(&threads[i], 0, slice_worker, 0);
+}
+
+static void stop_workers(void) {
+	int i;
+	flush_slices();
+	pthread_mutex_lock(&job_mutex);
+	job_quit = 1;
+	pthread_cond_broadcast(&job_cond_work);
+	pthread_mutex_unlock(&job_mutex);
+	for (i = 0; i < nthreads; i++)
+		pthread_join(threads[i], 0);
+	for (i = 0; i < jobsmax; i++)
+		h264_mb_arena_fini(&arenas[i]);
+	free(threads);
+	free(jobs);
+	free(arenas);
+}
+
+
+int main(int argc, char **argv) {
+	FILE *tracefile = 0;
 	int c;
-	while ((c = getchar()) != EOF) {
-		ADDARRAY(bytes, c);
+	while ((c = getopt(argc, argv, "j:t:")) != -1) {
+		switch (c) {
+			case 'j':
+				nthreads = atoi(optarg);
+				break;
+			case 't':
+				if (!(tracefile = fopen(optarg, "wb"))) {
+					perror(optarg);
+					return 1;
+				}
+				trace = vs_trace_new(tracefile);
+				break;
+			default:
+				fprintf(stderr, "Usage: %s [-j threads] [-t tracefile] < stream.264\n", argv[0]);
+				return 1;
+		}
 	}
-	struct bitstream *str = vs_new_decode(VS_H264, bytes, bytesnum);
+	if (nthreads < 0)
+		nthreads = 0;
+	if (nthreads)
+		start_workers();
+	else
+		arenas = calloc(sizeof *arenas, 1);
+	struct vs_splitter *split = vs_new_splitter(stdin);
+	uint8_t *bytes;
+	int bytesnum;
+	struct bitstream *str = vs_new_decode(VS_H264, 0, 0);
 	struct h264_seqparm *seqparms[32] = { 0 };
 	struct h264_seqparm *subseqparms[32] = { 0 };
 	struct h264_picparm *picparms[256] = { 0 };
-	int res;
 	int last_idr = 0;
-	while (1) {
+	while (vs_splitter_next(split, &bytes, &bytesnum)) {
 		uint32_t start_code;
+		vs_reset_decode(str, bytes, bytesnum);
 		if (vs_start(str, &start_code)) goto err;
 		if (start_code & 0x80) {
 			fprintf(stderr, "forbidden_zero_bit not 0\n");
@@ -50,12 +249,10 @@ int main() {
 		}
 		uint32_t nal_ref_idc = start_code >> 5;
 		uint32_t nal_unit_type = start_code & 0x1f;
-		printf("NAL unit:\n");
-		printf("\tnal_ref_idc = %d\n", nal_ref_idc);
-		printf("\tnal_unit_type = %d\n", nal_unit_type);
 		struct h264_seqparm *sp;
 		struct h264_picparm *pp;
 		struct h264_slice *slice;
+		struct slice_job *job;
 		uint32_t idx;
 		uint32_t additional_extension_flag = 0;
 		switch (nal_unit_type) {
@@ -71,20 +268,20 @@ int main() {
 					last_idr = 0;
 				/* for AUX, keep IDR status of last slice */
 				slice->idr_pic_flag = last_idr;
-				if (h264_slice_header(str, seqparms, picparms, slice)) {
-					h264_del_slice(slice);
-					goto err;
-				}
-				h264_print_slice_header(slice);
-				slice->mbs = calloc (sizeof *slice->mbs, slice->pic_size_in_mbs);
-				if (h264_slice_data(str, slice)) {
-					h264_print_slice_data(slice);
-					h264_del_slice(slice);
-					goto err;
-				}
-				h264_print_slice_data(slice);
-				h264_del_slice(slice);
-				break;
+				job = calloc (sizeof *job, 1);
+				job->slice = slice;
+				job->seqparms = seqparms;
+				job->picparms = picparms;
+				job->bytesnum = bytesnum;
+				job->bytes = malloc(bytesnum);
+				memcpy(job->bytes, bytes, bytesnum);
+				queue_slice(job);
+				continue;
+		}
+		flush_slices();
+		begin_nal();
+		print_nal_header(nal_ref_idc, nal_unit_type);
+		switch (nal_unit_type) {
 			case H264_NAL_UNIT_TYPE_SEQPARM:
 				sp = calloc (sizeof *sp, 1);
 				if (h264_seqparm(str, sp)) {
@@ -95,7 +292,10 @@ int main() {
 					h264_del_seqparm(sp);
 					goto err;
 				}
-				h264_print_seqparm(sp);
+				if (trace)
+					h264_trace_seqparm(trace, sp);
+				else
+					h264_print_seqparm(sp);
 				if (sp->seq_parameter_set_id > 31) {
 					fprintf(stderr, "seq_parameter_set_id out of bounds\n");
 					goto err;
@@ -115,7 +315,10 @@ int main() {
 					h264_del_picparm(pp);
 					goto err;
 				}
-				h264_print_picparm(pp);
+				if (trace)
+					h264_trace_picparm(trace, pp);
+				else
+					h264_print_picparm(pp);
 				if (pp->pic_parameter_set_id > 255) {
 					fprintf(stderr, "pic_parameter_set_id out of bounds\n");
 					goto err;
@@ -130,12 +333,17 @@ int main() {
 					goto err;
 				if (vs_end(str))
 					goto err;
-				h264_print_seqparm_ext(seqparms[idx]);
+				if (trace)
+					h264_trace_seqparm_ext(trace, seqparms[idx]);
+				else
+					h264_print_seqparm_ext(seqparms[idx]);
 				break;
 			case H264_NAL_UNIT_TYPE_ACC_UNIT_DELIM: {
 				uint32_t primary_pic_type;
 				if (vs_u(str, &primary_pic_type, 3)) goto err;
 				if (vs_end(str)) goto err;
+				if (trace)
+					break;
 				printf ("Access unit delimiter:\n");
 				static const char *const names[8] = {
 					"I",
@@ -151,10 +359,12 @@ int main() {
 				break;
 			}
 			case H264_NAL_UNIT_TYPE_END_SEQ:
-				printf ("End of sequence.\n");
+				if (!trace)
+					printf ("End of sequence.\n");
 				break;
 			case H264_NAL_UNIT_TYPE_END_STREAM:
-				printf ("End of stream.\n");
+				if (!trace)
+					printf ("End of stream.\n");
 				break;
 			case H264_NAL_UNIT_TYPE_SUBSET_SEQPARM:
 				sp = calloc (sizeof *sp, 1);
@@ -197,7 +407,10 @@ int main() {
 					h264_del_seqparm(sp);
 					goto err;
 				}
-				h264_print_seqparm(sp);
+				if (trace)
+					h264_trace_seqparm(trace, sp);
+				else
+					h264_print_seqparm(sp);
 				if (sp->seq_parameter_set_id > 31) {
 					fprintf(stderr, "seq_parameter_set_id out of bounds\n");
 					goto err;
@@ -211,15 +424,19 @@ int main() {
 				fprintf(stderr, "Unknown NAL type\n");
 				goto err;
 		}
-		printf("NAL decoded successfully\n\n");
+		end_nal(1);
 		continue;
 err:
-		res = vs_search_start(str);
-		if (res == -1)
-			return 1;
-		if (!res)
-			break;
-		printf("\n");
+		flush_slices();
+		begin_nal();
+		end_nal(0);
+	}
+	if (nthreads)
+		stop_workers();
+	vs_del_splitter(split);
+	if (trace) {
+		vs_trace_del(trace);
+		fclose(tracefile);
 	}
 	return 0;
 }
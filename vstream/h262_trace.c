@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2016 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "h262.h"
+
+void h262_trace_seqparm(struct vs_trace *tr, struct h262_seqparm *seqparm) {
+	vs_trace_begin(tr, VS_TRACE_H262_SEQPARM);
+	vs_trace_val(tr, seqparm->is_ext);
+	vs_trace_val(tr, seqparm->horizontal_size);
+	vs_trace_val(tr, seqparm->vertical_size);
+	vs_trace_val(tr, seqparm->aspect_ratio_information);
+	vs_trace_val(tr, seqparm->frame_rate_code);
+	vs_trace_val(tr, seqparm->bit_rate);
+	vs_trace_val(tr, seqparm->vbv_buffer_size);
+	vs_trace_val(tr, seqparm->constrained_parameters_flag);
+	vs_trace_val(tr, seqparm->load_intra_quantiser_matrix);
+	if (seqparm->load_intra_quantiser_matrix)
+		vs_trace_uvals(tr, seqparm->intra_quantiser_matrix, 64);
+	vs_trace_val(tr, seqparm->load_non_intra_quantiser_matrix);
+	if (seqparm->load_non_intra_quantiser_matrix)
+		vs_trace_uvals(tr, seqparm->non_intra_quantiser_matrix, 64);
+	if (seqparm->is_ext) {
+		vs_trace_val(tr, seqparm->profile_and_level_indication);
+		vs_trace_val(tr, seqparm->progressive_sequence);
+		vs_trace_val(tr, seqparm->chroma_format);
+		vs_trace_val(tr, seqparm->low_delay);
+		vs_trace_val(tr, seqparm->frame_rate_extension_n);
+		vs_trace_val(tr, seqparm->frame_rate_extension_d);
+	}
+	vs_trace_end(tr);
+}
+
+void h262_trace_picparm(struct vs_trace *tr, struct h262_picparm *picparm) {
+	vs_trace_begin(tr, VS_TRACE_H262_PICPARM);
+	vs_trace_val(tr, picparm->is_ext);
+	vs_trace_val(tr, picparm->temporal_reference);
+	vs_trace_val(tr, picparm->picture_coding_type);
+	vs_trace_val(tr, picparm->vbv_delay);
+	if (picparm->picture_coding_type == H262_PIC_TYPE_P || picparm->picture_coding_type == H262_PIC_TYPE_B) {
+		vs_trace_val(tr, picparm->full_pel_forward_vector);
+		vs_trace_val(tr, picparm->forward_f_code);
+	}
+	if (picparm->picture_coding_type == H262_PIC_TYPE_B) {
+		vs_trace_val(tr, picparm->full_pel_backward_vector);
+		vs_trace_val(tr, picparm->backward_f_code);
+	}
+	if (picparm->is_ext) {
+		vs_trace_uvals(tr, picparm->f_code[0], 4);
+		vs_trace_val(tr, picparm->intra_dc_precision);
+		vs_trace_val(tr, picparm->picture_structure);
+		vs_trace_val(tr, picparm->top_field_first);
+		vs_trace_val(tr, picparm->frame_pred_frame_dct);
+		vs_trace_val(tr, picparm->concealment_motion_vectors);
+		vs_trace_val(tr, picparm->q_scale_type);
+		vs_trace_val(tr, picparm->intra_vlc_format);
+		vs_trace_val(tr, picparm->alternate_scan);
+		vs_trace_val(tr, picparm->repeat_first_field);
+		vs_trace_val(tr, picparm->chroma_420_type);
+		vs_trace_val(tr, picparm->progressive_frame);
+		vs_trace_val(tr, picparm->composite_display_flag);
+		if (picparm->composite_display_flag) {
+			vs_trace_val(tr, picparm->v_axis);
+			vs_trace_val(tr, picparm->field_sequence);
+			vs_trace_val(tr, picparm->sub_carrier);
+			vs_trace_val(tr, picparm->burst_amplitude);
+			vs_trace_val(tr, picparm->sub_carrier_phase);
+		}
+	}
+	vs_trace_end(tr);
+}
+
+void h262_trace_gop(struct vs_trace *tr, struct h262_gop *gop) {
+	vs_trace_begin(tr, VS_TRACE_H262_GOP);
+	vs_trace_val(tr, gop->drop_frame_flag);
+	vs_trace_val(tr, gop->time_code_hours);
+	vs_trace_val(tr, gop->time_code_minutes);
+	vs_trace_val(tr, gop->time_code_seconds);
+	vs_trace_val(tr, gop->time_code_pictures);
+	vs_trace_val(tr, gop->closed_gop);
+	vs_trace_val(tr, gop->broken_link);
+	vs_trace_end(tr);
+}
+
+static void h262_trace_macroblock(struct vs_trace *tr, struct h262_seqparm *seqparm, struct h262_picparm *picparm, struct h262_macroblock *mb, int addr) {
+	static const int block_count[4] = { 4, 6, 8, 12 };
+	vs_trace_begin(tr, VS_TRACE_H262_MACROBLOCK);
+	vs_trace_val(tr, addr);
+	vs_trace_val(tr, mb->macroblock_skipped);
+	vs_trace_val(tr, mb->macroblock_quant);
+	vs_trace_val(tr, mb->macroblock_motion_forward);
+	vs_trace_val(tr, mb->macroblock_motion_backward);
+	vs_trace_val(tr, mb->macroblock_pattern);
+	vs_trace_val(tr, mb->macroblock_intra);
+	if (!mb->macroblock_intra) {
+		if (picparm->picture_structure == H262_PIC_STRUCT_FRAME)
+			vs_trace_val(tr, mb->frame_motion_type);
+		else
+			vs_trace_val(tr, mb->field_motion_type);
+	}
+	if (mb->macroblock_intra || mb->macroblock_pattern)
+		vs_trace_val(tr, mb->dct_type);
+	vs_trace_val(tr, mb->quantiser_scale_code);
+	/* unlike the text dump, motion is stored whole - unused entries are zero */
+	if (!mb->macroblock_intra && !mb->macroblock_skipped) {
+		vs_trace_uvals(tr, mb->motion_vertical_field_select[0], 4);
+		vs_trace_uvals(tr, mb->motion_code[0][0], 8);
+		vs_trace_uvals(tr, mb->motion_residual[0][0], 8);
+		vs_trace_uvals(tr, mb->dmvector, 2);
+	}
+	vs_trace_val(tr, mb->coded_block_pattern);
+	vs_trace_vals(tr, mb->block[0], block_count[seqparm->chroma_format] * 64);
+	vs_trace_end(tr);
+}
+
+void h262_trace_slice(struct vs_trace *tr, struct h262_seqparm *seqparm, struct h262_picparm *picparm, struct h262_slice *slice) {
+	int i;
+	vs_trace_begin(tr, VS_TRACE_H262_SLICE);
+	vs_trace_val(tr, slice->slice_vertical_position);
+	vs_trace_val(tr, slice->quantiser_scale_code);
+	vs_trace_end(tr);
+	if (slice->first_mb_in_slice == -1)
+		return;
+	for (i = slice->first_mb_in_slice; i <= slice->last_mb_in_slice; i++)
+		h262_trace_macroblock(tr, seqparm, picparm, &slice->mbs[i], i);
+}
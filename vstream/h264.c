@@ -56,10 +56,33 @@ void h264_del_slice(struct h264_slice *slice) {
 	free(slice->dec_ref_pic_marking.mmcos);
 	free(slice->dec_ref_base_pic_marking.mmcos);
 	free(slice->sgmap);
-	free(slice->mbs);
+	if (!slice->mb_arena)
+		free(slice->mbs);
 	free(slice);
 }
 
+void h264_mb_arena_attach(struct h264_mb_arena *arena, struct h264_slice *slice) {
+	/* size for a whole frame of the SPS, so that alternating fields and frames don't keep growing it */
+	struct h264_seqparm *seqparm = slice->seqparm;
+	uint32_t num = (seqparm->pic_width_in_mbs_minus1 + 1) * (seqparm->pic_height_in_map_units_minus1 + 1) * (2 - seqparm->frame_mbs_only_flag);
+	if (num < slice->pic_size_in_mbs)
+		num = slice->pic_size_in_mbs;
+	if (arena->mbsmax < num) {
+		free(arena->mbs);
+		arena->mbs = malloc(num * sizeof *arena->mbs);
+		arena->mbsmax = num;
+	}
+	/* no clearing here - h264_slice_data clears each macroblock as it gets to it */
+	slice->mbs = arena->mbs;
+	slice->mb_arena = arena;
+}
+
+void h264_mb_arena_fini(struct h264_mb_arena *arena) {
+	free(arena->mbs);
+	arena->mbs = 0;
+	arena->mbsmax = 0;
+}
+
 int h264_scaling_list(struct bitstream *str, uint32_t *scaling_list, int size, uint32_t *use_default_flag) {
 	uint32_t lastScale = 8;
 	uint32_t nextScale = 8;
@@ -27,6 +27,8 @@
 #include "util.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
 
 int h264_mb_slice_group(struct h264_slice *slice, uint32_t mbaddr) {
 	if (mbaddr >= slice->pic_size_in_mbs)
@@ -678,6 +680,12 @@ static int infer_skip(struct bitstream *str, struct h264_slice *slice, struct h2
 
 	}
 	if (vs_infer(str, &mb->mb_type, skip_type)) return 1;
+	if (str->dir == VS_DECODE) {
+		/* residual isn't parsed for skipped mbs, clear the blocks it'd have filled */
+		memset(mb->block_luma_4x4, 0, sizeof mb->block_luma_4x4);
+		memset(mb->block_chroma_dc, 0, sizeof mb->block_chroma_dc);
+		memset(mb->block_chroma_ac, 0, sizeof mb->block_chroma_ac);
+	}
 	if (vs_infers(str, &mb->mb_qp_delta, 0)) return 1;
 	if (vs_infer(str, &mb->transform_size_8x8_flag, 0)) return 1;
 	if (vs_infer(str, &mb->coded_block_pattern, 0)) return 1;
@@ -698,11 +706,29 @@ static int infer_skip(struct bitstream *str, struct h264_slice *slice, struct h2
 	return 0;
 }
 
+static int enter_mb(struct bitstream *str, struct h264_slice *slice) {
+	if (slice->curr_mb_addr >= slice->pic_size_in_mbs) {
+		fprintf(stderr, "MB index out of range!\n");
+		return 1;
+	}
+	/* the arrays at the end are cleared by whoever fills them, only do the rest here */
+	if (str->dir == VS_DECODE)
+		memset(&slice->mbs[slice->curr_mb_addr], 0, offsetof(struct h264_macroblock, pcm_sample_luma));
+	return 0;
+}
+
 int h264_slice_data(struct bitstream *str, struct h264_slice *slice) {
 	slice->prev_mb_addr = -1;
 	slice->curr_mb_addr = slice->first_mb_in_slice * (1 + slice->mbaff_frame_flag);
-	if (str->dir == VS_DECODE)
+	if (slice->curr_mb_addr >= slice->pic_size_in_mbs) {
+		fprintf(stderr, "MB index out of range!\n");
+		return 1;
+	}
+	if (str->dir == VS_DECODE) {
 		slice->last_mb_in_slice = slice->curr_mb_addr;
+		/* the first mb gets printed even if decoding it fails - make sure it's all clear */
+		memset(&slice->mbs[slice->curr_mb_addr], 0, sizeof *slice->mbs);
+	}
 	uint32_t skip_type = (slice->slice_type == H264_SLICE_TYPE_B ? H264_MB_TYPE_B_SKIP : H264_MB_TYPE_P_SKIP);
 	if (slice->picparm->entropy_coding_mode_flag) {
 		if (vs_align_byte(str, VS_ALIGN_1)) return 1;
@@ -710,6 +736,7 @@ int h264_slice_data(struct bitstream *str, struct h264_slice *slice) {
 		if (h264_cabac_init_arith(str, cabac)) { h264_cabac_destroy(cabac); return 1; }
 		while (1) {
 			uint32_t mb_skip_flag = 0;
+			if (enter_mb(str, slice)) { h264_cabac_destroy(cabac); return 1; }
 			if (slice->slice_type != H264_SLICE_TYPE_I && slice->slice_type != H264_SLICE_TYPE_SI) {
 				if (str->dir == VS_ENCODE) {
 					mb_skip_flag = slice->mbs[slice->curr_mb_addr].mb_type == skip_type;
@@ -788,10 +815,7 @@ int h264_slice_data(struct bitstream *str, struct h264_slice *slice) {
 				} else {
 					if (vs_ue(str, &mb_skip_run)) return 1;
 					while (mb_skip_run--) {
-						if (slice->curr_mb_addr >= slice->pic_size_in_mbs) {
-							fprintf(stderr, "MB index out of range!\n");
-							return 1;
-						}
+						if (enter_mb(str, slice)) return 1;
 						slice->last_mb_in_slice = slice->curr_mb_addr;
 						slice->mbs[slice->curr_mb_addr].mb_type = skip_type;
 						if (infer_skip(str, slice, &slice->mbs[slice->curr_mb_addr])) return 1;
@@ -806,10 +830,7 @@ int h264_slice_data(struct bitstream *str, struct h264_slice *slice) {
 						goto out_cavlc;
 				}
 			}
-			if (slice->curr_mb_addr >= slice->pic_size_in_mbs) {
-				fprintf(stderr, "MB index out of range!\n");
-				return 1;
-			}
+			if (enter_mb(str, slice)) return 1;
 			if (slice->mbaff_frame_flag) {
 				uint32_t first_addr = slice->curr_mb_addr & ~1;
 				if (slice->curr_mb_addr == first_addr) {
@@ -0,0 +1,477 @@
+/*
+ * Copyright (C) 2016 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "h264.h"
+
+/*
+ * Binary counterparts of the h264_print_* functions.  Each record carries the
+ * same syntax elements, in the same order and under the same conditions, as
+ * the matching text dump - just without the names.
+ */
+
+static void h264_trace_hrd(struct vs_trace *tr, struct h264_hrd_parameters *hrd) {
+	int i;
+	vs_trace_val(tr, hrd->cpb_cnt_minus1);
+	vs_trace_val(tr, hrd->bit_rate_scale);
+	vs_trace_val(tr, hrd->cpb_size_scale);
+	for (i = 0; i <= hrd->cpb_cnt_minus1; i++) {
+		vs_trace_val(tr, hrd->bit_rate_value_minus1[i]);
+		vs_trace_val(tr, hrd->cpb_size_value_minus1[i]);
+		vs_trace_val(tr, hrd->cbr_flag[i]);
+	}
+	vs_trace_val(tr, hrd->initial_cpb_removal_delay_length_minus1);
+	vs_trace_val(tr, hrd->cpb_removal_delay_length_minus1);
+	vs_trace_val(tr, hrd->dpb_output_delay_length_minus1);
+	vs_trace_val(tr, hrd->time_offset_length);
+}
+
+static void h264_trace_vui(struct vs_trace *tr, struct h264_vui *vui) {
+	vs_trace_val(tr, vui->aspect_ratio_present_flag);
+	vs_trace_val(tr, vui->aspect_ratio_idc);
+	vs_trace_val(tr, vui->sar_width);
+	vs_trace_val(tr, vui->sar_height);
+	vs_trace_val(tr, vui->overscan_info_present_flag);
+	if (vui->overscan_info_present_flag)
+		vs_trace_val(tr, vui->overscan_appropriate_flag);
+	vs_trace_val(tr, vui->video_signal_type_present_flag);
+	vs_trace_val(tr, vui->video_format);
+	vs_trace_val(tr, vui->video_full_range_flag);
+	vs_trace_val(tr, vui->colour_description_present_flag);
+	vs_trace_val(tr, vui->colour_primaries);
+	vs_trace_val(tr, vui->transfer_characteristics);
+	vs_trace_val(tr, vui->matrix_coefficients);
+	vs_trace_val(tr, vui->chroma_loc_info_present_flag);
+	vs_trace_val(tr, vui->chroma_sample_loc_type_top_field);
+	vs_trace_val(tr, vui->chroma_sample_loc_type_bottom_field);
+	vs_trace_val(tr, vui->timing_info_present_flag);
+	if (vui->timing_info_present_flag) {
+		vs_trace_val(tr, vui->num_units_in_tick);
+		vs_trace_val(tr, vui->time_scale);
+	}
+	vs_trace_val(tr, vui->fixed_frame_rate_flag);
+	vs_trace_val(tr, !!vui->nal_hrd_parameters);
+	if (vui->nal_hrd_parameters)
+		h264_trace_hrd(tr, vui->nal_hrd_parameters);
+	vs_trace_val(tr, !!vui->vcl_hrd_parameters);
+	if (vui->vcl_hrd_parameters)
+		h264_trace_hrd(tr, vui->vcl_hrd_parameters);
+	if (vui->nal_hrd_parameters || vui->vcl_hrd_parameters)
+		vs_trace_val(tr, vui->low_delay_hrd_flag);
+	vs_trace_val(tr, vui->pic_struct_present_flag);
+	vs_trace_val(tr, vui->bitstream_restriction_present_flag);
+	vs_trace_val(tr, vui->motion_vectors_over_pic_bounduaries_flag);
+	vs_trace_val(tr, vui->max_bytes_per_pic_denom);
+	vs_trace_val(tr, vui->max_bits_per_mb_denom);
+	vs_trace_val(tr, vui->log2_max_mv_length_horizontal);
+	vs_trace_val(tr, vui->log2_max_mv_length_vertical);
+	vs_trace_val(tr, vui->num_reorder_frames);
+	vs_trace_val(tr, vui->max_dec_frame_buffering);
+}
+
+void h264_trace_seqparm(struct vs_trace *tr, struct h264_seqparm *seqparm) {
+	int i, j;
+	vs_trace_begin(tr, VS_TRACE_H264_SEQPARM);
+	vs_trace_val(tr, seqparm->profile_idc);
+	vs_trace_val(tr, seqparm->constraint_set);
+	vs_trace_val(tr, seqparm->level_idc);
+	vs_trace_val(tr, seqparm->seq_parameter_set_id);
+	vs_trace_val(tr, seqparm->chroma_format_idc);
+	vs_trace_val(tr, seqparm->separate_colour_plane_flag);
+	vs_trace_val(tr, seqparm->bit_depth_luma_minus8);
+	vs_trace_val(tr, seqparm->bit_depth_chroma_minus8);
+	vs_trace_val(tr, seqparm->qpprime_y_zero_transform_bypass_flag);
+	vs_trace_val(tr, seqparm->seq_scaling_matrix_present_flag);
+	if (seqparm->seq_scaling_matrix_present_flag) {
+		for (i = 0; i < (seqparm->chroma_format_idc == 3 ? 12 : 8); i++) {
+			vs_trace_val(tr, seqparm->seq_scaling_list_present_flag[i]);
+			if (seqparm->seq_scaling_list_present_flag[i]) {
+				vs_trace_val(tr, seqparm->use_default_scaling_matrix_flag[i]);
+				if (!seqparm->use_default_scaling_matrix_flag[i]) {
+					if (i < 6)
+						vs_trace_uvals(tr, seqparm->seq_scaling_list_4x4[i], 16);
+					else
+						vs_trace_uvals(tr, seqparm->seq_scaling_list_8x8[i-6], 64);
+				}
+			}
+		}
+	}
+	vs_trace_val(tr, seqparm->log2_max_frame_num_minus4);
+	vs_trace_val(tr, seqparm->pic_order_cnt_type);
+	switch (seqparm->pic_order_cnt_type) {
+		case 0:
+			vs_trace_val(tr, seqparm->log2_max_pic_order_cnt_lsb_minus4);
+			break;
+		case 1:
+			vs_trace_val(tr, seqparm->delta_pic_order_always_zero_flag);
+			vs_trace_val(tr, seqparm->offset_for_non_ref_pic);
+			vs_trace_val(tr, seqparm->offset_for_top_to_bottom_field);
+			vs_trace_val(tr, seqparm->num_ref_frames_in_pic_order_cnt_cycle);
+			for (i = 0; i < seqparm->num_ref_frames_in_pic_order_cnt_cycle; i++)
+				vs_trace_val(tr, seqparm->offset_for_ref_frame[i]);
+			break;
+	}
+	vs_trace_val(tr, seqparm->max_num_ref_frames);
+	vs_trace_val(tr, seqparm->gaps_in_frame_num_value_allowed_flag);
+	vs_trace_val(tr, seqparm->pic_width_in_mbs_minus1);
+	vs_trace_val(tr, seqparm->pic_height_in_map_units_minus1);
+	vs_trace_val(tr, seqparm->frame_mbs_only_flag);
+	vs_trace_val(tr, seqparm->mb_adaptive_frame_field_flag);
+	vs_trace_val(tr, seqparm->direct_8x8_inference_flag);
+	vs_trace_val(tr, seqparm->frame_cropping_flag);
+	vs_trace_val(tr, seqparm->frame_crop_left_offset);
+	vs_trace_val(tr, seqparm->frame_crop_right_offset);
+	vs_trace_val(tr, seqparm->frame_crop_top_offset);
+	vs_trace_val(tr, seqparm->frame_crop_bottom_offset);
+	vs_trace_val(tr, !!seqparm->vui);
+	if (seqparm->vui)
+		h264_trace_vui(tr, seqparm->vui);
+	vs_trace_val(tr, seqparm->is_svc);
+	if (seqparm->is_svc) {
+		vs_trace_val(tr, seqparm->inter_layer_deblocking_filter_control_present_flag);
+		vs_trace_val(tr, seqparm->extended_spatial_scalability_idc);
+		vs_trace_val(tr, seqparm->chroma_phase_x_plus1_flag);
+		vs_trace_val(tr, seqparm->chroma_phase_y_plus1);
+		vs_trace_val(tr, seqparm->seq_ref_layer_chroma_phase_x_plus1_flag);
+		vs_trace_val(tr, seqparm->seq_ref_layer_chroma_phase_y_plus1);
+		vs_trace_val(tr, seqparm->seq_ref_layer_left_offset);
+		vs_trace_val(tr, seqparm->seq_ref_layer_top_offset);
+		vs_trace_val(tr, seqparm->seq_ref_layer_right_offset);
+		vs_trace_val(tr, seqparm->seq_ref_layer_bottom_offset);
+		vs_trace_val(tr, seqparm->seq_tcoeff_level_prediction_flag);
+		vs_trace_val(tr, seqparm->adaptive_tcoeff_level_prediction_flag);
+		vs_trace_val(tr, seqparm->slice_header_restriction_flag);
+	}
+	vs_trace_val(tr, seqparm->is_mvc);
+	if (seqparm->is_mvc) {
+		vs_trace_val(tr, seqparm->num_views_minus1);
+		for (i = 0; i <= seqparm->num_views_minus1; i++) {
+			vs_trace_val(tr, seqparm->views[i].view_id);
+			vs_trace_val(tr, seqparm->views[i].num_anchor_refs_l0);
+			for (j = 1; j < seqparm->views[i].num_anchor_refs_l0; j++)
+				vs_trace_val(tr, seqparm->views[i].anchor_ref_l0[j]);
+			vs_trace_val(tr, seqparm->views[i].num_anchor_refs_l1);
+			for (j = 1; j < seqparm->views[i].num_anchor_refs_l1; j++)
+				vs_trace_val(tr, seqparm->views[i].anchor_ref_l1[j]);
+			vs_trace_val(tr, seqparm->views[i].num_non_anchor_refs_l0);
+			for (j = 1; j < seqparm->views[i].num_non_anchor_refs_l0; j++)
+				vs_trace_val(tr, seqparm->views[i].non_anchor_ref_l0[j]);
+			vs_trace_val(tr, seqparm->views[i].num_non_anchor_refs_l1);
+			for (j = 1; j < seqparm->views[i].num_non_anchor_refs_l1; j++)
+				vs_trace_val(tr, seqparm->views[i].non_anchor_ref_l1[j]);
+		}
+		vs_trace_val(tr, seqparm->num_level_values_signalled_minus1);
+		for (i = 0; i <= seqparm->num_level_values_signalled_minus1; i++) {
+			vs_trace_val(tr, seqparm->levels[i].level_idc);
+			vs_trace_val(tr, seqparm->levels[i].num_applicable_ops_minus1);
+			for (j = 0; j <= seqparm->levels[i].num_applicable_ops_minus1; j++) {
+				struct h264_seqparm_mvc_applicable_op *op = &seqparm->levels[i].applicable_ops[j];
+				vs_trace_val(tr, op->temporal_id);
+				vs_trace_val(tr, op->num_target_views_minus1);
+				vs_trace_uvals(tr, op->target_view_id, op->num_target_views_minus1 + 1);
+				vs_trace_val(tr, op->num_views_minus1);
+			}
+		}
+	}
+	vs_trace_end(tr);
+}
+
+void h264_trace_seqparm_ext(struct vs_trace *tr, struct h264_seqparm *seqparm) {
+	vs_trace_begin(tr, VS_TRACE_H264_SEQPARM_EXT);
+	vs_trace_val(tr, seqparm->aux_format_idc);
+	if (seqparm->aux_format_idc) {
+		vs_trace_val(tr, seqparm->bit_depth_aux_minus8);
+		vs_trace_val(tr, seqparm->alpha_incr_flag);
+		vs_trace_val(tr, seqparm->alpha_opaque_value);
+		vs_trace_val(tr, seqparm->alpha_transparent_value);
+	}
+	vs_trace_end(tr);
+}
+
+void h264_trace_picparm(struct vs_trace *tr, struct h264_picparm *picparm) {
+	int i;
+	vs_trace_begin(tr, VS_TRACE_H264_PICPARM);
+	vs_trace_val(tr, picparm->pic_parameter_set_id);
+	vs_trace_val(tr, picparm->seq_parameter_set_id);
+	vs_trace_val(tr, picparm->entropy_coding_mode_flag);
+	vs_trace_val(tr, picparm->bottom_field_pic_order_in_frame_present_flag);
+	vs_trace_val(tr, picparm->num_slice_groups_minus1);
+	if (picparm->num_slice_groups_minus1) {
+		vs_trace_val(tr, picparm->slice_group_map_type);
+		switch (picparm->slice_group_map_type) {
+			case H264_SLICE_GROUP_MAP_INTERLEAVED:
+				vs_trace_uvals(tr, picparm->run_length_minus1, picparm->num_slice_groups_minus1 + 1);
+				break;
+			case H264_SLICE_GROUP_MAP_DISPERSED:
+				break;
+			case H264_SLICE_GROUP_MAP_FOREGROUND:
+				for (i = 0; i < picparm->num_slice_groups_minus1; i++) {
+					vs_trace_val(tr, picparm->top_left[i]);
+					vs_trace_val(tr, picparm->bottom_right[i]);
+				}
+				break;
+			case H264_SLICE_GROUP_MAP_CHANGING_BOX:
+			case H264_SLICE_GROUP_MAP_CHANGING_VERTICAL:
+			case H264_SLICE_GROUP_MAP_CHANGING_HORIZONTAL:
+				vs_trace_val(tr, picparm->slice_group_change_direction_flag);
+				vs_trace_val(tr, picparm->slice_group_change_rate_minus1);
+				break;
+			case H264_SLICE_GROUP_MAP_EXPLICIT:
+				vs_trace_val(tr, picparm->pic_size_in_map_units_minus1);
+				vs_trace_uvals(tr, picparm->slice_group_id, picparm->pic_size_in_map_units_minus1 + 1);
+				break;
+		}
+	}
+	vs_trace_val(tr, picparm->num_ref_idx_l0_default_active_minus1);
+	vs_trace_val(tr, picparm->num_ref_idx_l1_default_active_minus1);
+	vs_trace_val(tr, picparm->weighted_pred_flag);
+	vs_trace_val(tr, picparm->weighted_bipred_idc);
+	vs_trace_val(tr, picparm->pic_init_qp_minus26);
+	vs_trace_val(tr, picparm->pic_init_qs_minus26);
+	vs_trace_val(tr, picparm->chroma_qp_index_offset);
+	vs_trace_val(tr, picparm->deblocking_filter_control_present_flag);
+	vs_trace_val(tr, picparm->constrained_intra_pred_flag);
+	vs_trace_val(tr, picparm->redundant_pic_cnt_present_flag);
+	vs_trace_val(tr, picparm->transform_8x8_mode_flag);
+	vs_trace_val(tr, picparm->pic_scaling_matrix_present_flag);
+	if (picparm->pic_scaling_matrix_present_flag) {
+		for (i = 0; i < (picparm->chroma_format_idc == 3 ? 12 : 8); i++) {
+			vs_trace_val(tr, picparm->pic_scaling_list_present_flag[i]);
+			if (picparm->pic_scaling_list_present_flag[i]) {
+				vs_trace_val(tr, picparm->use_default_scaling_matrix_flag[i]);
+				if (!picparm->use_default_scaling_matrix_flag[i]) {
+					if (i < 6)
+						vs_trace_uvals(tr, picparm->pic_scaling_list_4x4[i], 16);
+					else
+						vs_trace_uvals(tr, picparm->pic_scaling_list_8x8[i-6], 64);
+				}
+			}
+		}
+	}
+	vs_trace_val(tr, picparm->second_chroma_qp_index_offset);
+	vs_trace_end(tr);
+}
+
+static void h264_trace_ref_pic_list_modification(struct vs_trace *tr, struct h264_ref_pic_list_modification *list) {
+	int i;
+	vs_trace_val(tr, list->flag);
+	for (i = 0; list->list[i].op != 3; i++) {
+		vs_trace_val(tr, list->list[i].op);
+		vs_trace_val(tr, list->list[i].param);
+	}
+	vs_trace_val(tr, 3);
+}
+
+static void h264_trace_pred_weight(struct vs_trace *tr, struct h264_pred_weight_table_entry *entry) {
+	vs_trace_val(tr, entry->luma_weight_flag);
+	vs_trace_val(tr, entry->luma_weight);
+	vs_trace_val(tr, entry->luma_offset);
+	vs_trace_val(tr, entry->chroma_weight_flag);
+	vs_trace_vals(tr, entry->chroma_weight, 2);
+	vs_trace_vals(tr, entry->chroma_offset, 2);
+}
+
+static void h264_trace_pred_weight_table(struct vs_trace *tr, struct h264_slice *slice, struct h264_pred_weight_table *table) {
+	int i;
+	vs_trace_val(tr, table->luma_log2_weight_denom);
+	vs_trace_val(tr, table->chroma_log2_weight_denom);
+	for (i = 0; i <= slice->num_ref_idx_l0_active_minus1; i++)
+		h264_trace_pred_weight(tr, &table->l0[i]);
+	if (slice->slice_type == H264_SLICE_TYPE_B)
+		for (i = 0; i <= slice->num_ref_idx_l1_active_minus1; i++)
+			h264_trace_pred_weight(tr, &table->l1[i]);
+}
+
+static void h264_trace_mmcos(struct vs_trace *tr, struct h264_mmco_entry *mmcos) {
+	int i = 0;
+	do {
+		vs_trace_val(tr, mmcos[i].memory_management_control_operation);
+		switch (mmcos[i].memory_management_control_operation) {
+			case H264_MMCO_FORGET_SHORT:
+				vs_trace_val(tr, mmcos[i].difference_of_pic_nums_minus1);
+				break;
+			case H264_MMCO_FORGET_LONG:
+				vs_trace_val(tr, mmcos[i].long_term_pic_num);
+				break;
+			case H264_MMCO_SHORT_TO_LONG:
+				vs_trace_val(tr, mmcos[i].difference_of_pic_nums_minus1);
+				vs_trace_val(tr, mmcos[i].long_term_frame_idx);
+				break;
+			case H264_MMCO_FORGET_LONG_MANY:
+				vs_trace_val(tr, mmcos[i].max_long_term_frame_idx_plus1);
+				break;
+			case H264_MMCO_THIS_TO_LONG:
+				vs_trace_val(tr, mmcos[i].long_term_frame_idx);
+				break;
+		}
+	} while (mmcos[i++].memory_management_control_operation != H264_MMCO_END);
+}
+
+void h264_trace_slice_header(struct vs_trace *tr, struct h264_slice *slice) {
+	vs_trace_begin(tr, VS_TRACE_H264_SLICE_HEADER);
+	vs_trace_val(tr, slice->first_mb_in_slice);
+	vs_trace_val(tr, slice->slice_type + slice->slice_all_same * 5);
+	vs_trace_val(tr, slice->picparm->pic_parameter_set_id);
+	if (slice->seqparm->separate_colour_plane_flag)
+		vs_trace_val(tr, slice->colour_plane_id);
+	vs_trace_val(tr, slice->frame_num);
+	vs_trace_val(tr, slice->field_pic_flag);
+	vs_trace_val(tr, slice->bottom_field_flag);
+	if (slice->idr_pic_flag)
+		vs_trace_val(tr, slice->idr_pic_id);
+	switch (slice->seqparm->pic_order_cnt_type) {
+		case 0:
+			vs_trace_val(tr, slice->pic_order_cnt_lsb);
+			vs_trace_val(tr, slice->delta_pic_order_cnt_bottom);
+			break;
+		case 1:
+			vs_trace_vals(tr, slice->delta_pic_order_cnt, 2);
+			break;
+	}
+	vs_trace_val(tr, slice->redundant_pic_cnt);
+	if (slice->slice_type == H264_SLICE_TYPE_B)
+		vs_trace_val(tr, slice->direct_spatial_mb_pred_flag);
+	if (slice->slice_type != H264_SLICE_TYPE_I && slice->slice_type != H264_SLICE_TYPE_SI) {
+		vs_trace_val(tr, slice->num_ref_idx_active_override_flag);
+		vs_trace_val(tr, slice->num_ref_idx_l0_active_minus1);
+		if (slice->slice_type == H264_SLICE_TYPE_B)
+			vs_trace_val(tr, slice->num_ref_idx_l1_active_minus1);
+		h264_trace_ref_pic_list_modification(tr, &slice->ref_pic_list_modification_l0);
+		if (slice->slice_type == H264_SLICE_TYPE_B)
+			h264_trace_ref_pic_list_modification(tr, &slice->ref_pic_list_modification_l1);
+	}
+	if ((slice->picparm->weighted_pred_flag && (slice->slice_type == H264_SLICE_TYPE_P || slice->slice_type == H264_SLICE_TYPE_SP)) || (slice->picparm->weighted_bipred_idc == 1 && slice->slice_type == H264_SLICE_TYPE_B)) {
+		vs_trace_val(tr, slice->base_pred_weight_table_flag);
+		if (!slice->base_pred_weight_table_flag)
+			h264_trace_pred_weight_table(tr, slice, &slice->pred_weight_table);
+	}
+	if (slice->nal_ref_idc) {
+		struct h264_dec_ref_pic_marking *ref = &slice->dec_ref_pic_marking;
+		if (slice->idr_pic_flag) {
+			vs_trace_val(tr, ref->no_output_of_prior_pics_flag);
+			vs_trace_val(tr, ref->long_term_reference_flag);
+		} else {
+			vs_trace_val(tr, ref->adaptive_ref_pic_marking_mode_flag);
+			if (ref->adaptive_ref_pic_marking_mode_flag)
+				h264_trace_mmcos(tr, ref->mmcos);
+		}
+		if (slice->seqparm->is_svc && !slice->seqparm->slice_header_restriction_flag) {
+			struct h264_dec_ref_base_pic_marking *bref = &slice->dec_ref_base_pic_marking;
+			vs_trace_val(tr, bref->store_ref_base_pic_flag);
+			if ((slice->svc.use_ref_base_pic_flag || bref->store_ref_base_pic_flag) && !slice->svc.idr_flag) {
+				vs_trace_val(tr, bref->adaptive_ref_base_pic_marking_mode_flag);
+				if (bref->adaptive_ref_base_pic_marking_mode_flag)
+					h264_trace_mmcos(tr, bref->mmcos);
+			}
+		}
+	}
+	if (slice->slice_type != H264_SLICE_TYPE_I && slice->slice_type != H264_SLICE_TYPE_SI)
+		vs_trace_val(tr, slice->cabac_init_idc);
+	vs_trace_val(tr, slice->slice_qp_delta);
+	if (slice->slice_type == H264_SLICE_TYPE_SP)
+		vs_trace_val(tr, slice->sp_for_switch_flag);
+	if (slice->slice_type == H264_SLICE_TYPE_SP || slice->slice_type == H264_SLICE_TYPE_SI)
+		vs_trace_val(tr, slice->slice_qs_delta);
+	vs_trace_val(tr, slice->disable_deblocking_filter_idc);
+	vs_trace_val(tr, slice->slice_alpha_c0_offset_div2);
+	vs_trace_val(tr, slice->slice_beta_offset_div2);
+	if (slice->picparm->num_slice_groups_minus1 && slice->picparm->slice_group_map_type >= 3 && slice->picparm->slice_group_map_type <= 5)
+		vs_trace_val(tr, slice->slice_group_change_cycle);
+	vs_trace_end(tr);
+}
+
+static void h264_trace_macroblock(struct vs_trace *tr, struct h264_slice *slice, struct h264_macroblock *mb, int addr) {
+	int i, j, n;
+	vs_trace_begin(tr, VS_TRACE_H264_MACROBLOCK);
+	vs_trace_val(tr, addr);
+	vs_trace_val(tr, mb->mb_field_decoding_flag);
+	vs_trace_val(tr, mb->mb_type);
+	if (mb->mb_type == H264_MB_TYPE_I_PCM) {
+		static const int chroma_pcm[4] = { 0, 128, 256, 512 };
+		vs_trace_uvals(tr, mb->pcm_sample_luma, 256);
+		vs_trace_uvals(tr, mb->pcm_sample_chroma, chroma_pcm[slice->chroma_array_type]);
+		vs_trace_end(tr);
+		return;
+	}
+	if (h264_is_submb_mb_type(mb->mb_type))
+		vs_trace_uvals(tr, mb->sub_mb_type, 4);
+	if (mb->mb_type >= H264_MB_TYPE_B_BASE)
+		n = 2;
+	else if (mb->mb_type >= H264_MB_TYPE_P_BASE)
+		n = 1;
+	else
+		n = 0;
+	for (i = 0; i < n; i++) {
+		vs_trace_uvals(tr, mb->ref_idx[i], 4);
+		vs_trace_vals(tr, mb->mvd[i][0], 32);
+	}
+	vs_trace_val(tr, mb->transform_size_8x8_flag);
+	vs_trace_val(tr, mb->coded_block_pattern);
+	if (mb->mb_type == H264_MB_TYPE_I_NXN || mb->mb_type == H264_MB_TYPE_SI) {
+		if (mb->transform_size_8x8_flag) {
+			for (i = 0; i < 4; i++) {
+				vs_trace_val(tr, mb->prev_intra8x8_pred_mode_flag[i]);
+				if (!mb->prev_intra8x8_pred_mode_flag[i])
+					vs_trace_val(tr, mb->rem_intra8x8_pred_mode[i]);
+			}
+		} else {
+			for (i = 0; i < 16; i++) {
+				vs_trace_val(tr, mb->prev_intra4x4_pred_mode_flag[i]);
+				if (!mb->prev_intra4x4_pred_mode_flag[i])
+					vs_trace_val(tr, mb->rem_intra4x4_pred_mode[i]);
+			}
+		}
+	}
+	if (mb->mb_type < H264_MB_TYPE_P_BASE)
+		vs_trace_val(tr, mb->intra_chroma_pred_mode);
+	vs_trace_val(tr, mb->mb_qp_delta);
+	n = (slice->chroma_array_type == 3 ? 3 : 1);
+	for (i = 0; i < n; i++) {
+		if (h264_is_intra_16x16_mb_type(mb->mb_type)) {
+			vs_trace_vals(tr, mb->block_luma_dc[i], 16);
+			vs_trace_vals(tr, mb->block_luma_ac[i][0], 16 * 15);
+		} else if (mb->transform_size_8x8_flag) {
+			vs_trace_vals(tr, mb->block_luma_8x8[i][0], 4 * 64);
+		} else {
+			vs_trace_vals(tr, mb->block_luma_4x4[i][0], 16 * 16);
+		}
+	}
+	if (slice->chroma_array_type == 1 || slice->chroma_array_type == 2) {
+		for (i = 0; i < 2; i++) {
+			vs_trace_vals(tr, mb->block_chroma_dc[i], slice->chroma_array_type * 4);
+			for (j = 0; j < slice->chroma_array_type * 4; j++)
+				vs_trace_vals(tr, mb->block_chroma_ac[i][j], 15);
+		}
+	}
+	vs_trace_end(tr);
+}
+
+void h264_trace_slice_data(struct vs_trace *tr, struct h264_slice *slice) {
+	int mb = slice->first_mb_in_slice * (1 + slice->mbaff_frame_flag);
+	while (1) {
+		h264_trace_macroblock(tr, slice, &slice->mbs[mb], mb);
+		if (mb == slice->last_mb_in_slice)
+			break;
+		mb = h264_next_mb_addr(slice, mb);
+	}
+}
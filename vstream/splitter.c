@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2016 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "vstream.h"
+#include "util.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#define VS_SPLITTER_CHUNK 0x100000
+
+int vs_find_start(const uint8_t *bytes, int num) {
+	/* look for the 01 byte first - memchr is much faster than walking the buffer by hand. */
+	int pos = 2;
+	while (pos < num) {
+		const uint8_t *p = memchr(bytes + pos, 1, num - pos);
+		if (!p)
+			return -1;
+		pos = p - bytes;
+		if (!bytes[pos-1] && !bytes[pos-2])
+			return pos - 2;
+		pos++;
+	}
+	return -1;
+}
+
+struct vs_splitter *vs_new_splitter(FILE *file) {
+	struct vs_splitter *res = calloc(sizeof *res, 1);
+	res->file = file;
+	res->bufmax = VS_SPLITTER_CHUNK;
+	res->buf = malloc(res->bufmax);
+	return res;
+}
+
+static int vs_splitter_fill(struct vs_splitter *sp) {
+	if (sp->start) {
+		memmove(sp->buf, sp->buf + sp->start, sp->bufnum - sp->start);
+		sp->bufnum -= sp->start;
+		sp->scanpos -= sp->start;
+		sp->start = 0;
+	}
+	if (sp->bufmax - sp->bufnum < VS_SPLITTER_CHUNK / 2) {
+		sp->bufmax *= 2;
+		sp->buf = realloc(sp->buf, sp->bufmax);
+	}
+	size_t num = fread(sp->buf + sp->bufnum, 1, sp->bufmax - sp->bufnum, sp->file);
+	if (!num) {
+		if (ferror(sp->file))
+			perror("fread");
+		sp->eof = 1;
+		return 1;
+	}
+	sp->bufnum += num;
+	return 0;
+}
+
+int vs_splitter_next(struct vs_splitter *sp, uint8_t **bytes, int *bytesnum) {
+	while (1) {
+		/* a start code right at sp->start can't overlap another one at +1 or +2 */
+		if (sp->scanpos < sp->start + 1)
+			sp->scanpos = sp->start + 1;
+		int idx = -1;
+		if (sp->scanpos < sp->bufnum)
+			idx = vs_find_start(sp->buf + sp->scanpos, sp->bufnum - sp->scanpos);
+		if (idx != -1) {
+			*bytes = sp->buf + sp->start;
+			*bytesnum = sp->scanpos + idx - sp->start;
+			sp->start = sp->scanpos + idx;
+			sp->scanpos = sp->start + 1;
+			return 1;
+		}
+		if (sp->eof) {
+			if (sp->start >= sp->bufnum)
+				return 0;
+			*bytes = sp->buf + sp->start;
+			*bytesnum = sp->bufnum - sp->start;
+			sp->start = sp->bufnum;
+			return 1;
+		}
+		/* keep the last two bytes - they may be the beginning of a start code */
+		if (sp->bufnum - 2 > sp->scanpos)
+			sp->scanpos = sp->bufnum - 2;
+		vs_splitter_fill(sp);
+	}
+}
+
+void vs_del_splitter(struct vs_splitter *sp) {
+	free(sp->buf);
+	free(sp);
+}
+
+uint8_t *vs_read_all(FILE *file, int *bytesnum) {
+	int bytesmax = VS_SPLITTER_CHUNK;
+	uint8_t *bytes = malloc(bytesmax);
+	size_t num;
+	*bytesnum = 0;
+	while ((num = fread(bytes + *bytesnum, 1, bytesmax - *bytesnum, file))) {
+		*bytesnum += num;
+		if (*bytesnum == bytesmax) {
+			bytesmax *= 2;
+			bytes = realloc(bytes, bytesmax);
+		}
+	}
+	if (ferror(file))
+		perror("fread");
+	return bytes;
+}
@@ -0,0 +1,102 @@
+#include "vstream.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static int ref_find_start(const uint8_t *bytes, int num) {
+	int i;
+	for (i = 0; i + 2 < num; i++)
+		if (!bytes[i] && !bytes[i+1] && bytes[i+2] == 1)
+			return i;
+	return -1;
+}
+
+/* compares the fast start code search against a trivial one on biased random data */
+static int test_find_start(void) {
+	uint8_t buf[300];
+	int iter, i;
+	srand(1);
+	for (iter = 0; iter < 2000; iter++) {
+		int num = rand() % sizeof buf;
+		for (i = 0; i < num; i++)
+			buf[i] = rand() % 4 ? rand() % 3 : rand();
+		for (i = 0; i <= num; i++) {
+			if (vs_find_start(buf + i, num - i) != ref_find_start(buf + i, num - i)) {
+				fprintf (stderr, "Fail: vs_find_start iteration %d offset %d\n", iter, i);
+				return 1;
+			}
+		}
+		struct bitstream *str = vs_new_decode(VS_H262, buf, num);
+		int pos = 0;
+		while (vs_search_start(str)) {
+			int ref = ref_find_start(buf + pos, num - pos);
+			if (ref == -1 || str->bytepos != pos + ref + 2) {
+				fprintf (stderr, "Fail: vs_search_start iteration %d at %d\n", iter, str->bytepos);
+				return 1;
+			}
+			pos = ++str->bytepos;
+			str->zero_bytes = 0;
+		}
+		if (ref_find_start(buf + pos, num - pos) != -1) {
+			fprintf (stderr, "Fail: vs_search_start iteration %d missed a start code\n", iter);
+			return 1;
+		}
+		free(str);
+	}
+	return 0;
+}
+
+int main() {
+	if (test_find_start())
+		return 1;
+	FILE *f = tmpfile();
+	if (!f) {
+		perror("tmpfile");
+		return 1;
+	}
+	/* leading junk, then units of varying sizes - some larger than the read chunk */
+	static const int sizes[] = { 1, 0, 100, 0x123456, 7, 0x100000 - 3, 2, 0x250000, 5 };
+	int nunits = sizeof sizes / sizeof sizes[0];
+	int i, j;
+	fputs("junk", f);
+	for (i = 0; i < nunits; i++) {
+		fputc(0, f);
+		fputc(0, f);
+		fputc(1, f);
+		fputc(i, f);
+		for (j = 0; j < sizes[i]; j++)
+			fputc(j % 3 ? 0 : 0x80 | (j & 0x7f), f);
+	}
+	rewind(f);
+	struct vs_splitter *sp = vs_new_splitter(f);
+	uint8_t *bytes;
+	int bytesnum;
+	if (!vs_splitter_next(sp, &bytes, &bytesnum) || bytesnum != 4) {
+		fprintf (stderr, "Fail: junk\n");
+		return 1;
+	}
+	for (i = 0; i < nunits; i++) {
+		if (!vs_splitter_next(sp, &bytes, &bytesnum)) {
+			fprintf (stderr, "Fail: unit %d missing\n", i);
+			return 1;
+		}
+		if (bytesnum != sizes[i] + 4 || bytes[0] || bytes[1] || bytes[2] != 1 || bytes[3] != i) {
+			fprintf (stderr, "Fail: unit %d size %d\n", i, bytesnum);
+			return 1;
+		}
+		struct bitstream *str = vs_new_decode(VS_H264, bytes, bytesnum);
+		uint32_t val;
+		if (vs_start(str, &val) || val != i) {
+			fprintf (stderr, "Fail: unit %d start code\n", i);
+			return 1;
+		}
+		free(str);
+	}
+	if (vs_splitter_next(sp, &bytes, &bytesnum)) {
+		fprintf (stderr, "Fail: trailing unit\n");
+		return 1;
+	}
+	vs_del_splitter(sp);
+	fclose(f);
+	fprintf (stderr, "All ok!\n");
+	return 0;
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2016 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "vstream.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+int main() {
+	static const int32_t vals[] = { 0, 1, -1, 63, -64, 64, 127, 128, -129, 0x12345678, INT32_MAX, INT32_MIN };
+	int nvals = sizeof vals / sizeof *vals;
+	int i, j;
+	FILE *f = tmpfile();
+	struct vs_trace *tr = vs_trace_new(f);
+	vs_trace_unit(tr, 0xb3);
+	/* large enough for a multi-byte length */
+	vs_trace_begin(tr, VS_TRACE_H264_MACROBLOCK);
+	for (i = 0; i < 100; i++)
+		vs_trace_vals(tr, vals, nvals);
+	vs_trace_end(tr);
+	vs_trace_error(tr);
+	vs_trace_del(tr);
+	rewind(f);
+	struct vs_trace_record rec = { 0 };
+	if (vs_trace_read_header(f)) {
+		fprintf (stderr, "Fail: header\n");
+		return 1;
+	}
+	if (vs_trace_read(f, &rec) != 1 || rec.tag != VS_TRACE_UNIT || rec.valsnum != 1 || rec.vals[0] != 0xb3) {
+		fprintf (stderr, "Fail: unit record\n");
+		return 1;
+	}
+	if (vs_trace_read(f, &rec) != 1 || rec.tag != VS_TRACE_H264_MACROBLOCK || rec.valsnum != 100 * nvals) {
+		fprintf (stderr, "Fail: macroblock record\n");
+		return 1;
+	}
+	for (i = 0; i < 100; i++)
+		for (j = 0; j < nvals; j++)
+			if (rec.vals[i * nvals + j] != vals[j]) {
+				fprintf (stderr, "Fail: value %d: %d != %d\n", j, rec.vals[i * nvals + j], vals[j]);
+				return 1;
+			}
+	if (vs_trace_read(f, &rec) != 1 || rec.tag != VS_TRACE_ERROR || rec.valsnum != 0) {
+		fprintf (stderr, "Fail: error record\n");
+		return 1;
+	}
+	if (vs_trace_read(f, &rec) != 0) {
+		fprintf (stderr, "Fail: trailing record\n");
+		return 1;
+	}
+	vs_trace_record_fini(&rec);
+	fclose(f);
+	fprintf (stderr, "All ok!\n");
+	return 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2016 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "vstream.h"
+#include "util.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+/*
+ * File layout: "VSTR", version byte, then records.  Each record is a tag byte,
+ * payload length in bytes, and the payload: a sequence of values.  All
+ * numbers are LEB128 varints, values are zigzag-encoded first so that small
+ * negative numbers stay small.
+ */
+
+static const char vs_trace_magic[4] = "VSTR";
+
+static void vs_trace_byte(struct vs_trace *tr, uint8_t byte) {
+	uint8_t *bytes = tr->buf;
+	int bytesnum = tr->bufnum;
+	int bytesmax = tr->bufmax;
+	ADDARRAY(bytes, byte);
+	tr->buf = bytes;
+	tr->bufnum = bytesnum;
+	tr->bufmax = bytesmax;
+}
+
+static void vs_trace_varint(struct vs_trace *tr, uint32_t val) {
+	while (val >= 0x80) {
+		vs_trace_byte(tr, val | 0x80);
+		val >>= 7;
+	}
+	vs_trace_byte(tr, val);
+}
+
+struct vs_trace *vs_trace_new(FILE *file) {
+	struct vs_trace *res = calloc(sizeof *res, 1);
+	res->file = file;
+	fwrite(vs_trace_magic, sizeof vs_trace_magic, 1, file);
+	fputc(VS_TRACE_VERSION, file);
+	return res;
+}
+
+void vs_trace_begin(struct vs_trace *tr, enum vs_trace_tag tag) {
+	tr->tag = tag;
+	tr->bufnum = 0;
+}
+
+void vs_trace_val(struct vs_trace *tr, int32_t val) {
+	vs_trace_varint(tr, (uint32_t)val << 1 ^ (uint32_t)(val >> 31));
+}
+
+void vs_trace_vals(struct vs_trace *tr, const int32_t *vals, int num) {
+	int i;
+	for (i = 0; i < num; i++)
+		vs_trace_val(tr, vals[i]);
+}
+
+void vs_trace_uvals(struct vs_trace *tr, const uint32_t *vals, int num) {
+	int i;
+	for (i = 0; i < num; i++)
+		vs_trace_val(tr, vals[i]);
+}
+
+void vs_trace_end(struct vs_trace *tr) {
+	uint8_t hdr[6];
+	int hdrnum = 0;
+	uint32_t len = tr->bufnum;
+	hdr[hdrnum++] = tr->tag;
+	while (len >= 0x80) {
+		hdr[hdrnum++] = len | 0x80;
+		len >>= 7;
+	}
+	hdr[hdrnum++] = len;
+	fwrite(hdr, hdrnum, 1, tr->file);
+	fwrite(tr->buf, tr->bufnum, 1, tr->file);
+}
+
+void vs_trace_unit(struct vs_trace *tr, uint32_t start_code) {
+	vs_trace_begin(tr, VS_TRACE_UNIT);
+	vs_trace_val(tr, start_code);
+	vs_trace_end(tr);
+}
+
+void vs_trace_error(struct vs_trace *tr) {
+	vs_trace_begin(tr, VS_TRACE_ERROR);
+	vs_trace_end(tr);
+}
+
+void vs_trace_del(struct vs_trace *tr) {
+	fflush(tr->file);
+	free(tr->buf);
+	free(tr);
+}
+
+static int vs_trace_read_varint(const uint8_t *bytes, int num, int *pos, uint32_t *val) {
+	int shift = 0;
+	*val = 0;
+	while (1) {
+		if (*pos >= num || shift > 28)
+			return 1;
+		uint8_t byte = bytes[(*pos)++];
+		*val |= (uint32_t)(byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+			return 0;
+		shift += 7;
+	}
+}
+
+int vs_trace_read_header(FILE *file) {
+	char magic[4];
+	int version;
+	if (fread(magic, sizeof magic, 1, file) != 1 || memcmp(magic, vs_trace_magic, sizeof magic)) {
+		fprintf(stderr, "Not a vstream trace file\n");
+		return 1;
+	}
+	version = fgetc(file);
+	if (version != VS_TRACE_VERSION) {
+		fprintf(stderr, "Unsupported trace version %d\n", version);
+		return 1;
+	}
+	return 0;
+}
+
+int vs_trace_read(FILE *file, struct vs_trace_record *rec) {
+	int c = fgetc(file);
+	if (c == EOF)
+		return 0;
+	rec->tag = c;
+	uint32_t len = 0;
+	int shift = 0;
+	do {
+		if ((c = fgetc(file)) == EOF || shift > 28) {
+			fprintf(stderr, "Truncated trace record\n");
+			return -1;
+		}
+		len |= (uint32_t)(c & 0x7f) << shift;
+		shift += 7;
+	} while (c & 0x80);
+	if (len > rec->bytesmax) {
+		rec->bytesmax = len;
+		rec->bytes = realloc(rec->bytes, len);
+	}
+	if (len && fread(rec->bytes, len, 1, file) != 1) {
+		fprintf(stderr, "Truncated trace record\n");
+		return -1;
+	}
+	rec->bytesnum = len;
+	/* every value takes at least a byte, so this is enough */
+	if (len > rec->valsmax) {
+		rec->valsmax = len;
+		rec->vals = realloc(rec->vals, len * sizeof *rec->vals);
+	}
+	int pos = 0;
+	rec->valsnum = 0;
+	while (pos < len) {
+		uint32_t val;
+		if (vs_trace_read_varint(rec->bytes, len, &pos, &val)) {
+			fprintf(stderr, "Malformed trace record\n");
+			return -1;
+		}
+		rec->vals[rec->valsnum++] = (int32_t)(val >> 1 ^ -(val & 1));
+	}
+	return 1;
+}
+
+void vs_trace_record_fini(struct vs_trace_record *rec) {
+	free(rec->bytes);
+	free(rec->vals);
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2016 Marcin Kościelnicki <koriakin@0x04.net>
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "vstream.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Dumps a binary trace written by deh262/deh264 -t, or compares two of them
+ * and reports where they first diverge.
+ */
+
+static const char *const tagnames[] = {
+	[VS_TRACE_UNIT] = "UNIT",
+	[VS_TRACE_ERROR] = "ERROR",
+	[VS_TRACE_H264_SEQPARM] = "H264_SEQPARM",
+	[VS_TRACE_H264_SEQPARM_EXT] = "H264_SEQPARM_EXT",
+	[VS_TRACE_H264_PICPARM] = "H264_PICPARM",
+	[VS_TRACE_H264_SLICE_HEADER] = "H264_SLICE_HEADER",
+	[VS_TRACE_H264_MACROBLOCK] = "H264_MACROBLOCK",
+	[VS_TRACE_H262_SEQPARM] = "H262_SEQPARM",
+	[VS_TRACE_H262_PICPARM] = "H262_PICPARM",
+	[VS_TRACE_H262_GOP] = "H262_GOP",
+	[VS_TRACE_H262_SLICE] = "H262_SLICE",
+	[VS_TRACE_H262_MACROBLOCK] = "H262_MACROBLOCK",
+};
+
+static const char *tagname(int tag) {
+	if (tag < sizeof tagnames / sizeof *tagnames && tagnames[tag])
+		return tagnames[tag];
+	return "???";
+}
+
+static FILE *open_trace(const char *name) {
+	FILE *file = fopen(name, "rb");
+	if (!file) {
+		perror(name);
+		return 0;
+	}
+	if (vs_trace_read_header(file)) {
+		fclose(file);
+		return 0;
+	}
+	return file;
+}
+
+static int dump(FILE *file) {
+	struct vs_trace_record rec = { 0 };
+	int idx = 0;
+	int res, i;
+	while ((res = vs_trace_read(file, &rec)) > 0) {
+		printf("%d: %s:", idx++, tagname(rec.tag));
+		for (i = 0; i < rec.valsnum; i++)
+			printf(" %d", rec.vals[i]);
+		printf("\n");
+	}
+	vs_trace_record_fini(&rec);
+	return res < 0;
+}
+
+static int diff(FILE *fa, FILE *fb) {
+	struct vs_trace_record ra = { 0 }, rb = { 0 };
+	int idx, i, resa, resb;
+	int res = 0;
+	for (idx = 0; ; idx++) {
+		resa = vs_trace_read(fa, &ra);
+		resb = vs_trace_read(fb, &rb);
+		if (resa < 0 || resb < 0) {
+			res = 2;
+			break;
+		}
+		if (!resa || !resb) {
+			if (resa != resb) {
+				printf("record %d: %s only in %s trace\n", idx, tagname(resa ? ra.tag : rb.tag), resa ? "first" : "second");
+				res = 1;
+			}
+			break;
+		}
+		if (ra.tag != rb.tag) {
+			printf("record %d: tag %s vs %s\n", idx, tagname(ra.tag), tagname(rb.tag));
+			res = 1;
+			break;
+		}
+		/* quick path - records with identical encodings are equal */
+		if (ra.bytesnum == rb.bytesnum && !memcmp(ra.bytes, rb.bytes, ra.bytesnum))
+			continue;
+		for (i = 0; i < ra.valsnum && i < rb.valsnum; i++)
+			if (ra.vals[i] != rb.vals[i])
+				break;
+		if (i < ra.valsnum && i < rb.valsnum)
+			printf("record %d: %s value %d: %d vs %d\n", idx, tagname(ra.tag), i, ra.vals[i], rb.vals[i]);
+		else
+			printf("record %d: %s length %d vs %d\n", idx, tagname(ra.tag), ra.valsnum, rb.valsnum);
+		res = 1;
+		break;
+	}
+	vs_trace_record_fini(&ra);
+	vs_trace_record_fini(&rb);
+	return res;
+}
+
+int main(int argc, char **argv) {
+	FILE *fa, *fb;
+	int res;
+	if (argc != 2 && argc != 3) {
+		fprintf(stderr, "Usage: %s <trace> [<trace>]\n", argv[0]);
+		return 2;
+	}
+	if (!(fa = open_trace(argv[1])))
+		return 2;
+	if (argc == 2) {
+		res = dump(fa);
+	} else {
+		if (!(fb = open_trace(argv[2])))
+			return 2;
+		res = diff(fa, fb);
+		fclose(fb);
+	}
+	fclose(fa);
+	return res;
+}